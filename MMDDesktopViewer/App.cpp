@@ -9,6 +9,7 @@
 #include "ProgressWindow.hpp"
 #include "MediaAudioAnalyzer.hpp"
 #include "StringUtil.hpp"
+#include "JobSystem.hpp"
 #include <algorithm>
 #include <format>
 #include <thread>
@@ -331,6 +332,8 @@ void App::StartLoadingModel(const std::filesystem::path& path)
 	// ワーカースレッド起動
 	m_loadThread = std::jthread([this, path](std::stop_token stopToken) {
 		HRESULT hr = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+		// 読み込みのジョブを描画スレッドが待ち合わせ中に拾わないよう、専用のキューを使う
+		JobSystem::ExternalThreadScope jobScope(JobSystem::Shared());
 
 		auto result = std::make_unique<ModelLoadResult>();
 
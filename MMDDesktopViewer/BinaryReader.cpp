@@ -2,7 +2,132 @@
 #include <fstream>
 #include <stdexcept>
 
+#if defined _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	void CheckFileSize(std::uint64_t size)
+	{
+#if defined _M_IX86 && !defined X86_NO_SAFE_MEMORY_SIZE
+		if (size > 1ull * 1024 * 1024 * 1024)
+		{
+			throw std::runtime_error("The model file is too large.");
+		}
+#else
+		(void)size;
+#endif
+	}
+}
+
 BinaryReader::BinaryReader(const std::filesystem::path& path)
+{
+	if (!TryMapFile(path))
+	{
+		ReadWholeFile(path);
+	}
+}
+
+BinaryReader::BinaryReader(std::span<const std::uint8_t> data)
+	: m_data(data.data())
+	, m_size(data.size())
+{
+}
+
+BinaryReader::~BinaryReader()
+{
+	if (!m_mappedView) return;
+
+#if defined _WIN32
+	UnmapViewOfFile(m_mappedView);
+#else
+	munmap(m_mappedView, m_size);
+#endif
+	m_mappedView = nullptr;
+}
+
+bool BinaryReader::TryMapFile(const std::filesystem::path& path)
+{
+#if defined _WIN32
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+							  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0)
+	{
+		// 空ファイルはマップできないのでフォールバックへ
+		CloseHandle(file);
+		return false;
+	}
+
+	try
+	{
+		CheckFileSize(static_cast<std::uint64_t>(size.QuadPart));
+	}
+	catch (...)
+	{
+		CloseHandle(file);
+		throw;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (!mapping) return false;
+
+	// ビューはマッピングハンドルを閉じても有効
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!view) return false;
+
+	m_mappedView = view;
+	m_data = static_cast<const std::uint8_t*>(view);
+	m_size = static_cast<size_t>(size.QuadPart);
+	return true;
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat st{};
+	if (::fstat(fd, &st) != 0 || st.st_size <= 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	try
+	{
+		CheckFileSize(static_cast<std::uint64_t>(st.st_size));
+	}
+	catch (...)
+	{
+		::close(fd);
+		throw;
+	}
+
+	void* view = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (view == MAP_FAILED) return false;
+
+	::madvise(view, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+
+	m_mappedView = view;
+	m_data = static_cast<const std::uint8_t*>(view);
+	m_size = static_cast<size_t>(st.st_size);
+	return true;
+#endif
+}
+
+void BinaryReader::ReadWholeFile(const std::filesystem::path& path)
 {
 	std::ifstream ifs(path, std::ios::binary);
 	if (!ifs) throw std::runtime_error("Failed to open file.");
@@ -13,12 +138,7 @@ BinaryReader::BinaryReader(const std::filesystem::path& path)
 
 	if (size < 0) throw std::runtime_error("Invalid file size.");
 
-#if defined _M_IX86 && !defined X86_NO_SAFE_MEMORY_SIZE
-	if (size > 1 * 1024 * 1024 * 1024)
-	{
-		throw std::runtime_error("The model file is too large.");
-	}
-#endif
+	CheckFileSize(static_cast<std::uint64_t>(size));
 
 	m_buf.resize(static_cast<size_t>(size));
 	if (!m_buf.empty())
@@ -26,38 +146,41 @@ BinaryReader::BinaryReader(const std::filesystem::path& path)
 		ifs.read(reinterpret_cast<char*>(m_buf.data()), size);
 		if (!ifs) throw std::runtime_error("Failed to read file.");
 	}
-}
 
-size_t BinaryReader::Remaining() const
-{
-	if (m_pos > m_buf.size()) return 0;
-	return m_buf.size() - m_pos;
+	m_data = m_buf.data();
+	m_size = m_buf.size();
 }
 
 void BinaryReader::Seek(size_t pos)
 {
-	if (pos > m_buf.size()) throw std::runtime_error("Seek out of range.");
+	if (pos > m_size) throw std::runtime_error("Seek out of range.");
 	m_pos = pos;
 }
 
 void BinaryReader::Skip(size_t bytes)
 {
-	Seek(m_pos + bytes);
+	if (bytes > Remaining()) throw std::runtime_error("Seek out of range.");
+	m_pos += bytes;
 }
 
-std::vector<std::uint8_t> BinaryReader::ReadBytes(size_t n)
+std::span<const std::uint8_t> BinaryReader::ReadSpan(size_t n)
 {
 	if (n > Remaining()) throw std::runtime_error("ReadBytes out of range.");
-	std::vector<std::uint8_t> out(m_buf.begin() + m_pos, m_buf.begin() + m_pos + n);
+	std::span<const std::uint8_t> out(m_data + m_pos, n);
 	m_pos += n;
 	return out;
 }
 
-std::string BinaryReader::ReadStringUtf8WithLength()
+std::span<const std::uint8_t> BinaryReader::ReadSpanWithLength()
 {
 	auto len = Read<std::int32_t>();
 	if (len < 0) throw std::runtime_error("Negative string length.");
-	auto bytes = ReadBytes(static_cast<size_t>(len));
+	return ReadSpan(static_cast<size_t>(len));
+}
+
+std::string BinaryReader::ReadStringUtf8WithLength()
+{
+	auto bytes = ReadSpanWithLength();
 	return std::string(reinterpret_cast<const char*>(bytes.data()), bytes.size());
 }
 
@@ -65,7 +188,7 @@ std::u16string BinaryReader::ReadStringUtf16LeWithLength()
 {
 	auto lenBytes = Read<std::int32_t>();
 	if (lenBytes < 0 || (lenBytes % 2) != 0) throw std::runtime_error("Invalid UTF16 length.");
-	auto bytes = ReadBytes(static_cast<size_t>(lenBytes));
+	auto bytes = ReadSpan(static_cast<size_t>(lenBytes));
 
 	std::u16string s;
 	s.resize(bytes.size() / 2);
@@ -77,24 +200,3 @@ std::u16string BinaryReader::ReadStringUtf16LeWithLength()
 	}
 	return s;
 }
-
-template <class T>
-T BinaryReader::Read()
-{
-	static_assert(std::is_trivially_copyable_v<T>);
-
-	if (sizeof(T) > Remaining()) throw std::runtime_error("Read<T> out of range.");
-
-	T v{};
-	std::memcpy(&v, m_buf.data() + m_pos, sizeof(T));
-	m_pos += sizeof(T);
-	return v;
-}
-
-template std::uint8_t  BinaryReader::Read<std::uint8_t>();
-template std::int32_t  BinaryReader::Read<std::int32_t>();
-template std::uint32_t BinaryReader::Read<std::uint32_t>();
-template float         BinaryReader::Read<float>();
-template std::int8_t   BinaryReader::Read<std::int8_t>();
-template std::int16_t  BinaryReader::Read<std::int16_t>();
-template std::uint16_t BinaryReader::Read<std::uint16_t>();
\ No newline at end of file
@@ -1,38 +1,112 @@
 ﻿#pragma once
 #include <cstdint>
+#include <cstring>
 #include <vector>
 #include <string>
 #include <filesystem>
 #include <span>
+#include <stdexcept>
+#include <type_traits>
 
+// ファイル全体をメモリマップして読み出すリーダー。
+// マップできないソース(空ファイル等)は従来どおり std::vector に読み込んで保持する。
+// ReadBytes / ReadSpan が返す span はリーダーが生存している間のみ有効。
 class BinaryReader
 {
 public:
 	explicit BinaryReader(const std::filesystem::path& path);
+	// 既にメモリ上にあるデータを所有せずに読む (呼び出し側が寿命を保証すること)
+	explicit BinaryReader(std::span<const std::uint8_t> data);
+	~BinaryReader();
 
-	size_t Remaining() const;
+	BinaryReader(const BinaryReader&) = delete;
+	BinaryReader& operator=(const BinaryReader&) = delete;
+
+	size_t Remaining() const
+	{
+		return (m_pos > m_size) ? 0 : (m_size - m_pos);
+	}
 	size_t Position() const
 	{
 		return m_pos;
 	}
+	size_t Size() const
+	{
+		return m_size;
+	}
+	bool IsMapped() const
+	{
+		return m_mappedView != nullptr;
+	}
+
+	// ファイル全体のビュー
+	std::span<const std::uint8_t> Data() const
+	{
+		return { m_data, m_size };
+	}
 
 	void Seek(size_t pos);
 	void Skip(size_t bytes);
 
 	template <class T>
-	T Read();
+	T Read()
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+
+		if (sizeof(T) > Remaining()) throw std::runtime_error("Read<T> out of range.");
+
+		T v{};
+		std::memcpy(&v, m_data + m_pos, sizeof(T));
+		m_pos += sizeof(T);
+		return v;
+	}
+
+	// 固定レイアウトの連続ブロックを一括で読む (アラインメントを問わないので memcpy)
+	template <class T>
+	void ReadArray(T* out, size_t count)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
 
-	std::vector<std::uint8_t> ReadBytes(size_t n);
+		if (count > Remaining() / sizeof(T)) throw std::runtime_error("ReadArray out of range.");
+
+		if (count != 0)
+		{
+			std::memcpy(out, m_data + m_pos, count * sizeof(T));
+		}
+		m_pos += count * sizeof(T);
+	}
+
+	template <class T>
+	std::vector<T> ReadArray(size_t count)
+	{
+		if (count > Remaining() / sizeof(T)) throw std::runtime_error("ReadArray out of range.");
+
+		std::vector<T> out(count);
+		ReadArray(out.data(), count);
+		return out;
+	}
+
+	// コピーせずにビューを返す
+	std::span<const std::uint8_t> ReadSpan(size_t n);
+	std::span<const std::uint8_t> ReadBytes(size_t n)
+	{
+		return ReadSpan(n);
+	}
 
 	std::string ReadStringUtf8WithLength();
 	std::u16string ReadStringUtf16LeWithLength();
 
+	// 長さ付き文字列の本体をビューで返す (デコードは呼び出し側)
+	std::span<const std::uint8_t> ReadSpanWithLength();
+
 private:
-	const std::vector<std::uint8_t>& Buf() const
-	{
-		return m_buf;
-	}
+	bool TryMapFile(const std::filesystem::path& path);
+	void ReadWholeFile(const std::filesystem::path& path);
 
-	std::vector<std::uint8_t> m_buf;
+	const std::uint8_t* m_data{ nullptr };
+	size_t m_size{};
 	size_t m_pos{};
+
+	void* m_mappedView{ nullptr };
+	std::vector<std::uint8_t> m_buf;
 };
@@ -1,8 +1,11 @@
 ﻿#include "BoneSolver.hpp"
+#include "JobSystem.hpp"
 #include <algorithm>
+#include <atomic>
 #include <stdexcept>
 #include <functional>
 #include <cmath>
+#include <cstring>
 #include <string>
 
 #ifndef BONESOLVER_DISABLE_FOOT_IK
@@ -24,6 +27,11 @@
 #define BONESOLVER_MAX_KNEE_DELTA_PER_FRAME_RAD 0.65f
 #endif
 
+#ifndef BONESOLVER_IK_CACHE_EPSILON
+// IK の入力がこの差以内なら前回の結果を使う (位置・行列要素・クォータニオン成分で共通)
+#define BONESOLVER_IK_CACHE_EPSILON 1.0e-5f
+#endif
+
 #ifndef BONESOLVER_DEFAULT_POLE_WORLD_X
 #define BONESOLVER_DEFAULT_POLE_WORLD_X 0.0f
 #endif
@@ -38,6 +46,12 @@ using namespace DirectX;
 
 namespace
 {
+	JobSystem::LoopSite g_resetPoseSite{ "bones.reset_pose" };
+	JobSystem::LoopSite g_skinningSite{ "bones.skinning" };
+	JobSystem::LoopSite g_bindPoseSite{ "bones.bind_pose" };
+	JobSystem::LoopSite g_ikWaveSite{ "bones.ik_wave" };
+	JobSystem::LoopSite g_fkWaveSite{ "bones.fk_wave" };
+
 	// クォータニオン -> オイラー角 (XYZ順)
 	DirectX::XMFLOAT3 QuaternionToEulerXYZ(DirectX::FXMVECTOR q)
 	{
@@ -255,6 +269,13 @@ namespace
 		return 2.0f * std::atan2(t.x, t.w);
 	}
 
+	// ビット単位で同じか (-0 と +0 も区別する。差分更新で「前と同じ結果になる」ことを保証するため)
+	template <class T>
+	bool BitEqual(const T& a, const T& b)
+	{
+		return std::memcmp(&a, &b, sizeof(T)) == 0;
+	}
+
 }
 
 void BoneSolver::Initialize(const PmxModel* model)
@@ -268,6 +289,19 @@ void BoneSolver::Initialize(const PmxModel* model)
 	m_boneNameToIndex.clear();
 	m_sortedBoneOrder.clear();
 	m_boneChildren.clear();
+	m_fkDirty.clear();
+	m_skinningDirty.clear();
+	m_skinningRevisions.clear();
+	m_ikPrograms.clear();
+	m_ikPaths.clear();
+	m_ikWaveOrder.clear();
+	m_ikWaveOffsets.clear();
+	m_ikCaches.clear();
+	m_ikDisabledByPose.clear();
+	m_ikDisabledByUser.clear();
+
+	// 番号は作り直しても戻さない (アップロード側が前のモデルの番号を持っていても取りこぼさないように)
+	++m_skinningRevision;
 
 	m_lastIkDominantEuler.clear();
 	m_hasLastIkDominantEuler.clear();
@@ -315,7 +349,16 @@ void BoneSolver::Initialize(const PmxModel* model)
 	}
 
 	BuildSortedBoneOrder();
+	BuildForwardKinematicsSchedule();
+	BuildIkPrograms();
 	ComputeBindPoseMatrices();
+
+	m_ikDisabledByPose.assign(n, 0);
+	m_ikDisabledByUser.assign(n, 0);
+
+	m_fkDirty.assign(n, 1);
+	m_skinningDirty.assign(n, 1);
+	m_skinningRevisions.assign(n, m_skinningRevision);
 }
 
 void BoneSolver::BuildSortedBoneOrder()
@@ -337,18 +380,88 @@ void BoneSolver::BuildSortedBoneOrder()
 	m_sortedBoneOrder = std::move(indices);
 }
 
-void BoneSolver::ApplyPose(const BonePose& pose)
+void BoneSolver::ApplyPose(const DensePose& pose, std::span<const BoneLocalOffset> offsets)
 {
-	const int n = static_cast<int>(m_boneStates.size());
-#ifdef _OPENMP
-#pragma omp parallel for schedule(static) if(n >= 256)
-#endif
-	for (int i = 0; i < n; ++i)
+	const size_t n = std::min(m_boneStates.size(), pose.BoneCount());
+	size_t offsetCursor = 0;
+	for (size_t i = 0; i < n; ++i)
 	{
-		m_boneStates[i].localTranslation = { 0.0f, 0.0f, 0.0f };
-		m_boneStates[i].localRotation = { 0.0f, 0.0f, 0.0f, 1.0f };
+		if (offsetCursor < offsets.size() && offsets[offsetCursor].boneIndex == i)
+		{
+			const auto& offset = offsets[offsetCursor++];
+			const XMFLOAT3 t = pose.BoneTranslationOrZero(i);
+			const XMFLOAT4 r = pose.BoneRotationOrIdentity(i);
+
+			XMFLOAT3 translation{ t.x + offset.translation.x, t.y + offset.translation.y, t.z + offset.translation.z };
+			XMFLOAT4 rotation;
+			XMStoreFloat4(&rotation, XMQuaternionNormalize(
+				XMQuaternionMultiply(XMLoadFloat4(&offset.rotation), XMLoadFloat4(&r))));
+			SetLocalPose(i, translation, rotation);
+			continue;
+		}
+		SetLocalPose(i, pose.BoneTranslationOrZero(i), pose.BoneRotationOrIdentity(i));
+	}
+	for (size_t i = n; i < m_boneStates.size(); ++i)
+	{
+		SetLocalPose(i, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f });
 	}
 
+	const size_t ikCount = std::min(m_ikDisabledByPose.size(), pose.ikDisabled.size());
+	std::copy_n(pose.ikDisabled.begin(), ikCount, m_ikDisabledByPose.begin());
+	std::fill(m_ikDisabledByPose.begin() + ikCount, m_ikDisabledByPose.end(), uint8_t{ 0 });
+}
+
+void BoneSolver::SetIkEnabled(size_t ikBoneIndex, bool enabled)
+{
+	if (ikBoneIndex >= m_ikDisabledByUser.size())
+	{
+		throw std::out_of_range("BoneSolver::SetIkEnabled: boneIndex out of range");
+	}
+	m_ikDisabledByUser[ikBoneIndex] = enabled ? 0 : 1;
+}
+
+bool BoneSolver::IsIkEnabled(size_t ikBoneIndex) const
+{
+	if (ikBoneIndex >= m_ikDisabledByUser.size()) return false;
+	return !m_ikDisabledByUser[ikBoneIndex] && !m_ikDisabledByPose[ikBoneIndex];
+}
+
+void BoneSolver::SetLocalPose(size_t boneIndex, const XMFLOAT3& translation, const XMFLOAT4& rotation)
+{
+	auto& state = m_boneStates[boneIndex];
+	if (BitEqual(state.localTranslation, translation) && BitEqual(state.localRotation, rotation)) return;
+
+	state.localTranslation = translation;
+	state.localRotation = rotation;
+	MarkPoseChanged(boneIndex);
+}
+
+void BoneSolver::MarkPoseChanged(size_t boneIndex)
+{
+	m_fkDirty[boneIndex] = 1;
+
+	// 付与先はこのボーンのローカル姿勢を読むので一緒に計算し直す
+	for (uint32_t k = m_grantDependentOffsets[boneIndex]; k < m_grantDependentOffsets[boneIndex + 1]; ++k)
+	{
+		m_fkDirty[m_grantDependents[k]] = 1;
+	}
+}
+
+void BoneSolver::MarkAllDirty()
+{
+	std::fill(m_fkDirty.begin(), m_fkDirty.end(), uint8_t{ 1 });
+}
+
+void BoneSolver::ApplyPose(const BonePose& pose)
+{
+	JobSystem::Shared().ParallelFor(g_resetPoseSite, m_boneStates.size(), [this](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+		{
+			m_boneStates[i].localTranslation = { 0.0f, 0.0f, 0.0f };
+			m_boneStates[i].localRotation = { 0.0f, 0.0f, 0.0f, 1.0f };
+		}
+	});
+
 	for (const auto& [name, trans] : pose.boneTranslations)
 	{
 		auto it = m_boneNameToIndex.find(name);
@@ -366,6 +479,10 @@ void BoneSolver::ApplyPose(const BonePose& pose)
 			m_boneStates[it->second].localRotation = rot;
 		}
 	}
+
+	// 名前指定は変化を追わずに全ボーンを計算し直す
+	MarkAllDirty();
+	std::fill(m_ikDisabledByPose.begin(), m_ikDisabledByPose.end(), uint8_t{ 0 });
 }
 
 void BoneSolver::CalculateLocalMatrix(size_t boneIndex)
@@ -427,7 +544,7 @@ void BoneSolver::UpdateGlobalMatrixRecursive(size_t boneIndex)
 	}
 }
 
-void BoneSolver::CalculateSkinningMatrix(size_t boneIndex)
+bool BoneSolver::CalculateSkinningMatrix(size_t boneIndex)
 {
 	auto& state = m_boneStates[boneIndex];
 
@@ -436,16 +553,79 @@ void BoneSolver::CalculateSkinningMatrix(size_t boneIndex)
 
 	XMMATRIX skinningMat = bindInverse * globalMat;
 	XMStoreFloat4x4(&state.skinningMatrix, skinningMat);
-	XMStoreFloat4x4(&m_skinningMatrices[boneIndex], skinningMat);
+
+	// 値が同じならアップロード対象にしない
+	if (BitEqual(state.skinningMatrix, m_skinningMatrices[boneIndex])) return false;
+	m_skinningMatrices[boneIndex] = state.skinningMatrix;
+	return true;
+}
+
+void BoneSolver::UpdateSkinningMatrices()
+{
+	const uint64_t revision = m_skinningRevision + 1;
+	std::atomic<bool> changed{ false };
+	JobSystem::Shared().ParallelFor(g_skinningSite, m_bones.size(), [&](size_t begin, size_t end) {
+		bool any = false;
+		for (size_t i = begin; i < end; ++i)
+		{
+			if (!m_skinningDirty[i]) continue;
+			m_skinningDirty[i] = 0;
+
+			if (CalculateSkinningMatrix(i))
+			{
+				m_skinningRevisions[i] = revision;
+				any = true;
+			}
+		}
+		if (any) changed.store(true, std::memory_order_relaxed);
+	});
+
+	if (changed.load(std::memory_order_relaxed)) m_skinningRevision = revision;
+}
+
+bool BoneSolver::GetSkinningChangedRange(uint64_t sinceRevision, size_t& outBegin, size_t& outEnd) const
+{
+	outBegin = 0;
+	outEnd = 0;
+	if (sinceRevision >= m_skinningRevision) return false;
+
+	const size_t n = m_skinningRevisions.size();
+	size_t begin = 0;
+	while (begin < n && m_skinningRevisions[begin] <= sinceRevision) ++begin;
+	if (begin == n) return false;
+
+	size_t end = n;
+	while (m_skinningRevisions[end - 1] <= sinceRevision) --end;
+
+	outBegin = begin;
+	outEnd = end;
+	return true;
+}
+
+size_t BoneSolver::WriteSkinningPalette(XMFLOAT3X4* dst, size_t capacity, uint64_t sinceRevision) const
+{
+	size_t begin = 0;
+	size_t end = 0;
+	if (!dst || !GetSkinningChangedRange(sinceRevision, begin, end)) return 0;
+	end = std::min(end, capacity);
+
+	size_t written = 0;
+	for (size_t i = begin; i < end; ++i)
+	{
+		// 書き込み先は書き込み結合メモリのことが多いので、変わっていないボーンには触れない
+		if (m_skinningRevisions[i] <= sinceRevision) continue;
+
+		// 最終列は常に (0, 0, 0, 1) なので捨てる。XMStoreFloat3x4 は転置して 3 行を書く
+		XMStoreFloat3x4(&dst[i], XMLoadFloat4x4(&m_skinningMatrices[i]));
+		++written;
+	}
+	return written;
 }
 
 void BoneSolver::ComputeBindPoseMatrices()
 {
-	const int boneCount = static_cast<int>(m_bones.size());
-#ifdef _OPENMP
-#pragma omp parallel for schedule(static) if(boneCount >= 256)
-#endif
-	for (int i = 0; i < boneCount; ++i)
+	const size_t boneCount = m_bones.size();
+	for (size_t i = 0; i < boneCount; ++i)
 	{
 		XMStoreFloat4x4(&m_boneStates[i].localMatrix, XMMatrixIdentity());
 	}
@@ -455,15 +635,14 @@ void BoneSolver::ComputeBindPoseMatrices()
 		CalculateGlobalMatrix(idx);
 	}
 
-#ifdef _OPENMP
-#pragma omp parallel for schedule(static) if(boneCount >= 256)
-#endif
-	for (int i = 0; i < boneCount; ++i)
-	{
-		XMMATRIX bindMat = XMLoadFloat4x4(&m_boneStates[i].globalMatrix);
-		XMMATRIX inv = XMMatrixInverse(nullptr, bindMat);
-		XMStoreFloat4x4(&m_inverseBindMatrices[i], inv);
-	}
+	JobSystem::Shared().ParallelFor(g_bindPoseSite, boneCount, [this](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+		{
+			XMMATRIX bindMat = XMLoadFloat4x4(&m_boneStates[i].globalMatrix);
+			XMMATRIX inv = XMMatrixInverse(nullptr, bindMat);
+			XMStoreFloat4x4(&m_inverseBindMatrices[i], inv);
+		}
+	});
 }
 
 void BoneSolver::ApplyGrantToBone(size_t boneIndex)
@@ -504,67 +683,325 @@ void BoneSolver::ApplyGrantToBone(size_t boneIndex)
 	CalculateLocalMatrix(boneIndex);
 }
 
-void BoneSolver::SolveIK()
+void BoneSolver::BuildIkPrograms()
 {
-	// IKを依存関係と並列化の可否に基づいて分類
-	std::vector<size_t> footIKs;
-	std::vector<size_t> toeIKs;
-	std::vector<size_t> otherIKs;
+	const size_t n = m_bones.size();
+
+	m_ikPrograms.clear();
+	m_ikPaths.clear();
+	m_ikWaveOrder.clear();
+	m_ikWaveOffsets.assign(1, 0);
 
-	footIKs.reserve(2);
-	toeIKs.reserve(2);
-	otherIKs.reserve(8);
+	auto isValid = [n](int32_t index) {
+		return index >= 0 && index < static_cast<int32_t>(n);
+	};
 
-	// m_sortedBoneOrder（親順）を走査して分類
-	// これにより、各リスト内でも基本的な親順（ID順）が保たれる
+	// m_sortedBoneOrder 順 (変形順) に並べる。名前には依存しない。
 	for (size_t idx : m_sortedBoneOrder)
 	{
 		const auto& bone = m_bones[idx];
-		if (!bone.IsIK()) continue;
+		if (!bone.IsIK() || !isValid(bone.ikTargetIndex)) continue;
 
-		if (IsToeIKName(bone.name))
+#if BONESOLVER_DISABLE_FOOT_IK
+		if (IsFootIKName(bone.name)) continue;
+#endif
+#if BONESOLVER_DISABLE_TOE_IK
+		if (IsToeIKName(bone.name)) continue;
+#endif
+
+		IkProgram program;
+		program.ikBone = static_cast<uint32_t>(idx);
+		program.target = static_cast<uint32_t>(bone.ikTargetIndex);
+		program.limitAngle = NormalizeIkUnitAngle(bone.ikLimitAngle);
+		if (program.limitAngle <= 0.0f) program.limitAngle = DirectX::XM_PI;
+		program.loopCount = bone.ikLoopCount;
+
+		// エフェクタから親を辿ったときに通るボーン (エフェクタの親から順に)
+		std::vector<uint32_t> ancestors;
+		for (int32_t cursor = m_fkParent[program.target]; cursor >= 0; cursor = m_fkParent[cursor])
 		{
-			toeIKs.push_back(idx);
+			ancestors.push_back(static_cast<uint32_t>(cursor));
+			if (ancestors.size() > n) break; // 親の循環に備える
 		}
-		else if (IsFootIKName(bone.name))
+
+		std::vector<int32_t> compiledIndex(bone.ikLinks.size(), -1);
+		for (size_t li = 0; li < bone.ikLinks.size(); ++li)
 		{
-			footIKs.push_back(idx);
+			const auto& src = bone.ikLinks[li];
+			if (!isValid(src.boneIndex)) continue;
+
+			IkLink link;
+			link.bone = static_cast<uint32_t>(src.boneIndex);
+			link.hasLimit = src.hasLimit;
+			link.limitMin = src.limitMin;
+			link.limitMax = src.limitMax;
+
+			const float eps = 1.0e-3f;
+			link.axisXOnly = src.hasLimit &&
+				(std::abs(src.limitMin.y) < eps && std::abs(src.limitMax.y) < eps) &&
+				(std::abs(src.limitMin.z) < eps && std::abs(src.limitMax.z) < eps);
+
+			link.pathBegin = static_cast<uint32_t>(m_ikPaths.size());
+			const auto it = std::find(ancestors.begin(), ancestors.end(), link.bone);
+			if (it != ancestors.end())
+			{
+				// リンク直下からエフェクタの親まで (親側から)
+				for (auto p = std::make_reverse_iterator(it); p != ancestors.rend(); ++p)
+				{
+					m_ikPaths.push_back(*p);
+				}
+			}
+			link.pathEnd = static_cast<uint32_t>(m_ikPaths.size());
+
+			compiledIndex[li] = static_cast<int32_t>(program.links.size());
+			program.links.push_back(link);
 		}
-		else
+
+		// 解析的 2 ボーン IK の対象か (root -> hinge -> target の形で、片方だけが X 軸 1 軸制限)
+		if (bone.ikLinks.size() == 2 && compiledIndex[0] >= 0 && compiledIndex[1] >= 0)
+		{
+			auto isAxisXOnly = [](const PmxModel::Bone::IKLink& link) -> bool {
+				if (!link.hasLimit) return false;
+				// YZがほぼゼロ（±0.1deg程度以内）ならXのみとみなす
+				const float eps = 0.00174533f; // 0.1deg in rad
+				const float ymin = std::fabs(MaybeDegreesToRadians(link.limitMin.y));
+				const float ymax = std::fabs(MaybeDegreesToRadians(link.limitMax.y));
+				const float zmin = std::fabs(MaybeDegreesToRadians(link.limitMin.z));
+				const float zmax = std::fabs(MaybeDegreesToRadians(link.limitMax.z));
+				return (ymin < eps && ymax < eps && zmin < eps && zmax < eps);
+			};
+
+			const bool axis0 = isAxisXOnly(bone.ikLinks[0]);
+			const bool axis1 = isAxisXOnly(bone.ikLinks[1]);
+			if (axis0 != axis1)
+			{
+				const int32_t hinge = axis0 ? 0 : 1;
+				const int32_t root = axis0 ? 1 : 0;
+				const uint32_t hingeBone = program.links[hinge].bone;
+				const uint32_t rootBone = program.links[root].bone;
+				if (m_bones[hingeBone].parentIndex == static_cast<int32_t>(rootBone) &&
+					m_bones[program.target].parentIndex == static_cast<int32_t>(hingeBone))
+				{
+					program.hingeLink = hinge;
+					program.rootLink = root;
+				}
+			}
+		}
+
+		// 読み書きするボーン。書き換えるのはリンクの姿勢と、リンク・経路・エフェクタの行列。
+		// 行列を計算し直すボーンは、親の行列と付与元の姿勢も読む。
+		auto& reads = program.reads;
+		auto& writes = program.writes;
+		auto addUpdated = [&](uint32_t b) {
+			writes.push_back(b);
+			reads.push_back(b);
+			if (m_fkParent[b] >= 0) reads.push_back(static_cast<uint32_t>(m_fkParent[b]));
+			if (m_grantSource[b] >= 0) reads.push_back(static_cast<uint32_t>(m_grantSource[b]));
+		};
+
+		reads.push_back(program.ikBone);
+		addUpdated(program.target);
+		for (const auto& link : program.links)
+		{
+			addUpdated(link.bone);
+			for (uint32_t k = link.pathBegin; k < link.pathEnd; ++k) addUpdated(m_ikPaths[k]);
+		}
+
+		for (auto* set : { &reads, &writes })
 		{
-			otherIKs.push_back(idx);
+			std::sort(set->begin(), set->end());
+			set->erase(std::unique(set->begin(), set->end()), set->end());
 		}
+
+		// 親から順に (ルートからの深さ順)
+		auto depthOf = [&](uint32_t b) {
+			size_t depth = 0;
+			for (int32_t cursor = m_fkParent[b]; cursor >= 0 && depth <= n; cursor = m_fkParent[cursor]) ++depth;
+			return depth;
+		};
+		program.refreshOrder = writes;
+		std::stable_sort(program.refreshOrder.begin(), program.refreshOrder.end(),
+						 [&](uint32_t a, uint32_t b) { return depthOf(a) < depthOf(b); });
+
+		m_ikPrograms.push_back(std::move(program));
 	}
 
-#if BONESOLVER_DISABLE_FOOT_IK
-	footIKs.clear();
-#endif
-#if BONESOLVER_DISABLE_TOE_IK
-	toeIKs.clear();
-#endif
+	// 段を決める。前の IK が書いたものを読む/前の IK が読むものを書く IK は、その後ろの段に置く。
+	// 段の中の IK は互いに触らないので、順序を入れ替えても逐次で解いた場合と同じ結果になる。
+	auto intersects = [](const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+		auto ia = a.begin();
+		auto ib = b.begin();
+		while (ia != a.end() && ib != b.end())
+		{
+			if (*ia < *ib) ++ia;
+			else if (*ib < *ia) ++ib;
+			else return true;
+		}
+		return false;
+	};
+
+	const size_t programCount = m_ikPrograms.size();
+	std::vector<uint32_t> wave(programCount, 0);
+	uint32_t waveCount = 0;
+	for (size_t p = 0; p < programCount; ++p)
+	{
+		uint32_t w = 0;
+		for (size_t q = 0; q < p; ++q)
+		{
+			if (intersects(m_ikPrograms[q].writes, m_ikPrograms[p].reads) ||
+				intersects(m_ikPrograms[q].reads, m_ikPrograms[p].writes))
+			{
+				w = std::max(w, wave[q] + 1);
+			}
+		}
+		wave[p] = w;
+		waveCount = std::max(waveCount, w + 1);
+	}
+
+	m_ikWaveOffsets.assign(static_cast<size_t>(waveCount) + 1, 0);
+	for (size_t p = 0; p < programCount; ++p) ++m_ikWaveOffsets[wave[p] + 1];
+	for (size_t w = 0; w < waveCount; ++w) m_ikWaveOffsets[w + 1] += m_ikWaveOffsets[w];
 
-	for (size_t idx : otherIKs)
+	m_ikWaveOrder.assign(programCount, 0);
+	std::vector<uint32_t> cursor(m_ikWaveOffsets.begin(), m_ikWaveOffsets.end() - 1);
+	for (size_t p = 0; p < programCount; ++p)
 	{
-		SolveIKBone(idx);
+		m_ikWaveOrder[cursor[wave[p]]++] = static_cast<uint32_t>(p);
 	}
 
-	int nFoot = (int)footIKs.size();
-#ifdef _OPENMP
-#pragma omp parallel for schedule(dynamic) if(nFoot > 1)
-#endif
-	for (int i = 0; i < nFoot; ++i)
+	m_ikCaches.assign(programCount, {});
+	m_ikCacheHits = 0;
+	m_ikCacheMisses = 0;
+}
+
+void BoneSolver::SetIkCacheEnabled(bool enabled)
+{
+	m_ikCacheEnabled = enabled;
+	for (auto& cache : m_ikCaches) cache.valid = false;
+}
+
+void BoneSolver::SolveIkCached(size_t programIndex)
+{
+	const auto& program = m_ikPrograms[programIndex];
+	auto& cache = m_ikCaches[programIndex];
+
+	if (!m_ikCacheEnabled)
 	{
-		SolveIKBone(footIKs[i]);
+		SolveIkProgram(program);
+		return;
 	}
 
-	int nToe = (int)toeIKs.size();
-#ifdef _OPENMP
-#pragma omp parallel for schedule(dynamic) if(nToe > 1)
-#endif
-	for (int i = 0; i < nToe; ++i)
+	// 入力を並べる: チェーンの外から読むボーン (目標の IK ボーン、根元の親、付与元) の行列と姿勢、
+	// チェーン内のボーンの解く前の姿勢
+	auto& key = cache.scratch;
+	key.clear();
+	auto appendPose = [&key](const BoneState& state) {
+		key.insert(key.end(), { state.localTranslation.x, state.localTranslation.y, state.localTranslation.z,
+								state.localRotation.x, state.localRotation.y, state.localRotation.z, state.localRotation.w });
+	};
+
+	auto write = program.writes.begin();
+	for (uint32_t b : program.reads)
+	{
+		while (write != program.writes.end() && *write < b) ++write;
+		if (write != program.writes.end() && *write == b) continue;
+
+		const auto& state = m_boneStates[b];
+		const float* g = &state.globalMatrix.m[0][0];
+		key.insert(key.end(), g, g + 16);
+		appendPose(state);
+	}
+	for (uint32_t b : program.writes) appendPose(m_boneStates[b]);
+
+	bool hit = cache.valid && cache.key.size() == key.size();
+	for (size_t i = 0; hit && i < key.size(); ++i)
 	{
-		SolveIKBone(toeIKs[i]);
+		// NaN は一致扱いにしない
+		if (!(std::fabs(key[i] - cache.key[i]) <= BONESOLVER_IK_CACHE_EPSILON)) hit = false;
 	}
+
+	if (hit)
+	{
+		// 前回の結果を戻し、チェーンの行列だけ更新する (後段の IK が読むため)。
+		// 鍵は解いたときのまま残し、少しずつ動く入力で差が積み重ならないようにする。
+		for (size_t i = 0; i < program.links.size(); ++i)
+		{
+			m_boneStates[program.links[i].bone].localRotation = cache.linkRotations[i];
+		}
+		for (uint32_t b : program.refreshOrder) UpdateBoneTransform(b);
+		++cache.hits;
+		return;
+	}
+
+	SolveIkProgram(program);
+
+	std::swap(cache.key, cache.scratch);
+	cache.linkRotations.resize(program.links.size());
+	for (size_t i = 0; i < program.links.size(); ++i)
+	{
+		cache.linkRotations[i] = m_boneStates[program.links[i].bone].localRotation;
+	}
+	cache.valid = true;
+	++cache.misses;
+}
+
+void BoneSolver::SolveIK()
+{
+	const size_t waveCount = m_ikWaveOffsets.empty() ? 0 : m_ikWaveOffsets.size() - 1;
+	for (size_t w = 0; w < waveCount; ++w)
+	{
+		const size_t first = m_ikWaveOffsets[w];
+		const size_t count = m_ikWaveOffsets[w + 1] - first;
+
+		// 同じ段の IK は読み書きが重ならないので並列に解く (左右の足、髪や尻尾など)
+		JobSystem::Shared().ParallelFor(g_ikWaveSite, count, [this, first](size_t begin, size_t end) {
+			for (size_t i = first + begin; i < first + end; ++i)
+			{
+				const uint32_t p = m_ikWaveOrder[i];
+				if (!IsIkEnabled(m_ikPrograms[p].ikBone)) continue;
+				SolveIkCached(p);
+			}
+		});
+	}
+
+	// 並列に数えた回数を集計する
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	for (auto& cache : m_ikCaches)
+	{
+		hits += cache.hits;
+		misses += cache.misses;
+		cache.hits = 0;
+		cache.misses = 0;
+	}
+	m_ikCacheHits += hits;
+	m_ikCacheMisses += misses;
+	if (m_profile)
+	{
+		m_profile->ikCacheHits += static_cast<uint32_t>(hits);
+		m_profile->ikCacheMisses += static_cast<uint32_t>(misses);
+	}
+
+	// IK が書き換えたリンクのローカル姿勢を差分更新に伝える (付与先も計算し直す)
+	for (const auto& program : m_ikPrograms)
+	{
+		if (!IsIkEnabled(program.ikBone)) continue;
+		for (const auto& link : program.links)
+		{
+			MarkPoseChanged(link.bone);
+		}
+	}
+}
+
+void BoneSolver::UpdateIkPath(const IkProgram& program, const IkLink& link)
+{
+	// 回したリンクから、エフェクタまでの経路だけを親側から更新する
+	UpdateBoneTransform(link.bone);
+	for (uint32_t k = link.pathBegin; k < link.pathEnd; ++k)
+	{
+		UpdateBoneTransform(m_ikPaths[k]);
+	}
+	UpdateBoneTransform(program.target);
 }
 
 XMVECTOR BoneSolver::ClampAngle(XMVECTOR euler,
@@ -591,120 +1028,296 @@ XMVECTOR BoneSolver::ClampAngle(XMVECTOR euler,
 	return XMLoadFloat3(&e);
 }
 
-void BoneSolver::UpdateBoneTransform(size_t boneIndex)
+void BoneSolver::ResolveLocalPose(size_t boneIndex, XMVECTOR& translation, XMVECTOR& rotation) const
+{
+	const auto& state = m_boneStates[boneIndex];
+
+	translation = XMLoadFloat3(&state.localTranslation);
+	rotation = XMLoadFloat4(&state.localRotation);
+
+	const int32_t grantIndex = m_grantSource[boneIndex];
+	if (grantIndex < 0) return;
+
+	const auto& grantState = m_boneStates[grantIndex];
+	const uint8_t flags = m_grantFlags[boneIndex];
+
+	if (flags & 1)
+	{
+		XMVECTOR grantRot = XMLoadFloat4(&grantState.localRotation);
+		XMVECTOR grantRotScaled = QuaternionPow(grantRot, m_grantWeight[boneIndex]);
+		rotation = XMQuaternionMultiply(rotation, grantRotScaled);
+		rotation = XMQuaternionNormalize(rotation);
+	}
+
+	if (flags & 2)
+	{
+		XMVECTOR grantTrans = XMLoadFloat3(&grantState.localTranslation);
+		XMVECTOR grantTransScaled = XMVectorScale(grantTrans, m_grantWeight[boneIndex]);
+		translation = XMVectorAdd(translation, grantTransScaled);
+	}
+}
+
+void XM_CALLCONV BoneSolver::StoreBoneTransform(size_t boneIndex,
+												FXMVECTOR row0, FXMVECTOR row1, FXMVECTOR row2,
+												GXMVECTOR localTranslation, HXMVECTOR globalTranslation)
 {
-	const auto& bone = m_bones[boneIndex];
 	auto& state = m_boneStates[boneIndex];
 
-	XMVECTOR translation = XMLoadFloat3(&state.localTranslation);
-	XMVECTOR rotation = XMLoadFloat4(&state.localRotation);
+	// ローカル行列 = 回転 * 平行移動 (平行移動は 4 行目に入るだけなので掛け算は不要)
+	XMStoreFloat4x4(&state.localMatrix, XMMATRIX(row0, row1, row2, localTranslation));
+
+	// グローバル行列 = ローカル * 親からの相対位置 * 親のグローバル
+	// (相対位置の平行移動も 4 行目への加算で済むので、呼び出し側で globalTranslation にまとめてある)
+	XMMATRIX globalMat(row0, row1, row2, globalTranslation);
+	const int32_t parentIndex = m_fkParent[boneIndex];
+	if (parentIndex >= 0)
+	{
+		globalMat = XMMatrixMultiply(globalMat, XMLoadFloat4x4(&m_boneStates[parentIndex].globalMatrix));
+	}
+
+	// 値が変わったときだけ子とスキニング行列を計算し直す対象にする。
+	// (IK の途中経過の書き込みもここを通るので、変化は漏れなく子に伝わる)
+	const XMMATRIX prevGlobal = XMLoadFloat4x4(&state.globalMatrix);
+	if (XMVector4EqualInt(prevGlobal.r[0], globalMat.r[0]) &&
+		XMVector4EqualInt(prevGlobal.r[1], globalMat.r[1]) &&
+		XMVector4EqualInt(prevGlobal.r[2], globalMat.r[2]) &&
+		XMVector4EqualInt(prevGlobal.r[3], globalMat.r[3]))
+	{
+		return;
+	}
+
+	XMStoreFloat4x4(&state.globalMatrix, globalMat);
+	m_skinningDirty[boneIndex] = 1;
+	for (size_t child : m_boneChildren[boneIndex])
+	{
+		m_fkDirty[child] = 1;
+	}
+}
+
+void BoneSolver::UpdateBoneTransform(size_t boneIndex)
+{
+	XMVECTOR translation;
+	XMVECTOR rotation;
+	ResolveLocalPose(boneIndex, translation, rotation);
+
+	const XMMATRIX rotMat = XMMatrixRotationQuaternion(rotation);
+	const XMVECTOR localT = XMVectorSelect(g_XMIdentityR3, translation, g_XMSelect1110);
+	const XMVECTOR globalT = XMVectorAdd(localT, XMLoadFloat3(&m_fkOffset[boneIndex]));
+
+	StoreBoneTransform(boneIndex, rotMat.r[0], rotMat.r[1], rotMat.r[2], localT, globalT);
+}
+
+void BoneSolver::BuildForwardKinematicsSchedule()
+{
+	const size_t n = m_bones.size();
+
+	m_fkParent.assign(n, -1);
+	m_fkOffset.assign(n, { 0.0f, 0.0f, 0.0f });
+	m_grantSource.assign(n, -1);
+	m_grantWeight.assign(n, 0.0f);
+	m_grantFlags.assign(n, 0);
 
-	if ((bone.HasRotationGrant() || bone.HasTranslationGrant()) &&
-		bone.grantParentIndex >= 0 &&
-		bone.grantParentIndex < static_cast<int32_t>(m_bones.size()) &&
-		bone.grantParentIndex != static_cast<int32_t>(boneIndex))
+	for (size_t i = 0; i < n; ++i)
 	{
-		const auto& grantState = m_boneStates[bone.grantParentIndex];
+		const auto& bone = m_bones[i];
 
-		if (bone.HasRotationGrant())
+		XMVECTOR offset = XMLoadFloat3(&bone.position);
+		if (bone.parentIndex >= 0 && bone.parentIndex < static_cast<int32_t>(n))
 		{
-			XMVECTOR grantRot = XMLoadFloat4(&grantState.localRotation);
-			XMVECTOR grantRotScaled = QuaternionPow(grantRot, bone.grantWeight);
-			rotation = XMQuaternionMultiply(rotation, grantRotScaled);
-			rotation = XMQuaternionNormalize(rotation);
+			m_fkParent[i] = bone.parentIndex;
+			offset = XMVectorSubtract(offset, XMLoadFloat3(&m_bones[bone.parentIndex].position));
 		}
+		XMStoreFloat3(&m_fkOffset[i], offset);
 
-		if (bone.HasTranslationGrant())
+		const uint8_t flags = static_cast<uint8_t>((bone.HasRotationGrant() ? 1 : 0) | (bone.HasTranslationGrant() ? 2 : 0));
+		if (flags != 0 &&
+			bone.grantParentIndex >= 0 &&
+			bone.grantParentIndex < static_cast<int32_t>(n) &&
+			bone.grantParentIndex != static_cast<int32_t>(i))
 		{
-			XMVECTOR grantTrans = XMLoadFloat3(&grantState.localTranslation);
-			XMVECTOR grantTransScaled = XMVectorScale(grantTrans, bone.grantWeight);
-			translation = XMVectorAdd(translation, grantTransScaled);
+			m_grantSource[i] = bone.grantParentIndex;
+			m_grantWeight[i] = bone.grantWeight;
+			m_grantFlags[i] = flags;
 		}
 	}
 
-	XMMATRIX localMat = XMMatrixRotationQuaternion(rotation) *
-		XMMatrixTranslationFromVector(translation);
-	XMStoreFloat4x4(&state.localMatrix, localMat);
+	// 付与親ごとの付与先一覧
+	m_grantDependentOffsets.assign(n + 1, 0);
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (m_grantSource[i] >= 0) ++m_grantDependentOffsets[m_grantSource[i] + 1];
+	}
+	for (size_t i = 0; i < n; ++i) m_grantDependentOffsets[i + 1] += m_grantDependentOffsets[i];
 
-	XMMATRIX globalMat;
-	if (bone.parentIndex >= 0 && bone.parentIndex < static_cast<int32_t>(m_bones.size()))
+	m_grantDependents.assign(m_grantDependentOffsets[n], 0);
 	{
-		const auto& parentState = m_boneStates[bone.parentIndex];
-		const auto& parentBone = m_bones[bone.parentIndex];
+		std::vector<uint32_t> cursor(m_grantDependentOffsets.begin(), m_grantDependentOffsets.end() - 1);
+		for (size_t i = 0; i < n; ++i)
+		{
+			if (m_grantSource[i] >= 0) m_grantDependents[cursor[m_grantSource[i]]++] = static_cast<uint32_t>(i);
+		}
+	}
 
-		XMVECTOR bonePos = XMLoadFloat3(&bone.position);
-		XMVECTOR parentPos = XMLoadFloat3(&parentBone.position);
-		XMVECTOR relativePos = XMVectorSubtract(bonePos, parentPos);
+	// 段を決める。m_sortedBoneOrder の順で k 番目に処理されるボーンについて、
+	//  - 親が先に処理されるなら、更新後の親を読むので親より後の段
+	//  - 子が先に処理されているなら (変形階層で親が後ろに来る場合)、
+	//    子は更新前の自分を読んでいるので、その子より後の段
+	// とすれば、段ごとにまとめて計算しても逐次処理と同じ値になる。
+	// 付与はローカルの姿勢しか読まないので段には影響しない。
+	std::vector<uint32_t> position(n, 0);
+	for (size_t k = 0; k < n; ++k) position[m_sortedBoneOrder[k]] = static_cast<uint32_t>(k);
+
+	std::vector<uint32_t> level(n, 0);
+	uint32_t levelCount = 0;
+	for (size_t k = 0; k < n; ++k)
+	{
+		const size_t i = m_sortedBoneOrder[k];
+		uint32_t lv = 0;
 
-		XMMATRIX parentGlobal = XMLoadFloat4x4(&parentState.globalMatrix);
+		const int32_t parentIndex = m_fkParent[i];
+		if (parentIndex >= 0 && position[parentIndex] < k)
+		{
+			lv = level[parentIndex] + 1;
+		}
+		for (size_t child : m_boneChildren[i])
+		{
+			if (position[child] < k) lv = std::max(lv, level[child] + 1);
+		}
 
-		globalMat = localMat * XMMatrixTranslationFromVector(relativePos) * parentGlobal;
+		level[i] = lv;
+		levelCount = std::max(levelCount, lv + 1);
 	}
-	else
+
+	// 段ごとに並べ直す (段の中は m_sortedBoneOrder の順)
+	m_fkLevelOffsets.assign(static_cast<size_t>(levelCount) + 1, 0);
+	for (size_t i = 0; i < n; ++i) ++m_fkLevelOffsets[level[i] + 1];
+	for (size_t l = 0; l < levelCount; ++l) m_fkLevelOffsets[l + 1] += m_fkLevelOffsets[l];
+
+	m_fkSchedule.assign(n, 0);
+	std::vector<uint32_t> cursor(m_fkLevelOffsets.begin(), m_fkLevelOffsets.end() - 1);
+	for (size_t k = 0; k < n; ++k)
 	{
-		XMVECTOR bonePos = XMLoadFloat3(&bone.position);
-		globalMat = localMat * XMMatrixTranslationFromVector(bonePos);
+		const size_t i = m_sortedBoneOrder[k];
+		m_fkSchedule[cursor[level[i]]++] = static_cast<uint32_t>(i);
 	}
 
-	XMStoreFloat4x4(&state.globalMatrix, globalMat);
+	m_fkWork.assign(n, 0);
+}
+
+void BoneSolver::UpdateForwardKinematicsBatch(const uint32_t* boneIndices, size_t count)
+{
+	// 4 本分の姿勢を集めて転置し、x/y/z/w をそれぞれ 1 本のベクトルにする (SoA)
+	XMMATRIX rotations(g_XMIdentityR3, g_XMIdentityR3, g_XMIdentityR3, g_XMIdentityR3);
+	XMMATRIX translations(g_XMZero, g_XMZero, g_XMZero, g_XMZero);
+	for (size_t lane = 0; lane < count; ++lane)
+	{
+		ResolveLocalPose(boneIndices[lane], translations.r[lane], rotations.r[lane]);
+	}
+	rotations = XMMatrixTranspose(rotations);
+	translations = XMMatrixTranspose(translations);
+
+	const XMVECTOR qx = rotations.r[0];
+	const XMVECTOR qy = rotations.r[1];
+	const XMVECTOR qz = rotations.r[2];
+	const XMVECTOR qw = rotations.r[3];
+
+	// XMMatrixRotationQuaternion と同じ式を 4 本同時に
+	const XMVECTOR one = XMVectorSplatOne();
+	const XMVECTOR x2 = XMVectorAdd(qx, qx);
+	const XMVECTOR y2 = XMVectorAdd(qy, qy);
+	const XMVECTOR z2 = XMVectorAdd(qz, qz);
+	const XMVECTOR w2 = XMVectorAdd(qw, qw);
+
+	const XMVECTOR xx2 = XMVectorMultiply(qx, x2);
+	const XMVECTOR yy2 = XMVectorMultiply(qy, y2);
+	const XMVECTOR zz2 = XMVectorMultiply(qz, z2);
+	const XMVECTOR xy2 = XMVectorMultiply(qx, y2);
+	const XMVECTOR xz2 = XMVectorMultiply(qx, z2);
+	const XMVECTOR yz2 = XMVectorMultiply(qy, z2);
+	const XMVECTOR wx2 = XMVectorMultiply(w2, qx);
+	const XMVECTOR wy2 = XMVectorMultiply(w2, qy);
+	const XMVECTOR wz2 = XMVectorMultiply(w2, qz);
+
+	const XMVECTOR zero = XMVectorZero();
+	const XMMATRIX row0 = XMMatrixTranspose(XMMATRIX(
+		XMVectorSubtract(XMVectorSubtract(one, yy2), zz2),
+		XMVectorAdd(xy2, wz2),
+		XMVectorSubtract(xz2, wy2),
+		zero));
+	const XMMATRIX row1 = XMMatrixTranspose(XMMATRIX(
+		XMVectorSubtract(xy2, wz2),
+		XMVectorSubtract(XMVectorSubtract(one, xx2), zz2),
+		XMVectorAdd(yz2, wx2),
+		zero));
+	const XMMATRIX row2 = XMMatrixTranspose(XMMATRIX(
+		XMVectorAdd(xz2, wy2),
+		XMVectorSubtract(yz2, wx2),
+		XMVectorSubtract(XMVectorSubtract(one, xx2), yy2),
+		zero));
+
+	const XMMATRIX localT = XMMatrixTranspose(XMMATRIX(translations.r[0], translations.r[1], translations.r[2], one));
+
+	for (size_t lane = 0; lane < count; ++lane)
+	{
+		const uint32_t boneIndex = boneIndices[lane];
+		const XMVECTOR globalT = XMVectorAdd(localT.r[lane], XMLoadFloat3(&m_fkOffset[boneIndex]));
+		StoreBoneTransform(boneIndex,
+						   row0.r[lane], row1.r[lane], row2.r[lane],
+						   localT.r[lane], globalT);
+	}
 }
 
-void BoneSolver::SolveIKBone(size_t boneIndex)
+void BoneSolver::UpdateForwardKinematics()
 {
-	const auto& ikBone = m_bones[boneIndex];
-	if (!ikBone.IsIK() || ikBone.ikTargetIndex < 0) return;
+	const size_t levelCount = m_fkLevelOffsets.empty() ? 0 : m_fkLevelOffsets.size() - 1;
+	for (size_t level = 0; level < levelCount; ++level)
+	{
+		// この段で計算し直すボーンだけを集める。
+		// 子の印は前の段の計算中に立つので、段を進めながら集めれば変化が下へ伝わる。
+		size_t count = 0;
+		for (size_t slot = m_fkLevelOffsets[level]; slot < m_fkLevelOffsets[level + 1]; ++slot)
+		{
+			const uint32_t boneIndex = m_fkSchedule[slot];
+			if (!m_fkDirty[boneIndex]) continue;
+			m_fkDirty[boneIndex] = 0;
+			m_fkWork[count++] = boneIndex;
+		}
+		if (count == 0) continue;
+
+		const size_t batchCount = (count + 3) / 4;
+
+		// 段の中は互いに独立。分けるかどうかは実測した 1 バッチの重さで決まる
+		JobSystem::Shared().ParallelFor(g_fkWaveSite, batchCount, [this, count](size_t begin, size_t end) {
+			for (size_t batch = begin; batch < end; ++batch)
+			{
+				const size_t first = batch * 4;
+				UpdateForwardKinematicsBatch(&m_fkWork[first], std::min<size_t>(4, count - first));
+			}
+		});
+	}
+}
 
-	const size_t targetIdx = static_cast<size_t>(ikBone.ikTargetIndex);
-	if (targetIdx >= m_bones.size()) return;
+void BoneSolver::SolveIkProgram(const IkProgram& program)
+{
+	const size_t boneIndex = program.ikBone;
+	const size_t targetIdx = program.target;
 
 	// IKループ設定
-	float limitAngle = NormalizeIkUnitAngle(ikBone.ikLimitAngle);
-	if (limitAngle <= 0.0f) limitAngle = DirectX::XM_PI;
-	const int loopCount = ikBone.ikLoopCount;
+	const float limitAngle = program.limitAngle;
+	const int loopCount = program.loopCount;
 
-	// [最適化] 更新チェーン探索用バッファ（スタック確保で高速化）
-	// 通常の人型モデルのIKチェーンは短いため16階層あれば十分
-	int chainBuffer[16];
 	// --- 解析的2ボーンIK（膝/肘などの1軸制限チェーン） ---
 	// 2ボーン + 中間が明確な1軸制限(例: 膝)のケースは、CCD反復より解析解の方が安定しやすい。
+	// (形の判定は BuildIkPrograms で済ませてある)
 	auto TrySolveAnalyticTwoBoneHinge = [&]() -> bool
 		{
-			if (ikBone.ikLinks.size() != 2) return false;
-
-			const auto& link0 = ikBone.ikLinks[0];
-			const auto& link1 = ikBone.ikLinks[1];
-
-			auto isAxisXOnly = [&](const auto& link) -> bool
-				{
-					if (!link.hasLimit) return false;
-					// YZがほぼゼロ（±0.1deg程度以内）ならXのみとみなす
-					const float eps = 0.00174533f; // 0.1deg in rad
-					const float ymin = std::fabs(MaybeDegreesToRadians(link.limitMin.y));
-					const float ymax = std::fabs(MaybeDegreesToRadians(link.limitMax.y));
-					const float zmin = std::fabs(MaybeDegreesToRadians(link.limitMin.z));
-					const float zmax = std::fabs(MaybeDegreesToRadians(link.limitMax.z));
-					return (ymin < eps && ymax < eps && zmin < eps && zmax < eps);
-				};
-
-			const bool axis0 = isAxisXOnly(link0);
-			const bool axis1 = isAxisXOnly(link1);
-			if (axis0 == axis1) return false; // 0個 or 2個
+			if (program.hingeLink < 0) return false;
 
-			const auto& hingeLink = axis0 ? link0 : link1; // 1軸制限（膝/肘）
-			const auto& rootLink = axis0 ? link1 : link0;  // 付け根側（腿/上腕）
+			const auto& hingeLink = program.links[program.hingeLink]; // 1軸制限（膝/肘）
+			const auto& rootLink = program.links[program.rootLink];   // 付け根側（腿/上腕）
 
-			const int midIdxI = hingeLink.boneIndex;
-			const int rootIdxI = rootLink.boneIndex;
-			if (midIdxI < 0 || rootIdxI < 0) return false;
-
-			const size_t midIdx = (size_t)midIdxI;
-			const size_t rootIdx = (size_t)rootIdxI;
-
-			if (rootIdx >= m_bones.size() || midIdx >= m_bones.size() || targetIdx >= m_bones.size()) return false;
-
-			// 2ボーン(root -> mid -> target) の形になっていること
-			if (m_bones[midIdx].parentIndex != (int)rootIdx) return false;
-			if (m_bones[targetIdx].parentIndex != (int)midIdx) return false;
+			const size_t midIdx = hingeLink.bone;
+			const size_t rootIdx = rootLink.bone;
 
 			// 現在の位置
 			XMMATRIX rootGlobal0 = XMLoadFloat4x4(&m_boneStates[rootIdx].globalMatrix);
@@ -840,36 +1453,6 @@ void BoneSolver::SolveIKBone(size_t boneIndex)
 
 			XMVECTOR upperCur = XMVector3Normalize(AB);
 			XMVECTOR upperDes = XMVector3Normalize(XMVectorSubtract(Bdes, A));
-			auto UpdateToTargetFrom = [&](size_t changedIdx)
-				{
-					UpdateBoneTransform(changedIdx);
-
-					int childCursor = m_bones[targetIdx].parentIndex;
-					int chainCount = 0;
-					bool connected = false;
-
-					while (childCursor >= 0 && chainCount < 16)
-					{
-						if (childCursor == (int)changedIdx)
-						{
-							connected = true;
-							break;
-						}
-						chainBuffer[chainCount++] = childCursor;
-						childCursor = m_bones[childCursor].parentIndex;
-					}
-
-					if (connected)
-					{
-						for (int i = chainCount - 1; i >= 0; --i) UpdateBoneTransform(chainBuffer[i]);
-						UpdateBoneTransform(targetIdx);
-					}
-					else
-					{
-						UpdateBoneTransform(targetIdx);
-					}
-				};
-
 			// 1) root swing: upperCur -> upperDes
 			{
 				XMVECTOR axisW = XMVector3Cross(upperCur, upperDes);
@@ -894,7 +1477,7 @@ void BoneSolver::SolveIKBone(size_t boneIndex)
 							if (rootLink.hasLimit) q = ClampIKRotationRobust(q, rootLink.limitMin, rootLink.limitMax);
 
 							XMStoreFloat4(&rootState.localRotation, q);
-							UpdateToTargetFrom(rootIdx);
+							UpdateIkPath(program, rootLink);
 						}
 					}
 				}
@@ -981,7 +1564,7 @@ void BoneSolver::SolveIKBone(size_t boneIndex)
 				m_lastIkLimitedEuler[midIdx].x = targetAngle;
 				m_hasLastIkLimitedEuler[midIdx] = 1;
 
-				UpdateToTargetFrom(midIdx);
+				UpdateIkPath(program, hingeLink);
 			}
 
 			return true;
@@ -993,13 +1576,9 @@ void BoneSolver::SolveIKBone(size_t boneIndex)
 
 	for (int loop = 0; loop < loopCount; ++loop)
 	{
-		for (size_t linkIdx = 0; linkIdx < ikBone.ikLinks.size(); ++linkIdx)
+		for (const auto& link : program.links)
 		{
-			const auto& link = ikBone.ikLinks[linkIdx];
-			if (link.boneIndex < 0) continue;
-
-			const size_t currIdx = static_cast<size_t>(link.boneIndex);
-			if (currIdx >= m_bones.size()) continue;
+			const size_t currIdx = link.bone;
 
 			// --- 現在の状態取得 ---
 			XMMATRIX destGlobal = XMLoadFloat4x4(&m_boneStates[boneIndex].globalMatrix);
@@ -1019,18 +1598,13 @@ void BoneSolver::SolveIKBone(size_t boneIndex)
 			}
 			XMMATRIX parentInv = XMMatrixInverse(nullptr, parentGlobal);
 
-			// --- 1軸制限（膝など）の判定 ---
-			bool hasLimit = link.hasLimit;
-			XMFLOAT3 limMin = link.limitMin;
-			XMFLOAT3 limMax = link.limitMax;
-			const float eps = 1.0e-3f;
-
-			// X軸のみに制限がある関節か判定
-			bool isAxisXOnly = hasLimit &&
-				(std::abs(limMin.y) < eps && std::abs(limMax.y) < eps) &&
-				(std::abs(limMin.z) < eps && std::abs(limMax.z) < eps);
+			// --- 1軸制限（膝など）---
+			const bool hasLimit = link.hasLimit;
+			const XMFLOAT3& limMin = link.limitMin;
+			const XMFLOAT3& limMax = link.limitMax;
 
-			if (isAxisXOnly)
+			// X軸のみに制限がある関節
+			if (link.axisXOnly)
 			{
 				XMVECTOR toDest = XMVectorSubtract(destPos, linkPos);
 				XMVECTOR toCurr = XMVectorSubtract(currPos, linkPos);
@@ -1101,46 +1675,9 @@ void BoneSolver::SolveIKBone(size_t boneIndex)
 					m_lastIkLimitedEuler[currIdx].x = targetAngle;
 					m_hasLastIkLimitedEuler[currIdx] = 1;
 
-					// --- [最適化] 行列更新 ---
-					// 全子孫を再帰更新する UpdateGlobalMatrixRecursive(currIdx) を廃止し、
-					// 影響のあるチェーン（現在リンク～エフェクタ）のみを更新する。
-					{
-						// 1. 自分自身の行列更新
-						UpdateBoneTransform(currIdx);
-
-						// 2. エフェクタ(targetIdx)までの経路を探索
-						int childCursor = m_bones[targetIdx].parentIndex;
-						int chainCount = 0;
-						bool connected = false;
-
-						// targetIdx から親を辿って currIdx に到達するか確認
-						while (childCursor >= 0 && chainCount < 16)
-						{
-							if (childCursor == (int)currIdx)
-							{
-								connected = true;
-								break;
-							}
-							chainBuffer[chainCount++] = childCursor;
-							childCursor = m_bones[childCursor].parentIndex;
-						}
-
-						if (connected)
-						{
-							// 経路上のボーンを親側(currIdx直下)から順に更新
-							for (int i = chainCount - 1; i >= 0; --i)
-							{
-								UpdateBoneTransform(chainBuffer[i]);
-							}
-							// 最後にエフェクタを更新
-							UpdateBoneTransform(targetIdx);
-						}
-						else
-						{
-							// 経路が繋がっていない場合(通常ありえない)はエフェクタのみ強制更新
-							UpdateBoneTransform(targetIdx);
-						}
-					}
+					// --- 行列更新 ---
+					// 全子孫は更新せず、影響のあるチェーン（現在リンク～エフェクタ）のみを更新する。
+					UpdateIkPath(program, link);
 
 					// 収束判定
 					targetGlobal = XMLoadFloat4x4(&m_boneStates[targetIdx].globalMatrix);
@@ -1216,43 +1753,8 @@ void BoneSolver::SolveIKBone(size_t boneIndex)
 
 			XMStoreFloat4(&linkState.localRotation, currentRot);
 
-			// --- [最適化] 行列更新 ---
-			// 上記と同じ最適化ロジック
-			{
-				// 1. 自分自身の行列更新
-				UpdateBoneTransform(currIdx);
-
-				// 2. エフェクタ(targetIdx)までの経路を探索
-				int childCursor = m_bones[targetIdx].parentIndex;
-				int chainCount = 0;
-				bool connected = false;
-
-				while (childCursor >= 0 && chainCount < 16)
-				{
-					if (childCursor == (int)currIdx)
-					{
-						connected = true;
-						break;
-					}
-					chainBuffer[chainCount++] = childCursor;
-					childCursor = m_bones[childCursor].parentIndex;
-				}
-
-				if (connected)
-				{
-					// 経路上のボーンを親側(currIdx直下)から順に更新
-					for (int i = chainCount - 1; i >= 0; --i)
-					{
-						UpdateBoneTransform(chainBuffer[i]);
-					}
-					// 最後にエフェクタを更新
-					UpdateBoneTransform(targetIdx);
-				}
-				else
-				{
-					UpdateBoneTransform(targetIdx);
-				}
-			}
+			// --- 行列更新 ---
+			UpdateIkPath(program, link);
 
 			// 収束判定
 			targetGlobal = XMLoadFloat4x4(&m_boneStates[targetIdx].globalMatrix);
@@ -1309,35 +1811,32 @@ void BoneSolver::UpdateMatrices()
 
 void BoneSolver::UpdateMatrices(bool solveIK)
 {
-	for (size_t idx : m_sortedBoneOrder) UpdateBoneTransform(idx);
+	{
+		TickStageTimer timer(m_profile, TickStage::ForwardKinematics);
+		UpdateForwardKinematics();
+	}
 
 	if (solveIK)
 	{
-		SolveIK();
+		{
+			TickStageTimer timer(m_profile, TickStage::InverseKinematics);
+			SolveIK();
+		}
 
-		for (size_t idx : m_sortedBoneOrder) UpdateBoneTransform(idx);
+		TickStageTimer timer(m_profile, TickStage::ForwardKinematics);
+		UpdateForwardKinematics();
 	}
 
-	const int n = static_cast<int>(m_bones.size());
-#pragma omp parallel for schedule(static) if(n >= 256)
-	for (int i = 0; i < n; ++i) CalculateSkinningMatrix(i);
+	TickStageTimer timer(m_profile, TickStage::ForwardKinematics);
+	UpdateSkinningMatrices();
 }
 
 void BoneSolver::UpdateMatricesNoIK()
 {
-	for (size_t idx : m_sortedBoneOrder)
-	{
-		UpdateBoneTransform(idx);
-	}
+	TickStageTimer timer(m_profile, TickStage::ForwardKinematics);
 
-	const size_t n = m_bones.size();
-#ifdef _OPENMP
-#pragma omp parallel for schedule(static) if(n >= 256)
-#endif
-	for (int i = 0; i < (int)n; ++i)
-	{
-		CalculateSkinningMatrix(i);
-	}
+	UpdateForwardKinematics();
+	UpdateSkinningMatrices();
 }
 
 const DirectX::XMFLOAT4X4& BoneSolver::GetBoneGlobalMatrix(size_t boneIndex) const
@@ -1367,9 +1866,7 @@ void BoneSolver::SetBoneLocalPose(size_t boneIndex,
 		throw std::out_of_range("Bone index out of range");
 	}
 
-	auto& s = m_boneStates[boneIndex];
-	s.localTranslation = translation;
-	s.localRotation = rotation;
+	SetLocalPose(boneIndex, translation, rotation);
 }
 
 void BoneSolver::GetBoneBounds(DirectX::XMFLOAT3& outMin, DirectX::XMFLOAT3& outMax) const
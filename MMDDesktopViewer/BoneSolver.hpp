@@ -2,8 +2,12 @@
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include <algorithm>
+#include <cstdint>
+#include <span>
 #include <DirectXMath.h>
 #include "PmxModel.hpp"
+#include "TickProfile.hpp"
 
 struct BonePose
 {
@@ -13,6 +17,94 @@ struct BonePose
 	float frame{};
 };
 
+// モデルのボーン/モーフ番号で引くポーズ。
+// has* が 0 のスロットは値を持たない (平行移動 0・回転なし・ウェイト 0 と同じ扱い)。
+// ikDisabled は IK ボーンの番号で引き、1 ならモーションがその IK を切っている。
+// Clear() は容量を保つので、毎フレーム作り直しても確保は発生しない。
+struct DensePose
+{
+	std::vector<DirectX::XMFLOAT3> boneTranslations;
+	std::vector<DirectX::XMFLOAT4> boneRotations;
+	std::vector<float> morphWeights;
+	std::vector<std::uint8_t> hasBoneTranslation;
+	std::vector<std::uint8_t> hasBoneRotation;
+	std::vector<std::uint8_t> hasMorphWeight;
+	std::vector<std::uint8_t> ikDisabled;
+	float frame{};
+
+	void Resize(size_t boneCount, size_t morphCount)
+	{
+		boneTranslations.assign(boneCount, { 0.0f, 0.0f, 0.0f });
+		boneRotations.assign(boneCount, { 0.0f, 0.0f, 0.0f, 1.0f });
+		morphWeights.assign(morphCount, 0.0f);
+		hasBoneTranslation.assign(boneCount, 0);
+		hasBoneRotation.assign(boneCount, 0);
+		hasMorphWeight.assign(morphCount, 0);
+		ikDisabled.assign(boneCount, 0);
+		frame = 0.0f;
+	}
+
+	void Clear()
+	{
+		std::fill(hasBoneTranslation.begin(), hasBoneTranslation.end(), std::uint8_t{ 0 });
+		std::fill(hasBoneRotation.begin(), hasBoneRotation.end(), std::uint8_t{ 0 });
+		std::fill(hasMorphWeight.begin(), hasMorphWeight.end(), std::uint8_t{ 0 });
+		std::fill(ikDisabled.begin(), ikDisabled.end(), std::uint8_t{ 0 });
+		frame = 0.0f;
+	}
+
+	size_t BoneCount() const
+	{
+		return boneRotations.size();
+	}
+	size_t MorphCount() const
+	{
+		return morphWeights.size();
+	}
+
+	void SetBoneTranslation(size_t boneIndex, const DirectX::XMFLOAT3& t)
+	{
+		boneTranslations[boneIndex] = t;
+		hasBoneTranslation[boneIndex] = 1;
+	}
+	void SetBoneRotation(size_t boneIndex, const DirectX::XMFLOAT4& q)
+	{
+		boneRotations[boneIndex] = q;
+		hasBoneRotation[boneIndex] = 1;
+	}
+	void SetMorphWeight(size_t morphIndex, float w)
+	{
+		morphWeights[morphIndex] = w;
+		hasMorphWeight[morphIndex] = 1;
+	}
+	void SetIkEnabled(size_t ikBoneIndex, bool enabled)
+	{
+		ikDisabled[ikBoneIndex] = enabled ? 0 : 1;
+	}
+
+	DirectX::XMFLOAT3 BoneTranslationOrZero(size_t boneIndex) const
+	{
+		return hasBoneTranslation[boneIndex] ? boneTranslations[boneIndex] : DirectX::XMFLOAT3{ 0.0f, 0.0f, 0.0f };
+	}
+	DirectX::XMFLOAT4 BoneRotationOrIdentity(size_t boneIndex) const
+	{
+		return hasBoneRotation[boneIndex] ? boneRotations[boneIndex] : DirectX::XMFLOAT4{ 0.0f, 0.0f, 0.0f, 1.0f };
+	}
+	float MorphWeightOrZero(size_t morphIndex) const
+	{
+		return hasMorphWeight[morphIndex] ? morphWeights[morphIndex] : 0.0f;
+	}
+};
+
+// ポーズの上に重ねるローカル姿勢のずれ (ボーンモーフなど)。
+// 平行移動は足し、回転はポーズの回転より先に掛ける。
+struct BoneLocalOffset
+{
+	std::uint32_t boneIndex{};
+	DirectX::XMFLOAT3 translation{ 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT4 rotation{ 0.0f, 0.0f, 0.0f, 1.0f };
+};
+
 class BoneSolver
 {
 public:
@@ -31,6 +123,9 @@ public:
 	BoneSolver() = default;
 
 	void Initialize(const PmxModel* model);
+	// offsets はボーン番号の昇順 (同じボーンは 1 つまで)
+	void ApplyPose(const DensePose& pose, std::span<const BoneLocalOffset> offsets = {});
+	// 名前で指定するポーズ (外部からの呼び出し用。ボーン名を毎回引くので遅い)
 	void ApplyPose(const BonePose& pose);
 	void SolveIK();
 	void UpdateMatrices();
@@ -43,6 +138,19 @@ public:
 		return m_skinningMatrices;
 	}
 
+	// スキニング行列の変更を数える番号。どれか 1 本でも値が変わった更新ごとに増える。
+	uint64_t SkinningRevision() const
+	{
+		return m_skinningRevision;
+	}
+	// sinceRevision より後に値が変わったボーンを含む範囲 [outBegin, outEnd) を返す。
+	// 変化がなければ false (アップロード先ごとに前回の番号を覚えておけば、差分だけ転送できる)
+	bool GetSkinningChangedRange(uint64_t sinceRevision, size_t& outBegin, size_t& outEnd) const;
+	// スキニング行列を転置済みの 3x4 (シェーダーの float4x3 と同じ並び) で dst[i] に書く。
+	// sinceRevision より後に変わったボーンだけを書き (0 なら全ボーン)、書いた本数を返す。
+	// dst は capacity 本分あればよく、BoneCount() を超える分には触れない。
+	size_t WriteSkinningPalette(DirectX::XMFLOAT3X4* dst, size_t capacity, uint64_t sinceRevision) const;
+
 	size_t BoneCount() const
 	{
 		return m_bones.size();
@@ -58,13 +166,39 @@ public:
 	// 物理後にIKを回さずスキニング行列だけ更新したい場合に使用
 	void UpdateMatricesNoIK();
 
+	// IK ボーンごとの有効/無効 (アプリ側からの切り替え。Initialize で全て有効に戻る)。
+	// ポーズ側 (VMD の IK キー) の無効と重ねて、どちらかで無効なら解かない。
+	void SetIkEnabled(size_t ikBoneIndex, bool enabled);
+	bool IsIkEnabled(size_t ikBoneIndex) const;
+
+	// IK の入力 (目標・チェーン根元の親の行列、リンクの姿勢) が前回と同じなら解き直さずに前回の結果を使う
+	void SetIkCacheEnabled(bool enabled);
+	bool IkCacheEnabled() const
+	{
+		return m_ikCacheEnabled;
+	}
+	// Initialize からの累計
+	uint64_t IkCacheHits() const
+	{
+		return m_ikCacheHits;
+	}
+	uint64_t IkCacheMisses() const
+	{
+		return m_ikCacheMisses;
+	}
+
+	// FK/IK の所要時間を加算する先 (nullptr で計測しない)
+	void SetProfile(TickProfile* profile)
+	{
+		m_profile = profile;
+	}
+
 private:
 	void CalculateLocalMatrix(size_t boneIndex);
 	void CalculateGlobalMatrix(size_t boneIndex);
-	void CalculateSkinningMatrix(size_t boneIndex);
+	bool CalculateSkinningMatrix(size_t boneIndex);
 	void ComputeBindPoseMatrices();
 
-	void SolveIKBone(size_t boneIndex);
 	void ApplyGrantToBone(size_t boneIndex);
 
 	static DirectX::XMVECTOR ClampAngle(DirectX::XMVECTOR euler,
@@ -72,6 +206,7 @@ private:
 										const DirectX::XMFLOAT3& maxAngle);
 
 	const PmxModel* m_model{ nullptr };
+	TickProfile* m_profile{ nullptr };
 	std::vector<PmxModel::Bone> m_bones;
 	std::vector<BoneState> m_boneStates;
 	std::vector<DirectX::XMFLOAT4X4> m_skinningMatrices;
@@ -85,6 +220,105 @@ private:
 	void BuildSortedBoneOrder();
 	void UpdateGlobalMatrixRecursive(size_t boneIndex);
 
+	// --- FK 用の前計算 (Initialize で構築) ---
+	// ボーン番号で引く。PmxModel::Bone を毎回読まずに済むよう必要な値だけ抜き出す。
+	std::vector<int32_t> m_fkParent;                 // 有効な親 (なければ -1)
+	std::vector<DirectX::XMFLOAT3> m_fkOffset;       // 親からの相対位置 (親なしは絶対位置)
+	std::vector<int32_t> m_grantSource;              // 付与親 (付与なしは -1)
+	std::vector<float> m_grantWeight;
+	std::vector<uint8_t> m_grantFlags;               // bit0: 回転付与 / bit1: 移動付与
+
+	// m_sortedBoneOrder を順に処理した場合と同じ結果になるよう段 (レベル) に分けた順序。
+	// 同じ段のボーンは互いの行列を読まないので、まとめて SIMD で計算でき、スレッドにも分けられる。
+	// 段 L は m_fkSchedule[m_fkLevelOffsets[L] .. m_fkLevelOffsets[L + 1])
+	std::vector<uint32_t> m_fkSchedule;
+	std::vector<uint32_t> m_fkLevelOffsets;
+	// 付与親 -> そのボーンを付与親にしているボーン (CSR)
+	std::vector<uint32_t> m_grantDependentOffsets;
+	std::vector<uint32_t> m_grantDependents;
+
+	// --- 差分更新 ---
+	// m_fkDirty: 次の FK で計算し直すボーン。ローカル姿勢が変わったボーンとその付与先、
+	//            グローバル行列の値が変わったボーンの子に立てる。
+	// m_skinningDirty: グローバル行列の値が変わり、スキニング行列を作り直すボーン。
+	// 値が変わらなければ子へは広げないので、待機中 (呼吸・まばたき・視線程度) は数本で済む。
+	std::vector<uint8_t> m_fkDirty;
+	std::vector<uint8_t> m_skinningDirty;
+	std::vector<uint32_t> m_fkWork;                  // 段ごとの計算対象 (作業用)
+	std::vector<uint64_t> m_skinningRevisions;       // ボーンごとの最終変更番号
+	uint64_t m_skinningRevision{ 0 };
+
+	void BuildForwardKinematicsSchedule();
+	void UpdateForwardKinematics();
+	void UpdateForwardKinematicsBatch(const uint32_t* boneIndices, size_t count);
+	void UpdateSkinningMatrices();
+	void SetLocalPose(size_t boneIndex, const DirectX::XMFLOAT3& translation, const DirectX::XMFLOAT4& rotation);
+	void MarkPoseChanged(size_t boneIndex);
+	void MarkAllDirty();
+	void ResolveLocalPose(size_t boneIndex, DirectX::XMVECTOR& translation, DirectX::XMVECTOR& rotation) const;
+	void XM_CALLCONV StoreBoneTransform(size_t boneIndex,
+										DirectX::FXMVECTOR row0, DirectX::FXMVECTOR row1, DirectX::FXMVECTOR row2,
+										DirectX::GXMVECTOR localTranslation, DirectX::HXMVECTOR globalTranslation);
+
+	// --- IK (Initialize でチェーンごとに前計算した手順) ---
+	struct IkLink
+	{
+		uint32_t bone{};
+		bool hasLimit{ false };
+		bool axisXOnly{ false };          // CCD で X 軸だけの関節として扱う
+		DirectX::XMFLOAT3 limitMin{};
+		DirectX::XMFLOAT3 limitMax{};
+		// リンクを回したあとエフェクタまでに更新するボーン (m_ikPaths 上、親側から)。
+		// エフェクタがリンクの子孫でなければ空で、エフェクタだけを更新する。
+		uint32_t pathBegin{};
+		uint32_t pathEnd{};
+	};
+	struct IkProgram
+	{
+		uint32_t ikBone{};
+		uint32_t target{};
+		float limitAngle{};
+		int32_t loopCount{};
+		// 解析的 2 ボーン IK を試す場合の 1 軸制限リンクと付け根リンク (links の番号、使わないなら -1)
+		int32_t hingeLink{ -1 };
+		int32_t rootLink{ -1 };
+		std::vector<IkLink> links;
+		// 依存関係の判定用。読むボーン (行列・姿勢・付与元) と書き換えるボーン (昇順)
+		std::vector<uint32_t> reads;
+		std::vector<uint32_t> writes;
+		// 書き換えるボーンを FK の順に並べたもの (結果を再利用したときの行列更新用)
+		std::vector<uint32_t> refreshOrder;
+	};
+	// IK ごとの前回の入力と結果
+	struct IkCache
+	{
+		bool valid{ false };
+		std::vector<float> key;                       // reads - writes の行列と姿勢、writes の姿勢
+		std::vector<float> scratch;
+		std::vector<DirectX::XMFLOAT4> linkRotations; // 解いた後のリンク回転
+		uint64_t hits{ 0 };
+		uint64_t misses{ 0 };
+	};
+	std::vector<IkProgram> m_ikPrograms;   // m_sortedBoneOrder 順
+	std::vector<uint32_t> m_ikPaths;
+	// 読み書きが重ならない IK をまとめた段。段の中は同時に解いてよい。
+	// 段 W は m_ikWaveOrder[m_ikWaveOffsets[W] .. m_ikWaveOffsets[W + 1])
+	std::vector<uint32_t> m_ikWaveOrder;
+	std::vector<uint32_t> m_ikWaveOffsets;
+
+	std::vector<IkCache> m_ikCaches;
+	// IK ボーン番号で引く無効フラグ (ポーズ由来 / アプリ由来)
+	std::vector<uint8_t> m_ikDisabledByPose;
+	std::vector<uint8_t> m_ikDisabledByUser;
+	bool m_ikCacheEnabled{ true };
+	uint64_t m_ikCacheHits{ 0 };
+	uint64_t m_ikCacheMisses{ 0 };
+
+	void BuildIkPrograms();
+	void SolveIkCached(size_t programIndex);
+	void SolveIkProgram(const IkProgram& program);
+	void UpdateIkPath(const IkProgram& program, const IkLink& link);
+
 	// IK制限のEuler連続性用
 	std::vector<DirectX::XMFLOAT3> m_lastIkDominantEuler;
 	std::vector<uint8_t>           m_hasLastIkDominantEuler;
@@ -0,0 +1,81 @@
+﻿#include "Cp932.hpp"
+
+namespace Cp932::detail
+{
+	extern const std::uint16_t DoubleByteTable[60 * 189];
+}
+
+namespace
+{
+	// MultiByteToWideChar(932) の既定文字
+	constexpr wchar_t DefaultChar = 0x30FB;
+
+	int LeadIndex(std::uint8_t b)
+	{
+		if (b >= 0x81 && b <= 0x9F) return b - 0x81;
+		if (b >= 0xE0 && b <= 0xFC) return b - 0xE0 + 31;
+		return -1;
+	}
+
+	wchar_t SingleByte(std::uint8_t b)
+	{
+		if (b < 0x80) return static_cast<wchar_t>(b);
+		// 半角カナ
+		if (b >= 0xA1 && b <= 0xDF) return static_cast<wchar_t>(0xFF61 + (b - 0xA1));
+		// Windows の対応表に合わせる
+		if (b == 0x80) return static_cast<wchar_t>(0x0080);
+		if (b == 0xA0) return static_cast<wchar_t>(0xF8F0);
+		if (b >= 0xFD) return static_cast<wchar_t>(0xF8F1 + (b - 0xFD));
+		return DefaultChar;
+	}
+}
+
+namespace Cp932
+{
+	std::wstring ToWide(std::string_view bytes)
+	{
+		std::wstring out;
+		out.reserve(bytes.size());
+
+		const size_t n = bytes.size();
+		for (size_t i = 0; i < n; ++i)
+		{
+			const auto b = static_cast<std::uint8_t>(bytes[i]);
+			const int lead = LeadIndex(b);
+			if (lead < 0)
+			{
+				out.push_back(SingleByte(b));
+				continue;
+			}
+
+			// 固定長フィールドで途中で切れた先行バイトは捨てる
+			if (i + 1 >= n) break;
+
+			const auto t = static_cast<std::uint8_t>(bytes[i + 1]);
+			if (t < 0x40 || t > 0xFC)
+			{
+				// 後続バイトとして不正なら先行バイトだけを既定文字にして次へ
+				out.push_back(DefaultChar);
+				continue;
+			}
+
+			const std::uint16_t u = detail::DoubleByteTable[lead * 189 + (t - 0x40)];
+			out.push_back(u ? static_cast<wchar_t>(u) : DefaultChar);
+			++i;
+		}
+		return out;
+	}
+
+	size_t LengthZ(std::span<const std::uint8_t> bytes)
+	{
+		size_t n = 0;
+		while (n < bytes.size() && bytes[n] != 0) ++n;
+		return n;
+	}
+
+	std::wstring ToWideZ(std::span<const std::uint8_t> bytes)
+	{
+		const size_t n = LengthZ(bytes);
+		return ToWide(std::string_view(reinterpret_cast<const char*>(bytes.data()), n));
+	}
+}
@@ -0,0 +1,19 @@
+﻿#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+// OS の API に依存しない CP932 (Shift-JIS) → wstring 変換。
+// VMD のボーン名/モーフ名など、固定長で NUL 終端されたフィールドの変換に使う。
+namespace Cp932
+{
+	// bytes 全体を変換する。未定義の文字は U+30FB (・) になる。
+	std::wstring ToWide(std::string_view bytes);
+
+	// 最初の NUL までを変換する (固定長フィールド用)
+	std::wstring ToWideZ(std::span<const std::uint8_t> bytes);
+
+	// 最初の NUL までの長さ
+	size_t LengthZ(std::span<const std::uint8_t> bytes);
+}
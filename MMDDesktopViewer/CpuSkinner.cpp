@@ -0,0 +1,256 @@
+﻿#include "CpuSkinner.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "BoneSolver.hpp"
+#include "JobSystem.hpp"
+#include "PmxVertexStreams.hpp"
+
+using namespace DirectX;
+
+namespace
+{
+	JobSystem::LoopSite g_linearSite{ "skinning.linear" };
+	JobSystem::LoopSite g_sdefSite{ "skinning.sdef" };
+}
+
+void CpuSkinner::Initialize(const PmxModel* model)
+{
+	m_boneCount = 0;
+	m_restPositions.clear();
+	m_restNormals.clear();
+	m_linear.clear();
+	m_sdef.clear();
+	m_matrices.clear();
+	m_rotations.clear();
+	m_positions.clear();
+	m_normals.clear();
+
+	if (!model) return;
+
+	const auto& verts = model->Vertices();
+	m_boneCount = model->Bones().size();
+	// シェーダーのパレットに載るボーン (これ以上の番号はシェーダーが無視する)
+	const auto paletteBones = static_cast<std::int32_t>(BoneSolver::MaxBones);
+
+	m_restPositions.resize(verts.size());
+	m_restNormals.resize(verts.size());
+	m_linear.reserve(verts.size());
+
+	for (size_t vi = 0; vi < verts.size(); ++vi)
+	{
+		const auto& v = verts[vi];
+		m_restPositions[vi] = { v.px, v.py, v.pz };
+		m_restNormals[vi] = { v.nx, v.ny, v.nz };
+
+		// 頂点バッファに載るのと同じウェイト
+		std::int32_t bones[4];
+		float weights[4];
+		PmxVertexStreams::CleanBoneWeights(v.weight, m_boneCount, bones, weights);
+
+		// ここからはシェーダー (VSMain) の判定。ウェイトの合計がほぼ 0 なら変形しない
+		float streamWeight = 0.0f;
+		for (int i = 0; i < 4; ++i)
+		{
+			if (bones[i] >= 0) streamWeight += weights[i];
+		}
+		if (!(streamWeight > 0.001f))
+		{
+			LinearVertex lv{};
+			lv.vertex = static_cast<std::uint32_t>(vi);
+			m_linear.push_back(lv);
+			continue;
+		}
+
+		if (v.weight.type == 3 && bones[0] >= 0 && bones[1] >= 0 && bones[0] < paletteBones && bones[1] < paletteBones)
+		{
+			SdefVertex sv{};
+			sv.vertex = static_cast<std::uint32_t>(vi);
+			sv.bones[0] = static_cast<std::uint32_t>(bones[0]);
+			sv.bones[1] = static_cast<std::uint32_t>(bones[1]);
+
+			float w0 = std::clamp(weights[0], 0.0f, 1.0f);
+			const float w1Raw = std::clamp(weights[1], 0.0f, 1.0f);
+			float w1 = (w1Raw > 0.0001f) ? w1Raw : (1.0f - w0);
+			const float sumW = w0 + w1;
+			if (sumW > 0.0001f)
+			{
+				w0 /= sumW;
+				w1 /= sumW;
+			}
+			else
+			{
+				w0 = 1.0f;
+				w1 = 0.0f;
+			}
+			sv.weights[0] = w0;
+			sv.weights[1] = w1;
+
+			const XMVECTOR c = XMLoadFloat3(&v.weight.sdefC);
+			const XMVECTOR r0 = XMLoadFloat3(&v.weight.sdefR0);
+			const XMVECTOR r1 = XMLoadFloat3(&v.weight.sdefR1);
+			const XMVECTOR rTilde = XMVectorAdd(XMVectorScale(r0, w0), XMVectorScale(r1, w1));
+			XMStoreFloat3(&sv.c, c);
+			XMStoreFloat3(&sv.c0, XMVectorMultiplyAdd(XMVectorSubtract(r0, rTilde), XMVectorReplicate(0.5f), c));
+			XMStoreFloat3(&sv.c1, XMVectorMultiplyAdd(XMVectorSubtract(r1, rTilde), XMVectorReplicate(0.5f), c));
+			m_sdef.push_back(sv);
+			continue;
+		}
+
+		// SDEF でも 2 本そろわなければ線形 (シェーダーと同じ)。
+		// GetSkinMatrix と同じく、パレット外とウェイト 0 以下のボーンを除いて合計で割る
+		LinearVertex lv{};
+		lv.vertex = static_cast<std::uint32_t>(vi);
+		float linearWeight = 0.0f;
+		for (int i = 0; i < 4; ++i)
+		{
+			if (bones[i] < 0 || bones[i] >= paletteBones || !(weights[i] > 0.0f)) continue;
+			lv.bones[lv.boneCount] = static_cast<std::uint32_t>(bones[i]);
+			lv.weights[lv.boneCount] = weights[i];
+			linearWeight += weights[i];
+			++lv.boneCount;
+		}
+		if (linearWeight < 0.001f)
+		{
+			lv.boneCount = 0;
+		}
+		else
+		{
+			for (std::uint32_t k = 0; k < lv.boneCount; ++k) lv.weights[k] /= linearWeight;
+		}
+		m_linear.push_back(lv);
+	}
+
+	m_positions = m_restPositions;
+	m_normals = m_restNormals;
+}
+
+void CpuSkinner::Skin(const std::vector<XMFLOAT4X4>& skinningMatrices, const XMFLOAT3* positions)
+{
+	if (m_restPositions.empty()) return;
+	if (skinningMatrices.size() < m_boneCount)
+	{
+		throw std::out_of_range("CpuSkinner::Skin: not enough skinning matrices");
+	}
+
+	m_matrices.resize(m_boneCount);
+	for (size_t i = 0; i < m_boneCount; ++i)
+	{
+		m_matrices[i] = XMLoadFloat4x4(&skinningMatrices[i]);
+	}
+
+	if (!m_sdef.empty())
+	{
+		m_rotations.resize(m_boneCount);
+		for (size_t i = 0; i < m_boneCount; ++i)
+		{
+			m_rotations[i] = XMQuaternionNormalize(XMQuaternionRotationMatrix(m_matrices[i]));
+		}
+	}
+
+	const XMFLOAT3* src = positions ? positions : m_restPositions.data();
+	SkinLinear(src);
+	SkinSdef(src);
+}
+
+void CpuSkinner::SkinLinear(const XMFLOAT3* positions)
+{
+	const XMMATRIX* matrices = m_matrices.data();
+	const LinearVertex* linear = m_linear.data();
+	XMFLOAT3* outPositions = m_positions.data();
+	XMFLOAT3* outNormals = m_normals.data();
+	const XMFLOAT3* restNormals = m_restNormals.data();
+
+	JobSystem::Shared().ParallelFor(g_linearSite, m_linear.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+		{
+			const LinearVertex& lv = linear[i];
+			const XMVECTOR pos = XMLoadFloat3(&positions[lv.vertex]);
+			const XMVECTOR nrm = XMLoadFloat3(&restNormals[lv.vertex]);
+
+			if (lv.boneCount == 0)
+			{
+				XMStoreFloat3(&outPositions[lv.vertex], pos);
+				XMStoreFloat3(&outNormals[lv.vertex], nrm);
+				continue;
+			}
+
+			// 行列をウェイトで混ぜてから 1 回だけ変換する (シェーダーの GetSkinMatrix と同じ)
+			const XMMATRIX& m0 = matrices[lv.bones[0]];
+			const XMVECTOR w0 = XMVectorReplicate(lv.weights[0]);
+			XMMATRIX blended;
+			blended.r[0] = XMVectorMultiply(m0.r[0], w0);
+			blended.r[1] = XMVectorMultiply(m0.r[1], w0);
+			blended.r[2] = XMVectorMultiply(m0.r[2], w0);
+			blended.r[3] = XMVectorMultiply(m0.r[3], w0);
+			for (std::uint32_t k = 1; k < lv.boneCount; ++k)
+			{
+				const XMMATRIX& m = matrices[lv.bones[k]];
+				const XMVECTOR w = XMVectorReplicate(lv.weights[k]);
+				blended.r[0] = XMVectorMultiplyAdd(m.r[0], w, blended.r[0]);
+				blended.r[1] = XMVectorMultiplyAdd(m.r[1], w, blended.r[1]);
+				blended.r[2] = XMVectorMultiplyAdd(m.r[2], w, blended.r[2]);
+				blended.r[3] = XMVectorMultiplyAdd(m.r[3], w, blended.r[3]);
+			}
+
+			XMStoreFloat3(&outPositions[lv.vertex], XMVector3Transform(pos, blended));
+			XMStoreFloat3(&outNormals[lv.vertex], XMVector3Normalize(XMVector3TransformNormal(nrm, blended)));
+		}
+	});
+}
+
+void CpuSkinner::SkinSdef(const XMFLOAT3* positions)
+{
+	const XMMATRIX* matrices = m_matrices.data();
+	const XMVECTOR* rotations = m_rotations.data();
+	const SdefVertex* sdef = m_sdef.data();
+	XMFLOAT3* outPositions = m_positions.data();
+	XMFLOAT3* outNormals = m_normals.data();
+	const XMFLOAT3* restNormals = m_restNormals.data();
+
+	JobSystem::Shared().ParallelFor(g_sdefSite, m_sdef.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+		{
+			const SdefVertex& sv = sdef[i];
+			const XMMATRIX& matA = matrices[sv.bones[0]];
+			const XMMATRIX& matB = matrices[sv.bones[1]];
+
+			// 回転は 2 本のクォータニオンを混ぜ、C0/C1 の移動は各ボーンの行列で動かす
+			const XMVECTOR qa = rotations[sv.bones[0]];
+			XMVECTOR qb = rotations[sv.bones[1]];
+			if (XMVectorGetX(XMVector4Dot(qa, qb)) < 0.0f) qb = XMVectorNegate(qb);
+			const XMVECTOR q = XMQuaternionNormalize(
+				XMVectorAdd(XMVectorScale(qa, sv.weights[0]), XMVectorScale(qb, sv.weights[1])));
+
+			const XMVECTOR term0 = XMVectorScale(XMVector3Transform(XMLoadFloat3(&sv.c0), matA), sv.weights[0]);
+			const XMVECTOR term1 = XMVectorScale(XMVector3Transform(XMLoadFloat3(&sv.c1), matB), sv.weights[1]);
+			const XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&positions[sv.vertex]), XMLoadFloat3(&sv.c));
+
+			XMStoreFloat3(&outPositions[sv.vertex], XMVectorAdd(XMVectorAdd(term0, term1), XMVector3Rotate(offset, q)));
+			XMStoreFloat3(&outNormals[sv.vertex], XMVector3Normalize(XMVector3Rotate(XMLoadFloat3(&restNormals[sv.vertex]), q)));
+		}
+	});
+}
+
+void CpuSkinner::GetBounds(XMFLOAT3& outMin, XMFLOAT3& outMax) const
+{
+	if (m_positions.empty())
+	{
+		outMin = { 0, 0, 0 };
+		outMax = { 0, 0, 0 };
+		return;
+	}
+
+	XMVECTOR mn = XMVectorReplicate(std::numeric_limits<float>::max());
+	XMVECTOR mx = XMVectorReplicate(std::numeric_limits<float>::lowest());
+	for (const auto& p : m_positions)
+	{
+		const XMVECTOR v = XMLoadFloat3(&p);
+		mn = XMVectorMin(mn, v);
+		mx = XMVectorMax(mx, v);
+	}
+	XMStoreFloat3(&outMin, mn);
+	XMStoreFloat3(&outMax, mx);
+}
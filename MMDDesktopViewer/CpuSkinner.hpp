@@ -0,0 +1,76 @@
+﻿#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <DirectXMath.h>
+#include "PmxModel.hpp"
+
+// PMX の頂点を CPU でスキニングする (PMX_VS.hlsl と同じ計算)。
+// GPU を使わない参照実装として、また境界・当たり判定・サムネイル用の変形後メッシュとして使う。
+// BDEF1/BDEF2/BDEF4/QDEF は線形ブレンド (シェーダーと同じく QDEF も線形)、SDEF は C/R0/R1 を使う。
+class CpuSkinner
+{
+public:
+	CpuSkinner() = default;
+
+	// 頂点ウェイトを頂点バッファと同じ PmxVertexStreams::CleanBoneWeights で整え、シェーダーと同じ判定で並べ直す
+	void Initialize(const PmxModel* model);
+
+	// skinningMatrices: BoneSolver::GetSkinningMatrices() (モデルのボーン数以上)
+	// positions: モーフ適用後の頂点位置 (VertexCount() 個)。nullptr ならモデルの頂点位置
+	void Skin(const std::vector<DirectX::XMFLOAT4X4>& skinningMatrices, const DirectX::XMFLOAT3* positions = nullptr);
+
+	size_t VertexCount() const
+	{
+		return m_restPositions.size();
+	}
+	const std::vector<DirectX::XMFLOAT3>& Positions() const
+	{
+		return m_positions;
+	}
+	const std::vector<DirectX::XMFLOAT3>& Normals() const
+	{
+		return m_normals;
+	}
+
+	// 直前の Skin の結果を囲む箱 (頂点がなければ原点)
+	void GetBounds(DirectX::XMFLOAT3& outMin, DirectX::XMFLOAT3& outMax) const;
+
+private:
+	// 線形ブレンドする頂点 (影響ボーンなしは boneCount == 0 で、変形しない)
+	struct LinearVertex
+	{
+		std::uint32_t vertex{};
+		std::uint32_t boneCount{};
+		std::uint32_t bones[4]{};
+		float weights[4]{};
+	};
+
+	// SDEF の頂点。C0/C1 はウェイトだけで決まるので前計算しておく
+	struct SdefVertex
+	{
+		std::uint32_t vertex{};
+		std::uint32_t bones[2]{};
+		float weights[2]{};
+		DirectX::XMFLOAT3 c{};
+		DirectX::XMFLOAT3 c0{};
+		DirectX::XMFLOAT3 c1{};
+	};
+
+	void SkinLinear(const DirectX::XMFLOAT3* positions);
+	void SkinSdef(const DirectX::XMFLOAT3* positions);
+
+	size_t m_boneCount{ 0 };
+
+	std::vector<DirectX::XMFLOAT3> m_restPositions;
+	std::vector<DirectX::XMFLOAT3> m_restNormals;
+	std::vector<LinearVertex> m_linear;
+	std::vector<SdefVertex> m_sdef;
+
+	// Skin ごとの作業領域 (行列は揃えて読み直す。クォータニオンは SDEF 用)
+	std::vector<DirectX::XMMATRIX> m_matrices;
+	std::vector<DirectX::XMVECTOR> m_rotations;
+
+	std::vector<DirectX::XMFLOAT3> m_positions;
+	std::vector<DirectX::XMFLOAT3> m_normals;
+};
@@ -407,7 +407,7 @@ void DcompRenderer::CreateBoneBuffers()
 
 		for (size_t b = 0; b < PmxModelDrawer::MaxBones; ++b)
 		{
-			DirectX::XMStoreFloat4x4(&m_boneCbMapped[i]->boneMatrices[b], DirectX::XMMatrixIdentity());
+			DirectX::XMStoreFloat3x4(&m_boneCbMapped[i]->boneMatrices[b], DirectX::XMMatrixIdentity());
 		}
 	}
 }
@@ -806,7 +806,7 @@ void DcompRenderer::Render(const MmdAnimator& animator)
 
 		m_cmdList->SetGraphicsRootSignature(m_pipeline.GetPmxRootSignature());
 		m_cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		m_cmdList->IASetVertexBuffers(0, 1, &pmx.vbv);
+		m_cmdList->IASetVertexBuffers(0, 2, pmx.vbvs);
 		m_cmdList->IASetIndexBuffer(&pmx.ibv);
 
 		m_cmdList->SetGraphicsRootConstantBufferView(0, m_sceneCb[frameIndex]->GetGPUVirtualAddress());
@@ -844,7 +844,7 @@ void DcompRenderer::Render(const MmdAnimator& animator)
 		m_cmdList->SetPipelineState(m_pipeline.GetEdgePso());
 		m_cmdList->SetGraphicsRootSignature(m_pipeline.GetPmxRootSignature());
 		m_cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		m_cmdList->IASetVertexBuffers(0, 1, &pmx.vbv);
+		m_cmdList->IASetVertexBuffers(0, 2, pmx.vbvs);
 		m_cmdList->IASetIndexBuffer(&pmx.ibv);
 
 		m_cmdList->SetGraphicsRootConstantBufferView(0, m_sceneCb[frameIndex]->GetGPUVirtualAddress());
@@ -1207,19 +1207,15 @@ void DcompRenderer::LoadTexturesForModel(const PmxModel* model,
 
 	m_gpuResources.CreateUploadObjects();
 
-	for (size_t i = 0; i < total; ++i)
-	{
-		if (onProgress && (i % 5 == 0 || i == total - 1))
-		{
-			float ratio = (float)i / (float)total;
-			float current = startProgress + ratio * (endProgress - startProgress);
+	m_gpuResources.LoadTextureSrvs(texPaths, [&](size_t done, size_t count) {
+		if (!onProgress || (done % 5 != 0 && done != count)) return;
 
-			auto buf = std::format(L"テクスチャ読み込み中 ({}/{})...", i + 1, total);
-			onProgress(current, buf.c_str());
-		}
+		float ratio = (float)done / (float)count;
+		float current = startProgress + ratio * (endProgress - startProgress);
 
-		m_gpuResources.LoadTextureSrv(texPaths[i]);
-	}
+		auto buf = std::format(L"テクスチャ読み込み中 ({}/{})...", done, count);
+		onProgress(current, buf.c_str());
+	});
 }
 
 DirectX::XMFLOAT3 DcompRenderer::ProjectToScreen(const DirectX::XMFLOAT3& localPos) const
@@ -69,9 +69,20 @@ cbuffer Material : register(b1)
 
 cbuffer BoneCB : register(b2)
 {
-    float4x4 g_boneMatrices[1024];
+    float4x3 g_boneMatrices[1024];
 };
 
+float4x4 LoadBoneMatrix(int index)
+{
+    float4x3 m = g_boneMatrices[index];
+    return float4x4(
+        float4(m[0], 0.0),
+        float4(m[1], 0.0),
+        float4(m[2], 0.0),
+        float4(m[3], 1.0)
+    );
+}
+
 struct VSIn
 {
     float3 pos : POSITION;
@@ -100,7 +111,7 @@ float4x4 GetSkinMatrix(int4 indices, float4 weights)
     {
         if (indices[i] >= 0 && indices[i] < 1024 && weights[i] > 0.0)
         {
-            skinMat += g_boneMatrices[indices[i]] * weights[i];
+            skinMat += LoadBoneMatrix(indices[i]) * weights[i];
             totalWeight += weights[i];
         }
     }
@@ -192,10 +203,10 @@ void ApplySdefSkin(VSIn i, out float3 skinnedPos, out float3 skinnedNrm)
         w1 = 0.0;
     }
 
-    float4x4 matA4 = g_boneMatrices[idx0];
-    float4x4 matB4 = g_boneMatrices[idx1];
-    float3x3 matA = (float3x3) matA4;
-    float3x3 matB = (float3x3) matB4;
+    float4x4 matA4 = LoadBoneMatrix(idx0);
+    float4x4 matB4 = LoadBoneMatrix(idx1);
+    float3x3 matA = transpose((float3x3) matA4);
+    float3x3 matB = transpose((float3x3) matB4);
 
     float4 qa = QuaternionFromMatrix(matA);
     float4 qb = QuaternionFromMatrix(matB);
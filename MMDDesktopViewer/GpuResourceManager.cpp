@@ -4,14 +4,19 @@
 #include "ExceptionHelper.hpp"
 #include "WicTexture.hpp"
 #include "DebugUtil.hpp"
+#include "JobSystem.hpp"
 
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <memory>
 #include <stdexcept>
+#include <unordered_set>
 
 namespace
 {
+	JobSystem::LoopSite g_mipRowSite{ "texture.mip_rows" };
+
 	static float Lanczos(float x, float a = 3.0f)
 	{
 		if (std::abs(x) < 1e-6f) return 1.0f;
@@ -94,76 +99,76 @@ namespace
 				}
 			}
 
-#if defined(_OPENMP)
-#pragma omp parallel for schedule(static)
-#endif
-			for (int yi = 0; yi < (int)nh; ++yi)
-			{
-				const uint32_t y = (uint32_t)yi;
-
-				std::array<int, kTaps> pyA{};
-				std::array<float, kTaps> wyA{};
-				std::array<size_t, kTaps> rowBaseA{};
-
-				const float centerY = (y + 0.5f) * scaleY - 0.5f;
-				const int startY = (int)std::floor(centerY) - kRadius + 1;
-
-				for (int ky = 0; ky < kTaps; ++ky)
+			// 行ごとに独立。小さいミップは逐次のまま回る
+			JobSystem::Shared().ParallelFor(g_mipRowSite, nh, nw, [&](size_t rowBegin, size_t rowEnd) {
+				for (size_t yi = rowBegin; yi < rowEnd; ++yi)
 				{
-					const int py = clampi(startY + ky, 0, (int)ch - 1);
-					pyA[ky] = py;
-					wyA[ky] = Lanczos(centerY - (float)py);
-					rowBaseA[ky] = (size_t)py * (size_t)cw * 4;
-				}
+					const uint32_t y = (uint32_t)yi;
 
-				for (uint32_t x = 0; x < nw; ++x)
-				{
-					const auto& pxA = pxTable[x];
-					const auto& wxA = wxTable[x];
+					std::array<int, kTaps> pyA{};
+					std::array<float, kTaps> wyA{};
+					std::array<size_t, kTaps> rowBaseA{};
 
-					float acc0 = 0.0f, acc1 = 0.0f, acc2 = 0.0f, acc3 = 0.0f;
-					float weightSum = 0.0f;
+					const float centerY = (y + 0.5f) * scaleY - 0.5f;
+					const int startY = (int)std::floor(centerY) - kRadius + 1;
 
 					for (int ky = 0; ky < kTaps; ++ky)
 					{
-						const float wy = wyA[ky];
-						const size_t rowBase = rowBaseA[ky];
+						const int py = clampi(startY + ky, 0, (int)ch - 1);
+						pyA[ky] = py;
+						wyA[ky] = Lanczos(centerY - (float)py);
+						rowBaseA[ky] = (size_t)py * (size_t)cw * 4;
+					}
 
-						for (int kx = 0; kx < kTaps; ++kx)
-						{
-							const float weight = wxA[kx] * wy;
-							weightSum += weight;
+					for (uint32_t x = 0; x < nw; ++x)
+					{
+						const auto& pxA = pxTable[x];
+						const auto& wxA = wxTable[x];
 
-							const size_t idx = rowBase + (size_t)pxA[kx] * 4;
+						float acc0 = 0.0f, acc1 = 0.0f, acc2 = 0.0f, acc3 = 0.0f;
+						float weightSum = 0.0f;
 
-							const uint8_t r8 = prev[idx + 0];
-							const uint8_t g8 = prev[idx + 1];
-							const uint8_t b8 = prev[idx + 2];
-							const uint8_t a8 = prev[idx + 3];
+						for (int ky = 0; ky < kTaps; ++ky)
+						{
+							const float wy = wyA[ky];
+							const size_t rowBase = rowBaseA[ky];
+
+							for (int kx = 0; kx < kTaps; ++kx)
+							{
+								const float weight = wxA[kx] * wy;
+								weightSum += weight;
+
+								const size_t idx = rowBase + (size_t)pxA[kx] * 4;
+
+								const uint8_t r8 = prev[idx + 0];
+								const uint8_t g8 = prev[idx + 1];
+								const uint8_t b8 = prev[idx + 2];
+								const uint8_t a8 = prev[idx + 3];
+
+								acc0 += kToLinear[r8] * weight;
+								acc1 += kToLinear[g8] * weight;
+								acc2 += kToLinear[b8] * weight;
+								acc3 += kToNorm[a8] * weight;
+							}
+						}
 
-							acc0 += kToLinear[r8] * weight;
-							acc1 += kToLinear[g8] * weight;
-							acc2 += kToLinear[b8] * weight;
-							acc3 += kToNorm[a8] * weight;
+						if (weightSum > 0.0f)
+						{
+							const float invW = 1.0f / weightSum;
+							acc0 *= invW;
+							acc1 *= invW;
+							acc2 *= invW;
+							acc3 *= invW;
 						}
-					}
 
-					if (weightSum > 0.0f)
-					{
-						const float invW = 1.0f / weightSum;
-						acc0 *= invW;
-						acc1 *= invW;
-						acc2 *= invW;
-						acc3 *= invW;
+						const size_t di = ((size_t)y * nw + x) * 4;
+						dst[di + 0] = (uint8_t)std::clamp(std::pow(acc0, kInvGamma) * 255.0f, 0.0f, 255.0f);
+						dst[di + 1] = (uint8_t)std::clamp(std::pow(acc1, kInvGamma) * 255.0f, 0.0f, 255.0f);
+						dst[di + 2] = (uint8_t)std::clamp(std::pow(acc2, kInvGamma) * 255.0f, 0.0f, 255.0f);
+						dst[di + 3] = (uint8_t)std::clamp(acc3 * 255.0f, 0.0f, 255.0f);
 					}
-
-					const size_t di = ((size_t)y * nw + x) * 4;
-					dst[di + 0] = (uint8_t)std::clamp(std::pow(acc0, kInvGamma) * 255.0f, 0.0f, 255.0f);
-					dst[di + 1] = (uint8_t)std::clamp(std::pow(acc1, kInvGamma) * 255.0f, 0.0f, 255.0f);
-					dst[di + 2] = (uint8_t)std::clamp(std::pow(acc2, kInvGamma) * 255.0f, 0.0f, 255.0f);
-					dst[di + 3] = (uint8_t)std::clamp(acc3 * 255.0f, 0.0f, 255.0f);
 				}
-			}
+			});
 
 			mips.emplace_back(std::move(next));
 			cw = nw;
@@ -330,21 +335,90 @@ uint32_t GpuResourceManager::LoadTextureSrv(const std::filesystem::path& path)
 		return m_defaultWhiteSrv;
 	}
 
+	DecodedTexture decoded = DecodeTexture(path);
+	return UploadTexture(key, decoded);
+}
+
+void GpuResourceManager::LoadTextureSrvs(const std::vector<std::filesystem::path>& paths,
+										 const std::function<void(size_t, size_t)>& onProgress)
+{
+	// 未読み込みのものだけを、重複を除いて拾う
+	std::vector<const std::filesystem::path*> pending;
+	std::unordered_set<std::wstring> seen;
+	for (const auto& path : paths)
+	{
+		std::wstring key = path.wstring();
+		if (m_textureCache.contains(key) || !seen.insert(key).second) continue;
+
+		if (!std::filesystem::exists(path))
+		{
+			m_textureCache[key] = m_defaultWhiteSrv;
+			continue;
+		}
+		pending.push_back(&path);
+	}
+
+	const size_t count = pending.size();
+	if (count == 0) return;
+
+	// デコード済みの画像を全部抱えるとメモリが膨らむので、先読みは並列度ぶんまでにする
+	JobSystem& jobs = JobSystem::Shared();
+	const size_t window = std::min<size_t>(count, jobs.Concurrency() + 1);
+	std::vector<DecodedTexture> decoded(window);
+	std::vector<std::unique_ptr<JobSystem::TaskGroup>> groups;
+	groups.reserve(window);
+	for (size_t i = 0; i < window; ++i)
+	{
+		groups.push_back(std::make_unique<JobSystem::TaskGroup>(jobs));
+	}
+
+	auto submit = [&](size_t i) {
+		DecodedTexture& slot = decoded[i % window];
+		const std::filesystem::path& path = *pending[i];
+		groups[i % window]->Run("texture.decode", [&slot, &path] { slot = DecodeTexture(path); });
+	};
+
+	for (size_t i = 0; i < window; ++i) submit(i);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const size_t slot = i % window;
+		groups[slot]->Wait();
+
+		// GPU への転送は呼び出し元で読み込み順に行う (SRV の番号を逐次読み込みと揃える)
+		UploadTexture(pending[i]->wstring(), decoded[slot]);
+		decoded[slot] = {};
+
+		if (i + window < count) submit(i + window);
+		if (onProgress) onProgress(i + 1, count);
+	}
+}
+
+GpuResourceManager::DecodedTexture GpuResourceManager::DecodeTexture(const std::filesystem::path& path)
+{
 	WicImage img = WicTexture::LoadRgba(path);
-	auto mips = BuildMipChainRGBA(img.rgba.data(), img.width, img.height);
 
+	DecodedTexture decoded;
+	decoded.width = img.width;
+	decoded.height = img.height;
+	decoded.mips = BuildMipChainRGBA(img.rgba.data(), img.width, img.height);
+	return decoded;
+}
+
+uint32_t GpuResourceManager::UploadTexture(const std::wstring& key, const DecodedTexture& decoded)
+{
 	const uint32_t srvIndex = AllocSrvIndex();
-	auto tex = CreateTexture2DFromRgbaMips(img.width, img.height, mips);
+	auto tex = CreateTexture2DFromRgbaMips(decoded.width, decoded.height, decoded.mips);
 
 	D3D12_SHADER_RESOURCE_VIEW_DESC srv{};
 	srv.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 	srv.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
 	srv.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srv.Texture2D.MipLevels = (UINT)mips.size();
+	srv.Texture2D.MipLevels = (UINT)decoded.mips.size();
 
 	m_ctx->Device()->CreateShaderResourceView(tex.get(), &srv, GetSrvCpuHandle(srvIndex));
 
-	m_textures.push_back(GpuTexture{ tex, srvIndex, img.width, img.height });
+	m_textures.push_back(GpuTexture{ tex, srvIndex, decoded.width, decoded.height });
 
 	m_textureCache[key] = srvIndex;
 	return srvIndex;
@@ -30,6 +30,10 @@ public:
 	void ResetTextureCache();
 
 	uint32_t LoadTextureSrv(const std::filesystem::path& path);
+	// まとめて読み込む。デコードとミップ生成は JobSystem で並列に、GPU への転送は呼び出し元で順に行う。
+	// onProgress(転送済みの数, 新たに読み込む数)
+	void LoadTextureSrvs(const std::vector<std::filesystem::path>& paths,
+						 const std::function<void(size_t, size_t)>& onProgress);
 
 	ID3D12DescriptorHeap* GetSrvHeap() const
 	{
@@ -64,6 +68,17 @@ public:
 	}
 
 private:
+	// デコードとミップ生成の結果 (GPU に触れないのでどのスレッドで作ってもよい)
+	struct DecodedTexture
+	{
+		uint32_t width{};
+		uint32_t height{};
+		std::vector<std::vector<uint8_t>> mips;
+	};
+
+	static DecodedTexture DecodeTexture(const std::filesystem::path& path);
+	uint32_t UploadTexture(const std::wstring& key, const DecodedTexture& decoded);
+
 	winrt::com_ptr<ID3D12Resource> CreateTexture2DFromRgba(
 		const uint8_t* rgba, uint32_t width, uint32_t height);
 
@@ -0,0 +1,640 @@
+﻿#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#include <objbase.h>
+#endif
+
+namespace
+{
+	// 仕事が途切れてから眠るまで回って待つ時間。物理のサブステップのように
+	// 短いループが続くときに、毎回起こし直す遅延を払わないようにする
+	constexpr auto IdleSpin = std::chrono::microseconds(50);
+
+	// チャンクの取り出しにかかる時間がチャンク自体の処理時間のこの割合以下になるよう粒度を選ぶ
+	constexpr double ChunkOverheadRatio = 1.0 / 16.0;
+
+	// 移動平均で新しい計測値に掛ける重み
+	constexpr double SampleWeight = 0.25;
+
+	thread_local const JobSystem* t_owner = nullptr;
+	thread_local unsigned t_index = 0;
+	thread_local const JobSystem* t_externalOwner = nullptr;
+	thread_local unsigned t_externalSlot = 0;
+
+	double ToNanoseconds(JobSystem::Clock::duration d)
+	{
+		return std::chrono::duration<double, std::nano>(d).count();
+	}
+
+	// 最初に起きた例外だけを残す
+	void StoreError(std::atomic<bool>& failed, std::exception_ptr& slot)
+	{
+		bool expected = false;
+		if (failed.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+		{
+			slot = std::current_exception();
+		}
+	}
+}
+
+struct JobSystem::ForContext
+{
+	JobSystem* jobs{};
+	const char* name{};
+	void* body{};
+	RangeFn fn{};
+	std::size_t count{};
+	std::size_t grain{};
+	std::size_t chunkCount{};
+	std::atomic<std::size_t> nextChunk{ 0 };
+	std::atomic<std::uint64_t> busyNs{ 0 };
+	std::atomic<std::uint32_t> pending{ 0 };
+	std::atomic<bool> failed{ false };
+	std::exception_ptr error;
+};
+
+void JobSystem::LoopSite::Record(std::size_t items, double nanoseconds)
+{
+	if (items == 0) return;
+	const double sample = nanoseconds / static_cast<double>(items);
+	const double current = m_nsPerItem.load(std::memory_order_relaxed);
+	const double next = (current > 0.0) ? current + (sample - current) * SampleWeight : sample;
+	m_nsPerItem.store(next, std::memory_order_relaxed);
+}
+
+JobSystem::ExternalThreadScope::ExternalThreadScope(JobSystem& jobs)
+	: m_jobs(jobs)
+	, m_prevOwner(t_externalOwner)
+	, m_prevSlot(t_externalSlot)
+{
+	{
+		std::lock_guard lock(jobs.m_externalMutex);
+		for (unsigned i = 1; i < ExternalQueueCount; ++i)
+		{
+			if ((jobs.m_externalSlots & (1u << i)) == 0)
+			{
+				jobs.m_externalSlots |= 1u << i;
+				m_slot = i;
+				break;
+			}
+		}
+	}
+	// 空きがなければ共有のキュー 0 のまま
+	t_externalOwner = &jobs;
+	t_externalSlot = m_slot;
+}
+
+JobSystem::ExternalThreadScope::~ExternalThreadScope()
+{
+	t_externalOwner = m_prevOwner;
+	t_externalSlot = m_prevSlot;
+	if (m_slot != 0)
+	{
+		std::lock_guard lock(m_jobs.m_externalMutex);
+		m_jobs.m_externalSlots &= ~(1u << m_slot);
+	}
+}
+
+JobSystem::TaskGroup::TaskGroup(JobSystem& jobs)
+	: m_jobs(jobs)
+{
+}
+
+JobSystem::TaskGroup::~TaskGroup()
+{
+	// 例外はここでは投げ直さない (Wait を呼んだ側で受け取る)
+	m_jobs.Wait(m_pending);
+}
+
+void JobSystem::TaskGroup::Run(const char* name, std::function<void()> fn)
+{
+	Entry& entry = m_entries.emplace_back();
+	entry.group = this;
+	entry.name = name;
+	entry.fn = std::move(fn);
+
+	m_pending.fetch_add(1, std::memory_order_relaxed);
+	const Task task{ &TaskGroup::Execute, &entry };
+	m_jobs.Push(&task, 1);
+}
+
+void JobSystem::TaskGroup::Wait()
+{
+	m_jobs.Wait(m_pending);
+	m_entries.clear();
+
+	if (m_failed.exchange(false, std::memory_order_acq_rel))
+	{
+		std::exception_ptr error = std::move(m_error);
+		m_error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+void JobSystem::TaskGroup::Execute(void* context)
+{
+	Entry& entry = *static_cast<Entry*>(context);
+	TaskGroup& group = *entry.group;
+	JobSystem& jobs = group.m_jobs;
+
+	const bool timed = jobs.HasTimingHook();
+	const Clock::time_point begin = timed ? Clock::now() : Clock::time_point{};
+	try
+	{
+		entry.fn();
+	}
+	catch (...)
+	{
+		StoreError(group.m_failed, group.m_error);
+	}
+	if (timed) jobs.Report(entry.name, 1, begin, Clock::now());
+
+	Complete(group.m_pending);
+}
+
+JobSystem::TaskGraph::TaskId JobSystem::TaskGraph::Add(const char* name, std::function<void()> fn)
+{
+	Node& node = m_nodes.emplace_back();
+	node.graph = this;
+	node.name = name;
+	node.fn = std::move(fn);
+	return static_cast<TaskId>(m_nodes.size() - 1);
+}
+
+void JobSystem::TaskGraph::Precede(TaskId before, TaskId after)
+{
+	if (before >= m_nodes.size() || after >= m_nodes.size())
+	{
+		throw std::out_of_range("TaskGraph::Precede: task id out of range");
+	}
+	m_nodes[before].successors.push_back(after);
+	++m_nodes[after].dependencies;
+}
+
+void JobSystem::TaskGraph::Clear()
+{
+	m_nodes.clear();
+}
+
+void JobSystem::TaskGraph::Execute(void* context)
+{
+	Node& node = *static_cast<Node*>(context);
+	TaskGraph& graph = *node.graph;
+	JobSystem& jobs = *graph.m_jobs;
+
+	// 先に失敗したジョブがあれば、後続は中身を実行せずに完了扱いにする
+	if (!graph.m_failed.load(std::memory_order_acquire))
+	{
+		const bool timed = jobs.HasTimingHook();
+		const Clock::time_point begin = timed ? Clock::now() : Clock::time_point{};
+		try
+		{
+			node.fn();
+		}
+		catch (...)
+		{
+			StoreError(graph.m_failed, graph.m_error);
+		}
+		if (timed) jobs.Report(node.name, 1, begin, Clock::now());
+	}
+
+	for (TaskId s : node.successors)
+	{
+		Node& next = graph.m_nodes[s];
+		if (next.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			const Task task{ &TaskGraph::Execute, &next };
+			jobs.Push(&task, 1);
+		}
+	}
+
+	Complete(graph.m_pending);
+}
+
+JobSystem::JobSystem(unsigned workerCount)
+{
+	StartWorkers(workerCount);
+	Calibrate();
+}
+
+JobSystem::~JobSystem()
+{
+	StopWorkers();
+}
+
+JobSystem& JobSystem::Shared()
+{
+	static JobSystem shared([] {
+		const unsigned hw = std::thread::hardware_concurrency();
+		return (hw > 1) ? hw - 1 : 0u;
+	}());
+	return shared;
+}
+
+void JobSystem::SetWorkerCount(unsigned workerCount)
+{
+	if (workerCount == WorkerCount()) return;
+	StopWorkers();
+	StartWorkers(workerCount);
+	Calibrate();
+}
+
+void JobSystem::SetTimingHook(TimingHook hook)
+{
+	m_hasHook.store(false, std::memory_order_relaxed);
+	m_hook = std::move(hook);
+	m_hasHook.store(static_cast<bool>(m_hook), std::memory_order_release);
+}
+
+unsigned JobSystem::CurrentThreadIndex() const
+{
+	return (t_owner == this) ? t_index : 0u;
+}
+
+void JobSystem::StartWorkers(unsigned workerCount)
+{
+	m_stop.store(false, std::memory_order_relaxed);
+	m_queues.clear();
+	for (unsigned i = 0; i < ExternalQueueCount + workerCount; ++i)
+	{
+		m_queues.push_back(std::make_unique<WorkQueue>());
+	}
+
+	m_threads.reserve(workerCount);
+	for (unsigned i = 1; i <= workerCount; ++i)
+	{
+		m_threads.emplace_back([this, i] { WorkerLoop(i); });
+	}
+}
+
+void JobSystem::StopWorkers()
+{
+	{
+		std::lock_guard lock(m_sleepMutex);
+		m_stop.store(true, std::memory_order_relaxed);
+	}
+	m_sleepCv.notify_all();
+
+	for (auto& t : m_threads)
+	{
+		if (t.joinable()) t.join();
+	}
+	m_threads.clear();
+}
+
+void JobSystem::Calibrate()
+{
+	m_forkJoinNs = 0.0;
+	m_chunkNs = 0.0;
+	if (m_threads.empty()) return;
+
+	// 空のチャンクを 1 スレッドで取り出し続け、1 つあたりの手間を測る
+	{
+		constexpr std::size_t ChunkSamples = 4096;
+		ForContext ctx;
+		ctx.jobs = this;
+		ctx.fn = [](void*, std::size_t, std::size_t) {};
+		ctx.count = ChunkSamples;
+		ctx.grain = 1;
+		ctx.chunkCount = ChunkSamples;
+		const Clock::time_point begin = Clock::now();
+		DrainChunks(ctx);
+		m_chunkNs = ToNanoseconds(Clock::now() - begin) / static_cast<double>(ChunkSamples);
+	}
+
+	// 全ワーカーに空のジョブを配って待つ往復。立ち上がり直後の回は捨てて中央値を取る
+	constexpr int Warmup = 8;
+	constexpr int Rounds = 32;
+	std::vector<double> samples;
+	samples.reserve(Rounds);
+	for (int r = 0; r < Warmup + Rounds; ++r)
+	{
+		ForContext ctx;
+		ctx.jobs = this;
+		ctx.fn = [](void*, std::size_t, std::size_t) {};
+		ctx.pending.store(WorkerCount(), std::memory_order_relaxed);
+
+		const Clock::time_point begin = Clock::now();
+		std::vector<Task> helpers(WorkerCount(), Task{ &JobSystem::ExecuteForHelper, &ctx });
+		Push(helpers.data(), helpers.size());
+		Wait(ctx.pending);
+		const double ns = ToNanoseconds(Clock::now() - begin);
+		if (r >= Warmup) samples.push_back(ns);
+	}
+	std::nth_element(samples.begin(), samples.begin() + Rounds / 2, samples.end());
+	m_forkJoinNs = samples[Rounds / 2];
+}
+
+void JobSystem::WorkerLoop(unsigned index)
+{
+	t_owner = this;
+	t_index = index;
+
+#ifdef _WIN32
+	// テクスチャのデコード (WIC) などの COM をワーカーからも使えるようにする
+	const HRESULT comHr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+
+	Clock::time_point lastWork = Clock::now();
+	while (!m_stop.load(std::memory_order_relaxed))
+	{
+		if (TryRunOne(CurrentQueue(), true))
+		{
+			lastWork = Clock::now();
+			continue;
+		}
+		if (Clock::now() - lastWork < IdleSpin)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock lock(m_sleepMutex);
+		m_sleeping.fetch_add(1);
+		m_sleepCv.wait(lock, [this] {
+			return m_stop.load(std::memory_order_relaxed) || m_queued.load() > 0;
+		});
+		m_sleeping.fetch_sub(1);
+		lastWork = Clock::now();
+	}
+
+#ifdef _WIN32
+	if (SUCCEEDED(comHr)) CoUninitialize();
+#endif
+}
+
+void JobSystem::Push(const Task* tasks, std::size_t count)
+{
+	if (count == 0) return;
+
+	// 先に数を増やしておけば、眠ろうとしているワーカーが取りこぼさない
+	m_queued.fetch_add(static_cast<std::int64_t>(count));
+
+	WorkQueue& queue = *m_queues[CurrentQueue()];
+	{
+		std::lock_guard lock(queue.mutex);
+		queue.tasks.insert(queue.tasks.end(), tasks, tasks + count);
+		queue.size.store(queue.tasks.size(), std::memory_order_relaxed);
+	}
+
+	if (m_sleeping.load() > 0)
+	{
+		{
+			std::lock_guard lock(m_sleepMutex);
+		}
+		if (count == 1) m_sleepCv.notify_one();
+		else m_sleepCv.notify_all();
+	}
+}
+
+unsigned JobSystem::CurrentQueue() const
+{
+	if (t_owner == this) return ExternalQueueCount + t_index - 1;
+	if (t_externalOwner == this) return t_externalSlot;
+	return 0;
+}
+
+bool JobSystem::TryRunOne(unsigned queue, bool steal)
+{
+	Task task{};
+	bool found = false;
+
+	// 自分のキューは後ろから (直前に積んだものほどキャッシュに残っている)
+	{
+		WorkQueue& own = *m_queues[queue];
+		std::lock_guard lock(own.mutex);
+		if (!own.tasks.empty())
+		{
+			task = own.tasks.back();
+			own.tasks.pop_back();
+			own.size.store(own.tasks.size(), std::memory_order_relaxed);
+			found = true;
+		}
+	}
+
+	// ワーカーは他のキューからも前から盗む。ワーカー以外のキューも同じ扱い
+	const std::size_t queueCount = m_queues.size();
+	for (std::size_t k = 1; steal && !found && k < queueCount; ++k)
+	{
+		WorkQueue& victim = *m_queues[(queue + k) % queueCount];
+		if (victim.size.load(std::memory_order_relaxed) == 0) continue;
+
+		std::lock_guard lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			task = victim.tasks.front();
+			victim.tasks.pop_front();
+			victim.size.store(victim.tasks.size(), std::memory_order_relaxed);
+			found = true;
+		}
+	}
+
+	if (!found) return false;
+	m_queued.fetch_sub(1);
+	task.invoke(task.context);
+	return true;
+}
+
+void JobSystem::Wait(std::atomic<std::uint32_t>& pending)
+{
+	// ワーカー以外は自分のキューだけを手伝う。物理スレッドが描画スレッドの、
+	// 描画スレッドが物理スレッドのジョブを実行して待ち時間を延ばさないように
+	const unsigned queue = CurrentQueue();
+	const bool steal = (t_owner == this);
+	Clock::time_point lastWork = Clock::now();
+	for (;;)
+	{
+		const std::uint32_t remaining = pending.load(std::memory_order_acquire);
+		if (remaining == 0) return;
+
+		// 待つ間も手伝う
+		if (TryRunOne(queue, steal))
+		{
+			lastWork = Clock::now();
+			continue;
+		}
+		if (Clock::now() - lastWork < IdleSpin)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		// 残りは他のスレッドが実行中。終わったら Complete が起こす
+		pending.wait(remaining, std::memory_order_acquire);
+	}
+}
+
+void JobSystem::Complete(std::atomic<std::uint32_t>& pending)
+{
+	if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		pending.notify_all();
+	}
+}
+
+std::size_t JobSystem::PlanGrain(const LoopSite& site, std::size_t count, std::size_t workPerItem) const
+{
+	if (m_threads.empty() || count < 2) return count;
+
+	// 初回は逐次で回して 1 要素あたりの時間を測る
+	const double perItem = site.NanosecondsPerItem() * static_cast<double>(workPerItem);
+	if (!(perItem > 0.0)) return count;
+
+	// P 並列で total / P + forkJoin < total にならなければ分けても速くならない
+	const double concurrency = static_cast<double>(Concurrency());
+	const double total = perItem * static_cast<double>(count);
+	if (total * (concurrency - 1.0) <= m_forkJoinNs * concurrency) return count;
+
+	// チャンクの取り出しが処理時間に比べて十分小さくなる粒度。
+	// ただし全スレッドに行き渡る数には分ける
+	const double minGrain = std::ceil(m_chunkNs / (perItem * ChunkOverheadRatio));
+	const std::size_t perThread = (count + Concurrency() - 1) / Concurrency();
+	std::size_t grain = static_cast<std::size_t>(std::clamp(minGrain, 1.0, static_cast<double>(count)));
+	grain = std::min(grain, perThread);
+	return std::max<std::size_t>(grain, 1);
+}
+
+void JobSystem::ParallelForImpl(LoopSite& site, std::size_t count, std::size_t workPerItem, void* body, RangeFn fn)
+{
+	const std::size_t grain = PlanGrain(site, count, workPerItem);
+	if (grain >= count)
+	{
+		const Clock::time_point begin = Clock::now();
+		fn(body, 0, count);
+		const Clock::time_point end = Clock::now();
+		site.Record(count * workPerItem, ToNanoseconds(end - begin));
+		if (HasTimingHook()) Report(site.Name(), count, begin, end);
+		return;
+	}
+
+	ForContext ctx;
+	ctx.jobs = this;
+	ctx.name = site.Name();
+	ctx.body = body;
+	ctx.fn = fn;
+	ctx.count = count;
+	ctx.grain = grain;
+	ctx.chunkCount = (count + grain - 1) / grain;
+
+	// 手伝うジョブを配り、呼び出し元も同じようにチャンクを取っていく
+	const std::size_t helperCount = std::min<std::size_t>(WorkerCount(), ctx.chunkCount - 1);
+	ctx.pending.store(static_cast<std::uint32_t>(helperCount), std::memory_order_relaxed);
+	Task helpers[64];
+	for (std::size_t pushed = 0; pushed < helperCount; )
+	{
+		const std::size_t n = std::min<std::size_t>(helperCount - pushed, std::size(helpers));
+		std::fill_n(helpers, n, Task{ &JobSystem::ExecuteForHelper, &ctx });
+		Push(helpers, n);
+		pushed += n;
+	}
+
+	DrainChunks(ctx);
+	Wait(ctx.pending);
+
+	site.Record(count * workPerItem, static_cast<double>(ctx.busyNs.load(std::memory_order_relaxed)));
+	if (ctx.failed.load(std::memory_order_acquire)) std::rethrow_exception(ctx.error);
+}
+
+void JobSystem::DrainChunks(ForContext& ctx)
+{
+	const bool timed = ctx.jobs->HasTimingHook();
+	std::uint64_t busy = 0;
+	for (;;)
+	{
+		const std::size_t chunk = ctx.nextChunk.fetch_add(1, std::memory_order_relaxed);
+		if (chunk >= ctx.chunkCount) break;
+		if (ctx.failed.load(std::memory_order_relaxed)) continue;
+
+		const std::size_t begin = chunk * ctx.grain;
+		const std::size_t end = std::min(begin + ctx.grain, ctx.count);
+		const Clock::time_point t0 = Clock::now();
+		try
+		{
+			ctx.fn(ctx.body, begin, end);
+		}
+		catch (...)
+		{
+			StoreError(ctx.failed, ctx.error);
+		}
+		const Clock::time_point t1 = Clock::now();
+		busy += static_cast<std::uint64_t>(ToNanoseconds(t1 - t0));
+		if (timed) ctx.jobs->Report(ctx.name, end - begin, t0, t1);
+	}
+	if (busy) ctx.busyNs.fetch_add(busy, std::memory_order_relaxed);
+}
+
+void JobSystem::ExecuteForHelper(void* context)
+{
+	ForContext& ctx = *static_cast<ForContext*>(context);
+	DrainChunks(ctx);
+	Complete(ctx.pending);
+}
+
+void JobSystem::Run(TaskGraph& graph)
+{
+	const std::size_t n = graph.m_nodes.size();
+	if (n == 0) return;
+
+	// 循環があると終わらないので、先に入次数を順にはがして確かめる
+	std::vector<std::uint32_t> indegree(n);
+	std::vector<TaskGraph::TaskId> ready;
+	ready.reserve(n);
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		indegree[i] = graph.m_nodes[i].dependencies;
+		if (indegree[i] == 0) ready.push_back(static_cast<TaskGraph::TaskId>(i));
+	}
+	const std::size_t rootCount = ready.size();
+	for (std::size_t head = 0; head < ready.size(); ++head)
+	{
+		for (TaskGraph::TaskId s : graph.m_nodes[ready[head]].successors)
+		{
+			if (--indegree[s] == 0) ready.push_back(s);
+		}
+	}
+	if (ready.size() != n) throw std::runtime_error("JobSystem: task graph has a cycle");
+
+	graph.m_jobs = this;
+	graph.m_failed.store(false, std::memory_order_relaxed);
+	graph.m_error = nullptr;
+	graph.m_pending.store(static_cast<std::uint32_t>(n), std::memory_order_relaxed);
+	for (auto& node : graph.m_nodes)
+	{
+		node.remaining.store(node.dependencies, std::memory_order_relaxed);
+	}
+
+	std::vector<Task> roots(rootCount);
+	for (std::size_t i = 0; i < rootCount; ++i)
+	{
+		roots[i] = Task{ &TaskGraph::Execute, &graph.m_nodes[ready[i]] };
+	}
+	Push(roots.data(), roots.size());
+	Wait(graph.m_pending);
+
+	if (graph.m_failed.load(std::memory_order_acquire))
+	{
+		std::exception_ptr error = std::move(graph.m_error);
+		graph.m_error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+void JobSystem::Report(const char* name, std::size_t items, Clock::time_point begin, Clock::time_point end) const
+{
+	if (!m_hasHook.load(std::memory_order_acquire)) return;
+	TaskTiming timing;
+	timing.name = name;
+	timing.thread = CurrentThreadIndex();
+	timing.items = items;
+	timing.begin = begin;
+	timing.end = end;
+	m_hook(timing);
+}
@@ -0,0 +1,282 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// ボーン・物理・読み込みなどで共有する、ワークスティーリング方式のジョブシステム。
+// ワーカーは常駐し、それぞれ自分の両端キューを持つ。自分のキューは後ろから取り、
+// 空なら他のキューの前から盗む。待ち合わせるスレッドも待つ間にジョブを実行する。
+// ワーカー以外のスレッドは、待つ間に自分のキューのジョブだけを実行する (別のスレッドの仕事を肩代わりしない)。
+// ワーカーが 0 本 (1 コア環境) のときは、すべて呼び出し元で順に実行される。
+class JobSystem
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// ジョブ 1 件の計測結果。SetTimingHook で登録した関数に、実行したスレッドから渡される
+	struct TaskTiming
+	{
+		const char* name{};
+		unsigned thread{};          // 0 = ワーカー以外、1.. = ワーカー
+		std::size_t items{};        // ParallelFor はチャンクの要素数、それ以外は 1
+		Clock::time_point begin{};
+		Clock::time_point end{};
+	};
+	using TimingHook = std::function<void(const TaskTiming&)>;
+
+	// ParallelFor の呼び出し箇所ごとの計測値。関数内 static などで呼び出し箇所ごとに 1 つ置く。
+	// 1 要素あたりの実測時間から、逐次で回すか・何要素ずつ分けるかを決める
+	class LoopSite
+	{
+	public:
+		explicit constexpr LoopSite(const char* name)
+			: m_name(name)
+		{
+		}
+
+		const char* Name() const
+		{
+			return m_name;
+		}
+		// 作業量 1 あたりの処理時間の移動平均 (まだ測っていなければ 0)
+		double NanosecondsPerItem() const
+		{
+			return m_nsPerItem.load(std::memory_order_relaxed);
+		}
+
+	private:
+		friend class JobSystem;
+
+		void Record(std::size_t items, double nanoseconds);
+
+		const char* m_name;
+		std::atomic<double> m_nsPerItem{ 0.0 };
+	};
+
+	// 独立したジョブをまとめて投げ、Wait で待ち合わせる (fork/join)
+	class TaskGroup
+	{
+	public:
+		explicit TaskGroup(JobSystem& jobs);
+		~TaskGroup();
+
+		TaskGroup(const TaskGroup&) = delete;
+		TaskGroup& operator=(const TaskGroup&) = delete;
+
+		void Run(const char* name, std::function<void()> fn);
+		// すべて終わるまで待つ。ジョブが例外を投げていたら最初のものを投げ直す
+		void Wait();
+
+	private:
+		struct Entry
+		{
+			TaskGroup* group{};
+			const char* name{};
+			std::function<void()> fn;
+		};
+
+		static void Execute(void* context);
+
+		JobSystem& m_jobs;
+		std::deque<Entry> m_entries;    // 実行中に参照されるので要素が動かない deque に置く
+		std::atomic<std::uint32_t> m_pending{ 0 };
+		std::atomic<bool> m_failed{ false };
+		std::exception_ptr m_error;
+	};
+
+	// 依存関係つきのジョブ群。Precede(a, b) で a の完了後に b を実行する。
+	// 組み立てたグラフは Run で何度でも実行できる
+	class TaskGraph
+	{
+	public:
+		using TaskId = std::uint32_t;
+
+		TaskGraph() = default;
+		TaskGraph(const TaskGraph&) = delete;
+		TaskGraph& operator=(const TaskGraph&) = delete;
+
+		TaskId Add(const char* name, std::function<void()> fn);
+		void Precede(TaskId before, TaskId after);
+		void Clear();
+
+		std::size_t Size() const
+		{
+			return m_nodes.size();
+		}
+
+	private:
+		friend class JobSystem;
+
+		struct Node
+		{
+			TaskGraph* graph{};
+			const char* name{};
+			std::function<void()> fn;
+			std::vector<TaskId> successors;
+			std::uint32_t dependencies{ 0 };
+			std::atomic<std::uint32_t> remaining{ 0 };
+		};
+
+		static void Execute(void* context);
+
+		std::deque<Node> m_nodes;
+		JobSystem* m_jobs{};
+		std::atomic<std::uint32_t> m_pending{ 0 };
+		std::atomic<bool> m_failed{ false };
+		std::exception_ptr m_error;
+	};
+
+	// ワーカー以外の常駐スレッド (物理スレッド・読み込みスレッドなど) に専用のキューを割り当てる。
+	// 登録していないスレッドはキュー 0 を共有するので、待ち合わせ中に互いのジョブを実行しうる。
+	// スレッドの関数の先頭で作り、JobSystem より先に破棄すること
+	class ExternalThreadScope
+	{
+	public:
+		explicit ExternalThreadScope(JobSystem& jobs);
+		~ExternalThreadScope();
+
+		ExternalThreadScope(const ExternalThreadScope&) = delete;
+		ExternalThreadScope& operator=(const ExternalThreadScope&) = delete;
+
+	private:
+		JobSystem& m_jobs;
+		unsigned m_slot{ 0 };
+		const JobSystem* m_prevOwner{};
+		unsigned m_prevSlot{ 0 };
+	};
+
+	// workerCount: 呼び出し元のほかに常駐させるスレッド数
+	explicit JobSystem(unsigned workerCount);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// プロセス全体で共有するインスタンス (ワーカーは論理コア数 - 1 本)
+	static JobSystem& Shared();
+
+	unsigned WorkerCount() const
+	{
+		return static_cast<unsigned>(m_threads.size());
+	}
+	// 呼び出し元を含めた並列度
+	unsigned Concurrency() const
+	{
+		return WorkerCount() + 1;
+	}
+	// ワーカー数を変えて計測し直す。ジョブが走っていないときに呼ぶこと
+	void SetWorkerCount(unsigned workerCount);
+
+	// 全ワーカーへ空のジョブを配って戻るまでの時間と、チャンク 1 つを取り出す時間 (起動時に測る)
+	double ForkJoinNanoseconds() const
+	{
+		return m_forkJoinNs;
+	}
+	double ChunkNanoseconds() const
+	{
+		return m_chunkNs;
+	}
+
+	// ジョブごとの計測を受け取る関数を登録する (空で解除)。ジョブが走っていないときに呼ぶこと
+	void SetTimingHook(TimingHook hook);
+
+	// [0, count) を区間に分けて fn(begin, end) を並列に呼び、すべて終わるまで待つ。
+	// 分け方は site の実測値から決めるので、軽いループは呼び出し元でそのまま回る
+	template <class Fn>
+	void ParallelFor(LoopSite& site, std::size_t count, Fn&& fn)
+	{
+		ParallelFor(site, count, 1, std::forward<Fn>(fn));
+	}
+	// 1 要素の重さが呼び出しごとに違うとき (画像の行など) は、その重さを workPerItem で渡す。
+	// site には作業量 1 あたりの時間が記録される
+	template <class Fn>
+	void ParallelFor(LoopSite& site, std::size_t count, std::size_t workPerItem, Fn&& fn)
+	{
+		if (count == 0) return;
+		using Body = std::remove_reference_t<Fn>;
+		ParallelForImpl(site, count, std::max<std::size_t>(workPerItem, 1),
+						const_cast<void*>(static_cast<const void*>(std::addressof(fn))),
+						[](void* body, std::size_t begin, std::size_t end) { (*static_cast<Body*>(body))(begin, end); });
+	}
+
+	// グラフのジョブを依存順に実行し、すべて終わるまで待つ。循環があれば std::runtime_error
+	void Run(TaskGraph& graph);
+
+	// 今のスレッドの、このジョブシステムでの番号 (0 = ワーカー以外、1.. = ワーカー)
+	unsigned CurrentThreadIndex() const;
+
+private:
+	using RangeFn = void (*)(void* body, std::size_t begin, std::size_t end);
+
+	struct Task
+	{
+		void (*invoke)(void* context) {};
+		void* context{};
+	};
+
+	// キュー [0, ExternalQueueCount) はワーカー以外のスレッド用 (0 は登録していないスレッドの共有)、
+	// その後ろがワーカーごと
+	static constexpr unsigned ExternalQueueCount = 8;
+
+	struct alignas(64) WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+		std::atomic<std::size_t> size{ 0 };   // 空のキューを錠を取らずに飛ばすための目安
+	};
+
+	struct ForContext;
+
+	void StartWorkers(unsigned workerCount);
+	void StopWorkers();
+	void Calibrate();
+	void WorkerLoop(unsigned index);
+
+	unsigned CurrentQueue() const;
+	void Push(const Task* tasks, std::size_t count);
+	bool TryRunOne(unsigned queue, bool steal);
+	void Wait(std::atomic<std::uint32_t>& pending);
+	static void Complete(std::atomic<std::uint32_t>& pending);
+
+	std::size_t PlanGrain(const LoopSite& site, std::size_t count, std::size_t workPerItem) const;
+	void ParallelForImpl(LoopSite& site, std::size_t count, std::size_t workPerItem, void* body, RangeFn fn);
+	static void DrainChunks(ForContext& ctx);
+	static void ExecuteForHelper(void* context);
+
+	bool HasTimingHook() const
+	{
+		return m_hasHook.load(std::memory_order_relaxed);
+	}
+	void Report(const char* name, std::size_t items, Clock::time_point begin, Clock::time_point end) const;
+
+	std::vector<std::unique_ptr<WorkQueue>> m_queues;
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_externalMutex;
+	std::uint32_t m_externalSlots{ 1 };   // 使用中の外部キュー (ビット 0 = 共有のキュー 0)
+
+	std::atomic<std::int64_t> m_queued{ 0 };
+	std::atomic<std::uint32_t> m_sleeping{ 0 };
+	std::atomic<bool> m_stop{ false };
+	std::mutex m_sleepMutex;
+	std::condition_variable m_sleepCv;
+
+	double m_forkJoinNs{ 0.0 };
+	double m_chunkNs{ 0.0 };
+
+	std::atomic<bool> m_hasHook{ false };
+	TimingHook m_hook;
+};
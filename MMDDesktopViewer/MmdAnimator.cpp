@@ -1,6 +1,7 @@
 ﻿#include "MmdAnimator.hpp"
 #include "BoneSolver.hpp"
 #include "MmdPhysicsWorld.hpp"
+#include "PhysicsThread.hpp"
 #include <stdexcept>
 #include <algorithm>
 #include <cmath>
@@ -19,39 +20,6 @@ namespace
 		return frame;
 	}
 
-	float EvaluateBezier(float t, float x1, float y1, float x2, float y2)
-	{
-		if (t <= 0.0f) return 0.0f;
-		if (t >= 1.0f) return 1.0f;
-
-		auto cubic = [](float p0, float p1, float p2, float p3, float s) {
-			float inv = 1.0f - s;
-			return inv * inv * inv * p0 + 3.0f * inv * inv * s * p1 + 3.0f * inv * s * s * p2 + s * s * s * p3;
-			};
-
-		float low = 0.0f, high = 1.0f, s = t;
-		for (int i = 0; i < 15; ++i)
-		{
-			s = 0.5f * (low + high);
-			float x = cubic(0.0f, x1, x2, 1.0f, s);
-			if (x < t)
-				low = s;
-			else
-				high = s;
-		}
-
-		return cubic(0.0f, y1, y2, 1.0f, s);
-	}
-
-	float EvaluateChannelT(const std::uint8_t* interp, float t)
-	{
-		float x1 = interp[0] / 127.0f;
-		float y1 = interp[4] / 127.0f;
-		float x2 = interp[8] / 127.0f;
-		float y2 = interp[12] / 127.0f;
-		return EvaluateBezier(t, x1, y1, x2, y2);
-	}
-
 	float ComputeBreathFactor(double t, double period)
 	{
 		const double PI = 3.141592653589793;
@@ -113,11 +81,11 @@ bool MmdAnimator::LoadMotion(const std::filesystem::path& vmd)
 		BeginPoseTransitionFromLastPose();
 		m_motion = std::move(motion);
 		m_time = 0.0;
-		m_pose = {};
+		m_pose.Clear();
 		m_paused = false;
 		DirectX::XMStoreFloat4x4(&m_motionTransform, DirectX::XMMatrixIdentity());
 		m_prevFrameForPhysicsValid = false;
-		if (m_physicsWorld) m_physicsWorld->Reset();
+		ResetPhysics();
 		return true;
 	}
 	return false;
@@ -128,12 +96,12 @@ void MmdAnimator::ClearMotion()
 	BeginPoseTransitionFromLastPose();
 	m_motion.reset();
 	m_time = 0.0;
-	m_pose = {};
+	m_pose.Clear();
 	m_paused = false;
 	m_hasSkinnedPose = false;
 	m_prevFrameForPhysicsValid = false;
 	DirectX::XMStoreFloat4x4(&m_motionTransform, DirectX::XMMatrixIdentity());
-	if (m_physicsWorld) m_physicsWorld->Reset();
+	ResetPhysics();
 }
 
 void MmdAnimator::StopMotion()
@@ -168,16 +136,22 @@ void MmdAnimator::UpdateMotionCache(const VmdMotion* motion)
 	// キャッシュが有効なら何もしない
 	if (motion && m_cachedMotionPtr == motion && m_model &&
 		m_boneTrackToBoneIndex.size() == motion->BoneTracks().size() &&
-		m_morphTrackToMorphIndex.size() == motion->MorphTracks().size())
+		m_morphTrackToMorphIndex.size() == motion->MorphTracks().size() &&
+		m_ikKeyStateOffsets.size() == motion->IkKeys().size() + 1)
 	{
 		return;
 	}
 
 	m_cachedMotionPtr = motion;
 	m_boneTrackToBoneIndex.clear();
+	m_boneTrackTranslationMode.clear();
 	m_morphTrackToMorphIndex.clear();
 	m_boneKeyCursors.clear();
 	m_morphKeyCursors.clear();
+	m_ikKeyStateOffsets.clear();
+	m_ikKeyBones.clear();
+	m_ikKeyEnabled.clear();
+	m_ikKeyCursor = 0;
 
 	if (!motion || !m_model) return;
 
@@ -186,6 +160,7 @@ void MmdAnimator::UpdateMotionCache(const VmdMotion* motion)
 	const auto& bones = m_model->Bones();
 
 	m_boneTrackToBoneIndex.resize(boneTracks.size(), -1);
+	m_boneTrackTranslationMode.resize(boneTracks.size(), 0);
 	m_boneKeyCursors.resize(boneTracks.size(), 0);
 
 	// 名前検索用マップを作成 (O(N) + O(M))
@@ -203,11 +178,51 @@ void MmdAnimator::UpdateMotionCache(const VmdMotion* motion)
 		{
 			m_boneTrackToBoneIndex[i] = it->second;
 		}
+
+		// 位置を無視するボーン (1: 全成分, 2: XZ)
+		const auto& name = boneTracks[i].name;
+		if (name == L"全ての親") m_boneTrackTranslationMode[i] = 1;
+		else if (name == L"センター" || name == L"グルーブ") m_boneTrackTranslationMode[i] = 2;
 	}
 
+	// --- モーフのマッピング (同名モーフは先頭の番号に紐付ける) ---
 	const auto& morphTracks = motion->MorphTracks();
+	const auto& morphs = m_model->Morphs();
 	m_morphTrackToMorphIndex.resize(morphTracks.size(), -1);
 	m_morphKeyCursors.resize(morphTracks.size(), 0);
+
+	std::unordered_map<std::wstring, int> morphMap;
+	morphMap.reserve(morphs.size());
+	for (int i = 0; i < (int)morphs.size(); ++i)
+	{
+		morphMap.try_emplace(morphs[i].name, i);
+	}
+
+	for (size_t i = 0; i < morphTracks.size(); ++i)
+	{
+		auto it = morphMap.find(morphTracks[i].name);
+		if (it != morphMap.end())
+		{
+			m_morphTrackToMorphIndex[i] = it->second;
+		}
+	}
+
+	// --- IK キーのマッピング (モデルの IK ボーンだけを残す) ---
+	const auto& ikKeys = motion->IkKeys();
+	m_ikKeyStateOffsets.reserve(ikKeys.size() + 1);
+	m_ikKeyStateOffsets.push_back(0);
+	for (const auto& key : ikKeys)
+	{
+		for (const auto& state : key.states)
+		{
+			auto it = boneMap.find(motion->Name(state.nameId));
+			if (it == boneMap.end() || !bones[it->second].IsIK()) continue;
+
+			m_ikKeyBones.push_back(it->second);
+			m_ikKeyEnabled.push_back(state.enabled ? 1 : 0);
+		}
+		m_ikKeyStateOffsets.push_back(static_cast<std::uint32_t>(m_ikKeyBones.size()));
+	}
 }
 
 void MmdAnimator::CacheLookAtBones()
@@ -230,20 +245,322 @@ void MmdAnimator::CacheLookAtBones()
 	}
 }
 
+void MmdAnimator::CacheLayerTargets()
+{
+	m_boneIdxUpperBody = -1;
+	m_boneIdxUpperBody2 = -1;
+	m_boneIdxShoulderL = -1;
+	m_boneIdxShoulderR = -1;
+	m_morphIdxBlink = -1;
+	m_morphIdxLipSync.fill(-1);
+	m_morphNextSameName.clear();
+
+	if (!m_model) return;
+
+	const auto& bones = m_model->Bones();
+	for (int i = 0; i < (int)bones.size(); ++i)
+	{
+		const auto& name = bones[i].name;
+		if (name == L"上半身") m_boneIdxUpperBody = i;
+		else if (name == L"上半身2") m_boneIdxUpperBody2 = i;
+		else if (name == L"左肩") m_boneIdxShoulderL = i;
+		else if (name == L"右肩") m_boneIdxShoulderR = i;
+	}
+
+	const auto& morphs = m_model->Morphs();
+	m_morphNextSameName.assign(morphs.size(), -1);
+
+	std::unordered_map<std::wstring, int> lastByName;
+	lastByName.reserve(morphs.size());
+	for (int i = 0; i < (int)morphs.size(); ++i)
+	{
+		auto [it, inserted] = lastByName.try_emplace(morphs[i].name, i);
+		if (!inserted)
+		{
+			m_morphNextSameName[it->second] = i;
+			it->second = i;
+		}
+	}
+
+	auto findFirst = [&](const wchar_t* name) -> int32_t {
+		for (int i = 0; i < (int)morphs.size(); ++i)
+		{
+			if (morphs[i].name == name) return i;
+		}
+		return -1;
+		};
+
+	m_morphIdxBlink = findFirst(L"まばたき");
+	const wchar_t* lipNames[] = { L"あ", L"い", L"う", L"え", L"お", L"口開け", L"口開き" };
+	for (size_t i = 0; i < m_morphIdxLipSync.size(); ++i)
+	{
+		m_morphIdxLipSync[i] = findFirst(lipNames[i]);
+	}
+}
+
+void MmdAnimator::SetMorphWeightByName(int32_t firstMorph, float weight)
+{
+	for (int32_t i = firstMorph; i >= 0; i = m_morphNextSameName[i])
+	{
+		m_pose.SetMorphWeight(i, weight);
+	}
+}
+
+void MmdAnimator::MaxMorphWeightByName(int32_t firstMorph, float weight)
+{
+	for (int32_t i = firstMorph; i >= 0; i = m_morphNextSameName[i])
+	{
+		m_pose.SetMorphWeight(i, std::max(m_pose.MorphWeightOrZero(i), weight));
+	}
+}
+
+void MmdAnimator::MultiplyBoneRotation(int32_t boneIndex, DirectX::FXMVECTOR delta, bool normalize)
+{
+	using namespace DirectX;
+	if (boneIndex < 0) return;
+
+	const XMFLOAT4 current = m_pose.BoneRotationOrIdentity(boneIndex);
+	XMVECTOR next = XMQuaternionMultiply(XMLoadFloat4(&current), delta);
+	if (normalize) next = XMQuaternionNormalize(next);
+
+	XMFLOAT4 out;
+	XMStoreFloat4(&out, next);
+	m_pose.SetBoneRotation(boneIndex, out);
+}
+
+BonePose MmdAnimator::CurrentNamedPose() const
+{
+	BonePose named;
+	named.frame = m_pose.frame;
+	if (!m_model) return named;
+
+	const auto& bones = m_model->Bones();
+	for (size_t i = 0; i < bones.size() && i < m_pose.BoneCount(); ++i)
+	{
+		if (m_pose.hasBoneTranslation[i]) named.boneTranslations.insert_or_assign(bones[i].name, m_pose.boneTranslations[i]);
+		if (m_pose.hasBoneRotation[i]) named.boneRotations.insert_or_assign(bones[i].name, m_pose.boneRotations[i]);
+	}
+
+	const auto& morphs = m_model->Morphs();
+	for (size_t i = 0; i < morphs.size() && i < m_pose.MorphCount(); ++i)
+	{
+		if (m_pose.hasMorphWeight[i]) named.morphWeights.insert_or_assign(morphs[i].name, m_pose.morphWeights[i]);
+	}
+	return named;
+}
+
+void MmdAnimator::SetProfile(TickProfile* profile)
+{
+	m_profile = profile;
+	m_boneSolver->SetProfile(profile);
+	// 物理スレッドが回っている間、world は計測しない (止めたときに渡し直す)
+	if (m_physicsWorld && !IsPhysicsThreadRunning()) m_physicsWorld->SetProfile(profile);
+}
+
+void MmdAnimator::SetIkCacheEnabled(bool enabled)
+{
+	m_boneSolver->SetIkCacheEnabled(enabled);
+}
+
+bool MmdAnimator::SetIkEnabled(const std::wstring& ikBoneName, bool enabled)
+{
+	if (!m_model) return false;
+
+	const auto& bones = m_model->Bones();
+	for (size_t i = 0; i < bones.size() && i < m_boneSolver->BoneCount(); ++i)
+	{
+		if (bones[i].IsIK() && bones[i].name == ikBoneName)
+		{
+			m_boneSolver->SetIkEnabled(i, enabled);
+			return true;
+		}
+	}
+	return false;
+}
+
 void MmdAnimator::SetPhysicsSettings(const PhysicsSettings& settings)
 {
 	if (!m_physicsWorld) return;
 
+	StopPhysicsThread();
 	m_physicsWorld->GetSettings() = settings;
 	m_physicsWorld->Reset();
 }
 
+bool MmdAnimator::IsPhysicsThreadRunning() const
+{
+	return m_physicsThread && m_physicsThread->IsRunning();
+}
+
+const PhysicsThread* MmdAnimator::GetPhysicsThread() const
+{
+	return m_physicsThread.get();
+}
+
+void MmdAnimator::StopPhysicsThread()
+{
+	if (!IsPhysicsThreadRunning()) return;
+
+	m_physicsThread->Stop();
+	if (m_physicsWorld) m_physicsWorld->SetProfile(m_profile);
+}
+
+void MmdAnimator::ResetPhysics()
+{
+	StopPhysicsThread();
+	if (m_physicsWorld) m_physicsWorld->Reset();
+}
+
 const PhysicsSettings& MmdAnimator::GetPhysicsSettings() const
 {
 	static PhysicsSettings fallback{};
 	return m_physicsWorld ? m_physicsWorld->GetSettings() : fallback;
 }
 
+void MmdAnimator::SampleBoneTracks(const VmdMotion& motion, float currentFrame)
+{
+	TickStageTimer timer(m_profile, TickStage::TrackSampling);
+
+	const auto& boneTracks = motion.BoneTracks();
+	const size_t numBoneTracks = boneTracks.size();
+
+	for (size_t i = 0; i < numBoneTracks; ++i)
+	{
+		const int boneIndex = m_boneTrackToBoneIndex[i];
+		if (boneIndex == -1) continue;
+
+		const auto& track = boneTracks[i];
+		const auto& frames = track.frames;
+		if (frames.empty()) continue;
+
+		size_t kIdx = m_boneKeyCursors[i];
+		if (kIdx >= frames.size() - 1) kIdx = 0;
+		if (frames[kIdx] > currentFrame) kIdx = 0;
+
+		while (kIdx + 1 < frames.size() && frames[kIdx + 1] <= currentFrame)
+		{
+			kIdx++;
+		}
+		m_boneKeyCursors[i] = kIdx;
+
+		const size_t k1Idx = (kIdx + 1 < frames.size()) ? kIdx + 1 : kIdx;
+		const std::uint32_t f0 = frames[kIdx];
+		const std::uint32_t f1 = frames[k1Idx];
+
+		float t = 0.0f;
+		if (f1 != f0)
+		{
+			t = (currentFrame - static_cast<float>(f0)) /
+				static_cast<float>(f1 - f0);
+			t = std::clamp(t, 0.0f, 1.0f);
+		}
+
+		// X/Y/Z/回転 の補間係数を一度に求める
+		DirectX::XMFLOAT4 curveT;
+		DirectX::XMStoreFloat4(&curveT, motion.CompiledCurve(track.curveIds[kIdx]).Evaluate(t));
+		const float txT = curveT.x;
+		const float tyT = curveT.y;
+		const float tzT = curveT.z;
+		const float rotT = curveT.w;
+
+		auto lerp = [](float a, float b, float s) { return a + (b - a) * s; };
+
+		const auto& p0 = track.translations[kIdx];
+		const auto& p1 = track.translations[k1Idx];
+		DirectX::XMFLOAT3 trans{
+			lerp(p0.x, p1.x, txT),
+			lerp(p0.y, p1.y, tyT),
+			lerp(p0.z, p1.z, tzT)
+		};
+
+		using namespace DirectX;
+		XMVECTOR q0 = XMQuaternionNormalize(XMLoadFloat4(&track.rotations[kIdx]));
+		XMVECTOR q1 = XMQuaternionNormalize(XMLoadFloat4(&track.rotations[k1Idx]));
+		XMVECTOR q = XMQuaternionSlerp(q0, q1, rotT);
+		XMFLOAT4 rot;
+		XMStoreFloat4(&rot, q);
+
+		if (m_boneTrackTranslationMode[i] == 1)
+		{
+			trans = { 0.0f, 0.0f, 0.0f };
+		}
+		else if (m_boneTrackTranslationMode[i] == 2)
+		{
+			trans.x = 0.0f; trans.z = 0.0f;
+		}
+
+		m_pose.SetBoneTranslation(boneIndex, trans);
+		m_pose.SetBoneRotation(boneIndex, rot);
+	}
+}
+
+void MmdAnimator::SampleIkStates(const VmdMotion& motion, float currentFrame)
+{
+	TickStageTimer timer(m_profile, TickStage::TrackSampling);
+
+	const auto& ikKeys = motion.IkKeys();
+	if (ikKeys.empty()) return;
+
+	// 補間はしない。currentFrame 以前の最後のキーを使う (最初のキーより前は最初のキー)
+	size_t kIdx = m_ikKeyCursor;
+	if (kIdx >= ikKeys.size() || ikKeys[kIdx].frame > currentFrame) kIdx = 0;
+	while (kIdx + 1 < ikKeys.size() && ikKeys[kIdx + 1].frame <= currentFrame)
+	{
+		kIdx++;
+	}
+	m_ikKeyCursor = kIdx;
+
+	for (std::uint32_t s = m_ikKeyStateOffsets[kIdx]; s < m_ikKeyStateOffsets[kIdx + 1]; ++s)
+	{
+		m_pose.SetIkEnabled(static_cast<size_t>(m_ikKeyBones[s]), m_ikKeyEnabled[s] != 0);
+	}
+}
+
+void MmdAnimator::SampleMorphTracks(const VmdMotion& motion, float currentFrame)
+{
+	TickStageTimer timer(m_profile, TickStage::MorphWeights);
+
+	const auto& morphTracks = motion.MorphTracks();
+	const size_t numMorphTracks = morphTracks.size();
+
+	for (size_t i = 0; i < numMorphTracks; ++i)
+	{
+		const int morphIndex = m_morphTrackToMorphIndex[i];
+		if (morphIndex == -1) continue;
+
+		const auto& track = morphTracks[i];
+		const auto& frames = track.frames;
+		if (frames.empty()) continue;
+
+		size_t kIdx = m_morphKeyCursors[i];
+		if (kIdx >= frames.size() - 1) kIdx = 0;
+		if (frames[kIdx] > currentFrame) kIdx = 0;
+
+		while (kIdx + 1 < frames.size() && frames[kIdx + 1] <= currentFrame)
+		{
+			kIdx++;
+		}
+		m_morphKeyCursors[i] = kIdx;
+
+		const size_t k1Idx = (kIdx + 1 < frames.size()) ? kIdx + 1 : kIdx;
+		const std::uint32_t f0 = frames[kIdx];
+		const std::uint32_t f1 = frames[k1Idx];
+
+		float t = 0.0f;
+		if (f1 != f0)
+		{
+			t = (currentFrame - static_cast<float>(f0)) /
+				static_cast<float>(f1 - f0);
+			t = std::clamp(t, 0.0f, 1.0f);
+		}
+
+		const float w0 = track.weights[kIdx];
+		const float w1 = track.weights[k1Idx];
+		float w = w0 + (w1 - w0) * t;
+		SetMorphWeightByName(morphIndex, w);
+	}
+}
+
 void MmdAnimator::Tick(double dtSeconds)
 {
 	if (!m_paused)
@@ -294,129 +611,29 @@ void MmdAnimator::Tick(double dtSeconds)
 		}
 		if (needsPhysicsReset)
 		{
-			if (m_physicsWorld) m_physicsWorld->Reset();
+			ResetPhysics();
 		}
 	}
 
 	// ポーズ初期化
-	m_pose.boneTranslations.clear();
-	m_pose.boneRotations.clear();
-	m_pose.morphWeights.clear();
+	if (m_pose.BoneCount() != m_model->Bones().size() || m_pose.MorphCount() != m_model->Morphs().size())
+	{
+		m_pose.Resize(m_model->Bones().size(), m_model->Morphs().size());
+	}
+	m_pose.Clear();
 	m_pose.frame = currentFrame;
 
 	bool isMotionActive = (motion != nullptr && !m_paused);
 
 	if (motion)
 	{
-		// --- ボーンアニメーション適用 ---
-		const auto& boneTracks = motion->BoneTracks();
-		const size_t numBoneTracks = boneTracks.size();
-		m_pose.boneTranslations.reserve(numBoneTracks);
-		m_pose.boneRotations.reserve(numBoneTracks);
-		auto& poseTranslations = m_pose.boneTranslations;
-		auto& poseRotations = m_pose.boneRotations;
-
-		for (size_t i = 0; i < numBoneTracks; ++i)
-		{
-			if (m_boneTrackToBoneIndex[i] == -1) continue;
-
-			const auto& track = boneTracks[i];
-			const auto& keys = track.keys;
-			if (keys.empty()) continue;
-
-			size_t kIdx = m_boneKeyCursors[i];
-			if (kIdx >= keys.size() - 1) kIdx = 0;
-			if (keys[kIdx].frame > currentFrame) kIdx = 0;
-
-			while (kIdx + 1 < keys.size() && keys[kIdx + 1].frame <= currentFrame)
-			{
-				kIdx++;
-			}
-			m_boneKeyCursors[i] = kIdx;
-
-			const auto& k0 = keys[kIdx];
-			const auto* k1 = (kIdx + 1 < keys.size()) ? &keys[kIdx + 1] : &k0;
-
-			float t = 0.0f;
-			if (k1->frame != k0.frame)
-			{
-				t = (currentFrame - static_cast<float>(k0.frame)) /
-					static_cast<float>(k1->frame - k0.frame);
-				t = std::clamp(t, 0.0f, 1.0f);
-			}
-
-			const std::uint8_t* base = k0.interp;
-			float txT = EvaluateChannelT(base + 0, t);
-			float tyT = EvaluateChannelT(base + 16, t);
-			float tzT = EvaluateChannelT(base + 32, t);
-			float rotT = EvaluateChannelT(base + 48, t);
-
-			auto lerp = [](float a, float b, float s) { return a + (b - a) * s; };
-
-			DirectX::XMFLOAT3 trans{
-				lerp(k0.tx, k1->tx, txT),
-				lerp(k0.ty, k1->ty, tyT),
-				lerp(k0.tz, k1->tz, tzT)
-			};
-
-			using namespace DirectX;
-			XMVECTOR q0 = XMQuaternionNormalize(XMVectorSet(k0.qx, k0.qy, k0.qz, k0.qw));
-			XMVECTOR q1 = XMQuaternionNormalize(XMVectorSet(k1->qx, k1->qy, k1->qz, k1->qw));
-			XMVECTOR q = XMQuaternionSlerp(q0, q1, rotT);
-			XMFLOAT4 rot;
-			XMStoreFloat4(&rot, q);
-
-			if (track.name == L"全ての親")
-			{
-				trans = { 0.0f, 0.0f, 0.0f };
-			}
-			else if (track.name == L"センター" || track.name == L"グルーブ")
-			{
-				trans.x = 0.0f; trans.z = 0.0f;
-			}
-
-			poseTranslations.insert_or_assign(track.name, trans);
-			poseRotations.insert_or_assign(track.name, rot);
-		}
-
-		// --- モーフアニメーション適用 ---
-		const auto& morphTracks = motion->MorphTracks();
-		const size_t numMorphTracks = morphTracks.size();
-		m_pose.morphWeights.reserve(numMorphTracks);
-		auto& poseMorphs = m_pose.morphWeights;
-
-		for (size_t i = 0; i < numMorphTracks; ++i)
-		{
-			const auto& track = morphTracks[i];
-			const auto& keys = track.keys;
-			if (keys.empty()) continue;
-
-			size_t kIdx = m_morphKeyCursors[i];
-			if (kIdx >= keys.size() - 1) kIdx = 0;
-			if (keys[kIdx].frame > currentFrame) kIdx = 0;
-
-			while (kIdx + 1 < keys.size() && keys[kIdx + 1].frame <= currentFrame)
-			{
-				kIdx++;
-			}
-			m_morphKeyCursors[i] = kIdx;
-
-			const auto& k0 = keys[kIdx];
-			const auto* k1 = (kIdx + 1 < keys.size()) ? &keys[kIdx + 1] : &k0;
-
-			float t = 0.0f;
-			if (k1->frame != k0.frame)
-			{
-				t = (currentFrame - static_cast<float>(k0.frame)) /
-					static_cast<float>(k1->frame - k0.frame);
-				t = std::clamp(t, 0.0f, 1.0f);
-			}
-
-			float w = k0.weight + (k1->weight - k0.weight) * t;
-			poseMorphs.insert_or_assign(track.name, w);
-		}
+		SampleBoneTracks(*motion, currentFrame);
+		SampleMorphTracks(*motion, currentFrame);
+		SampleIkStates(*motion, currentFrame);
 	}
 
+	TickStageTimer layerTimer(m_profile, TickStage::PoseLayers);
+
 	// --- 自動まばたき処理 ---
 	if (m_autoBlinkEnabled)
 	{
@@ -429,8 +646,7 @@ void MmdAnimator::Tick(double dtSeconds)
 			UpdateAutoBlink(dtSeconds);
 
 			// 既存のモーフ値(一時停止中のポーズなど)と比較し、目が閉じている度合いが大きい方を採用する
-			float currentW = m_pose.morphWeights[L"まばたき"];
-			m_pose.morphWeights[L"まばたき"] = std::max(currentW, m_blinkWeight);
+			MaxMorphWeightByName(m_morphIdxBlink, m_blinkWeight);
 		}
 		else
 		{
@@ -511,29 +727,23 @@ void MmdAnimator::Tick(double dtSeconds)
 		XMVECTOR qHead = XMQuaternionRotationRollPitchYaw(neckPitch * headPitchW, neckYaw * headYawW, 0.0f);
 		XMVECTOR qEyes = XMQuaternionRotationRollPitchYaw(eyePitch, eyeYaw, 0.0f);
 
-		auto ApplyRot = [&](int32_t idx, XMVECTOR qOffset) {
-			if (idx < 0) return;
-			const auto& name = m_model->Bones()[idx].name;
-
-			XMVECTOR current = XMQuaternionIdentity();
-			if (m_pose.boneRotations.count(name))
-			{
-				current = XMLoadFloat4(&m_pose.boneRotations[name]);
-			}
-			XMVECTOR next = XMQuaternionMultiply(current, qOffset);
-			XMStoreFloat4(&m_pose.boneRotations[name], next);
-			};
-
-		ApplyRot(m_boneIdxNeck, qNeck);
-		ApplyRot(m_boneIdxHead, qHead);
-		ApplyRot(m_boneIdxEyeL, qEyes);
-		ApplyRot(m_boneIdxEyeR, qEyes);
+		MultiplyBoneRotation(m_boneIdxNeck, qNeck, false);
+		MultiplyBoneRotation(m_boneIdxHead, qHead, false);
+		MultiplyBoneRotation(m_boneIdxEyeL, qEyes, false);
+		MultiplyBoneRotation(m_boneIdxEyeR, qEyes, false);
 	}
 
 	ApplyPoseTransition(dtSeconds);
+	layerTimer.Stop();
+
+	// グループ/フリップを展開して末端モーフのウェイトを求め、ボーンモーフは FK の前にポーズへ重ねる
+	{
+		TickStageTimer morphTimer(m_profile, TickStage::MorphWeights);
+		m_morphGraph.Evaluate(m_pose);
+		m_boneSolver->ApplyPose(m_pose, m_morphGraph.BoneOffsets());
+	}
 
 	// 行列更新 (FK)
-	m_boneSolver->ApplyPose(m_pose);
 	m_boneSolver->UpdateMatrices();
 
 	// 物理演算
@@ -541,15 +751,44 @@ void MmdAnimator::Tick(double dtSeconds)
 	{
 		if (!m_physicsWorld->IsBuilt() || m_physicsWorld->BuiltRevision() != m_model->Revision())
 		{
+			StopPhysicsThread();
 			m_physicsWorld->BuildFromModel(*m_model, *m_boneSolver);
 		}
 
-		if (m_physicsWorld->IsBuilt())
+		if (m_physicsWorld->IsBuilt() && m_physicsWorld->GetSettings().asyncPhysics)
+		{
+			// 物理は専用スレッドが fixedTimeStep ごとに進める。ここでは目標を渡し、
+			// 届いている直近 2 ステップの姿勢を補間して書き戻すだけ
+			if (!IsPhysicsThreadRunning())
+			{
+				if (!m_physicsThread) m_physicsThread = std::make_unique<PhysicsThread>();
+				m_physicsWorld->SetProfile(nullptr);
+				m_physicsThread->Start(*m_physicsWorld, *m_model);
+			}
+
+			m_physicsThread->Submit(*m_boneSolver, m_morphGraph.Impulses());
+
+			TickStageTimer writeBackTimer(m_profile, TickStage::PhysicsWriteBack);
+			if (m_physicsThread->WriteBack(*m_model, *m_boneSolver))
+			{
+				m_boneSolver->UpdateMatricesNoIK();
+			}
+		}
+		else if (m_physicsWorld->IsBuilt())
 		{
+			StopPhysicsThread();
+			for (const auto& impulse : m_morphGraph.Impulses())
+			{
+				m_physicsWorld->ApplyImpulseMorph(impulse.rigidBodyIndex, impulse.velocity, impulse.torque, impulse.local);
+			}
 			m_physicsWorld->Step(dtSeconds, *m_model, *m_boneSolver);
 			m_boneSolver->UpdateMatricesNoIK();
 		}
 	}
+	else
+	{
+		StopPhysicsThread();
+	}
 
 	m_hasSkinnedPose = true;
 	m_prevFrameForPhysics = currentFrame;
@@ -565,6 +804,21 @@ const std::vector<DirectX::XMFLOAT4X4>& MmdAnimator::GetSkinningMatrices() const
 	return m_boneSolver->GetSkinningMatrices();
 }
 
+uint64_t MmdAnimator::SkinningRevision() const
+{
+	return m_boneSolver->SkinningRevision();
+}
+
+bool MmdAnimator::GetSkinningChangedRange(uint64_t sinceRevision, size_t& outBegin, size_t& outEnd) const
+{
+	return m_boneSolver->GetSkinningChangedRange(sinceRevision, outBegin, outEnd);
+}
+
+size_t MmdAnimator::WriteSkinningPalette(DirectX::XMFLOAT3X4* dst, size_t capacity, uint64_t sinceRevision) const
+{
+	return m_boneSolver->WriteSkinningPalette(dst, capacity, sinceRevision);
+}
+
 size_t MmdAnimator::GetBoneCount() const
 {
 	return m_boneSolver->BoneCount();
@@ -583,17 +837,22 @@ bool MmdAnimator::LoadModel(const std::filesystem::path& pmx, std::function<void
 
 void MmdAnimator::SetModel(std::unique_ptr<PmxModel> model)
 {
+	// 物理スレッドは今のモデルを参照しているので、差し替える前に止める
+	StopPhysicsThread();
 	m_model = std::move(model);
 	m_time = 0.0;
-	m_pose = {};
+	m_pose.Resize(m_model ? m_model->Bones().size() : 0, m_model ? m_model->Morphs().size() : 0);
+	m_cachedMotionPtr = nullptr;
 	m_hasSkinnedPose = false;
 	m_hasLastPose = false;
 	m_hasTransitionPose = false;
 	m_transitionActive = false;
 	m_prevFrameForPhysicsValid = false;
 	m_boneSolver->Initialize(m_model.get());
-	if (m_physicsWorld) m_physicsWorld->Reset();
+	m_morphGraph.Initialize(m_model.get());
+	ResetPhysics();
 	CacheLookAtBones();
+	CacheLayerTargets();
 }
 
 void MmdAnimator::GetBounds(float& minx, float& miny, float& minz, float& maxx, float& maxy, float& maxz) const
@@ -844,41 +1103,33 @@ void MmdAnimator::UpdateBreath(double dt)
 	float intensity = (baseWave + slowWave * 0.2f) * 0.5f;
 
 	// 各ボーンへの適用
-	auto ApplyBoneRot = [&](const std::wstring& name, float pitch, float yaw, float roll)
+	auto ApplyBoneRot = [&](int32_t boneIndex, float pitch, float yaw, float roll)
 		{
-			// 既存の回転を取得 (LookAtなどで既に設定されている場合があるため合成する)
-			XMVECTOR currentQ = XMQuaternionIdentity();
-			if (m_pose.boneRotations.count(name))
-			{
-				currentQ = XMLoadFloat4(&m_pose.boneRotations[name]);
-			}
-
 			// オイラー角から追加回転を作成 (ラジアン)
 			XMVECTOR addQ = XMQuaternionRotationRollPitchYaw(pitch, yaw, roll);
 
-			// 現在の回転に適用
-			XMVECTOR nextQ = XMQuaternionMultiply(currentQ, addQ);
-			XMStoreFloat4(&m_pose.boneRotations[name], nextQ);
+			// 既存の回転に合成する (LookAtなどで既に設定されている場合があるため)
+			MultiplyBoneRotation(boneIndex, addQ, false);
 		};
 
 	// ボーンごとの微調整 (モデルに合わせて微調整してください)
 	// 上半身: 呼吸のメイン。前後にわずかに揺れる (Pitch)
 	// 吸うとき(intensity > 0)に少し反り、吐くときに戻る
-	ApplyBoneRot(L"上半身", intensity * XMConvertToRadians(1.5f), 0.0f, 0.0f);
+	ApplyBoneRot(m_boneIdxUpperBody, intensity * XMConvertToRadians(1.5f), 0.0f, 0.0f);
 
 	// 上半身2: 上半身の動きを増幅または遅延させる
 	// 少し位相をずらすとより有機的になりますが、ここでは単純な連動とします
-	ApplyBoneRot(L"上半身2", intensity * XMConvertToRadians(1.8f), 0.0f, 0.0f);
+	ApplyBoneRot(m_boneIdxUpperBody2, intensity * XMConvertToRadians(1.8f), 0.0f, 0.0f);
 
 	// 首・頭: 体の動きに対して少し遅れてバランスを取る (逆位相気味に)
 	// 体が反ると顎を引くような動きを入れると視線が安定する
-	ApplyBoneRot(L"首", intensity * XMConvertToRadians(-0.8f), 0.0f, 0.0f);
-	ApplyBoneRot(L"頭", intensity * XMConvertToRadians(-0.5f), 0.0f, 0.0f);
+	ApplyBoneRot(m_boneIdxNeck, intensity * XMConvertToRadians(-0.8f), 0.0f, 0.0f);
+	ApplyBoneRot(m_boneIdxHead, intensity * XMConvertToRadians(-0.5f), 0.0f, 0.0f);
 
 	// 肩: 吸うときにわずかに上がる (Roll) - Z軸
 	// 左肩(Z+) 右肩(Z-)
-	ApplyBoneRot(L"左肩", 0.0f, 0.0f, intensity * XMConvertToRadians(1.0f));
-	ApplyBoneRot(L"右肩", 0.0f, 0.0f, intensity * XMConvertToRadians(-1.0f));
+	ApplyBoneRot(m_boneIdxShoulderL, 0.0f, 0.0f, intensity * XMConvertToRadians(1.0f));
+	ApplyBoneRot(m_boneIdxShoulderR, 0.0f, 0.0f, intensity * XMConvertToRadians(-1.0f));
 }
 
 void MmdAnimator::ApplyAudioReactive(double dt, bool isMotionActive)
@@ -941,19 +1192,13 @@ void MmdAnimator::ApplyLipSync(float weight)
 {
 	float w = std::clamp(weight * 1.1f, 0.0f, 1.0f);
 	w = std::clamp(w * (0.65f + 0.35f * w), 0.0f, 1.0f);
-	auto applyMorph = [&](const std::wstring& name, float value)
-		{
-			float current = m_pose.morphWeights[name];
-			m_pose.morphWeights[name] = std::max(current, value);
-		};
 
-	applyMorph(L"あ", w);
-	applyMorph(L"い", w * 0.35f);
-	applyMorph(L"う", w * 0.55f);
-	applyMorph(L"え", w * 0.2f);
-	applyMorph(L"お", w * 0.6f);
-	applyMorph(L"口開け", w);
-	applyMorph(L"口開き", w);
+	// あ い う え お 口開け 口開き
+	const float scales[] = { 1.0f, 0.35f, 0.55f, 0.2f, 0.6f, 1.0f, 1.0f };
+	for (size_t i = 0; i < m_morphIdxLipSync.size(); ++i)
+	{
+		MaxMorphWeightByName(m_morphIdxLipSync[i], w * scales[i]);
+	}
 }
 
 void MmdAnimator::ApplySway(float phase, float strength, float motionScale)
@@ -968,33 +1213,23 @@ void MmdAnimator::ApplySway(float phase, float strength, float motionScale)
 
 	const float roll = DirectX::XMConvertToRadians(1.5f) * std::cos(phase * 0.5f) * amplitude;
 
-	auto applyRotation = [&](const std::wstring& boneName, float pitchRad, float yawRad, float rollRad, float weight)
+	auto applyRotation = [&](int32_t boneIndex, float pitchRad, float yawRad, float rollRad, float weight)
 		{
 			using namespace DirectX;
 			XMVECTOR delta = XMQuaternionRotationRollPitchYaw(pitchRad * weight, yawRad * weight, rollRad * weight);
-
-			XMVECTOR base = XMQuaternionIdentity();
-			auto it = m_pose.boneRotations.find(boneName);
-			if (it != m_pose.boneRotations.end())
-			{
-				base = XMLoadFloat4(&it->second);
-			}
-			XMVECTOR combined = XMQuaternionNormalize(XMQuaternionMultiply(base, delta));
-			XMFLOAT4 out{};
-			XMStoreFloat4(&out, combined);
-			m_pose.boneRotations.insert_or_assign(boneName, out);
+			MultiplyBoneRotation(boneIndex, delta, true);
 		};
 
-	applyRotation(L"頭", pitch * 1.2f, yaw * 0.6f, roll * 0.4f, 1.0f);
-	applyRotation(L"首", pitch * 0.8f, yaw * 0.5f, roll * 0.5f, 1.0f);
+	applyRotation(m_boneIdxHead, pitch * 1.2f, yaw * 0.6f, roll * 0.4f, 1.0f);
+	applyRotation(m_boneIdxNeck, pitch * 0.8f, yaw * 0.5f, roll * 0.5f, 1.0f);
 
 	// 上半身は逆位相にしたり、遅らせたりすると自然
-	applyRotation(L"上半身", pitch * 0.25f, yaw * 0.2f, roll * 0.25f, 1.0f);
-	applyRotation(L"上半身2", pitch * 0.18f, yaw * 0.16f, roll * 0.2f, 1.0f);
+	applyRotation(m_boneIdxUpperBody, pitch * 0.25f, yaw * 0.2f, roll * 0.25f, 1.0f);
+	applyRotation(m_boneIdxUpperBody2, pitch * 0.18f, yaw * 0.16f, roll * 0.2f, 1.0f);
 
 	const float shoulderRoll = roll * 0.35f + pitch * 0.12f;
-	applyRotation(L"左肩", 0.0f, 0.0f, shoulderRoll, 1.0f);
-	applyRotation(L"右肩", 0.0f, 0.0f, -shoulderRoll, 1.0f);
+	applyRotation(m_boneIdxShoulderL, 0.0f, 0.0f, shoulderRoll, 1.0f);
+	applyRotation(m_boneIdxShoulderR, 0.0f, 0.0f, -shoulderRoll, 1.0f);
 }
 
 void MmdAnimator::ApplyPoseTransition(double dtSeconds)
@@ -1026,76 +1261,46 @@ void MmdAnimator::ApplyPoseTransition(double dtSeconds)
 			return a + (b - a) * s;
 		};
 
-	// --- ボーン平行移動 ---
-	for (auto& [name, target] : m_pose.boneTranslations)
+	// 前のポーズと今回のポーズの片方にしか無い値は、無い側を既定値 (0 / 回転なし) として補間する
+	const size_t boneCount = std::min(m_pose.BoneCount(), m_transitionPose.BoneCount());
+	for (size_t i = 0; i < boneCount; ++i)
 	{
-		DirectX::XMFLOAT3 from{ 0.0f, 0.0f, 0.0f };
-		auto it = m_transitionPose.boneTranslations.find(name);
-		if (it != m_transitionPose.boneTranslations.end())
+		// --- ボーン平行移動 ---
+		if (m_pose.hasBoneTranslation[i] || m_transitionPose.hasBoneTranslation[i])
 		{
-			from = it->second;
+			const DirectX::XMFLOAT3 from = m_transitionPose.BoneTranslationOrZero(i);
+			const DirectX::XMFLOAT3 to = m_pose.BoneTranslationOrZero(i);
+			m_pose.SetBoneTranslation(i, DirectX::XMFLOAT3{
+				lerp(from.x, to.x, alpha),
+				lerp(from.y, to.y, alpha),
+				lerp(from.z, to.z, alpha)
+									  });
 		}
 
-		target.x = lerp(from.x, target.x, alpha);
-		target.y = lerp(from.y, target.y, alpha);
-		target.z = lerp(from.z, target.z, alpha);
-	}
-	for (const auto& [name, from] : m_transitionPose.boneTranslations)
-	{
-		if (m_pose.boneTranslations.find(name) != m_pose.boneTranslations.end()) continue;
-		m_pose.boneTranslations.insert_or_assign(name, DirectX::XMFLOAT3{
-			lerp(from.x, 0.0f, alpha),
-			lerp(from.y, 0.0f, alpha),
-			lerp(from.z, 0.0f, alpha)
-												 });
-	}
-
-	// --- ボーン回転 ---
-	auto LoadQuatOrIdentity = [](const std::unordered_map<std::wstring, DirectX::XMFLOAT4>& map, const std::wstring& name)
+		// --- ボーン回転 ---
+		if (m_pose.hasBoneRotation[i] || m_transitionPose.hasBoneRotation[i])
 		{
-			auto it = map.find(name);
-			if (it != map.end())
-			{
-				return DirectX::XMLoadFloat4(&it->second);
-			}
-			return DirectX::XMQuaternionIdentity();
-		};
-
-	for (auto& [name, target] : m_pose.boneRotations)
-	{
-		using namespace DirectX;
-		XMVECTOR toQ = XMQuaternionNormalize(XMLoadFloat4(&target));
-		XMVECTOR fromQ = XMQuaternionNormalize(LoadQuatOrIdentity(m_transitionPose.boneRotations, name));
-		XMVECTOR blended = XMQuaternionSlerp(fromQ, toQ, alpha);
+			using namespace DirectX;
+			const XMFLOAT4 from = m_transitionPose.BoneRotationOrIdentity(i);
+			const XMFLOAT4 to = m_pose.BoneRotationOrIdentity(i);
+			XMVECTOR fromQ = XMQuaternionNormalize(XMLoadFloat4(&from));
+			XMVECTOR toQ = XMQuaternionNormalize(XMLoadFloat4(&to));
+			XMVECTOR blended = XMQuaternionSlerp(fromQ, toQ, alpha);
 
-		XMStoreFloat4(&target, blended);
-	}
-	for (const auto& [name, from] : m_transitionPose.boneRotations)
-	{
-		if (m_pose.boneRotations.find(name) != m_pose.boneRotations.end()) continue;
-		using namespace DirectX;
-		XMVECTOR fromQ = XMQuaternionNormalize(XMLoadFloat4(&from));
-		XMVECTOR blended = XMQuaternionSlerp(fromQ, XMQuaternionIdentity(), alpha);
-		DirectX::XMFLOAT4 out{};
-		XMStoreFloat4(&out, blended);
-		m_pose.boneRotations.insert_or_assign(name, out);
+			XMFLOAT4 out{};
+			XMStoreFloat4(&out, blended);
+			m_pose.SetBoneRotation(i, out);
+		}
 	}
 
 	// --- モーフ ---
-	for (auto& [name, target] : m_pose.morphWeights)
+	const size_t morphCount = std::min(m_pose.MorphCount(), m_transitionPose.MorphCount());
+	for (size_t i = 0; i < morphCount; ++i)
 	{
-		float from = 0.0f;
-		auto it = m_transitionPose.morphWeights.find(name);
-		if (it != m_transitionPose.morphWeights.end())
+		if (m_pose.hasMorphWeight[i] || m_transitionPose.hasMorphWeight[i])
 		{
-			from = it->second;
+			m_pose.SetMorphWeight(i, lerp(m_transitionPose.MorphWeightOrZero(i), m_pose.MorphWeightOrZero(i), alpha));
 		}
-		target = lerp(from, target, alpha);
-	}
-	for (const auto& [name, from] : m_transitionPose.morphWeights)
-	{
-		if (m_pose.morphWeights.find(name) != m_pose.morphWeights.end()) continue;
-		m_pose.morphWeights.insert_or_assign(name, lerp(from, 0.0f, alpha));
 	}
 
 	if (t >= 1.0f)
@@ -1104,7 +1309,7 @@ void MmdAnimator::ApplyPoseTransition(double dtSeconds)
 	}
 }
 
-double MmdAnimator::ComputeAdaptiveTransitionDuration(const BonePose& from, const BonePose& to) const
+double MmdAnimator::ComputeAdaptiveTransitionDuration(const DensePose& from, const DensePose& to) const
 {
 	using namespace DirectX;
 
@@ -1120,87 +1325,34 @@ double MmdAnimator::ComputeAdaptiveTransitionDuration(const BonePose& from, cons
 			return std::sqrt(dx * dx + dy * dy + dz * dz);
 		};
 
-	auto getQuat = [](const std::unordered_map<std::wstring, DirectX::XMFLOAT4>& map, const std::wstring& name)
-		{
-			auto it = map.find(name);
-			if (it != map.end())
-			{
-				return DirectX::XMLoadFloat4(&it->second);
-			}
-			return DirectX::XMQuaternionIdentity();
-		};
-
-	auto accumulateBoneTranslation = [&](const std::wstring& name, const DirectX::XMFLOAT3& target, bool targetIsInTo)
-		{
-			DirectX::XMFLOAT3 source{ 0.0f,0.0f,0.0f };
-			auto it = from.boneTranslations.find(name);
-			if (it != from.boneTranslations.end())
-			{
-				source = it->second;
-			}
-			else if (!targetIsInTo)
-			{
-				return;
-			}
-			maxTranslation = std::max(maxTranslation, lengthDiff(source, target));
-		};
-
-	for (const auto& [name, target] : to.boneTranslations)
-	{
-		accumulateBoneTranslation(name, target, true);
-	}
-	for (const auto& entry : from.boneTranslations)
+	// 片方にしか無い値は、無い側を既定値 (0 / 回転なし) として比較する
+	const size_t boneCount = std::min(from.BoneCount(), to.BoneCount());
+	for (size_t i = 0; i < boneCount; ++i)
 	{
-		const auto& name = entry.first;
-		if (to.boneTranslations.find(name) == to.boneTranslations.end())
+		if (from.hasBoneTranslation[i] || to.hasBoneTranslation[i])
 		{
-			accumulateBoneTranslation(name, DirectX::XMFLOAT3{}, false);
+			maxTranslation = std::max(maxTranslation, lengthDiff(from.BoneTranslationOrZero(i), to.BoneTranslationOrZero(i)));
 		}
-	}
 
-	auto accumulateBoneRotation = [&](const std::wstring& name, XMVECTOR target, bool targetIsInTo)
+		if (from.hasBoneRotation[i] || to.hasBoneRotation[i])
 		{
-			XMVECTOR source = getQuat(from.boneRotations, name);
-			if (!targetIsInTo && from.boneRotations.find(name) == from.boneRotations.end())
-			{
-				return;
-			}
-			XMVECTOR fromN = XMQuaternionNormalize(source);
-			XMVECTOR toN = XMQuaternionNormalize(target);
+			const XMFLOAT4 source = from.BoneRotationOrIdentity(i);
+			const XMFLOAT4 target = to.BoneRotationOrIdentity(i);
+			XMVECTOR fromN = XMQuaternionNormalize(XMLoadFloat4(&source));
+			XMVECTOR toN = XMQuaternionNormalize(XMLoadFloat4(&target));
 			float dot = std::abs(XMVectorGetX(XMQuaternionDot(fromN, toN)));
 			dot = std::clamp(dot, -1.0f, 1.0f);
 			float angleRad = 2.0f * std::acos(dot);
 			maxRotDeg = std::max(maxRotDeg, XMConvertToDegrees(angleRad));
-		};
-
-	for (const auto& [name, target] : to.boneRotations)
-	{
-		accumulateBoneRotation(name, DirectX::XMLoadFloat4(&target), true);
-	}
-	for (const auto& entry : from.boneRotations)
-	{
-		const auto& name = entry.first;
-		if (to.boneRotations.find(name) == to.boneRotations.end())
-		{
-			accumulateBoneRotation(name, DirectX::XMQuaternionIdentity(), false);
 		}
 	}
 
-	for (const auto& [name, target] : to.morphWeights)
-	{
-		float fromWeight = 0.0f;
-		auto it = from.morphWeights.find(name);
-		if (it != from.morphWeights.end())
-		{
-			fromWeight = it->second;
-		}
-		maxMorph = std::max(maxMorph, std::abs(target - fromWeight));
-	}
-	for (const auto& [name, source] : from.morphWeights)
+	const size_t morphCount = std::min(from.MorphCount(), to.MorphCount());
+	for (size_t i = 0; i < morphCount; ++i)
 	{
-		if (to.morphWeights.find(name) == to.morphWeights.end())
+		if (from.hasMorphWeight[i] || to.hasMorphWeight[i])
 		{
-			maxMorph = std::max(maxMorph, std::abs(source));
+			maxMorph = std::max(maxMorph, std::abs(to.MorphWeightOrZero(i) - from.MorphWeightOrZero(i)));
 		}
 	}
 
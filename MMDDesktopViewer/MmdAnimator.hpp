@@ -2,20 +2,24 @@
 #include <filesystem>
 #include <memory>
 #include <chrono>
+#include <array>
 #include <unordered_map>
 #include <DirectXMath.h>
 #include "PmxModel.hpp"
 #include "VmdMotion.hpp"
 #include "BoneSolver.hpp"
+#include "MorphGraph.hpp"
 #include "Settings.hpp"
 #include "AudioReactiveState.hpp"
+#include "TickProfile.hpp"
 
 class MmdPhysicsWorld;
+class PhysicsThread;
 
 class MmdAnimator
 {
 public:
-	using Pose = BonePose;
+	using Pose = DensePose;
 
 	MmdAnimator();
 	~MmdAnimator();
@@ -60,6 +64,20 @@ public:
 	void SetPhysicsSettings(const PhysicsSettings& settings);
 	const PhysicsSettings& GetPhysicsSettings() const;
 
+	// PhysicsSettings::asyncPhysics で物理スレッドが回っているか。
+	// GetPhysicsThread はまだ一度も起動していなければ nullptr
+	bool IsPhysicsThreadRunning() const;
+	const PhysicsThread* GetPhysicsThread() const;
+
+	// Tick の段階ごとの所要時間を profile に加算する (nullptr で計測しない)。
+	// 値のリセットは呼び出し側で行う。
+	void SetProfile(TickProfile* profile);
+
+	// IK の入力が前回と同じなら解き直さない (BoneSolver::SetIkCacheEnabled)
+	void SetIkCacheEnabled(bool enabled);
+	// IK ボーン名で IK を有効/無効にする (モーションの IK キーとは別。見つからなければ false)
+	bool SetIkEnabled(const std::wstring& ikBoneName, bool enabled);
+
 	// --- LookAt 機能 ---
 	void SetLookAtState(bool enabled, float yaw, float pitch);
 	void SetLookAtTarget(bool enabled, const DirectX::XMFLOAT3& targetPos);
@@ -76,10 +94,18 @@ public:
 		return m_motion.get();
 	}
 
+	// モデルのボーン/モーフ番号で引く現在のポーズ
 	const Pose& CurrentPose() const
 	{
 		return m_pose;
 	}
+	// グループ/フリップを展開したモーフの実効ウェイトと対象ごとの索引 (Tick で更新)
+	const MorphGraph& CurrentMorphs() const
+	{
+		return m_morphGraph;
+	}
+	// 名前で引く形に変換したポーズ (外部呼び出し用。呼ぶたびに組み立てる)
+	BonePose CurrentNamedPose() const;
 	const DirectX::XMFLOAT4X4& MotionTransform() const
 	{
 		return m_motionTransform;
@@ -95,6 +121,11 @@ public:
 	}
 
 	const std::vector<DirectX::XMFLOAT4X4>& GetSkinningMatrices() const;
+	// スキニング行列の差分 (BoneSolver::SkinningRevision / GetSkinningChangedRange を参照)
+	uint64_t SkinningRevision() const;
+	bool GetSkinningChangedRange(uint64_t sinceRevision, size_t& outBegin, size_t& outEnd) const;
+	// 転置済み 3x4 のボーン行列を書く (BoneSolver::WriteSkinningPalette を参照)
+	size_t WriteSkinningPalette(DirectX::XMFLOAT3X4* dst, size_t capacity, uint64_t sinceRevision) const;
 	size_t GetBoneCount() const;
 	bool HasSkinnedPose() const
 	{
@@ -141,8 +172,11 @@ private:
 	std::unique_ptr<PmxModel> m_model;
 	std::unique_ptr<VmdMotion> m_motion;
 	std::unique_ptr<BoneSolver> m_boneSolver;
+	MorphGraph m_morphGraph;
 
 	std::unique_ptr<MmdPhysicsWorld> m_physicsWorld;
+	// m_physicsWorld と m_model を参照するので、それらより後に宣言する (先に破棄される)
+	std::unique_ptr<PhysicsThread> m_physicsThread;
 	bool m_physicsEnabled{ true };
 
 	double m_time{};
@@ -162,9 +196,16 @@ private:
 	// キャッシュ用メンバ変数
 	const VmdMotion* m_cachedMotionPtr = nullptr;
 	std::vector<int> m_boneTrackToBoneIndex;
-	std::vector<int> m_morphTrackToMorphIndex;
+	std::vector<int> m_morphTrackToMorphIndex;   // 同名モーフの先頭 (m_morphNextSameName で残りを辿る)
+	std::vector<std::uint8_t> m_boneTrackTranslationMode;
 	std::vector<size_t> m_boneKeyCursors;
 	std::vector<size_t> m_morphKeyCursors;
+	// IK キーごとの状態 (モデルの IK ボーンに解決済み)。
+	// キー k は m_ikKeyBones/m_ikKeyEnabled[m_ikKeyStateOffsets[k] .. m_ikKeyStateOffsets[k + 1])
+	std::vector<std::uint32_t> m_ikKeyStateOffsets;
+	std::vector<std::int32_t> m_ikKeyBones;
+	std::vector<std::uint8_t> m_ikKeyEnabled;
+	size_t m_ikKeyCursor{ 0 };
 
 	// LookAt用
 	bool m_lookAtEnabled{ false };
@@ -177,9 +218,19 @@ private:
 	int32_t m_boneIdxEyeL{ -1 };
 	int32_t m_boneIdxEyeR{ -1 };
 
-	BonePose m_lastPose{};
+	// 呼吸・揺れ・まばたき・リップシンクの対象 (モデル設定時に名前から解決)
+	int32_t m_boneIdxUpperBody{ -1 };
+	int32_t m_boneIdxUpperBody2{ -1 };
+	int32_t m_boneIdxShoulderL{ -1 };
+	int32_t m_boneIdxShoulderR{ -1 };
+	int32_t m_morphIdxBlink{ -1 };
+	std::array<int32_t, 7> m_morphIdxLipSync{};   // あ い う え お 口開け 口開き
+	// 同じ名前のモーフが複数ある場合の次の番号 (-1 で終端)
+	std::vector<int32_t> m_morphNextSameName;
+
+	DensePose m_lastPose{};
 	bool m_hasLastPose{ false };
-	BonePose m_transitionPose{};
+	DensePose m_transitionPose{};
 	bool m_hasTransitionPose{ false };
 	bool m_transitionActive{ false };
 	double m_transitionElapsed{ 0.0 };
@@ -187,8 +238,21 @@ private:
 	bool m_transitionNeedsInit{ false };
 
 	void CacheLookAtBones();
+	void CacheLayerTargets();
+	void SetMorphWeightByName(int32_t firstMorph, float weight);
+	void MaxMorphWeightByName(int32_t firstMorph, float weight);
+	void MultiplyBoneRotation(int32_t boneIndex, DirectX::FXMVECTOR delta, bool normalize);
 
 	void UpdateMotionCache(const VmdMotion* motion);
+	void SampleBoneTracks(const VmdMotion& motion, float currentFrame);
+	void SampleMorphTracks(const VmdMotion& motion, float currentFrame);
+	void SampleIkStates(const VmdMotion& motion, float currentFrame);
+
+	// 物理スレッドを止め、world の計測先を戻す。ResetPhysics はさらに world をリセットする
+	void StopPhysicsThread();
+	void ResetPhysics();
+
+	TickProfile* m_profile{ nullptr };
 
 	bool m_autoBlinkEnabled{ false };
 	float m_blinkTimer{ 0.0f };       // 次の動作までのタイマー
@@ -207,7 +271,7 @@ private:
 	void ApplySway(float phase, float strength, float motionScale);
 	void ApplyPoseTransition(double dtSeconds);
 	void BeginPoseTransitionFromLastPose();
-	double ComputeAdaptiveTransitionDuration(const BonePose& from, const BonePose& to) const;
+	double ComputeAdaptiveTransitionDuration(const DensePose& from, const DensePose& to) const;
 	float EvaluateTransitionAlpha(float t) const;
 
 	bool m_audioReactiveEnabled{ false };
@@ -1,12 +1,15 @@
 ﻿#include "MmdPhysicsWorld.hpp"
+#include "JobSystem.hpp"
 #include <algorithm>
 #include <limits>
 #include <cmath>
+#include <numeric>
 #include <cstdint>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 #include <queue>
+#include <random>
 #include <span>
 
 using namespace DirectX;
@@ -16,6 +19,15 @@ namespace
 	static constexpr float kEps = 1.0e-6f;
 	static constexpr float kBigEps = 1.0e-4f;
 
+	// 剛体ごとに独立したループ。分け方は JobSystem が実測から決める
+	JobSystem::LoopSite g_initSite{ "physics.init_bodies" };
+	JobSystem::LoopSite g_kinematicSite{ "physics.kinematic" };
+	JobSystem::LoopSite g_integrateSite{ "physics.integrate" };
+	JobSystem::LoopSite g_shapesSite{ "physics.collision_shapes" };
+	JobSystem::LoopSite g_groundSite{ "physics.ground" };
+	JobSystem::LoopSite g_endSite{ "physics.end_substep" };
+	JobSystem::LoopSite g_jointSite{ "physics.joints" };
+
 	// Scratch types for broadphase (kept in anonymous namespace)
 	struct SapNode
 	{
@@ -44,6 +56,136 @@ namespace
 		return std::isfinite(f.x) && std::isfinite(f.y) && std::isfinite(f.z) && std::isfinite(f.w);
 	}
 
+	// --- 4 剛体ずつ処理するためのレーン演算 ---
+	// XMVECTOR の各レーンが別の剛体。成分ごとの配列 (BodyState) から 4 要素まとめて読み書きする
+
+	struct Vec3Lanes
+	{
+		XMVECTOR x, y, z;
+	};
+
+	struct QuatLanes
+	{
+		XMVECTOR x, y, z, w;
+	};
+
+	inline static XMVECTOR LoadLanes(const std::vector<float>& v, size_t i)
+	{
+		return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(v.data() + i));
+	}
+
+	inline static void StoreLanes(std::vector<float>& v, size_t i, FXMVECTOR value)
+	{
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(v.data() + i), value);
+	}
+
+	// 有限なレーンは全ビット 1
+	inline static XMVECTOR FiniteLanes(FXMVECTOR v)
+	{
+		return XMVectorNorInt(XMVectorIsNaN(v), XMVectorIsInfinite(v));
+	}
+
+	inline static XMVECTOR LengthLanes(const Vec3Lanes& v)
+	{
+		return XMVectorSqrt(XMVectorAdd(XMVectorAdd(XMVectorMultiply(v.x, v.x), XMVectorMultiply(v.y, v.y)), XMVectorMultiply(v.z, v.z)));
+	}
+
+	inline static Vec3Lanes ScaleLanes(const Vec3Lanes& v, FXMVECTOR s)
+	{
+		return { XMVectorMultiply(v.x, s), XMVectorMultiply(v.y, s), XMVectorMultiply(v.z, s) };
+	}
+
+	inline static Vec3Lanes SelectLanes(const Vec3Lanes& a, const Vec3Lanes& b, FXMVECTOR control)
+	{
+		return { XMVectorSelect(a.x, b.x, control), XMVectorSelect(a.y, b.y, control), XMVectorSelect(a.z, b.z, control) };
+	}
+
+	// XMQuaternionMultiply(q1, q2) をレーンごとに (q1 の回転のあとに q2 の回転)
+	inline static QuatLanes QuaternionMultiplyLanes(const QuatLanes& q1, const QuatLanes& q2)
+	{
+		QuatLanes r;
+		r.x = XMVectorSubtract(XMVectorAdd(XMVectorAdd(XMVectorMultiply(q2.w, q1.x), XMVectorMultiply(q2.x, q1.w)), XMVectorMultiply(q2.y, q1.z)), XMVectorMultiply(q2.z, q1.y));
+		r.y = XMVectorAdd(XMVectorAdd(XMVectorSubtract(XMVectorMultiply(q2.w, q1.y), XMVectorMultiply(q2.x, q1.z)), XMVectorMultiply(q2.y, q1.w)), XMVectorMultiply(q2.z, q1.x));
+		r.z = XMVectorAdd(XMVectorSubtract(XMVectorAdd(XMVectorMultiply(q2.w, q1.z), XMVectorMultiply(q2.x, q1.y)), XMVectorMultiply(q2.y, q1.x)), XMVectorMultiply(q2.z, q1.w));
+		r.w = XMVectorSubtract(XMVectorSubtract(XMVectorSubtract(XMVectorMultiply(q2.w, q1.w), XMVectorMultiply(q2.x, q1.x)), XMVectorMultiply(q2.y, q1.y)), XMVectorMultiply(q2.z, q1.z));
+		return r;
+	}
+
+	inline static QuatLanes QuaternionNormalizeLanes(const QuatLanes& q)
+	{
+		const XMVECTOR lenSq = XMVectorAdd(XMVectorAdd(XMVectorMultiply(q.x, q.x), XMVectorMultiply(q.y, q.y)),
+										   XMVectorAdd(XMVectorMultiply(q.z, q.z), XMVectorMultiply(q.w, q.w)));
+		const XMVECTOR len = XMVectorSqrt(lenSq);
+		const XMVECTOR valid = XMVectorGreater(len, XMVectorZero());
+		const XMVECTOR inv = XMVectorSelect(XMVectorSplatOne(), XMVectorReciprocal(len), valid);
+		return { XMVectorMultiply(q.x, inv), XMVectorMultiply(q.y, inv), XMVectorMultiply(q.z, inv), XMVectorMultiply(q.w, inv) };
+	}
+
+	// 角速度 w で dt だけ回す四元数 (QuaternionFromAngularVelocity のレーン版)
+	inline static QuatLanes QuaternionFromAngularVelocityLanes(const Vec3Lanes& w, float dt)
+	{
+		const XMVECTOR len = LengthLanes(w);
+		const XMVECTOR angle = XMVectorScale(len, dt);
+		const XMVECTOR turn = XMVectorAndInt(XMVectorGreaterOrEqual(angle, XMVectorReplicate(kEps)), FiniteLanes(angle));
+
+		XMVECTOR s, c;
+		XMVectorSinCos(&s, &c, XMVectorScale(angle, 0.5f));
+		const XMVECTOR axisScale = XMVectorDivide(s, len);   // 軸の正規化と sin(θ/2) をまとめて掛ける
+
+		QuatLanes dq;
+		dq.x = XMVectorSelect(XMVectorZero(), XMVectorMultiply(w.x, axisScale), turn);
+		dq.y = XMVectorSelect(XMVectorZero(), XMVectorMultiply(w.y, axisScale), turn);
+		dq.z = XMVectorSelect(XMVectorZero(), XMVectorMultiply(w.z, axisScale), turn);
+		dq.w = XMVectorSelect(XMVectorSplatOne(), c, turn);
+		return dq;
+	}
+
+	// 回転の差分 dq を dt で割った角速度 (QuaternionDeltaToAngularVelocity のレーン版)
+	inline static Vec3Lanes QuaternionDeltaToAngularVelocityLanes(QuatLanes dq, float dt)
+	{
+		dt = std::max(dt, kEps);
+		const XMVECTOR valid = XMVectorAndInt(XMVectorAndInt(FiniteLanes(dq.x), FiniteLanes(dq.y)),
+											  XMVectorAndInt(FiniteLanes(dq.z), FiniteLanes(dq.w)));
+
+		// 短い方の回りにする
+		const XMVECTOR flip = XMVectorLess(dq.w, XMVectorZero());
+		dq.x = XMVectorSelect(dq.x, XMVectorNegate(dq.x), flip);
+		dq.y = XMVectorSelect(dq.y, XMVectorNegate(dq.y), flip);
+		dq.z = XMVectorSelect(dq.z, XMVectorNegate(dq.z), flip);
+		dq.w = XMVectorSelect(dq.w, XMVectorNegate(dq.w), flip);
+
+		const XMVECTOR w = XMVectorClamp(dq.w, XMVectorReplicate(-1.0f), XMVectorSplatOne());
+		const XMVECTOR angle = XMVectorScale(XMVectorACos(w), 2.0f);
+		const XMVECTOR s = XMVectorSqrt(XMVectorMax(XMVectorZero(), XMVectorSubtract(XMVectorSplatOne(), XMVectorMultiply(w, w))));
+
+		const XMVECTOR tiny = XMVectorReplicate(1.0e-5f);
+		XMVECTOR turn = XMVectorAndInt(valid, XMVectorAndInt(XMVectorGreaterOrEqual(s, tiny), XMVectorGreaterOrEqual(XMVectorAbs(angle), tiny)));
+
+		Vec3Lanes axis = ScaleLanes({ dq.x, dq.y, dq.z }, XMVectorReciprocal(s));
+		axis = ScaleLanes(axis, XMVectorReciprocal(LengthLanes(axis)));
+		turn = XMVectorAndInt(turn, XMVectorAndInt(XMVectorAndInt(FiniteLanes(axis.x), FiniteLanes(axis.y)), FiniteLanes(axis.z)));
+
+		const Vec3Lanes omega = ScaleLanes(axis, XMVectorScale(angle, 1.0f / dt));
+		return SelectLanes({ XMVectorZero(), XMVectorZero(), XMVectorZero() }, omega, turn);
+	}
+
+	// 速さを maxSpeed までに抑え、restSpeed 未満なら 0 にする (どちらも 0 以下なら何もしない)
+	inline static Vec3Lanes LimitSpeedLanes(Vec3Lanes v, float maxSpeed, float restSpeed)
+	{
+		if (maxSpeed > 0.0f)
+		{
+			const XMVECTOR len = LengthLanes(v);
+			const XMVECTOR limit = XMVectorReplicate(maxSpeed);
+			v = ScaleLanes(v, XMVectorSelect(XMVectorSplatOne(), XMVectorDivide(limit, len), XMVectorGreater(len, limit)));
+		}
+		if (restSpeed > 0.0f)
+		{
+			const XMVECTOR still = XMVectorLess(LengthLanes(v), XMVectorReplicate(restSpeed));
+			v = SelectLanes(v, { XMVectorZero(), XMVectorZero(), XMVectorZero() }, still);
+		}
+		return v;
+	}
+
 	inline static XMVECTOR SafeNormalize3(XMVECTOR v)
 	{
 		float len = Length3(v);
@@ -466,15 +608,38 @@ void MmdPhysicsWorld::Reset()
 	m_builtRevision = 0;
 	m_accumulator = 0.0;
 	m_bodies.clear();
+	m_state.Clear();
 	m_joints.clear();
 	m_jointAdjacency.clear();
+	m_islands.clear();
+	m_bodyIsland.clear();
+	m_jointIsland.clear();
+	m_kinematicMoved.clear();
+	m_bodyActive.clear();
+	m_simBodies.clear();
+	m_simBlocks.clear();
+	m_dampingDt = -1.0f;
+	m_jointSlots.Clear();
+	m_jointColorOffsets.clear();
+	m_activeJointSlots.clear();
+	m_activeColorOffsets.clear();
+	m_colorOrder.clear();
+	m_awakeDynamicBodies = 0;
+	m_wakePending = false;
 	m_shapeCache.clear();
+	m_collisionFilters.clear();
+	m_pairs.clear();
+	m_nextPairs.clear();
+	m_pairTable.clear();
+	m_pairTableValid = false;
 	m_candidates.clear();
 	m_axisList.clear();
 	m_radii.clear();
-	m_maxXs.clear();
+	m_axisMax.clear();
 	m_bodyToAxisIndex.clear();
 	m_axisListInitialized = false;
+	m_sapAxis = 0;
+	m_sapAxisCheckCountdown = 0;
 	m_writeBackOrder.clear();
 	m_keepTranslationFlags.clear();
 	m_desiredGlobals.clear();
@@ -483,6 +648,8 @@ void MmdPhysicsWorld::Reset()
 	m_hasAppliedGlobal.clear();
 	m_originalLocalTranslation.clear();
 	m_writebackFallbackNoAfterPhysics = false;
+	m_writeBackPositions.clear();
+	m_writeBackRotations.clear();
 }
 
 void MmdPhysicsWorld::BuildFromModel(const PmxModel& model, const BoneSolver& bones)
@@ -571,6 +738,7 @@ void MmdPhysicsWorld::BuildFromModel(const PmxModel& model, const BoneSolver& bo
 
 	m_bodies.reserve(rbDefs.size() + static_cast<size_t>(m_settings.maxGeneratedBodyColliders));
 	m_bodies.resize(rbDefs.size());
+	m_state.Resize(rbDefs.size());
 
 	// [FIX] 既に剛体が割り当てられているボーンを追跡するためのフラグ配列
 	std::vector<bool> boneHasBody(bonesDef.size(), false);
@@ -636,14 +804,13 @@ void MmdPhysicsWorld::BuildFromModel(const PmxModel& model, const BoneSolver& bo
 		b.groupMask = def.ignoreCollisionGroup;
 		b.friction = def.friction;
 		b.restitution = def.restitution;
-		b.linearVelocity = { 0.0f, 0.0f, 0.0f };
-		b.angularVelocity = { 0.0f, 0.0f, 0.0f };
 
 		const bool dynamic = (def.operation != PmxModel::RigidBody::OperationType::Static);
 		if (dynamic && def.mass > 0.0f)
 		{
-			b.invMass = 1.0f / def.mass;
-			if (m_settings.maxInvMass > 0.0f) b.invMass = std::min(b.invMass, m_settings.maxInvMass);
+			float invMass = 1.0f / def.mass;
+			if (m_settings.maxInvMass > 0.0f) invMass = std::min(invMass, m_settings.maxInvMass);
+			m_state.invMass[i] = invMass;
 
 			float effR = std::max(b.capsuleRadius, b.capsuleRadius + b.capsuleHalfHeight);
 			effR = std::max(effR, 0.05f);
@@ -651,7 +818,7 @@ void MmdPhysicsWorld::BuildFromModel(const PmxModel& model, const BoneSolver& bo
 			float I = 0.4f * def.mass * effR * effR;
 			float invI = (I > 0.0f) ? (1.0f / I) : 0.0f;
 			if (invI > m_settings.maxInvInertia) invI = m_settings.maxInvInertia;
-			b.invInertia = { invI, invI, invI };
+			m_state.invInertia.Set(i, { invI, invI, invI });
 		}
 
 		DirectX::XMMATRIX rb0 =
@@ -667,15 +834,16 @@ void MmdPhysicsWorld::BuildFromModel(const PmxModel& model, const BoneSolver& bo
 		}
 		DirectX::XMStoreFloat4x4(&b.localFromBone, localFromBone);
 
-		DecomposeTR(rb0, b.position, b.rotation);
-		b.prevPosition = b.position;
-		b.prevRotation = b.rotation;
-		b.kinematicStartPos = b.position;
-		b.kinematicStartRot = b.rotation;
-		b.kinematicTargetPos = b.position;
-		b.kinematicTargetRot = b.rotation;
+		XMFLOAT3 pos;
+		XMFLOAT4 rot;
+		DecomposeTR(rb0, pos, rot);
+		b.kinematicStartPos = pos;
+		b.kinematicStartRot = rot;
+		b.kinematicTargetPos = pos;
+		b.kinematicTargetRot = rot;
 
 		m_bodies[i] = b;
+		m_state.SetPose(i, pos, rot);
 	}
 
 	// Auto-generate kinematic body colliders
@@ -816,9 +984,6 @@ void MmdPhysicsWorld::BuildFromModel(const PmxModel& model, const BoneSolver& bo
 				b.capsuleRadius = radius;
 				b.capsuleHalfHeight = hh;
 
-				b.invMass = 0.0f;
-				b.invInertia = { 0.0f, 0.0f, 0.0f };
-
 				b.group = genGroup;
 				b.groupMask = genMask;
 				b.friction = m_settings.generatedBodyColliderFriction;
@@ -831,48 +996,53 @@ void MmdPhysicsWorld::BuildFromModel(const PmxModel& model, const BoneSolver& bo
 				XMMATRIX localFromBone = invBind * rb0;
 				XMStoreFloat4x4(&b.localFromBone, localFromBone);
 
-				DecomposeTR(rb0, b.position, b.rotation);
-				b.prevPosition = b.position;
-				b.prevRotation = b.rotation;
-				b.kinematicStartPos = b.position;
-				b.kinematicStartRot = b.rotation;
-				b.kinematicTargetPos = b.position;
-				b.kinematicTargetRot = b.rotation;
+				XMFLOAT3 pos;
+				XMFLOAT4 rot;
+				DecomposeTR(rb0, pos, rot);
+				b.kinematicStartPos = pos;
+				b.kinematicStartRot = rot;
+				b.kinematicTargetPos = pos;
+				b.kinematicTargetRot = rot;
 
 				m_bodies.push_back(b);
+				m_state.Resize(m_bodies.size());
+				m_state.SetPose(m_bodies.size() - 1, pos, rot);
 			}
 		}
 	}
 
 	BuildConstraints(model);
+	BuildIslands();
+	BuildJointColors();
+	BuildCollisionFilters();
+	RebuildActiveLists();
 
-	const int n = static_cast<int>(m_bodies.size());
-#ifdef _OPENMP
-#pragma omp parallel for schedule(static) if(n >= 512)
-#endif
-	for (int i = 0; i < n; ++i)
-	{
-		Body& b = m_bodies[i];
+	JobSystem::Shared().ParallelFor(g_initSite, m_bodies.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+		{
+			Body& b = m_bodies[i];
 
-		DirectX::XMMATRIX rbCurrent = MatrixFromTR(b.position, b.rotation);
+			DirectX::XMMATRIX rbCurrent = MatrixFromTR(m_state.position.Get(i), m_state.rotation.Get(i));
 
-		const int boneIndex = b.boneIndex;
-		if (boneIndex >= 0 && boneIndex < static_cast<int>(bonesDef.size()))
-		{
-			const auto& boneGlobalF = bones.GetBoneGlobalMatrix(static_cast<size_t>(boneIndex));
-			DirectX::XMMATRIX boneG = DirectX::XMLoadFloat4x4(&boneGlobalF);
-			DirectX::XMMATRIX localFromBone = DirectX::XMLoadFloat4x4(&b.localFromBone);
-			rbCurrent = boneG * localFromBone;
-		}
+			const int boneIndex = b.boneIndex;
+			if (boneIndex >= 0 && boneIndex < static_cast<int>(bonesDef.size()))
+			{
+				const auto& boneGlobalF = bones.GetBoneGlobalMatrix(static_cast<size_t>(boneIndex));
+				DirectX::XMMATRIX boneG = DirectX::XMLoadFloat4x4(&boneGlobalF);
+				DirectX::XMMATRIX localFromBone = DirectX::XMLoadFloat4x4(&b.localFromBone);
+				rbCurrent = boneG * localFromBone;
+			}
 
-		DecomposeTR(rbCurrent, b.position, b.rotation);
-		b.prevPosition = b.position;
-		b.prevRotation = b.rotation;
-		b.kinematicStartPos = b.position;
-		b.kinematicStartRot = b.rotation;
-		b.kinematicTargetPos = b.position;
-		b.kinematicTargetRot = b.rotation;
-	}
+			XMFLOAT3 pos;
+			XMFLOAT4 rot;
+			DecomposeTR(rbCurrent, pos, rot);
+			m_state.SetPose(i, pos, rot);
+			b.kinematicStartPos = pos;
+			b.kinematicStartRot = rot;
+			b.kinematicTargetPos = pos;
+			b.kinematicTargetRot = rot;
+		}
+	});
 
 	BuildWriteBackOrder(model);
 
@@ -895,11 +1065,11 @@ void MmdPhysicsWorld::BuildConstraints(const PmxModel& model)
 		if (j.rigidBodyA >= static_cast<int>(m_bodies.size())) continue;
 		if (j.rigidBodyB >= static_cast<int>(m_bodies.size())) continue;
 
-		const Body& a0 = m_bodies[static_cast<size_t>(j.rigidBodyA)];
-		const Body& b0 = m_bodies[static_cast<size_t>(j.rigidBodyB)];
+		const size_t a0 = static_cast<size_t>(j.rigidBodyA);
+		const size_t b0 = static_cast<size_t>(j.rigidBodyB);
 
-		XMMATRIX Ta0 = MatrixFromTR(a0.position, a0.rotation);
-		XMMATRIX Tb0 = MatrixFromTR(b0.position, b0.rotation);
+		XMMATRIX Ta0 = MatrixFromTR(m_state.position.Get(a0), m_state.rotation.Get(a0));
+		XMMATRIX Tb0 = MatrixFromTR(m_state.position.Get(b0), m_state.rotation.Get(b0));
 
 		XMMATRIX Tj0 = MatrixRotationEulerXYZ(j.rotation.x, j.rotation.y, j.rotation.z) *
 			XMMatrixTranslation(j.position.x, j.position.y, j.position.z);
@@ -929,7 +1099,6 @@ void MmdPhysicsWorld::BuildConstraints(const PmxModel& model)
 		c.rotUpper = j.rotationUpper;
 		c.positionSpring = j.springPosition;
 		c.rotationSpring = j.springRotation;
-		c.lambdaPos = 0.0f;
 
 		m_joints.push_back(c);
 
@@ -946,6 +1115,217 @@ void MmdPhysicsWorld::BuildConstraints(const PmxModel& model)
 
 }
 
+void MmdPhysicsWorld::BuildIslands()
+{
+	const size_t bodyCount = m_bodies.size();
+	m_islands.clear();
+	m_bodyIsland.assign(bodyCount, -1);
+	m_jointIsland.assign(m_joints.size(), -1);
+	m_kinematicMoved.assign(bodyCount, 0);
+	m_bodyActive.assign(bodyCount, 0);
+
+	// 動的剛体どうしをつなぐジョイントで union-find。
+	// ボーン追従剛体は島をつながず (頭に付いた髪とスカートを同じ島にしない)、つながる島のアンカーになる
+	std::vector<uint32_t> parent(bodyCount);
+	std::iota(parent.begin(), parent.end(), 0u);
+	auto findRoot = [&](uint32_t x) {
+		while (parent[x] != x)
+		{
+			parent[x] = parent[parent[x]];
+			x = parent[x];
+		}
+		return x;
+	};
+
+	for (const auto& c : m_joints)
+	{
+		const uint32_t a = static_cast<uint32_t>(c.bodyA);
+		const uint32_t b = static_cast<uint32_t>(c.bodyB);
+		if (m_state.invMass[a] <= 0.0f || m_state.invMass[b] <= 0.0f) continue;
+
+		const uint32_t ra = findRoot(a);
+		const uint32_t rb = findRoot(b);
+		if (ra != rb) parent[std::max(ra, rb)] = std::min(ra, rb);
+	}
+
+	std::vector<int> rootIsland(bodyCount, -1);
+	for (uint32_t i = 0; i < bodyCount; ++i)
+	{
+		if (m_state.invMass[i] <= 0.0f) continue;
+
+		int& island = rootIsland[findRoot(i)];
+		if (island < 0)
+		{
+			island = static_cast<int>(m_islands.size());
+			m_islands.emplace_back();
+		}
+		m_bodyIsland[i] = island;
+		m_islands[static_cast<size_t>(island)].bodies.push_back(i);
+	}
+
+	for (size_t j = 0; j < m_joints.size(); ++j)
+	{
+		const auto& c = m_joints[j];
+		const int islandA = m_bodyIsland[static_cast<size_t>(c.bodyA)];
+		const int islandB = m_bodyIsland[static_cast<size_t>(c.bodyB)];
+		const int island = (islandA >= 0) ? islandA : islandB;
+		m_jointIsland[j] = island;
+		if (island < 0 || (islandA >= 0 && islandB >= 0)) continue;
+
+		const uint32_t anchor = static_cast<uint32_t>((islandA >= 0) ? c.bodyB : c.bodyA);
+		auto& anchors = m_islands[static_cast<size_t>(island)].anchors;
+		if (std::find(anchors.begin(), anchors.end(), anchor) == anchors.end()) anchors.push_back(anchor);
+	}
+}
+
+void MmdPhysicsWorld::JointSlots::Clear()
+{
+	bodyA.clear();
+	bodyB.clear();
+	island.clear();
+	localAnchorA.clear();
+	localAnchorB.clear();
+	rotAtoJ.clear();
+	rotBtoJ.clear();
+	rotLower.clear();
+	rotUpper.clear();
+	rotationSpring.clear();
+	lambdaPos.clear();
+}
+
+void MmdPhysicsWorld::JointSlots::Push(const JointConstraint& c, int islandIndex)
+{
+	bodyA.push_back(static_cast<uint32_t>(c.bodyA));
+	bodyB.push_back(static_cast<uint32_t>(c.bodyB));
+	island.push_back(islandIndex);
+	localAnchorA.push_back(c.localAnchorA);
+	localAnchorB.push_back(c.localAnchorB);
+	rotAtoJ.push_back(c.rotAtoJ);
+	rotBtoJ.push_back(c.rotBtoJ);
+	rotLower.push_back(c.rotLower);
+	rotUpper.push_back(c.rotUpper);
+	rotationSpring.push_back(c.rotationSpring);
+	lambdaPos.push_back(0.0f);
+}
+
+void MmdPhysicsWorld::Float3Soa::Resize(size_t count, const XMFLOAT3& value)
+{
+	x.resize(count, value.x);
+	y.resize(count, value.y);
+	z.resize(count, value.z);
+}
+
+void MmdPhysicsWorld::Float3Soa::Store(size_t i, FXMVECTOR v)
+{
+	XMFLOAT3 f;
+	XMStoreFloat3(&f, v);
+	Set(i, f);
+}
+
+void MmdPhysicsWorld::Float4Soa::Resize(size_t count, const XMFLOAT4& value)
+{
+	x.resize(count, value.x);
+	y.resize(count, value.y);
+	z.resize(count, value.z);
+	w.resize(count, value.w);
+}
+
+void MmdPhysicsWorld::Float4Soa::Store(size_t i, FXMVECTOR v)
+{
+	XMFLOAT4 f;
+	XMStoreFloat4(&f, v);
+	Set(i, f);
+}
+
+void MmdPhysicsWorld::BodyState::Resize(size_t bodyCount)
+{
+	// 4 剛体ずつ読み書きするので、端数の分も動かない剛体として確保しておく
+	const size_t count = (bodyCount + 3) & ~static_cast<size_t>(3);
+	const XMFLOAT3 zero{ 0.0f, 0.0f, 0.0f };
+	const XMFLOAT4 identity{ 0.0f, 0.0f, 0.0f, 1.0f };
+
+	position.Resize(count, zero);
+	rotation.Resize(count, identity);
+	prevPosition.Resize(count, zero);
+	prevRotation.Resize(count, identity);
+	linearVelocity.Resize(count, zero);
+	angularVelocity.Resize(count, zero);
+	invInertia.Resize(count, zero);
+	invMass.resize(count, 0.0f);
+	linearDampingScale.resize(count, 1.0f);
+	angularDampingScale.resize(count, 1.0f);
+	simulate.resize(count, 0u);
+}
+
+void MmdPhysicsWorld::BodyState::Clear()
+{
+	*this = BodyState{};
+}
+
+void MmdPhysicsWorld::BodyState::SetPose(size_t i, const XMFLOAT3& p, const XMFLOAT4& q)
+{
+	position.Set(i, p);
+	rotation.Set(i, q);
+	prevPosition.Set(i, p);
+	prevRotation.Set(i, q);
+}
+
+void MmdPhysicsWorld::BuildJointColors()
+{
+	// 貪欲法で色を塗る: ジョイントを順に見て、両端の動的剛体がまだ使っていない最小の色にする。
+	// ボーン追従剛体は書き換えないので、同じ色で共有してよい
+	const size_t bodyCount = m_bodies.size();
+	std::vector<std::vector<uint32_t>> bodyColors(bodyCount);
+	std::vector<uint32_t> jointColor(m_joints.size(), 0);
+	uint32_t colorCount = 0;
+
+	auto uses = [&](uint32_t body, uint32_t color) {
+		const auto& colors = bodyColors[body];
+		return std::find(colors.begin(), colors.end(), color) != colors.end();
+	};
+
+	for (size_t j = 0; j < m_joints.size(); ++j)
+	{
+		if (m_jointIsland[j] < 0) continue;    // 両端ともボーン追従剛体なら何もしない
+
+		const uint32_t a = static_cast<uint32_t>(m_joints[j].bodyA);
+		const uint32_t b = static_cast<uint32_t>(m_joints[j].bodyB);
+		const bool dynamicA = (m_state.invMass[a] > 0.0f);
+		const bool dynamicB = (m_state.invMass[b] > 0.0f);
+
+		uint32_t color = 0;
+		while ((dynamicA && uses(a, color)) || (dynamicB && uses(b, color))) ++color;
+
+		if (dynamicA) bodyColors[a].push_back(color);
+		if (dynamicB) bodyColors[b].push_back(color);
+		jointColor[j] = color;
+		colorCount = std::max(colorCount, color + 1);
+	}
+
+	// 色ごとに連続するよう SoA へ詰める (色の中は元のジョイント順)
+	m_jointSlots.Clear();
+	m_jointColorOffsets.assign(colorCount + 1, 0);
+	for (size_t j = 0; j < m_joints.size(); ++j)
+	{
+		if (m_jointIsland[j] >= 0) ++m_jointColorOffsets[jointColor[j] + 1];
+	}
+	for (uint32_t c = 0; c < colorCount; ++c)
+	{
+		m_jointColorOffsets[c + 1] += m_jointColorOffsets[c];
+	}
+	for (uint32_t c = 0; c < colorCount; ++c)
+	{
+		for (size_t j = 0; j < m_joints.size(); ++j)
+		{
+			if (m_jointIsland[j] >= 0 && jointColor[j] == c) m_jointSlots.Push(m_joints[j], m_jointIsland[j]);
+		}
+	}
+
+	m_colorOrder.resize(colorCount);
+	std::iota(m_colorOrder.begin(), m_colorOrder.end(), 0u);
+	m_colorShuffle.seed(std::random_device{}());
+}
+
 void MmdPhysicsWorld::BuildWriteBackOrder(const PmxModel& model)
 {
 	const auto& rbDefs = model.RigidBodies();
@@ -969,8 +1349,7 @@ void MmdPhysicsWorld::BuildWriteBackOrder(const PmxModel& model)
 		if (def.operation == PmxModel::RigidBody::OperationType::Static) continue;
 		if (def.boneIndex < 0 || def.boneIndex >= static_cast<int>(bonesDef.size())) continue;
 
-		const Body& b = m_bodies[i];
-		if (b.invMass <= 0.0f) continue;
+		if (m_state.invMass[i] <= 0.0f) continue;
 
 		if (bonesDef[static_cast<size_t>(def.boneIndex)].IsAfterPhysics())
 		{
@@ -993,8 +1372,7 @@ void MmdPhysicsWorld::BuildWriteBackOrder(const PmxModel& model)
 		const int boneIndex = def.boneIndex;
 		if (boneIndex < 0 || boneIndex >= static_cast<int>(bonesDef.size())) continue;
 
-		const Body& b = m_bodies[i];
-		if (b.invMass <= 0.0f) continue;
+		if (m_state.invMass[i] <= 0.0f) continue;
 
 		if (m_settings.requireAfterPhysicsFlag && !m_writebackFallbackNoAfterPhysics)
 		{
@@ -1229,6 +1607,145 @@ bool MmdPhysicsWorld::IsJointConnected(uint32_t a, uint32_t b) const
 	return std::binary_search(adj.begin(), adj.end(), b);
 }
 
+void MmdPhysicsWorld::BuildCollisionFilters()
+{
+	// グループ番号の基準とマスクの意味は読み込み時に決まるので、
+	// 剛体ごとに「自分のビット」と「当たる相手のビット」に直しておく
+	m_collisionFilters.resize(m_bodies.size());
+	for (size_t i = 0; i < m_bodies.size(); ++i)
+	{
+		const Body& b = m_bodies[i];
+		CollisionFilter& f = m_collisionFilters[i];
+		const int group = m_groupIndexIsOneBased ? (b.group - 1) : b.group;
+		f.collideAll = (group < 0 || group >= 16);
+		f.groupBit = f.collideAll ? 0 : static_cast<uint16_t>(1u << group);
+		f.collidesWith = m_groupMaskIsCollisionMask ? b.groupMask : static_cast<uint16_t>(~b.groupMask);
+	}
+}
+
+bool MmdPhysicsWorld::ShouldCollide(uint32_t a, uint32_t b) const
+{
+	if (!m_settings.respectCollisionGroups) return true;
+	const CollisionFilter& fa = m_collisionFilters[a];
+	const CollisionFilter& fb = m_collisionFilters[b];
+	if (fa.collideAll || fb.collideAll) return true;
+	return ((fa.collidesWith & fb.groupBit) != 0) && ((fb.collidesWith & fa.groupBit) != 0);
+}
+
+namespace
+{
+	inline uint32_t HashBodyPair(uint32_t a, uint32_t b)
+	{
+		return (a * 0x9E3779B1u) ^ (b * 0x85EBCA77u);
+	}
+}
+
+uint32_t MmdPhysicsWorld::FindPair(uint32_t a, uint32_t b, uint32_t hint)
+{
+	// 軸の並びが変わらなければ、組は前のサブステップと同じ順に現れる。
+	// 予想が外れたときだけ表を引く (表はそのサブステップで最初に外れたときに作る)
+	if (hint < m_pairs.size() && m_pairs[hint].a == a && m_pairs[hint].b == b) return hint;
+	if (m_pairs.empty()) return UINT32_MAX;
+	if (!m_pairTableValid) RebuildPairTable();
+
+	const uint32_t mask = static_cast<uint32_t>(m_pairTable.size() - 1);
+	for (uint32_t slot = HashBodyPair(a, b) & mask;; slot = (slot + 1) & mask)
+	{
+		const uint32_t index = m_pairTable[slot];
+		if (index == UINT32_MAX) return UINT32_MAX;
+		const ContactPair& pair = m_pairs[index];
+		if (pair.a == a && pair.b == b) return index;
+	}
+}
+
+void MmdPhysicsWorld::RebuildPairTable()
+{
+	// 埋まり具合を半分以下に保つ
+	size_t tableSize = 64;
+	while (tableSize < m_pairs.size() * 2) tableSize *= 2;
+	m_pairTable.assign(tableSize, UINT32_MAX);
+
+	const uint32_t mask = static_cast<uint32_t>(tableSize - 1);
+	for (size_t i = 0; i < m_pairs.size(); ++i)
+	{
+		uint32_t slot = HashBodyPair(m_pairs[i].a, m_pairs[i].b) & mask;
+		while (m_pairTable[slot] != UINT32_MAX) slot = (slot + 1) & mask;
+		m_pairTable[slot] = static_cast<uint32_t>(i);
+	}
+	m_pairTableValid = true;
+}
+
+void MmdPhysicsWorld::SelectSweepAxis()
+{
+	// 髪やスカートは縦に並ぶので、X 軸だけで掃くと区間がほとんど重なってしまう。
+	// 剛体の中心がいちばん散らばっている軸で掃く。軸を替えると並べ直しになるので、
+	// 今の軸より十分に広い軸があるときだけ替え、判定もときどきにとどめる
+	constexpr uint32_t kCheckInterval = 64;
+	constexpr float kSwitchRatio = 1.5f;
+
+	if (m_sapAxisCheckCountdown > 0 && m_axisListInitialized)
+	{
+		--m_sapAxisCheckCountdown;
+		return;
+	}
+	m_sapAxisCheckCountdown = kCheckInterval;
+
+	const size_t count = m_bodies.size();
+	if (count < 2) return;
+
+	double sum[3]{};
+	double sumSq[3]{};
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float c[3] = { m_state.position.x[i], m_state.position.y[i], m_state.position.z[i] };
+		for (int k = 0; k < 3; ++k)
+		{
+			sum[k] += c[k];
+			sumSq[k] += static_cast<double>(c[k]) * c[k];
+		}
+	}
+
+	double variance[3];
+	int best = 0;
+	for (int k = 0; k < 3; ++k)
+	{
+		const double mean = sum[k] / static_cast<double>(count);
+		variance[k] = sumSq[k] / static_cast<double>(count) - mean * mean;
+		if (variance[k] > variance[best]) best = k;
+	}
+
+	if (best != m_sapAxis && variance[best] > variance[m_sapAxis] * kSwitchRatio * kSwitchRatio)
+	{
+		m_sapAxis = best;
+		m_axisListInitialized = false;
+	}
+}
+
+void MmdPhysicsWorld::WarmStartContacts(float warmStart)
+{
+	// 直前のサブステップで当たっていた組を、そのとき押し戻した量の warmStart 倍だけ先に離しておく。
+	// 形状キャッシュを作る前に動かすので、narrow phase は離したあとの位置から残りの食い込みを解く
+	using namespace DirectX;
+	for (const ContactPair& pair : m_pairs)
+	{
+		if (!pair.touching || pair.filtered || pair.lambda <= 0.0f) continue;
+
+		const float wA = IsBodySleeping(pair.a) ? 0.0f : m_state.invMass[pair.a];
+		const float wB = IsBodySleeping(pair.b) ? 0.0f : m_state.invMass[pair.b];
+		if (wA <= 0.0f && wB <= 0.0f) continue;
+
+		const XMVECTOR dp = XMVectorScale(XMLoadFloat3(&pair.normal), pair.lambda * warmStart);
+		if (wA > 0.0f)
+		{
+			m_state.position.Store(pair.a, XMVectorSubtract(m_state.position.Load(pair.a), XMVectorScale(dp, wA)));
+		}
+		if (wB > 0.0f)
+		{
+			m_state.position.Store(pair.b, XMVectorAdd(m_state.position.Load(pair.b), XMVectorScale(dp, wB)));
+		}
+	}
+}
+
 void MmdPhysicsWorld::Step(double dtSeconds, const PmxModel& model, BoneSolver& bones)
 {
 	if (!m_isBuilt || m_builtRevision != model.Revision())
@@ -1241,56 +1758,123 @@ void MmdPhysicsWorld::Step(double dtSeconds, const PmxModel& model, BoneSolver&
 	const double maxAcc = m_settings.fixedTimeStep * static_cast<double>(m_settings.maxCatchUpSteps);
 	if (m_accumulator > maxAcc) m_accumulator = maxAcc;
 
+	TickStageTimer stepTimer(m_profile, TickStage::PhysicsSubSteps);
+
 	int stepCount = 0;
 	while (m_accumulator >= m_settings.fixedTimeStep && stepCount < m_settings.maxCatchUpSteps)
 	{
 		PrecomputeKinematicTargets(model, bones);
+		SimulateFixedStep(model);
 
-		if (ShouldSkipPhysicsTick())
-		{
-			m_accumulator -= m_settings.fixedTimeStep;
-			++stepCount;
-			continue;
-		}
+		m_accumulator -= m_settings.fixedTimeStep;
+		++stepCount;
+	}
+	stepTimer.Stop();
 
-		const int subSteps = std::max(1, m_settings.maxSubSteps);
-		const float subStepDt = m_settings.fixedTimeStep / static_cast<float>(subSteps);
+	TickStageTimer writeBackTimer(m_profile, TickStage::PhysicsWriteBack);
+	CopyBodyTransforms(m_writeBackPositions, m_writeBackRotations);
+	WriteBackBones(model, bones, m_writeBackPositions, m_writeBackRotations);
+}
 
-		for (int sub = 0; sub < subSteps; ++sub)
-		{
-			BeginSubStep();
+void MmdPhysicsWorld::StepFixed(const PmxModel& model, std::span<const XMFLOAT4X4> boneGlobals)
+{
+	if (m_bodies.empty()) return;
+
+	TickStageTimer stepTimer(m_profile, TickStage::PhysicsSubSteps);
+	PrecomputeKinematicTargets(boneGlobals);
+	SimulateFixedStep(model);
+}
+
+void MmdPhysicsWorld::SimulateFixedStep(const PmxModel& model)
+{
+	// どの島も起きておらず、ボーン追従剛体も動いていなければ何もしない
+	if (UpdateIslandSleep()) return;
+
+	const int subSteps = std::max(1, m_settings.maxSubSteps);
+	const float subStepDt = m_settings.fixedTimeStep / static_cast<float>(subSteps);
+	UpdateDampingScales(subStepDt);
+
+	if (m_profile) m_profile->physicsSubSteps += static_cast<std::uint32_t>(subSteps);
 
-			float t = static_cast<float>(sub + 1) / static_cast<float>(subSteps);
-			InterpolateKinematicBodies(t);
+	for (int sub = 0; sub < subSteps; ++sub)
+	{
+		// 前のサブステップの接触で起こされた島は、ここから回す
+		ApplyPendingWakes();
+		if (m_profile) m_profile->physicsBodySubSteps += m_awakeDynamicBodies;
+
+		BeginSubStep();
+
+		float t = static_cast<float>(sub + 1) / static_cast<float>(subSteps);
+		InterpolateKinematicBodies(t);
+
+		Integrate(subStepDt, model);
 
-			Integrate(subStepDt, model);
 
+		for (int it = 0; it < m_settings.solverIterations; ++it)
+		{
+			SolveJoints(subStepDt);
+		}
+
+		if (m_settings.collisionIterations > 0)
+		{
+			// Body-body collisions: SAP broadphase once, then iterate m_settings.collisionIterations internally.
+			SolveBodyCollisions(subStepDt);
 
-			for (int it = 0; it < m_settings.solverIterations; ++it)
+			// Ground contacts: keep the same iteration count as before for stability.
+			for (int it = 0; it < m_settings.collisionIterations; ++it)
 			{
-				SolveJoints(subStepDt);
+				SolveGround(subStepDt, model);
 			}
+		}
 
-			if (m_settings.collisionIterations > 0)
-			{
-				// Body-body collisions: SAP broadphase once, then iterate m_settings.collisionIterations internally.
-				SolveBodyCollisions(subStepDt);
+		EndSubStep(subStepDt, model);
+	}
+}
 
-				// Ground contacts: keep the same iteration count as before for stability.
-				for (int it = 0; it < m_settings.collisionIterations; ++it)
-				{
-					SolveGround(subStepDt, model);
-				}
-			}
+std::vector<int> MmdPhysicsWorld::KinematicBones() const
+{
+	std::vector<int> result;
+	for (size_t i = 0; i < m_bodies.size(); ++i)
+	{
+		if (m_state.invMass[i] > 0.0f || m_bodies[i].boneIndex < 0) continue;
+		result.push_back(m_bodies[i].boneIndex);
+	}
+	std::sort(result.begin(), result.end());
+	result.erase(std::unique(result.begin(), result.end()), result.end());
+	return result;
+}
 
-			EndSubStep(subStepDt, model);
-		}
+void MmdPhysicsWorld::CopyBodyTransforms(std::vector<XMFLOAT3>& positions, std::vector<XMFLOAT4>& rotations) const
+{
+	const size_t count = m_bodies.size();
+	positions.resize(count);
+	rotations.resize(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		positions[i] = m_state.position.Get(i);
+		rotations[i] = m_state.rotation.Get(i);
+	}
+}
 
-		m_accumulator -= m_settings.fixedTimeStep;
-		++stepCount;
+void MmdPhysicsWorld::ApplyImpulseMorph(size_t rigidBodyIndex, const XMFLOAT3& velocity, const XMFLOAT3& torque, bool local)
+{
+	if (rigidBodyIndex >= m_bodies.size()) return;
+	const Body& b = m_bodies[rigidBodyIndex];
+	if (b.defIndex != static_cast<int>(rigidBodyIndex) || m_state.invMass[rigidBodyIndex] <= 0.0f) return;
+
+	XMVECTOR v = Load3(velocity);
+	XMVECTOR tq = Load3(torque);
+	if (local)
+	{
+		const XMVECTOR q = m_state.rotation.Load(rigidBodyIndex);
+		v = XMVector3Rotate(v, q);
+		tq = XMVector3Rotate(tq, q);
 	}
 
-	WriteBackBones(model, bones);
+	m_state.linearVelocity.Store(rigidBodyIndex, v);
+	m_state.angularVelocity.Store(rigidBodyIndex, XMVectorMultiply(m_state.invInertia.Load(rigidBodyIndex), tq));
+
+	WakeIsland(m_bodyIsland[rigidBodyIndex]);
 }
 
 void MmdPhysicsWorld::PrecomputeKinematicTargets(const PmxModel& model, const BoneSolver& bones)
@@ -1303,169 +1887,299 @@ void MmdPhysicsWorld::PrecomputeKinematicTargets(const PmxModel& model, const Bo
 	{
 		Body& b = m_bodies[i];
 
-		if (b.invMass > 0.0f) continue;
+		if (m_state.invMass[i] > 0.0f) continue;
 
+		m_kinematicMoved[i] = 0;
 		const int boneIndex = b.boneIndex;
 		if (boneIndex < 0 || boneIndex >= static_cast<int>(bonesDef.size())) continue;
 
-		b.kinematicStartPos = b.position;
-		b.kinematicStartRot = b.rotation;
-
-		const auto& boneGlobalF = bones.GetBoneGlobalMatrix(static_cast<size_t>(boneIndex));
-		DirectX::XMMATRIX boneG = DirectX::XMLoadFloat4x4(&boneGlobalF);
-		DirectX::XMMATRIX localFromBone = DirectX::XMLoadFloat4x4(&b.localFromBone);
-		DirectX::XMMATRIX rbG = boneG * localFromBone;
-
-		DirectX::XMFLOAT3 prevT = b.kinematicTargetPos;
-		DirectX::XMFLOAT4 prevR = b.kinematicTargetRot;
+		UpdateKinematicTarget(i, bones.GetBoneGlobalMatrix(static_cast<size_t>(boneIndex)));
+	}
+}
 
-		DecomposeTR(rbG, b.kinematicTargetPos, b.kinematicTargetRot);
+void MmdPhysicsWorld::PrecomputeKinematicTargets(std::span<const XMFLOAT4X4> boneGlobals)
+{
+	m_anyKinematicMovedThisTick = false;
 
-		const float dx = b.kinematicTargetPos.x - prevT.x;
-		const float dy = b.kinematicTargetPos.y - prevT.y;
-		const float dz = b.kinematicTargetPos.z - prevT.z;
-		const float dp2 = dx * dx + dy * dy + dz * dz;
+	for (size_t i = 0; i < m_bodies.size(); ++i)
+	{
+		if (m_state.invMass[i] > 0.0f) continue;
 
-		const float dot =
-			std::fabs(prevR.x * b.kinematicTargetRot.x +
-					  prevR.y * b.kinematicTargetRot.y +
-					  prevR.z * b.kinematicTargetRot.z +
-					  prevR.w * b.kinematicTargetRot.w);
+		m_kinematicMoved[i] = 0;
+		const int boneIndex = m_bodies[i].boneIndex;
+		if (boneIndex < 0 || static_cast<size_t>(boneIndex) >= boneGlobals.size()) continue;
 
-		if (dp2 > 1.0e-10f || (1.0f - dot) > 1.0e-6f)
-			m_anyKinematicMovedThisTick = true;
+		UpdateKinematicTarget(i, boneGlobals[static_cast<size_t>(boneIndex)]);
 	}
 }
 
-bool MmdPhysicsWorld::ShouldSkipPhysicsTick()
+void MmdPhysicsWorld::UpdateKinematicTarget(size_t bodyIndex, const XMFLOAT4X4& boneGlobal)
 {
-	const float vThr = m_settings.sleepLinearSpeed;
-	const float wThr = m_settings.sleepAngularSpeed;
+	Body& b = m_bodies[bodyIndex];
 
-	if (vThr <= 0.0f && wThr <= 0.0f)
-	{
-		m_sleepCounter = 0;
-		m_worldSleeping = false;
-		return false;
-	}
+	b.kinematicStartPos = m_state.position.Get(bodyIndex);
+	b.kinematicStartRot = m_state.rotation.Get(bodyIndex);
+
+	DirectX::XMMATRIX boneG = DirectX::XMLoadFloat4x4(&boneGlobal);
+	DirectX::XMMATRIX localFromBone = DirectX::XMLoadFloat4x4(&b.localFromBone);
+	DirectX::XMMATRIX rbG = boneG * localFromBone;
+
+	DirectX::XMFLOAT3 prevT = b.kinematicTargetPos;
+	DirectX::XMFLOAT4 prevR = b.kinematicTargetRot;
+
+	DecomposeTR(rbG, b.kinematicTargetPos, b.kinematicTargetRot);
 
-	// 骨が動いたら即起床
-	if (m_anyKinematicMovedThisTick)
+	const float dx = b.kinematicTargetPos.x - prevT.x;
+	const float dy = b.kinematicTargetPos.y - prevT.y;
+	const float dz = b.kinematicTargetPos.z - prevT.z;
+	const float dp2 = dx * dx + dy * dy + dz * dz;
+
+	const float dot =
+		std::fabs(prevR.x * b.kinematicTargetRot.x +
+				  prevR.y * b.kinematicTargetRot.y +
+				  prevR.z * b.kinematicTargetRot.z +
+				  prevR.w * b.kinematicTargetRot.w);
+
+	if (dp2 > 1.0e-10f || (1.0f - dot) > 1.0e-6f)
 	{
-		m_sleepCounter = 0;
-		m_worldSleeping = false;
-		return false;
+		m_kinematicMoved[bodyIndex] = 1;
+		m_anyKinematicMovedThisTick = true;
 	}
+}
+
+bool MmdPhysicsWorld::UpdateIslandSleep()
+{
+	const float vThr = m_settings.sleepLinearSpeed;
+	const float wThr = m_settings.sleepAngularSpeed;
+	const bool sleepEnabled = (vThr > 0.0f || wThr > 0.0f);
 
 	const float v2Thr = (vThr > 0.0f) ? (vThr * vThr) : 0.0f;
 	const float w2Thr = (wThr > 0.0f) ? (wThr * wThr) : 0.0f;
 
-	bool anyMoving = false;
-	for (const Body& b : m_bodies)
+	for (Island& island : m_islands)
 	{
-		if (b.invMass <= 0.0f) continue; // dynamicのみ
+		bool awake = !sleepEnabled || island.wakeRequested;
+		island.wakeRequested = false;
 
-		const float vx = b.linearVelocity.x, vy = b.linearVelocity.y, vz = b.linearVelocity.z;
-		const float wx = b.angularVelocity.x, wy = b.angularVelocity.y, wz = b.angularVelocity.z;
+		// アンカーの骨が動いたら即起床
+		for (size_t k = 0; k < island.anchors.size() && !awake; ++k)
+		{
+			awake = (m_kinematicMoved[island.anchors[k]] != 0);
+		}
+
+		// 眠っている島は積分しないので速度も変わらない
+		if (!awake && !island.sleeping)
+		{
+			const BodyState& S = m_state;
+			for (uint32_t i : island.bodies)
+			{
+				const float vx = S.linearVelocity.x[i], vy = S.linearVelocity.y[i], vz = S.linearVelocity.z[i];
+				const float wx = S.angularVelocity.x[i], wy = S.angularVelocity.y[i], wz = S.angularVelocity.z[i];
 
-		const float v2 = vx * vx + vy * vy + vz * vz;
-		const float w2 = wx * wx + wy * wy + wz * wz;
+				const float v2 = vx * vx + vy * vy + vz * vz;
+				const float w2 = wx * wx + wy * wy + wz * wz;
 
-		if ((v2Thr > 0.0f && v2 > v2Thr) || (w2Thr > 0.0f && w2 > w2Thr))
+				if ((v2Thr > 0.0f && v2 > v2Thr) || (w2Thr > 0.0f && w2 > w2Thr))
+				{
+					awake = true;
+					break;
+				}
+			}
+		}
+
+		if (awake)
 		{
-			anyMoving = true;
-			break;
+			island.sleepCounter = 0;
+			island.sleeping = false;
+			continue;
 		}
-	}
+		if (island.sleeping) continue;
 
-	if (anyMoving)
-	{
-		m_sleepCounter = 0;
-		m_worldSleeping = false;
-		return false;
+		// しばらく静止したら sleep。接触の判定で位置差から速度が出ないよう、前回位置を今の位置に揃えておく
+		if (++island.sleepCounter >= 10)
+		{
+			island.sleeping = true;
+			for (uint32_t i : island.bodies)
+			{
+				m_state.prevPosition.Set(i, m_state.position.Get(i));
+				m_state.prevRotation.Set(i, m_state.rotation.Get(i));
+			}
+		}
 	}
+	m_wakePending = false;
 
-	// しばらく静止したらsleep
-	if (++m_sleepCounter >= 10)
-		m_worldSleeping = true;
+	RebuildActiveLists();
 
-	return m_worldSleeping;
+	// ボーン追従剛体が動いていれば、眠っている島に当たるかもしれないので接触だけは見る
+	return sleepEnabled && m_awakeDynamicBodies == 0 && !m_anyKinematicMovedThisTick;
 }
 
-void MmdPhysicsWorld::InterpolateKinematicBodies(float t)
+void MmdPhysicsWorld::WakeIsland(int island)
 {
-	const int n = static_cast<int>(m_bodies.size());
-#ifdef _OPENMP
-#pragma omp parallel for schedule(static) if(n >= 512)
-#endif
-	for (int i = 0; i < n; ++i)
-	{
-		Body& b = m_bodies[static_cast<size_t>(i)];
-		// Only strictly interpolate Kinematic bodies (Static/Kinematic type)
-		if (b.invMass > 0.0f) continue;
-
-		XMVECTOR p0 = Load3(b.kinematicStartPos);
-		XMVECTOR p1 = Load3(b.kinematicTargetPos);
-		XMVECTOR q0 = Load4(b.kinematicStartRot);
-		XMVECTOR q1 = Load4(b.kinematicTargetRot);
+	if (island < 0) return;
+	m_islands[static_cast<size_t>(island)].wakeRequested = true;
+	m_wakePending = true;
+}
 
-		XMVECTOR p = XMVectorLerp(p0, p1, t);
-		XMVECTOR q = XMQuaternionSlerp(q0, q1, t);
+void MmdPhysicsWorld::ApplyPendingWakes()
+{
+	if (!m_wakePending) return;
+	m_wakePending = false;
 
-		Store3(b.position, p);
-		Store4(b.rotation, q);
+	for (Island& island : m_islands)
+	{
+		if (!island.wakeRequested) continue;
+		island.wakeRequested = false;
+		island.sleepCounter = 0;
+		island.sleeping = false;
 	}
+	RebuildActiveLists();
 }
 
-void MmdPhysicsWorld::BeginSubStep()
+void MmdPhysicsWorld::RebuildActiveLists()
 {
-	float ws = std::clamp(m_settings.jointWarmStart, 0.0f, 1.0f);
-	for (auto& c : m_joints)
+	m_simBodies.clear();
+	m_simBlocks.clear();
+	m_awakeDynamicBodies = 0;
+	std::fill(m_state.simulate.begin(), m_state.simulate.end(), 0u);
+	for (uint32_t i = 0; i < static_cast<uint32_t>(m_bodies.size()); ++i)
 	{
-		c.lambdaPos *= ws;
+		const bool dynamic = (m_state.invMass[i] > 0.0f);
+		const bool awake = dynamic && !IsBodySleeping(i);
+		m_bodyActive[i] = dynamic ? static_cast<uint8_t>(awake) : m_kinematicMoved[i];
+
+		if (dynamic && !awake) continue;
+		m_simBodies.push_back(i);
+		if (!awake) continue;
+
+		++m_awakeDynamicBodies;
+		m_state.simulate[i] = 0xFFFFFFFFu;
+		const uint32_t block = i & ~3u;
+		if (m_simBlocks.empty() || m_simBlocks.back() != block) m_simBlocks.push_back(block);
 	}
 
-	const int nb = static_cast<int>(m_bodies.size());
-#ifdef _OPENMP
-#pragma omp parallel for schedule(static) if(nb >= 256)
-#endif
-	for (int i = 0; i < nb; ++i)
+	m_activeJointSlots.clear();
+	m_activeColorOffsets.assign(m_colorOrder.size() + 1, 0);
+	for (size_t c = 0; c < m_colorOrder.size(); ++c)
 	{
-		Body& b = m_bodies[static_cast<size_t>(i)];
-		b.prevPosition = b.position;
-		b.prevRotation = b.rotation;
+		for (uint32_t slot = m_jointColorOffsets[c]; slot < m_jointColorOffsets[c + 1]; ++slot)
+		{
+			if (!m_islands[static_cast<size_t>(m_jointSlots.island[slot])].sleeping) m_activeJointSlots.push_back(slot);
+		}
+		m_activeColorOffsets[c + 1] = static_cast<uint32_t>(m_activeJointSlots.size());
 	}
 }
 
-void MmdPhysicsWorld::Integrate(float dt, const PmxModel& model)
+void MmdPhysicsWorld::InterpolateKinematicBodies(float t)
 {
-	XMVECTOR g = XMVectorSet(m_settings.gravity.x, m_settings.gravity.y, m_settings.gravity.z, 0.0f);
+	JobSystem::Shared().ParallelFor(g_kinematicSite, m_simBodies.size(), [&](size_t begin, size_t end) {
+		for (size_t k = begin; k < end; ++k)
+		{
+			const uint32_t i = m_simBodies[k];
+			const Body& b = m_bodies[i];
+			// Only strictly interpolate Kinematic bodies (Static/Kinematic type)
+			if (m_state.invMass[i] > 0.0f) continue;
 
-	const int n = static_cast<int>(m_bodies.size());
-#ifdef _OPENMP
-#pragma omp parallel for schedule(static) if(n >= 512)
-#endif
-	for (int i = 0; i < n; ++i)
-	{
-		Body& b = m_bodies[static_cast<size_t>(i)];
-		if (b.invMass <= 0.0f) continue;
+			XMVECTOR p0 = Load3(b.kinematicStartPos);
+			XMVECTOR p1 = Load3(b.kinematicTargetPos);
+			XMVECTOR q0 = Load4(b.kinematicStartRot);
+			XMVECTOR q1 = Load4(b.kinematicTargetRot);
 
-		if (!IsVectorFinite3(Load3(b.position))) continue;
+			XMVECTOR p = XMVectorLerp(p0, p1, t);
+			XMVECTOR q = XMQuaternionSlerp(q0, q1, t);
 
-		XMVECTOR v = Load3(b.linearVelocity);
-		v = XMVectorAdd(v, XMVectorScale(g, dt));
+			m_state.position.Store(i, p);
+			m_state.rotation.Store(i, q);
+		}
+	});
+}
 
-		XMVECTOR p = Load3(b.position);
-		p = XMVectorAdd(p, XMVectorScale(v, dt));
-		Store3(b.position, p);
-		Store3(b.linearVelocity, v);
+void MmdPhysicsWorld::BeginSubStep()
+{
+	float ws = std::clamp(m_settings.jointWarmStart, 0.0f, 1.0f);
+	for (uint32_t slot : m_activeJointSlots)
+	{
+		m_jointSlots.lambdaPos[slot] *= ws;
+	}
+
+	// 眠っている剛体と止まっているボーン追従剛体は位置と前回位置が同じなので、配列ごと写してよい
+	m_state.prevPosition = m_state.position;
+	m_state.prevRotation = m_state.rotation;
+}
 
-		XMVECTOR q = Load4(b.rotation);
-		XMVECTOR w = Load3(b.angularVelocity);
-		XMVECTOR dq = QuaternionFromAngularVelocity(w, dt);
-		q = XMQuaternionNormalize(XMQuaternionMultiply(dq, q));
-		Store4(b.rotation, q);
+void MmdPhysicsWorld::UpdateDampingScales(float dt)
+{
+	if (dt == m_dampingDt &&
+		m_settings.minLinearDamping == m_dampingMinLinear &&
+		m_settings.minAngularDamping == m_dampingMinAngular)
+	{
+		return;
 	}
+	m_dampingDt = dt;
+	m_dampingMinLinear = m_settings.minLinearDamping;
+	m_dampingMinAngular = m_settings.minAngularDamping;
+
+	// PMX の減衰は 1 秒あたりに失う割合として扱い、サブステップ 1 回分の倍率にしておく
+	auto scaleFor = [dt](float damping, float minDamping) {
+		float d = std::clamp(damping, 0.0f, 1.0f);
+		d = std::max(d, minDamping);
+		if (d >= 1.0f) return 0.0f;
+		const float oneMinus = std::max(1.0e-6f, 1.0f - d);
+		return std::exp(std::log(oneMinus) * dt);
+	};
+
+	for (size_t i = 0; i < m_bodies.size(); ++i)
+	{
+		m_state.linearDampingScale[i] = scaleFor(m_bodies[i].linearDamping, m_dampingMinLinear);
+		m_state.angularDampingScale[i] = scaleFor(m_bodies[i].angularDamping, m_dampingMinAngular);
+	}
+}
+
+void MmdPhysicsWorld::Integrate(float dt, const PmxModel& model)
+{
+	const XMVECTOR dtV = XMVectorReplicate(dt);
+	const Vec3Lanes gravityDt{
+		XMVectorReplicate(m_settings.gravity.x * dt),
+		XMVectorReplicate(m_settings.gravity.y * dt),
+		XMVectorReplicate(m_settings.gravity.z * dt) };
+
+	// 4 剛体ずつ: 重力で速度を更新して位置を進め、角速度の分だけ回す。
+	// 起きている動的剛体でないレーンと、位置が壊れているレーンは書き戻さない
+	BodyState& S = m_state;
+	JobSystem::Shared().ParallelFor(g_integrateSite, m_simBlocks.size(), [&](size_t begin, size_t end) {
+		for (size_t k = begin; k < end; ++k)
+		{
+			const size_t i = m_simBlocks[k];
+
+			const Vec3Lanes p{ LoadLanes(S.position.x, i), LoadLanes(S.position.y, i), LoadLanes(S.position.z, i) };
+			const XMVECTOR active = XMVectorAndInt(
+				XMLoadInt4(S.simulate.data() + i),
+				XMVectorAndInt(XMVectorAndInt(FiniteLanes(p.x), FiniteLanes(p.y)), FiniteLanes(p.z)));
+
+			const Vec3Lanes v0{ LoadLanes(S.linearVelocity.x, i), LoadLanes(S.linearVelocity.y, i), LoadLanes(S.linearVelocity.z, i) };
+			const Vec3Lanes v{ XMVectorAdd(v0.x, gravityDt.x), XMVectorAdd(v0.y, gravityDt.y), XMVectorAdd(v0.z, gravityDt.z) };
+
+			StoreLanes(S.linearVelocity.x, i, XMVectorSelect(v0.x, v.x, active));
+			StoreLanes(S.linearVelocity.y, i, XMVectorSelect(v0.y, v.y, active));
+			StoreLanes(S.linearVelocity.z, i, XMVectorSelect(v0.z, v.z, active));
+			StoreLanes(S.position.x, i, XMVectorSelect(p.x, XMVectorAdd(p.x, XMVectorMultiply(v.x, dtV)), active));
+			StoreLanes(S.position.y, i, XMVectorSelect(p.y, XMVectorAdd(p.y, XMVectorMultiply(v.y, dtV)), active));
+			StoreLanes(S.position.z, i, XMVectorSelect(p.z, XMVectorAdd(p.z, XMVectorMultiply(v.z, dtV)), active));
+
+			// 4 剛体とも回っていなければ回転はそのまま (休止速度以下の角速度は EndSubStep で 0 になる)
+			const Vec3Lanes w{ LoadLanes(S.angularVelocity.x, i), LoadLanes(S.angularVelocity.y, i), LoadLanes(S.angularVelocity.z, i) };
+			if (XMVector4Less(XMVectorScale(LengthLanes(w), dt), XMVectorReplicate(kEps))) continue;
+
+			const QuatLanes q0{ LoadLanes(S.rotation.x, i), LoadLanes(S.rotation.y, i), LoadLanes(S.rotation.z, i), LoadLanes(S.rotation.w, i) };
+			const QuatLanes dq = QuaternionFromAngularVelocityLanes(w, dt);
+			const QuatLanes q = QuaternionNormalizeLanes(QuaternionMultiplyLanes(dq, q0));
+
+			StoreLanes(S.rotation.x, i, XMVectorSelect(q0.x, q.x, active));
+			StoreLanes(S.rotation.y, i, XMVectorSelect(q0.y, q.y, active));
+			StoreLanes(S.rotation.z, i, XMVectorSelect(q0.z, q.z, active));
+			StoreLanes(S.rotation.w, i, XMVectorSelect(q0.w, q.w, active));
+		}
+	});
 }
 
 void MmdPhysicsWorld::SolveXPBD(float dt, const PmxModel& model)
@@ -1477,11 +2191,29 @@ void MmdPhysicsWorld::SolveXPBD(float dt, const PmxModel& model)
 
 void MmdPhysicsWorld::SolveBodyCollisions(float dt)
 {
-	if (!m_settings.enableRigidBodyCollisions) return;
 	const size_t bodyCount = m_bodies.size();
-	if (bodyCount < 2) return;
+	if (!m_settings.enableRigidBodyCollisions || bodyCount < 2)
+	{
+		m_pairs.clear();
+		m_pairTableValid = false;
+		return;
+	}
 	const int bodyCountInt = static_cast<int>(bodyCount);
 
+	// 関節による除外は組ができたときにしか判定しないので、設定が変わったら組を作り直す
+	if (m_pairsCollideJointConnected != m_settings.collideJointConnectedBodies)
+	{
+		m_pairs.clear();
+		m_pairTableValid = false;
+		m_pairsCollideJointConnected = m_settings.collideJointConnectedBodies;
+	}
+
+	const float warmStart = std::clamp(m_settings.contactWarmStart, 0.0f, 1.0f);
+	if (warmStart > 0.0f) WarmStartContacts(warmStart);
+
+	SelectSweepAxis();
+	const int sweepAxis = m_sapAxis;
+
 	// --- 1. 形状キャッシュの更新 (並列化) ---
 	// ワールド座標系の形状データを一括計算し、後の判定ループでの計算コストを削減
 
@@ -1505,138 +2237,109 @@ void MmdPhysicsWorld::SolveBodyCollisions(float dt)
 	{
 		m_radii.resize(m_bodies.size());
 	}
-	if (m_maxXs.size() != m_bodies.size())
+	if (m_axisMax.size() != m_bodies.size())
 	{
-		m_maxXs.resize(m_bodies.size());
+		m_axisMax.resize(m_bodies.size());
 	}
 
 	std::span<CollisionShapeCache> shapeCache{ m_shapeCache.data(), bodyCount };
 	std::span<SapNode> axisList{ m_axisList.data(), bodyCount };
 	std::span<float> radii{ m_radii.data(), bodyCount };
-	std::span<float> maxXs{ m_maxXs.data(), bodyCount };
+	std::span<float> axisMax{ m_axisMax.data(), bodyCount };
 
 	const float radiusScale = m_settings.collisionRadiusScale;
 	const float collisionMargin = m_settings.collisionMargin;
 	const float kPhantomMargin = std::max(0.0f, m_settings.phantomMargin);
 
-#ifdef _OPENMP
-#pragma omp parallel for schedule(static) if(bodyCount >= 512)
-#endif
-	for (int i = 0; i < bodyCountInt; ++i)
-	{
-		const Body& b = m_bodies[i];
-		CollisionShapeCache& cache = shapeCache[static_cast<size_t>(i)];
-
-		using namespace DirectX;
-		XMVECTOR c = XMLoadFloat3(&b.position);
-		XMVECTOR q = XMLoadFloat4(&b.rotation);
-
-		const float extra = (b.invMass <= 0.0f) ? kPhantomMargin : 0.0f;
-
-		cache.isBox = (b.shapeType == PmxModel::RigidBody::ShapeType::Box);
+	// 眠っている剛体の形状は前回のものがそのまま使える (SAP を作り直すときだけ全部求める)
+	const bool updateAllShapes = !m_axisListInitialized;
+	const size_t shapeCount = updateAllShapes ? bodyCount : m_simBodies.size();
 
-		float minX, maxX;
-
-		if (cache.isBox)
+	JobSystem::Shared().ParallelFor(g_shapesSite, shapeCount, [&](size_t begin, size_t end) {
+		for (size_t k = begin; k < end; ++k)
 		{
-			cache.p0 = c; // Box Center
-			cache.rotation = q;
-			cache.ex = std::max(kEps, b.shapeSize.x * radiusScale * 0.5f);
-			cache.ey = std::max(kEps, b.shapeSize.y * radiusScale * 0.5f);
-			cache.ez = std::max(kEps, b.shapeSize.z * radiusScale * 0.5f);
-			cache.radius = 0.0f; // Box自体には使わない
+			const int i = static_cast<int>(updateAllShapes ? k : m_simBodies[k]);
+			const Body& b = m_bodies[i];
+			CollisionShapeCache& cache = shapeCache[static_cast<size_t>(i)];
 
-			// AABB (X軸) の計算 for SAP
-			const XMVECTOR ux = XMVector3Rotate(XMVectorSet(1, 0, 0, 0), q);
-			const XMVECTOR uy = XMVector3Rotate(XMVectorSet(0, 1, 0, 0), q);
-			const XMVECTOR uz = XMVector3Rotate(XMVectorSet(0, 0, 1, 0), q);
+			using namespace DirectX;
+			XMVECTOR c = m_state.position.Load(static_cast<size_t>(i));
+			XMVECTOR q = m_state.rotation.Load(static_cast<size_t>(i));
 
-			const float ax = std::abs(XMVectorGetX(ux));
-			const float ay = std::abs(XMVectorGetX(uy));
-			const float az = std::abs(XMVectorGetX(uz));
+			const float extra = (m_state.invMass[i] <= 0.0f) ? kPhantomMargin : 0.0f;
 
-			float extX = ax * cache.ex + ay * cache.ey + az * cache.ez;
-			extX += (collisionMargin + extra);
+			cache.isBox = (b.shapeType == PmxModel::RigidBody::ShapeType::Box);
 
-			const float cx = XMVectorGetX(c);
-			minX = cx - extX;
-			maxX = cx + extX;
+			float minA, maxA;
 
-			// バウンディング球半径 (保守的)
-			radii[static_cast<size_t>(i)] = std::sqrt(cache.ex * cache.ex + cache.ey * cache.ey + cache.ez * cache.ez)
-				+ collisionMargin + extra;
-		}
-		else
-		{
-			// Capsule / Sphere
-			cache.radius = b.capsuleRadius * radiusScale;
-			float hh = b.capsuleHalfHeight;
-			if (hh > kEps)
+			if (cache.isBox)
 			{
-				XMVECTOR axisL = XMLoadFloat3(&b.capsuleLocalAxis);
-				XMVECTOR axisW = XMVector3Rotate(axisL, q);
-				XMVECTOR o = XMVectorScale(axisW, hh);
-				cache.p0 = XMVectorSubtract(c, o);
-				cache.p1 = XMVectorAdd(c, o);
+				cache.p0 = c; // Box Center
+				cache.rotation = q;
+				cache.ex = std::max(kEps, b.shapeSize.x * radiusScale * 0.5f);
+				cache.ey = std::max(kEps, b.shapeSize.y * radiusScale * 0.5f);
+				cache.ez = std::max(kEps, b.shapeSize.z * radiusScale * 0.5f);
+				cache.radius = 0.0f; // Box自体には使わない
+
+				// 掃く軸に沿った AABB の範囲 (SAP 用)
+				const XMVECTOR ux = XMVector3Rotate(XMVectorSet(1, 0, 0, 0), q);
+				const XMVECTOR uy = XMVector3Rotate(XMVectorSet(0, 1, 0, 0), q);
+				const XMVECTOR uz = XMVector3Rotate(XMVectorSet(0, 0, 1, 0), q);
+
+				const float ax = std::abs(XMVectorGetByIndex(ux, sweepAxis));
+				const float ay = std::abs(XMVectorGetByIndex(uy, sweepAxis));
+				const float az = std::abs(XMVectorGetByIndex(uz, sweepAxis));
+
+				float ext = ax * cache.ex + ay * cache.ey + az * cache.ez;
+				ext += (collisionMargin + extra);
+
+				const float center = XMVectorGetByIndex(c, sweepAxis);
+				minA = center - ext;
+				maxA = center + ext;
+
+				// バウンディング球半径 (保守的)
+				radii[static_cast<size_t>(i)] = std::sqrt(cache.ex * cache.ex + cache.ey * cache.ey + cache.ez * cache.ez)
+					+ collisionMargin + extra;
 			}
 			else
 			{
-				cache.p0 = c;
-				cache.p1 = c;
-			}
-
-			float rTotal = cache.radius + collisionMargin + extra;
-			float x0 = XMVectorGetX(cache.p0);
-			float x1 = XMVectorGetX(cache.p1);
-			minX = std::min(x0, x1) - rTotal;
-			maxX = std::max(x0, x1) + rTotal;
-
-			radii[static_cast<size_t>(i)] = b.capsuleHalfHeight + cache.radius + collisionMargin + extra;
-		}
-
-		const int axisPos = (m_axisListInitialized && static_cast<size_t>(i) < m_bodyToAxisIndex.size())
-			? m_bodyToAxisIndex[static_cast<size_t>(i)]
-			: i;
-		if (static_cast<size_t>(axisPos) < axisList.size())
-		{
-			axisList[static_cast<size_t>(axisPos)] = { minX, i };
-		}
-		maxXs[static_cast<size_t>(i)] = maxX;
-		m_bodyToAxisIndex[static_cast<size_t>(i)] = axisPos;
-	}
-
-	auto shouldCollide = [&](int i, int j) -> bool
-		{
-			if (!m_settings.respectCollisionGroups) return true;
-			const Body& A = m_bodies[static_cast<size_t>(i)];
-			const Body& B = m_bodies[static_cast<size_t>(j)];
+				// Capsule / Sphere
+				cache.radius = b.capsuleRadius * radiusScale;
+				float hh = b.capsuleHalfHeight;
+				if (hh > kEps)
+				{
+					XMVECTOR axisL = XMLoadFloat3(&b.capsuleLocalAxis);
+					XMVECTOR axisW = XMVector3Rotate(axisL, q);
+					XMVECTOR o = XMVectorScale(axisW, hh);
+					cache.p0 = XMVectorSubtract(c, o);
+					cache.p1 = XMVectorAdd(c, o);
+				}
+				else
+				{
+					cache.p0 = c;
+					cache.p1 = c;
+				}
 
-			uint16_t maskA = A.groupMask;
-			uint16_t maskB = B.groupMask;
+				float rTotal = cache.radius + collisionMargin + extra;
+				float e0 = XMVectorGetByIndex(cache.p0, sweepAxis);
+				float e1 = XMVectorGetByIndex(cache.p1, sweepAxis);
+				minA = std::min(e0, e1) - rTotal;
+				maxA = std::max(e0, e1) + rTotal;
 
-			int groupA = A.group;
-			int groupB = B.group;
-			if (m_groupIndexIsOneBased)
-			{
-				groupA -= 1; groupB -= 1;
+				radii[static_cast<size_t>(i)] = b.capsuleHalfHeight + cache.radius + collisionMargin + extra;
 			}
 
-			if (groupA < 0 || groupA >= 16 || groupB < 0 || groupB >= 16) return true;
-
-			const uint16_t bitA = static_cast<uint16_t>(1u << groupA);
-			const uint16_t bitB = static_cast<uint16_t>(1u << groupB);
-
-			if (m_groupMaskIsCollisionMask)
+			const int axisPos = (m_axisListInitialized && static_cast<size_t>(i) < m_bodyToAxisIndex.size())
+				? m_bodyToAxisIndex[static_cast<size_t>(i)]
+				: i;
+			if (static_cast<size_t>(axisPos) < axisList.size())
 			{
-				// mask が「当たる相手」ビット
-				return ((maskA & bitB) != 0) && ((maskB & bitA) != 0);
+				axisList[static_cast<size_t>(axisPos)] = { minA, i };
 			}
-			else
-			{
-				// mask が「当たらない相手」ビット
-				return ((maskA & bitB) == 0) && ((maskB & bitA) == 0);
-			}
-		};
+			axisMax[static_cast<size_t>(i)] = maxA;
+			m_bodyToAxisIndex[static_cast<size_t>(i)] = axisPos;
+		}
+	});
 
 	// --- 2. Broadphase (SAP) ---
 	// 前フレームからほぼ整列している前提で挿入ソートを使用し、O(N) に近いコストで更新する。
@@ -1646,7 +2349,7 @@ void MmdPhysicsWorld::SolveBodyCollisions(float dt)
 			{
 				SapNode key = nodes[i];
 				size_t j = i;
-				while (j > 0 && key.minX < nodes[j - 1].minX)
+				while (j > 0 && key.min < nodes[j - 1].min)
 				{
 					nodes[j] = nodes[j - 1];
 					--j;
@@ -1660,7 +2363,7 @@ void MmdPhysicsWorld::SolveBodyCollisions(float dt)
 	}
 	else
 	{
-		std::sort(axisList.begin(), axisList.end(), [](const SapNode& a, const SapNode& b) { return a.minX < b.minX; });
+		std::sort(axisList.begin(), axisList.end(), [](const SapNode& a, const SapNode& b) { return a.min < b.min; });
 		m_axisListInitialized = true;
 	}
 
@@ -1673,49 +2376,83 @@ void MmdPhysicsWorld::SolveBodyCollisions(float dt)
 		}
 	}
 
+	// 境界球が重なる組を集め、前のサブステップから続いている組は記録を引き継ぐ。
+	// 関節でつながっているかは新しくできた組だけ調べる
+	m_nextPairs.clear();
 	m_candidates.clear();
-	// 適切な予約サイズ確保 (前回のサイズ等を参考にするとより良い)
-	const size_t candidateHint = bodyCount * 4;
-	if (m_candidates.capacity() < candidateHint)
-	{
-		m_candidates.reserve(bodyCount * 8);
-	}
+	uint32_t pairsAdded = 0;
+	uint32_t pairsKept = 0;
+	uint32_t pairHint = 0;
 
 	for (int i = 0; i < bodyCountInt; ++i)
 	{
 		const int idxA = axisList[static_cast<size_t>(i)].index;
-		const float maxX_A = maxXs[static_cast<size_t>(idxA)];
+		const float maxA = axisMax[static_cast<size_t>(idxA)];
 
 		// 静的オブジェクト同士の衝突を除外するためのフラグ
-		const bool isStaticA = (m_bodies[idxA].invMass <= 0.0f);
+		const bool isStaticA = (m_state.invMass[idxA] <= 0.0f);
 		using namespace DirectX;
-		XMVECTOR posA = XMLoadFloat3(&m_bodies[idxA].position);
+		XMVECTOR posA = m_state.position.Load(static_cast<size_t>(idxA));
 
 		for (int j = i + 1; j < bodyCountInt; ++j)
 		{
-			if (axisList[static_cast<size_t>(j)].minX > maxX_A) break;
+			if (axisList[static_cast<size_t>(j)].min > maxA) break;
 
 			const int idxB = axisList[static_cast<size_t>(j)].index;
 
 			// 両方Staticなら無視
-			if (isStaticA && m_bodies[idxB].invMass <= 0.0f) continue;
+			if (isStaticA && m_state.invMass[idxB] <= 0.0f) continue;
 
-			// ジョイント接続チェック
-			if (!m_settings.collideJointConnectedBodies && IsJointConnected(idxA, idxB)) continue;
+			// 眠っている剛体と止まっているボーン追従剛体どうしは何も動かない
+			if (!m_bodyActive[static_cast<size_t>(idxA)] && !m_bodyActive[static_cast<size_t>(idxB)]) continue;
 
-			// グループフィルタ
-			if (!shouldCollide(idxA, idxB)) continue; // shouldCollideはラムダとして定義するかメンバ関数化が必要
+			// グループフィルタ (ビット演算だけなので組を引くより先に済ませる)
+			if (!ShouldCollide(static_cast<uint32_t>(idxA), static_cast<uint32_t>(idxB))) continue;
 
 			// Sphere Check (保守的判定)
-			XMVECTOR posB = XMLoadFloat3(&m_bodies[idxB].position);
+			XMVECTOR posB = m_state.position.Load(static_cast<size_t>(idxB));
 			float rSum = radii[static_cast<size_t>(idxA)] + radii[static_cast<size_t>(idxB)];
 			XMVECTOR dp = XMVectorSubtract(posB, posA);
 			if (XMVectorGetX(XMVector3LengthSq(dp)) > rSum * rSum) continue;
 
-			m_candidates.push_back({ idxA, idxB });
+			const uint32_t a = static_cast<uint32_t>(std::min(idxA, idxB));
+			const uint32_t b = static_cast<uint32_t>(std::max(idxA, idxB));
+			const uint32_t found = FindPair(a, b, pairHint);
+			ContactPair pair;
+			if (found != UINT32_MAX)
+			{
+				pair = m_pairs[found];
+				pair.lambda = pair.touching ? pair.lambda * warmStart : 0.0f;
+				pairHint = found + 1;
+				++pairsKept;
+			}
+			else
+			{
+				pair.a = a;
+				pair.b = b;
+				pair.normal = { 0.0f, 1.0f, 0.0f };
+				pair.lambda = 0.0f;
+				pair.filtered = !m_settings.collideJointConnectedBodies && IsJointConnected(a, b);
+				++pairsAdded;
+			}
+			pair.touching = false;
+
+			if (!pair.filtered) m_candidates.push_back(static_cast<uint32_t>(m_nextPairs.size()));
+			m_nextPairs.push_back(pair);
 		}
 	}
 
+	const uint32_t pairsRemoved = static_cast<uint32_t>(m_pairs.size()) - pairsKept;
+	m_pairs.swap(m_nextPairs);
+	m_pairTableValid = false;
+
+	if (m_profile)
+	{
+		m_profile->physicsPairsAdded += pairsAdded;
+		m_profile->physicsPairsRemoved += pairsRemoved;
+		m_profile->physicsCandidatePairs += static_cast<std::uint32_t>(m_candidates.size());
+	}
+
 	if (m_candidates.empty()) return;
 
 	// --- 3. Narrow Phase & Solver ---
@@ -1725,14 +2462,18 @@ void MmdPhysicsWorld::SolveBodyCollisions(float dt)
 		? (m_settings.maxDepenetrationVelocity * dt)
 		: std::numeric_limits<float>::max();
 
+	uint32_t contacts = 0;
 	for (int iter = 0; iter < m_settings.collisionIterations; ++iter)
 	{
-		for (const auto& pair : m_candidates)
+		for (const uint32_t pairIndex : m_candidates)
 		{
-			int idxA = pair.a;
-			int idxB = pair.b;
-			Body& A = m_bodies[idxA];
-			Body& B = m_bodies[idxB];
+			ContactPair& pair = m_pairs[pairIndex];
+			const int idxA = static_cast<int>(pair.a);
+			const int idxB = static_cast<int>(pair.b);
+			const Body& A = m_bodies[idxA];
+			const Body& B = m_bodies[idxB];
+			const float invMassA = m_state.invMass[idxA];
+			const float invMassB = m_state.invMass[idxB];
 			const CollisionShapeCache& cA = m_shapeCache[idxA];
 			const CollisionShapeCache& cB = m_shapeCache[idxB];
 
@@ -1744,9 +2485,9 @@ void MmdPhysicsWorld::SolveBodyCollisions(float dt)
 			XMVECTOR posB = XMVectorZero();
 			bool hit = false;
 
-			const bool isMixed = ((A.invMass <= 0.0f) != (B.invMass <= 0.0f));
-			const float extraA = (isMixed && (A.invMass <= 0.0f)) ? kPhantomMargin : 0.0f;
-			const float extraB = (isMixed && (B.invMass <= 0.0f)) ? kPhantomMargin : 0.0f;
+			const bool isMixed = ((invMassA <= 0.0f) != (invMassB <= 0.0f));
+			const float extraA = (isMixed && (invMassA <= 0.0f)) ? kPhantomMargin : 0.0f;
+			const float extraB = (isMixed && (invMassB <= 0.0f)) ? kPhantomMargin : 0.0f;
 			const float marginTotal = collisionMargin + extraA + extraB;
 
 			// 衝突判定: 事前計算キャッシュを利用して高速化
@@ -1765,7 +2506,8 @@ void MmdPhysicsWorld::SolveBodyCollisions(float dt)
 					if (p >= slop)
 					{
 						penetration = p - slop;
-						n = (dist > kEps) ? XMVectorScale(d, 1.0f / dist) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+						// 芯が重なって向きが決まらないときは前回の法線で押し戻す
+						n = (dist > kEps) ? XMVectorScale(d, 1.0f / dist) : XMLoadFloat3(&pair.normal);
 						posA = segC1;
 						posB = segC2;
 						hit = true;
@@ -1829,15 +2571,23 @@ void MmdPhysicsWorld::SolveBodyCollisions(float dt)
 			}
 
 			if (!hit) continue;
+			++contacts;
+
+			// 起きている相手に触れた眠っている島を起こす。回り始めるのは次のサブステップからで、
+			// それまでは動かない剛体として押し返す
+			const bool sleepingA = IsBodySleeping(static_cast<size_t>(idxA));
+			const bool sleepingB = IsBodySleeping(static_cast<size_t>(idxB));
+			if (sleepingA) WakeIsland(m_bodyIsland[static_cast<size_t>(idxA)]);
+			if (sleepingB) WakeIsland(m_bodyIsland[static_cast<size_t>(idxB)]);
 
 			// --- ソルバー適用 (Impulse Apply) ---
 			// ※ここは元のロジックと同一だが、計算済みの値を使用
 
-			float wA = A.invMass;
-			float wB = B.invMass;
+			float wA = sleepingA ? 0.0f : invMassA;
+			float wB = sleepingB ? 0.0f : invMassB;
 
-			XMVECTOR pA0 = XMLoadFloat3(&A.position);
-			XMVECTOR pB0 = XMLoadFloat3(&B.position);
+			XMVECTOR pA0 = m_state.position.Load(static_cast<size_t>(idxA));
+			XMVECTOR pB0 = m_state.position.Load(static_cast<size_t>(idxB));
 			XMVECTOR leverA = XMVectorSubtract(posA, pA0);
 			XMVECTOR leverB = XMVectorSubtract(posB, pB0);
 
@@ -1845,17 +2595,17 @@ void MmdPhysicsWorld::SolveBodyCollisions(float dt)
 			if (wA > 0.0f)
 			{
 				XMVECTOR rxn = XMVector3Cross(leverA, n);
-				wAngA = XMVectorGetX(XMVector3Dot(XMVectorMultiply(XMLoadFloat3(&A.invInertia), rxn), rxn));
+				wAngA = XMVectorGetX(XMVector3Dot(XMVectorMultiply(m_state.invInertia.Load(static_cast<size_t>(idxA)), rxn), rxn));
 			}
 			if (wB > 0.0f)
 			{
 				XMVECTOR rxn = XMVector3Cross(leverB, n);
-				wAngB = XMVectorGetX(XMVector3Dot(XMVectorMultiply(XMLoadFloat3(&B.invInertia), rxn), rxn));
+				wAngB = XMVectorGetX(XMVector3Dot(XMVectorMultiply(m_state.invInertia.Load(static_cast<size_t>(idxB)), rxn), rxn));
 			}
 
 			// Stabilization
-			XMVECTOR vA_cur = XMVectorSubtract(pA0, XMLoadFloat3(&A.prevPosition));
-			XMVECTOR vB_cur = XMVectorSubtract(pB0, XMLoadFloat3(&B.prevPosition));
+			XMVECTOR vA_cur = XMVectorSubtract(pA0, m_state.prevPosition.Load(static_cast<size_t>(idxA)));
+			XMVECTOR vB_cur = XMVectorSubtract(pB0, m_state.prevPosition.Load(static_cast<size_t>(idxB)));
 			float vn = XMVectorGetX(XMVector3Dot(XMVectorSubtract(vA_cur, vB_cur), n));
 
 			float currentAlpha = alpha;
@@ -1888,14 +2638,14 @@ void MmdPhysicsWorld::SolveBodyCollisions(float dt)
 			}
 
 			// Apply
-			auto applyImpulse = [&](Body& body, XMVECTOR imp, XMVECTOR lever) {
-				if (body.invMass <= 0.0f) return;
-				XMVECTOR p = XMLoadFloat3(&body.position);
-				p = XMVectorAdd(p, XMVectorScale(imp, body.invMass));
-				XMStoreFloat3(&body.position, p);
+			auto applyImpulse = [&](size_t body, float invMass, XMVECTOR imp, XMVECTOR lever) {
+				if (invMass <= 0.0f) return;
+				XMVECTOR p = m_state.position.Load(body);
+				p = XMVectorAdd(p, XMVectorScale(imp, invMass));
+				m_state.position.Store(body, p);
 
 				XMVECTOR T = XMVector3Cross(lever, imp);
-				XMVECTOR dTheta = XMVectorMultiply(XMLoadFloat3(&body.invInertia), T);
+				XMVECTOR dTheta = XMVectorMultiply(m_state.invInertia.Load(body), T);
 				if (!IsVectorFinite3(dTheta)) return;
 				float maxTheta = std::max(0.0f, m_settings.maxAngularSpeed) * dt;
 				float theta = XMVectorGetX(XMVector3Length(dTheta));
@@ -1910,170 +2660,208 @@ void MmdPhysicsWorld::SolveBodyCollisions(float dt)
 					XMVECTOR dq = QuaternionFromRotationVector(dTheta);
 					if (!IsVectorFinite4(dq)) return;
 
-					XMVECTOR q = Load4(body.rotation);
+					XMVECTOR q = m_state.rotation.Load(body);
 					if (!IsVectorFinite4(q)) return;
 
-					XMStoreFloat4(&body.rotation, XMQuaternionNormalize(XMQuaternionMultiply(dq, q)));
+					m_state.rotation.Store(body, XMQuaternionNormalize(XMQuaternionMultiply(dq, q)));
 				}
 			};
 
-			applyImpulse(A, XMVectorAdd(XMVectorNegate(dp), frictionImpulse), leverA);
-			applyImpulse(B, XMVectorSubtract(dp, frictionImpulse), leverB);
+			applyImpulse(static_cast<size_t>(idxA), wA, XMVectorAdd(XMVectorNegate(dp), frictionImpulse), leverA);
+			applyImpulse(static_cast<size_t>(idxB), wB, XMVectorSubtract(dp, frictionImpulse), leverB);
+
+			XMStoreFloat3(&pair.normal, n);
+			pair.lambda += dLambda;
+			pair.touching = true;
 		}
 	}
+
+	if (m_profile) m_profile->physicsContacts += contacts;
 }
 
 void MmdPhysicsWorld::SolveJoints(float dt)
 {
-	if (m_joints.empty()) return;
+	if (m_activeJointSlots.empty()) return;
 	const float alphaPos = m_settings.jointCompliance / (std::max(dt, kEps) * std::max(dt, kEps));
 
-	for (auto& c : m_joints)
+	// 色の中のジョイントは互いに独立なので並列に解き、色と色の間で待ち合わせる (色単位の Gauss-Seidel)
+	if (!m_settings.deterministicJointOrder)
 	{
-		Body& A = m_bodies[static_cast<size_t>(c.bodyA)];
-		Body& B = m_bodies[static_cast<size_t>(c.bodyB)];
-		float wA = A.invMass, wB = B.invMass;
-		if (wA + wB <= 0.0f) continue;
-
-		XMVECTOR qA = Load4(A.rotation);
-		XMVECTOR qB = Load4(B.rotation);
-		XMVECTOR pA = Load3(A.position);
-		XMVECTOR pB = Load3(B.position);
-
-		if (!IsVectorFinite3(pA) || !IsVectorFinite3(pB)) continue;
-
-		XMVECTOR qJA = Load4(c.rotAtoJ);
-		XMVECTOR qJB = Load4(c.rotBtoJ);
-		XMVECTOR qJ_WorldA = XMQuaternionMultiply(qJA, qA);
-		XMVECTOR qJ_WorldB = XMQuaternionMultiply(qJB, qB);
-		XMVECTOR qDiff = XMQuaternionMultiply(XMQuaternionConjugate(qJ_WorldA), qJ_WorldB);
-
-		XMFLOAT3 euler = QuaternionToEulerXYZ(qDiff);
-
-		auto WrapPi = [](float a) -> float {
-			a = std::fmod(a + DirectX::XM_PI, DirectX::XM_2PI);
-			if (a < 0.0f) a += DirectX::XM_2PI;
-			return a - DirectX::XM_PI;
-			};
-		euler.x = WrapPi(euler.x); euler.y = WrapPi(euler.y); euler.z = WrapPi(euler.z);
+		std::shuffle(m_colorOrder.begin(), m_colorOrder.end(), m_colorShuffle);
+	}
 
-		bool clamped = false;
-		auto clampAxis = [&](float& val, float minV, float maxV) {
-			if (val < minV)
-			{
-				val += (minV - val) * 0.8f; clamped = true;
-			}
-			else if (val > maxV)
+	for (uint32_t color : m_colorOrder)
+	{
+		const uint32_t first = m_activeColorOffsets[color];
+		const uint32_t count = m_activeColorOffsets[color + 1] - first;
+		JobSystem::Shared().ParallelFor(g_jointSite, count, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i)
 			{
-				val -= (val - maxV) * 0.8f; clamped = true;
+				SolveJoint(m_activeJointSlots[first + i], dt, alphaPos);
 			}
-			};
+		});
+	}
+}
 
-		clampAxis(euler.x, c.rotLower.x, c.rotUpper.x);
-		clampAxis(euler.y, c.rotLower.y, c.rotUpper.y);
-		clampAxis(euler.z, c.rotLower.z, c.rotUpper.z);
+void MmdPhysicsWorld::SolveJoint(uint32_t slot, float dt, float alphaPos)
+{
+	JointSlots& J = m_jointSlots;
+	BodyState& S = m_state;
+	const uint32_t a = J.bodyA[slot];
+	const uint32_t b = J.bodyB[slot];
+	float wA = S.invMass[a], wB = S.invMass[b];
+	if (wA + wB <= 0.0f) return;
+
+	XMVECTOR qA = S.rotation.Load(a);
+	XMVECTOR qB = S.rotation.Load(b);
+	XMVECTOR pA = S.position.Load(a);
+	XMVECTOR pB = S.position.Load(b);
+
+	if (!IsVectorFinite3(pA) || !IsVectorFinite3(pB)) return;
+
+	XMVECTOR qJA = Load4(J.rotAtoJ[slot]);
+	XMVECTOR qJB = Load4(J.rotBtoJ[slot]);
+	XMVECTOR qJ_WorldA = XMQuaternionMultiply(qJA, qA);
+	XMVECTOR qJ_WorldB = XMQuaternionMultiply(qJB, qB);
+	XMVECTOR qDiff = XMQuaternionMultiply(XMQuaternionConjugate(qJ_WorldA), qJ_WorldB);
+
+	XMFLOAT3 euler = QuaternionToEulerXYZ(qDiff);
+
+	auto WrapPi = [](float a) -> float {
+		a = std::fmod(a + DirectX::XM_PI, DirectX::XM_2PI);
+		if (a < 0.0f) a += DirectX::XM_2PI;
+		return a - DirectX::XM_PI;
+		};
+	euler.x = WrapPi(euler.x); euler.y = WrapPi(euler.y); euler.z = WrapPi(euler.z);
 
-		if (!clamped)
+	bool clamped = false;
+	auto clampAxis = [&](float& val, float minV, float maxV) {
+		if (val < minV)
 		{
-			float sx = c.rotationSpring.x * m_settings.springStiffnessScale;
-			float sy = c.rotationSpring.y * m_settings.springStiffnessScale;
-			float sz = c.rotationSpring.z * m_settings.springStiffnessScale;
-
-			float stiffness = std::max({ sx, sy, sz });
-			if (stiffness > 0.0f)
-			{
-				float factor = std::clamp(stiffness * dt, 0.0f, m_settings.maxSpringCorrectionRate);
-				euler.x *= (1.0f - factor); euler.y *= (1.0f - factor); euler.z *= (1.0f - factor);
-				clamped = true;
-			}
+			val += (minV - val) * 0.8f; clamped = true;
+		}
+		else if (val > maxV)
+		{
+			val -= (val - maxV) * 0.8f; clamped = true;
 		}
+		};
 
-		if (clamped)
+	const XMFLOAT3& rotLower = J.rotLower[slot];
+	const XMFLOAT3& rotUpper = J.rotUpper[slot];
+	clampAxis(euler.x, rotLower.x, rotUpper.x);
+	clampAxis(euler.y, rotLower.y, rotUpper.y);
+	clampAxis(euler.z, rotLower.z, rotUpper.z);
+
+	if (!clamped)
+	{
+		const XMFLOAT3& spring = J.rotationSpring[slot];
+		float sx = spring.x * m_settings.springStiffnessScale;
+		float sy = spring.y * m_settings.springStiffnessScale;
+		float sz = spring.z * m_settings.springStiffnessScale;
+
+		float stiffness = std::max({ sx, sy, sz });
+		if (stiffness > 0.0f)
 		{
-			XMVECTOR qDiffNew = EulerXYZToQuaternion(euler.x, euler.y, euler.z);
-			XMVECTOR qJ_WorldB_Target = XMQuaternionMultiply(qJ_WorldA, qDiffNew);
-			XMVECTOR qB_Target = XMQuaternionMultiply(XMQuaternionConjugate(qJB), qJ_WorldB_Target);
-			XMVECTOR qDelta = XMQuaternionMultiply(qB_Target, XMQuaternionConjugate(qB));
-			qDelta = XMQuaternionNormalize(qDelta);
+			float factor = std::clamp(stiffness * dt, 0.0f, m_settings.maxSpringCorrectionRate);
+			euler.x *= (1.0f - factor); euler.y *= (1.0f - factor); euler.z *= (1.0f - factor);
+			clamped = true;
+		}
+	}
 
-			float totalW = wA + wB;
-			float ratioB = wB / totalW;
-			float ratioA = wA / totalW;
+	if (clamped)
+	{
+		XMVECTOR qDiffNew = EulerXYZToQuaternion(euler.x, euler.y, euler.z);
+		XMVECTOR qJ_WorldB_Target = XMQuaternionMultiply(qJ_WorldA, qDiffNew);
+		XMVECTOR qB_Target = XMQuaternionMultiply(XMQuaternionConjugate(qJB), qJ_WorldB_Target);
+		XMVECTOR qDelta = XMQuaternionMultiply(qB_Target, XMQuaternionConjugate(qB));
+		qDelta = XMQuaternionNormalize(qDelta);
 
-			XMVECTOR axis; float ang;
-			XMQuaternionToAxisAngle(&axis, &ang, qDelta);
+		float totalW = wA + wB;
+		float ratioB = wB / totalW;
+		float ratioA = wA / totalW;
 
-			if (ang > XM_PI) ang -= XM_2PI; else if (ang < -XM_PI) ang += XM_2PI;
+		XMVECTOR axis; float ang;
+		XMQuaternionToAxisAngle(&axis, &ang, qDelta);
 
+		if (ang > XM_PI) ang -= XM_2PI; else if (ang < -XM_PI) ang += XM_2PI;
+
+		// ボーン追従剛体は同じ色の複数のジョイントから読まれるので、動的な側だけ書き換える
+		if (wB > 0.0f)
+		{
 			XMVECTOR dqB = SafeQuaternionRotationAxis(axis, ang * ratioB);
-			XMVECTOR dqA = SafeQuaternionRotationAxis(axis, -ang * ratioA);
 			qB = XMQuaternionNormalize(XMQuaternionMultiply(dqB, qB));
+			S.rotation.Store(b, qB);
+		}
+		if (wA > 0.0f)
+		{
+			XMVECTOR dqA = SafeQuaternionRotationAxis(axis, -ang * ratioA);
 			qA = XMQuaternionNormalize(XMQuaternionMultiply(dqA, qA));
-			Store4(A.rotation, qA); Store4(B.rotation, qB);
+			S.rotation.Store(a, qA);
 		}
+	}
 
-		XMVECTOR rA = RotateVector(Load3(c.localAnchorA), qA);
-		XMVECTOR rB = RotateVector(Load3(c.localAnchorB), qB);
-		XMVECTOR ancA = XMVectorAdd(pA, rA);
-		XMVECTOR ancB = XMVectorAdd(pB, rB);
+	XMVECTOR rA = RotateVector(Load3(J.localAnchorA[slot]), qA);
+	XMVECTOR rB = RotateVector(Load3(J.localAnchorB[slot]), qB);
+	XMVECTOR ancA = XMVectorAdd(pA, rA);
+	XMVECTOR ancB = XMVectorAdd(pB, rB);
 
-		XMVECTOR distVec = XMVectorSubtract(ancA, ancB);
-		float dist = Length3(distVec);
-		if (dist < kEps) continue;
+	XMVECTOR distVec = XMVectorSubtract(ancA, ancB);
+	float dist = Length3(distVec);
+	if (dist < kEps) return;
 
-		XMVECTOR n = XMVectorScale(distVec, 1.0f / dist);
+	XMVECTOR n = XMVectorScale(distVec, 1.0f / dist);
 
-		float wAngA = 0.0f, wAngB = 0.0f;
-		if (wA > 0.0f)
-		{
-			XMVECTOR rxn = XMVector3Cross(rA, n);
-			wAngA = Dot3(rxn, XMVectorMultiply(Load3(A.invInertia), rxn));
-		}
-		if (wB > 0.0f)
-		{
-			XMVECTOR rxn = XMVector3Cross(rB, n);
-			wAngB = Dot3(rxn, XMVectorMultiply(Load3(B.invInertia), rxn));
-		}
+	float wAngA = 0.0f, wAngB = 0.0f;
+	if (wA > 0.0f)
+	{
+		XMVECTOR rxn = XMVector3Cross(rA, n);
+		wAngA = Dot3(rxn, XMVectorMultiply(S.invInertia.Load(a), rxn));
+	}
+	if (wB > 0.0f)
+	{
+		XMVECTOR rxn = XMVector3Cross(rB, n);
+		wAngB = Dot3(rxn, XMVectorMultiply(S.invInertia.Load(b), rxn));
+	}
 
-		float wTot = wA + wB + wAngA + wAngB + alphaPos;
-		float dLambda = (-dist - alphaPos * c.lambdaPos) / wTot;
-		c.lambdaPos += dLambda;
-		XMVECTOR P = XMVectorScale(n, dLambda);
+	float wTot = wA + wB + wAngA + wAngB + alphaPos;
+	float& lambdaPos = J.lambdaPos[slot];
+	float dLambda = (-dist - alphaPos * lambdaPos) / wTot;
+	lambdaPos += dLambda;
+	XMVECTOR P = XMVectorScale(n, dLambda);
 
+	{
+		float maxP = std::max(0.0f, m_settings.maxJointPositionCorrection);
+		if (maxP > 0.0f)
 		{
-			float maxP = std::max(0.0f, m_settings.maxJointPositionCorrection);
-			if (maxP > 0.0f)
-			{
-				float pLen = Length3(P);
-				if (pLen > maxP) P = XMVectorScale(P, maxP / pLen);
-			}
+			float pLen = Length3(P);
+			if (pLen > maxP) P = XMVectorScale(P, maxP / pLen);
 		}
+	}
 
-		if (wA > 0.0f)
-		{
-			XMVECTOR dp = XMVectorScale(P, wA);
-			Store3(A.position, XMVectorAdd(pA, dp));
-			XMVECTOR T = XMVector3Cross(rA, P);
-			XMVECTOR dTheta = XMVectorMultiply(Load3(A.invInertia), T);
-			float theta = Length3(dTheta);
-			float maxTheta = std::max(0.0f, m_settings.maxJointAngularCorrection);
-			if (maxTheta > 0.0f && theta > maxTheta) dTheta = XMVectorScale(dTheta, maxTheta / theta);
-			XMVECTOR dqRot = QuaternionFromRotationVector(dTheta);
-			Store4(A.rotation, XMQuaternionNormalize(XMQuaternionMultiply(dqRot, qA)));
-		}
-		if (wB > 0.0f)
-		{
-			XMVECTOR Pneg = XMVectorNegate(P);
-			XMVECTOR dp = XMVectorScale(Pneg, wB);
-			Store3(B.position, XMVectorAdd(pB, dp));
-			XMVECTOR T = XMVector3Cross(rB, Pneg);
-			XMVECTOR dTheta = XMVectorMultiply(Load3(B.invInertia), T);
-			float theta = Length3(dTheta);
-			float maxTheta = std::max(0.0f, m_settings.maxJointAngularCorrection);
-			if (maxTheta > 0.0f && theta > maxTheta) dTheta = XMVectorScale(dTheta, maxTheta / theta);
-			XMVECTOR dqRot = QuaternionFromRotationVector(dTheta);
-			Store4(B.rotation, XMQuaternionNormalize(XMQuaternionMultiply(dqRot, qB)));
-		}
+	if (wA > 0.0f)
+	{
+		XMVECTOR dp = XMVectorScale(P, wA);
+		S.position.Store(a, XMVectorAdd(pA, dp));
+		XMVECTOR T = XMVector3Cross(rA, P);
+		XMVECTOR dTheta = XMVectorMultiply(S.invInertia.Load(a), T);
+		float theta = Length3(dTheta);
+		float maxTheta = std::max(0.0f, m_settings.maxJointAngularCorrection);
+		if (maxTheta > 0.0f && theta > maxTheta) dTheta = XMVectorScale(dTheta, maxTheta / theta);
+		XMVECTOR dqRot = QuaternionFromRotationVector(dTheta);
+		S.rotation.Store(a, XMQuaternionNormalize(XMQuaternionMultiply(dqRot, qA)));
+	}
+	if (wB > 0.0f)
+	{
+		XMVECTOR Pneg = XMVectorNegate(P);
+		XMVECTOR dp = XMVectorScale(Pneg, wB);
+		S.position.Store(b, XMVectorAdd(pB, dp));
+		XMVECTOR T = XMVector3Cross(rB, Pneg);
+		XMVECTOR dTheta = XMVectorMultiply(S.invInertia.Load(b), T);
+		float theta = Length3(dTheta);
+		float maxTheta = std::max(0.0f, m_settings.maxJointAngularCorrection);
+		if (maxTheta > 0.0f && theta > maxTheta) dTheta = XMVectorScale(dTheta, maxTheta / theta);
+		XMVECTOR dqRot = QuaternionFromRotationVector(dTheta);
+		S.rotation.Store(b, XMQuaternionNormalize(XMQuaternionMultiply(dqRot, qB)));
 	}
 }
 
@@ -2087,149 +2875,124 @@ void MmdPhysicsWorld::SolveGround(float dt, const PmxModel& model)
 		: std::numeric_limits<float>::max();
 
 	// [最適化] 剛体ごとの地面判定は独立しているため並列化
-	const int n = static_cast<int>(m_bodies.size());
-#ifdef _OPENMP
-#pragma omp parallel for schedule(static) if(n >= 512)
-#endif
-	for (int i = 0; i < n; ++i)
-	{
-		// ループ変数をローカル参照で受ける
-		auto& b = m_bodies[i];
-
-		if (b.invMass <= 0.0f) continue;
-		if (!IsVectorFinite3(Load3(b.position))) continue;
-
-		float r = (b.capsuleRadius * m_settings.collisionRadiusScale) + m_settings.collisionMargin;
-
-		DirectX::XMVECTOR p = DirectX::XMLoadFloat3(&b.position);
-		float yMinEnd = DirectX::XMVectorGetY(p);
-
-		if (b.capsuleHalfHeight > kEps)
+	JobSystem::Shared().ParallelFor(g_groundSite, m_simBodies.size(), [&](size_t begin, size_t end) {
+		for (size_t k = begin; k < end; ++k)
 		{
-			DirectX::XMVECTOR q = DirectX::XMLoadFloat4(&b.rotation);
-			DirectX::XMVECTOR axisLocal = DirectX::XMVectorSet(b.capsuleLocalAxis.x, b.capsuleLocalAxis.y, b.capsuleLocalAxis.z, 0.0f);
-			if (DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(axisLocal)) < kEps)
-				axisLocal = DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
-			axisLocal = DirectX::XMVector3Normalize(axisLocal);
-			DirectX::XMVECTOR axis = DirectX::XMVector3Rotate(axisLocal, q);
-			DirectX::XMVECTOR o = DirectX::XMVectorScale(axis, b.capsuleHalfHeight);
-			DirectX::XMVECTOR p0 = DirectX::XMVectorAdd(p, o);
-			DirectX::XMVECTOR p1 = DirectX::XMVectorSubtract(p, o);
-			yMinEnd = std::min(DirectX::XMVectorGetY(p0), DirectX::XMVectorGetY(p1));
-		}
-
-		float target = ground + r;
-		float C = target - yMinEnd;
-		if (C <= 0.0f) continue;
-
-		float s = b.invMass / (b.invMass + alpha);
-		float dy = C * s;
-		if (dy > maxDist) dy = maxDist;
-
-		b.position.y += dy;
-	}
-}
-
-void MmdPhysicsWorld::EndSubStep(float dt, const PmxModel& model)
-{
-	(void)model;
-	float invDt = 1.0f / std::max(dt, kEps);
-
-	// [最適化] 速度更新ループの並列化
-	const int n = static_cast<int>(m_bodies.size());
-#ifdef _OPENMP
-#pragma omp parallel for schedule(static) if(n >= 512)
-#endif
-	for (int i = 0; i < n; ++i)
-	{
-		Body& b = m_bodies[i];
-		if (b.operation == PmxModel::RigidBody::OperationType::Static) continue;
-		if (b.invMass <= 0.0f) continue;
-
-		XMVECTOR pCheck = Load3(b.position);
-		if (!IsVectorFinite3(pCheck)) continue;
-
-		XMVECTOR p = Load3(b.position);
-		XMVECTOR p0 = Load3(b.prevPosition);
-		XMVECTOR vInt = Load3(b.linearVelocity);
-		XMVECTOR vPos = XMVectorScale(XMVectorSubtract(p, p0), invDt);
+			const uint32_t i = m_simBodies[k];
+			const float invMass = m_state.invMass[i];
+			if (invMass <= 0.0f) continue;
 
-		float ld = std::clamp(b.linearDamping, 0.0f, 1.0f);
-		ld = std::max(ld, m_settings.minLinearDamping);
+			DirectX::XMVECTOR p = m_state.position.Load(i);
+			if (!IsVectorFinite3(p)) continue;
 
-		float linScale = 1.0f;
-		if (ld >= 1.0f) linScale = 0.0f;
-		else
-		{
-			float oneMinus = std::max(1.0e-6f, 1.0f - ld);
-			linScale = std::exp(std::log(oneMinus) * dt);
-		}
-		vInt = XMVectorScale(vInt, linScale);
-		vPos = XMVectorScale(vPos, linScale);
+			const Body& b = m_bodies[i];
+			float r = (b.capsuleRadius * m_settings.collisionRadiusScale) + m_settings.collisionMargin;
 
-		float a = std::clamp(m_settings.postSolveVelocityBlend, 0.0f, 1.0f);
-		XMVECTOR v = XMVectorAdd(XMVectorScale(vInt, 1.0f - a), XMVectorScale(vPos, a));
+			float yMinEnd = DirectX::XMVectorGetY(p);
 
-		{
-			float maxV = std::max(0.0f, m_settings.maxLinearSpeed);
-			if (maxV > 0.0f)
+			if (b.capsuleHalfHeight > kEps)
 			{
-				float vLen = Length3(v);
-				if (vLen > maxV) v = XMVectorScale(v, maxV / vLen);
+				DirectX::XMVECTOR q = m_state.rotation.Load(i);
+				DirectX::XMVECTOR axisLocal = DirectX::XMVectorSet(b.capsuleLocalAxis.x, b.capsuleLocalAxis.y, b.capsuleLocalAxis.z, 0.0f);
+				if (DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(axisLocal)) < kEps)
+					axisLocal = DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+				axisLocal = DirectX::XMVector3Normalize(axisLocal);
+				DirectX::XMVECTOR axis = DirectX::XMVector3Rotate(axisLocal, q);
+				DirectX::XMVECTOR o = DirectX::XMVectorScale(axis, b.capsuleHalfHeight);
+				DirectX::XMVECTOR p0 = DirectX::XMVectorAdd(p, o);
+				DirectX::XMVECTOR p1 = DirectX::XMVectorSubtract(p, o);
+				yMinEnd = std::min(DirectX::XMVectorGetY(p0), DirectX::XMVectorGetY(p1));
 			}
-		}
-
-		if (m_settings.sleepLinearSpeed > 0.0f)
-		{
-			float vLen = Length3(v);
-			if (vLen < m_settings.sleepLinearSpeed) v = XMVectorZero();
-		}
-
-		Store3(b.linearVelocity, v);
-		XMVECTOR q = Load4(b.rotation);
-		XMVECTOR q0 = Load4(b.prevRotation);
-
-		XMVECTOR wInt = Load3(b.angularVelocity);
-
-		XMVECTOR dq = XMQuaternionMultiply(q, QuaternionConjugate(q0));
-		XMVECTOR wPos = QuaternionDeltaToAngularVelocity(dq, dt);
 
-		float ad = std::clamp(b.angularDamping, 0.0f, 1.0f);
-		ad = std::max(ad, m_settings.minAngularDamping);
+			float target = ground + r;
+			float C = target - yMinEnd;
+			if (C <= 0.0f) continue;
 
-		float angScale = 1.0f;
-		if (ad >= 1.0f) angScale = 0.0f;
-		else
-		{
-			float oneMinus = std::max(1.0e-6f, 1.0f - ad);
-			angScale = std::exp(std::log(oneMinus) * dt);
-		}
-		wInt = XMVectorScale(wInt, angScale);
-		wPos = XMVectorScale(wPos, angScale);
-
-		float aAng = std::clamp(m_settings.postSolveAngularVelocityBlend, 0.0f, 1.0f);
-		XMVECTOR w = XMVectorAdd(XMVectorScale(wInt, 1.0f - aAng), XMVectorScale(wPos, aAng));
+			float s = invMass / (invMass + alpha);
+			float dy = C * s;
+			if (dy > maxDist) dy = maxDist;
 
-		{
-			float maxW = std::max(0.0f, m_settings.maxAngularSpeed);
-			if (maxW > 0.0f)
-			{
-				float wLen = Length3(w);
-				if (wLen > maxW) w = XMVectorScale(w, maxW / wLen);
-			}
-		}
-
-		if (m_settings.sleepAngularSpeed > 0.0f)
-		{
-			float wLen = Length3(w);
-			if (wLen < m_settings.sleepAngularSpeed) w = XMVectorZero();
+			m_state.position.y[i] += dy;
 		}
+	});
+}
 
-		Store3(b.angularVelocity, w);
-	}
+void MmdPhysicsWorld::EndSubStep(float dt, const PmxModel& model)
+{
+	(void)model;
+	const float invDt = 1.0f / std::max(dt, kEps);
+
+	const float linBlend = std::clamp(m_settings.postSolveVelocityBlend, 0.0f, 1.0f);
+	const float angBlend = std::clamp(m_settings.postSolveAngularVelocityBlend, 0.0f, 1.0f);
+	const float maxV = std::max(0.0f, m_settings.maxLinearSpeed);
+	const float maxW = std::max(0.0f, m_settings.maxAngularSpeed);
+	const float restV = m_settings.sleepLinearSpeed;
+	const float restW = m_settings.sleepAngularSpeed;
+
+	// 4 剛体ずつ: 積分した速度と、拘束で動いた位置・回転から求めた速度を減衰させて混ぜ、速さを制限する
+	BodyState& S = m_state;
+	JobSystem::Shared().ParallelFor(g_endSite, m_simBlocks.size(), [&](size_t begin, size_t end) {
+		for (size_t k = begin; k < end; ++k)
+		{
+			const size_t i = m_simBlocks[k];
+
+			const Vec3Lanes p{ LoadLanes(S.position.x, i), LoadLanes(S.position.y, i), LoadLanes(S.position.z, i) };
+			const XMVECTOR active = XMVectorAndInt(
+				XMLoadInt4(S.simulate.data() + i),
+				XMVectorAndInt(XMVectorAndInt(FiniteLanes(p.x), FiniteLanes(p.y)), FiniteLanes(p.z)));
+
+			const XMVECTOR linScale = LoadLanes(S.linearDampingScale, i);
+			const XMVECTOR angScale = LoadLanes(S.angularDampingScale, i);
+
+			// 線速度
+			const Vec3Lanes p0{ LoadLanes(S.prevPosition.x, i), LoadLanes(S.prevPosition.y, i), LoadLanes(S.prevPosition.z, i) };
+			const Vec3Lanes vOld{ LoadLanes(S.linearVelocity.x, i), LoadLanes(S.linearVelocity.y, i), LoadLanes(S.linearVelocity.z, i) };
+
+			const Vec3Lanes vInt = ScaleLanes(vOld, linScale);
+			const Vec3Lanes vPos = ScaleLanes(ScaleLanes({
+				XMVectorSubtract(p.x, p0.x), XMVectorSubtract(p.y, p0.y), XMVectorSubtract(p.z, p0.z) }, XMVectorReplicate(invDt)), linScale);
+
+			const XMVECTOR keepV = XMVectorReplicate(1.0f - linBlend);
+			const XMVECTOR takeV = XMVectorReplicate(linBlend);
+			Vec3Lanes v{
+				XMVectorAdd(XMVectorMultiply(vInt.x, keepV), XMVectorMultiply(vPos.x, takeV)),
+				XMVectorAdd(XMVectorMultiply(vInt.y, keepV), XMVectorMultiply(vPos.y, takeV)),
+				XMVectorAdd(XMVectorMultiply(vInt.z, keepV), XMVectorMultiply(vPos.z, takeV)) };
+			v = LimitSpeedLanes(v, maxV, restV);
+
+			StoreLanes(S.linearVelocity.x, i, XMVectorSelect(vOld.x, v.x, active));
+			StoreLanes(S.linearVelocity.y, i, XMVectorSelect(vOld.y, v.y, active));
+			StoreLanes(S.linearVelocity.z, i, XMVectorSelect(vOld.z, v.z, active));
+
+			// 角速度
+			const QuatLanes q{ LoadLanes(S.rotation.x, i), LoadLanes(S.rotation.y, i), LoadLanes(S.rotation.z, i), LoadLanes(S.rotation.w, i) };
+			const QuatLanes q0Conj{
+				XMVectorNegate(LoadLanes(S.prevRotation.x, i)),
+				XMVectorNegate(LoadLanes(S.prevRotation.y, i)),
+				XMVectorNegate(LoadLanes(S.prevRotation.z, i)),
+				LoadLanes(S.prevRotation.w, i) };
+			const Vec3Lanes wOld{ LoadLanes(S.angularVelocity.x, i), LoadLanes(S.angularVelocity.y, i), LoadLanes(S.angularVelocity.z, i) };
+
+			const Vec3Lanes wInt = ScaleLanes(wOld, angScale);
+			const Vec3Lanes wPos = ScaleLanes(QuaternionDeltaToAngularVelocityLanes(QuaternionMultiplyLanes(q, q0Conj), dt), angScale);
+
+			const XMVECTOR keepW = XMVectorReplicate(1.0f - angBlend);
+			const XMVECTOR takeW = XMVectorReplicate(angBlend);
+			Vec3Lanes w{
+				XMVectorAdd(XMVectorMultiply(wInt.x, keepW), XMVectorMultiply(wPos.x, takeW)),
+				XMVectorAdd(XMVectorMultiply(wInt.y, keepW), XMVectorMultiply(wPos.y, takeW)),
+				XMVectorAdd(XMVectorMultiply(wInt.z, keepW), XMVectorMultiply(wPos.z, takeW)) };
+			w = LimitSpeedLanes(w, maxW, restW);
+
+			StoreLanes(S.angularVelocity.x, i, XMVectorSelect(wOld.x, w.x, active));
+			StoreLanes(S.angularVelocity.y, i, XMVectorSelect(wOld.y, w.y, active));
+			StoreLanes(S.angularVelocity.z, i, XMVectorSelect(wOld.z, w.z, active));
+		}
+	});
 }
 
-void MmdPhysicsWorld::WriteBackBones(const PmxModel& model, BoneSolver& bones)
+void MmdPhysicsWorld::WriteBackBones(const PmxModel& model, BoneSolver& bones,
+									 std::span<const XMFLOAT3> positions, std::span<const XMFLOAT4> rotations)
 {
 	const auto& rbDefs = model.RigidBodies();
 	const auto& bonesDef = model.Bones();
@@ -2252,7 +3015,7 @@ void MmdPhysicsWorld::WriteBackBones(const PmxModel& model, BoneSolver& bones)
 	std::fill(m_hasDesiredGlobal.begin(), m_hasDesiredGlobal.end(), 0);
 	std::fill(m_hasAppliedGlobal.begin(), m_hasAppliedGlobal.end(), 0);
 
-	const size_t rbCount = std::min(rbDefs.size(), m_bodies.size());
+	const size_t rbCount = std::min({ rbDefs.size(), m_bodies.size(), positions.size(), rotations.size() });
 	const bool fallbackNoAfterPhysics = m_writebackFallbackNoAfterPhysics;
 
 	bool needsTranslationBackup = false;
@@ -2284,7 +3047,7 @@ void MmdPhysicsWorld::WriteBackBones(const PmxModel& model, BoneSolver& bones)
 		if (def.boneIndex < 0 || def.boneIndex >= static_cast<int>(boneCount)) continue;
 
 		const Body& b = m_bodies[i];
-		if (b.invMass <= 0.0f) continue;
+		if (m_state.invMass[i] <= 0.0f) continue;
 
 		if (m_settings.requireAfterPhysicsFlag && !fallbackNoAfterPhysics)
 		{
@@ -2295,11 +3058,11 @@ void MmdPhysicsWorld::WriteBackBones(const PmxModel& model, BoneSolver& bones)
 			if (def.operation != PmxModel::RigidBody::OperationType::DynamicAndPositionAdjust) continue;
 		}
 
-		const XMVECTOR pCheck = Load3(b.position);
-		const XMVECTOR qCheck = Load4(b.rotation);
+		const XMVECTOR pCheck = XMLoadFloat3(&positions[i]);
+		const XMVECTOR qCheck = XMLoadFloat4(&rotations[i]);
 		if (!IsVectorFinite3(pCheck) || !IsVectorFinite4(qCheck)) continue;
 
-		const XMMATRIX rbG = MatrixFromTR(b.position, b.rotation);
+		const XMMATRIX rbG = MatrixFromTR(positions[i], rotations[i]);
 		const XMMATRIX localFromBone = XMLoadFloat4x4(&b.localFromBone);
 		const XMMATRIX invLocalFromBone = XMMatrixInverse(nullptr, localFromBone);
 		const XMMATRIX boneG = rbG * invLocalFromBone;
@@ -2,12 +2,15 @@
 
 #include <vector>
 #include <cstdint>
+#include <random>
+#include <span>
 #include <unordered_map>
 #include <unordered_set>
 #include <DirectXMath.h>
 #include "PmxModel.hpp"
 #include "BoneSolver.hpp"
 #include "Settings.hpp"
+#include "TickProfile.hpp"
 
 class MmdPhysicsWorld
 {
@@ -21,6 +24,19 @@ public:
 	void BuildFromModel(const PmxModel& model, const BoneSolver& bones);
 	void Step(double dtSeconds, const PmxModel& model, BoneSolver& bones);
 
+	// 以下は物理を別スレッドで回すとき (PhysicsThread) に使う。
+	// StepFixed は fixedTimeStep を 1 回分進める。boneGlobals はボーン番号で引くグローバル行列で、
+	// KinematicBones() のボーンだけ埋まっていればよい。構築済みであること
+	void StepFixed(const PmxModel& model, std::span<const DirectX::XMFLOAT4X4> boneGlobals);
+	// ボーン追従剛体がついているボーン
+	std::vector<int> KinematicBones() const;
+	// 剛体の位置・回転を剛体番号順に写す
+	void CopyBodyTransforms(std::vector<DirectX::XMFLOAT3>& positions, std::vector<DirectX::XMFLOAT4>& rotations) const;
+	// 与えた剛体の姿勢をボーンへ書き戻す。構築時に決まる値しか読まないので、
+	// 別スレッドが StepFixed を回している間に呼んでもよい
+	void WriteBackBones(const PmxModel& model, BoneSolver& bones,
+						std::span<const DirectX::XMFLOAT3> positions, std::span<const DirectX::XMFLOAT4> rotations);
+
 	bool IsBuilt() const
 	{
 		return m_isBuilt;
@@ -38,7 +54,19 @@ public:
 		return m_settings;
 	}
 
+	// インパルスモーフ: 剛体 (PMX の剛体番号) の速度・角速度を与えた値にする。
+	// モーフが効いている間は毎 Tick 呼ぶ (足し込まないので、効かせ続けても加速しない)。
+	// 動的な剛体だけが対象で、眠っている島も起こす。local なら剛体の向きで回す。トルクは慣性で割って角速度にする
+	void ApplyImpulseMorph(size_t rigidBodyIndex, const DirectX::XMFLOAT3& velocity, const DirectX::XMFLOAT3& torque, bool local);
+
+	// サブステップと書き戻しの所要時間を加算する先 (nullptr で計測しない)
+	void SetProfile(TickProfile* profile)
+	{
+		m_profile = profile;
+	}
+
 private:
+	// 剛体の構築時に決まる値と、ボーン追従の目標。サブステップ中に書き換える値は BodyState に置く
 	struct Body
 	{
 		int defIndex{ -1 };
@@ -47,23 +75,11 @@ private:
 
 		DirectX::XMFLOAT4X4 localFromBone{};
 
-		DirectX::XMFLOAT3 position{};
-		DirectX::XMFLOAT4 rotation{ 0.0f, 0.0f, 0.0f, 1.0f };
-
-		DirectX::XMFLOAT3 prevPosition{};
-		DirectX::XMFLOAT4 prevRotation{ 0.0f, 0.0f, 0.0f, 1.0f };
-
 		DirectX::XMFLOAT3 kinematicTargetPos{};
 		DirectX::XMFLOAT4 kinematicTargetRot{};
 		DirectX::XMFLOAT3 kinematicStartPos{};
 		DirectX::XMFLOAT4 kinematicStartRot{};
 
-		DirectX::XMFLOAT3 linearVelocity{};
-		DirectX::XMFLOAT3 angularVelocity{};
-
-		float invMass{ 0.0f };
-		DirectX::XMFLOAT3 invInertia{ 0.0f, 0.0f, 0.0f };
-
 		PmxModel::RigidBody::ShapeType shapeType{ PmxModel::RigidBody::ShapeType::Sphere };
 		DirectX::XMFLOAT3 shapeSize{};
 		float capsuleRadius{ 0.0f };
@@ -81,6 +97,73 @@ private:
 		float angularDamping{ 0.0f };
 	};
 
+	// XMFLOAT3 の列を成分ごとの配列に分けたもの。Load/Store は 1 要素、LoadLanes は 4 要素ずつ
+	struct Float3Soa
+	{
+		std::vector<float> x, y, z;
+
+		void Resize(size_t count, const DirectX::XMFLOAT3& value);
+		DirectX::XMVECTOR Load(size_t i) const
+		{
+			return DirectX::XMVectorSet(x[i], y[i], z[i], 0.0f);
+		}
+		DirectX::XMFLOAT3 Get(size_t i) const
+		{
+			return { x[i], y[i], z[i] };
+		}
+		void Store(size_t i, DirectX::FXMVECTOR v);
+		void Set(size_t i, const DirectX::XMFLOAT3& v)
+		{
+			x[i] = v.x; y[i] = v.y; z[i] = v.z;
+		}
+	};
+
+	struct Float4Soa
+	{
+		std::vector<float> x, y, z, w;
+
+		void Resize(size_t count, const DirectX::XMFLOAT4& value);
+		DirectX::XMVECTOR Load(size_t i) const
+		{
+			return DirectX::XMVectorSet(x[i], y[i], z[i], w[i]);
+		}
+		DirectX::XMFLOAT4 Get(size_t i) const
+		{
+			return { x[i], y[i], z[i], w[i] };
+		}
+		void Store(size_t i, DirectX::FXMVECTOR v);
+		void Set(size_t i, const DirectX::XMFLOAT4& v)
+		{
+			x[i] = v.x; y[i] = v.y; z[i] = v.z; w[i] = v.w;
+		}
+	};
+
+	// サブステップごとに読み書きする剛体の状態 (SoA)。
+	// 配列の長さは剛体数を 4 の倍数に切り上げたもので、積分と速度の更新は XMVECTOR 1 本で 4 剛体ずつ回す。
+	// 余りの要素は動かない剛体 (invMass 0、simulate 0) として扱われる
+	struct BodyState
+	{
+		Float3Soa position;
+		Float4Soa rotation;
+		Float3Soa prevPosition;
+		Float4Soa prevRotation;
+		Float3Soa linearVelocity;
+		Float3Soa angularVelocity;
+		Float3Soa invInertia;
+		std::vector<float> invMass;
+
+		// EndSubStep で速度に掛ける減衰 (サブステップ長と設定から求める)
+		std::vector<float> linearDampingScale;
+		std::vector<float> angularDampingScale;
+
+		// 積分する剛体 (起きている動的剛体) は全ビット 1、それ以外は 0
+		std::vector<uint32_t> simulate;
+
+		void Resize(size_t bodyCount);
+		void Clear();
+		void SetPose(size_t i, const DirectX::XMFLOAT3& p, const DirectX::XMFLOAT4& q);
+	};
+
 	struct JointConstraint
 	{
 		int bodyA{ -1 };
@@ -99,25 +182,81 @@ private:
 
 		DirectX::XMFLOAT3 positionSpring{};
 		DirectX::XMFLOAT3 rotationSpring{};
+	};
+
+	// SolveJoints が毎回読む値だけを、色順に並べた SoA。
+	// 同じ色のジョイントは動的剛体を共有しないので、色の中は並列に解ける
+	struct JointSlots
+	{
+		std::vector<uint32_t> bodyA;
+		std::vector<uint32_t> bodyB;
+		std::vector<int> island;
+		std::vector<DirectX::XMFLOAT3> localAnchorA;
+		std::vector<DirectX::XMFLOAT3> localAnchorB;
+		std::vector<DirectX::XMFLOAT4> rotAtoJ;
+		std::vector<DirectX::XMFLOAT4> rotBtoJ;
+		std::vector<DirectX::XMFLOAT3> rotLower;
+		std::vector<DirectX::XMFLOAT3> rotUpper;
+		std::vector<DirectX::XMFLOAT3> rotationSpring;
+		std::vector<float> lambdaPos;
+
+		size_t Size() const
+		{
+			return bodyA.size();
+		}
+		void Clear();
+		void Push(const JointConstraint& c, int islandIndex);
+	};
 
-		float lambdaPos{ 0.0f };
+	// ジョイントでつながった動的剛体のまとまり。島ごとに静止を判定して眠らせ、
+	// つながっている固定剛体 (アンカー) が動くか、起きている剛体と接触したら起こす
+	struct Island
+	{
+		std::vector<uint32_t> bodies;   // 動的剛体 (番号順)
+		std::vector<uint32_t> anchors;  // ジョイントでつながったボーン追従剛体
+		int sleepCounter{ 0 };
+		bool sleeping{ false };
+		bool wakeRequested{ false };
 	};
 
 	void BuildConstraints(const PmxModel& model);
+	void BuildIslands();
+	void BuildJointColors();
 	bool IsJointConnected(uint32_t a, uint32_t b) const;
+	void BuildCollisionFilters();
+	bool ShouldCollide(uint32_t a, uint32_t b) const;
 
 	void PrecomputeKinematicTargets(const PmxModel& model, const BoneSolver& bones);
+	void PrecomputeKinematicTargets(std::span<const DirectX::XMFLOAT4X4> boneGlobals);
+	void UpdateKinematicTarget(size_t bodyIndex, const DirectX::XMFLOAT4X4& boneGlobal);
+	void SimulateFixedStep(const PmxModel& model);
 	void InterpolateKinematicBodies(float t);
 
+	// 島ごとの眠りを更新する。どの島も起きておらず、ボーン追従剛体も動いていなければ true (この Tick は丸ごと省く)
+	bool UpdateIslandSleep();
+	void WakeIsland(int island);
+	void ApplyPendingWakes();
+	void RebuildActiveLists();
+	bool IsBodySleeping(size_t bodyIndex) const
+	{
+		const int island = m_bodyIsland[bodyIndex];
+		return island >= 0 && m_islands[static_cast<size_t>(island)].sleeping;
+	}
+
 	void BeginSubStep();
+	void UpdateDampingScales(float dt);
 	void Integrate(float dt, const PmxModel& model);
 	void SolveXPBD(float dt, const PmxModel& model);
 	void SolveBodyCollisions(float dt);
+	void SelectSweepAxis();
+	void WarmStartContacts(float warmStart);
+	uint32_t FindPair(uint32_t a, uint32_t b, uint32_t hint);
+	void RebuildPairTable();
 	void SolveGround(float dt, const PmxModel& model);
 	void SolveJoints(float dt);
+	void SolveJoint(uint32_t slot, float dt, float alphaPos);
 	void EndSubStep(float dt, const PmxModel& model);
 
-	void WriteBackBones(const PmxModel& model, BoneSolver& bones);
 	void BuildWriteBackOrder(const PmxModel& model);
 
 	static DirectX::XMVECTOR Load3(const DirectX::XMFLOAT3& v);
@@ -130,12 +269,14 @@ private:
 	DirectX::XMFLOAT3 ExtractTranslation(const DirectX::XMMATRIX& m);
 
 	Settings m_settings{};
+	TickProfile* m_profile{ nullptr };
 
 	bool m_isBuilt{ false };
 	uint64_t m_builtRevision{ 0 };
 	double m_accumulator{ 0.0 };
 
 	std::vector<Body> m_bodies;
+	BodyState m_state;
 	std::vector<JointConstraint> m_joints;
 	std::vector<std::vector<uint32_t>> m_jointAdjacency;
 
@@ -143,10 +284,29 @@ private:
 	bool m_groupMaskIsCollisionMask{ true };
 
 	bool m_anyKinematicMovedThisTick{ false };
-	int  m_sleepCounter{ 0 };
-	bool m_worldSleeping{ false };
 
-	bool ShouldSkipPhysicsTick();
+	std::vector<Island> m_islands;
+	std::vector<int> m_bodyIsland;              // 剛体 → 島 (ボーン追従剛体は -1)
+	std::vector<int> m_jointIsland;             // ジョイント → 島 (動的剛体を含まなければ -1)
+	std::vector<uint8_t> m_kinematicMoved;      // この Tick で目標が動いたボーン追従剛体
+	std::vector<uint8_t> m_bodyActive;          // 起きている動的剛体と、動いたボーン追従剛体
+	std::vector<uint32_t> m_simBodies;          // サブステップで回す剛体 (ボーン追従剛体 + 起きている動的剛体、番号順)
+	std::vector<uint32_t> m_simBlocks;          // 起きている動的剛体を含む 4 剛体の組 (先頭の剛体番号)
+
+	// m_state の減衰を求めたときのサブステップ長と下限 (変わったら求め直す)
+	float m_dampingDt{ -1.0f };
+	float m_dampingMinLinear{ 0.0f };
+	float m_dampingMinAngular{ 0.0f };
+
+	// 色 c のジョイントは m_jointSlots の [m_jointColorOffsets[c], m_jointColorOffsets[c + 1])
+	JointSlots m_jointSlots;
+	std::vector<uint32_t> m_jointColorOffsets;
+	std::vector<uint32_t> m_activeJointSlots;   // 起きている島のジョイント (色順)
+	std::vector<uint32_t> m_activeColorOffsets; // m_activeJointSlots を色ごとに区切る
+	std::vector<uint32_t> m_colorOrder;         // 色を解く順 (順序固定でなければ反復ごとに並べ替える)
+	std::minstd_rand m_colorShuffle;
+	uint32_t m_awakeDynamicBodies{ 0 };
+	bool m_wakePending{ false };
 
 	struct CollisionShapeCache
 	{
@@ -159,24 +319,45 @@ private:
 	};
 	std::vector<CollisionShapeCache> m_shapeCache;
 
-	// 物理演算用ワークバッファ（毎回確保しないようにメンバ化）
-
-	struct SapPair
+	// 衝突グループの判定に使うビット (読み込み時に剛体ごとに求める)。
+	// グループ番号が範囲外の剛体は collideAll で何とでも当たる
+	struct CollisionFilter
 	{
-		int a; int b;
+		uint16_t groupBit;
+		uint16_t collidesWith;
+		bool collideAll;
 	};
-	std::vector<SapPair> m_candidates;
+	std::vector<CollisionFilter> m_collisionFilters;
 
-	// SAP用バッファ
+	// 境界球が重なり、衝突グループでも当たる剛体の組。重なっている間はサブステップをまたいで残し、
+	// 関節でつながっているかは組ができたときに一度だけ調べる
+	struct ContactPair
+	{
+		uint32_t a; uint32_t b;      // a < b
+		DirectX::XMFLOAT3 normal;    // 最後に当たったときの法線 (A → B)
+		float lambda;                // 最後に当たったサブステップで押し戻した量の合計
+		bool filtered;               // 関節でつながっていて除外される組
+		bool touching;               // 直前のサブステップで当たった
+	};
+	std::vector<ContactPair> m_pairs;
+	std::vector<ContactPair> m_nextPairs;
+	std::vector<uint32_t> m_pairTable;      // (a, b) → m_pairs の添字 (開番地法、空きは UINT32_MAX)
+	bool m_pairTableValid{ false };         // m_pairTable が今の m_pairs を指しているか
+	std::vector<uint32_t> m_candidates;     // narrow phase で調べる m_pairs の添字
+	bool m_pairsCollideJointConnected{ false };
+
+	// SAP用バッファ。m_sapAxis (0=X, 1=Y, 2=Z) に沿って区間の下端で並べる
 	struct SapNode
 	{
-		float minX; int index;
+		float min; int index;
 	};
 	std::vector<SapNode> m_axisList;
 	std::vector<float> m_radii;
-	std::vector<float> m_maxXs;
+	std::vector<float> m_axisMax;
 	std::vector<int> m_bodyToAxisIndex;
 	bool m_axisListInitialized{ false };
+	int m_sapAxis{ 0 };
+	uint32_t m_sapAxisCheckCountdown{ 0 };
 
 	std::vector<int> m_writeBackOrder;
 	std::vector<uint8_t> m_keepTranslationFlags;
@@ -186,4 +367,6 @@ private:
 	std::vector<uint8_t> m_hasAppliedGlobal;
 	std::vector<DirectX::XMFLOAT3> m_originalLocalTranslation;
 	bool m_writebackFallbackNoAfterPhysics{ false };
+	std::vector<DirectX::XMFLOAT3> m_writeBackPositions;   // Step で書き戻す剛体の姿勢
+	std::vector<DirectX::XMFLOAT4> m_writeBackRotations;
 };
\ No newline at end of file
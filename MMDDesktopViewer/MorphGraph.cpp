@@ -0,0 +1,389 @@
+﻿#include "MorphGraph.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// これより小さいウェイトは 0 とみなす (VertexMorpher と同じ閾値)
+	constexpr float WeightEpsilon = 0.0001f;
+
+	// グループ展開の状態
+	constexpr std::uint8_t GroupUnvisited = 0;
+	constexpr std::uint8_t GroupExpanding = 1;
+	constexpr std::uint8_t GroupFlattened = 2;
+
+	using MorphType = PmxModel::Morph::Type;
+}
+
+void MorphGraph::Initialize(const PmxModel* model)
+{
+	m_types.clear();
+	m_termOffsets.clear();
+	m_terms.clear();
+	m_flipOffsets.clear();
+	m_flipChildren.clear();
+	m_boneTargets.clear();
+	m_boneEntryOffsets.clear();
+	m_boneEntries.clear();
+	m_materialEntryOffsets.clear();
+	m_materialEntries.clear();
+	m_impulseOffsets.clear();
+	m_impulseEntries.clear();
+	m_weights.clear();
+	m_active.clear();
+	m_isActive.clear();
+	m_flipEvaluated.clear();
+	m_activeBoneMorphs = 0;
+	m_activeImpulseMorphs = 0;
+	m_boneOffsets.clear();
+	m_impulses.clear();
+
+	if (!model) return;
+
+	const auto& morphs = model->Morphs();
+	const auto morphCount = static_cast<std::uint32_t>(morphs.size());
+	const size_t boneCount = model->Bones().size();
+	const size_t materialCount = model->Materials().size();
+	const size_t rigidBodyCount = model->RigidBodies().size();
+
+	m_types.resize(morphCount);
+	for (std::uint32_t i = 0; i < morphCount; ++i)
+	{
+		m_types[i] = morphs[i].type;
+	}
+
+	// グループを末端 (とフリップ) の一次結合に展開する。
+	// 子のグループを先に展開しておき (深さ優先の帰りがけ順)、親はその結果を倍して足すだけにする。
+	// 経路ごとにたどり直すと入れ子の多いモデルで項が指数的に増えるため。展開中のグループへの参照 (循環) は無視する
+	std::vector<std::uint8_t> state(morphCount, GroupUnvisited);
+	std::vector<std::vector<Term>> flattened(morphCount);
+	{
+		struct Frame
+		{
+			std::uint32_t morphIndex;
+			size_t nextChild;
+		};
+		std::vector<Frame> stack;
+		for (std::uint32_t root = 0; root < morphCount; ++root)
+		{
+			if (m_types[root] != MorphType::Group || state[root] != GroupUnvisited) continue;
+
+			state[root] = GroupExpanding;
+			stack.push_back({ root, 0 });
+			while (!stack.empty())
+			{
+				Frame& frame = stack.back();
+				const auto& offsets = morphs[frame.morphIndex].groupOffsets;
+				if (frame.nextChild < offsets.size())
+				{
+					const std::int32_t child = offsets[frame.nextChild++].morphIndex;
+					if (child >= 0 && child < static_cast<std::int32_t>(morphCount) &&
+						m_types[static_cast<size_t>(child)] == MorphType::Group &&
+						state[static_cast<size_t>(child)] == GroupUnvisited)
+					{
+						state[static_cast<size_t>(child)] = GroupExpanding;
+						stack.push_back({ static_cast<std::uint32_t>(child), 0 });
+					}
+					continue;
+				}
+
+				const std::uint32_t morphIndex = frame.morphIndex;
+				FlattenGroup(*model, morphIndex, state, flattened, flattened[morphIndex]);
+				state[morphIndex] = GroupFlattened;
+				stack.pop_back();
+			}
+		}
+	}
+
+	m_termOffsets.reserve(morphCount + 1);
+	m_termOffsets.push_back(0);
+	for (std::uint32_t i = 0; i < morphCount; ++i)
+	{
+		if (m_types[i] != MorphType::Group)
+		{
+			m_terms.push_back({ i, 1.0f });
+		}
+		else
+		{
+			m_terms.insert(m_terms.end(), flattened[i].begin(), flattened[i].end());
+		}
+		m_termOffsets.push_back(static_cast<std::uint32_t>(m_terms.size()));
+	}
+
+	// フリップの候補
+	m_flipOffsets.reserve(morphCount + 1);
+	m_flipOffsets.push_back(0);
+	for (std::uint32_t i = 0; i < morphCount; ++i)
+	{
+		if (m_types[i] == MorphType::Flip)
+		{
+			for (const auto& fo : morphs[i].flipOffsets)
+			{
+				if (fo.morphIndex < 0 || fo.morphIndex >= static_cast<std::int32_t>(morphCount)) continue;
+				m_flipChildren.push_back({ static_cast<std::uint32_t>(fo.morphIndex), fo.weight });
+			}
+		}
+		m_flipOffsets.push_back(static_cast<std::uint32_t>(m_flipChildren.size()));
+	}
+
+	// ボーン → モーフ (同じボーン内はモーフ番号の昇順)
+	struct BoneItem
+	{
+		std::uint32_t boneIndex;
+		BoneEntry entry;
+	};
+	std::vector<BoneItem> boneItems;
+	for (std::uint32_t i = 0; i < morphCount; ++i)
+	{
+		if (m_types[i] != MorphType::Bone) continue;
+		for (const auto& bo : morphs[i].boneOffsets)
+		{
+			if (bo.boneIndex < 0 || static_cast<size_t>(bo.boneIndex) >= boneCount) continue;
+			boneItems.push_back({ static_cast<std::uint32_t>(bo.boneIndex), { i, bo.translation, bo.rotation } });
+		}
+	}
+	std::stable_sort(boneItems.begin(), boneItems.end(),
+					 [](const BoneItem& a, const BoneItem& b) { return a.boneIndex < b.boneIndex; });
+	for (const auto& item : boneItems)
+	{
+		if (m_boneTargets.empty() || m_boneTargets.back() != item.boneIndex)
+		{
+			m_boneTargets.push_back(item.boneIndex);
+			m_boneEntryOffsets.push_back(static_cast<std::uint32_t>(m_boneEntries.size()));
+		}
+		m_boneEntries.push_back(item.entry);
+	}
+	m_boneEntryOffsets.push_back(static_cast<std::uint32_t>(m_boneEntries.size()));
+
+	// 材質 → モーフ。数えてから詰めるので、各材質の中はモーフ番号の昇順になる
+	m_materialEntryOffsets.assign(materialCount + 1, 0);
+	auto forEachMaterialOffset = [&](auto&& fn) {
+		for (std::uint32_t i = 0; i < morphCount; ++i)
+		{
+			if (m_types[i] != MorphType::Material) continue;
+			for (const auto& mo : morphs[i].materialOffsets)
+			{
+				if (mo.materialIndex == -1)
+				{
+					for (size_t mi = 0; mi < materialCount; ++mi) fn(mi, i, mo);
+				}
+				else if (mo.materialIndex >= 0 && static_cast<size_t>(mo.materialIndex) < materialCount)
+				{
+					fn(static_cast<size_t>(mo.materialIndex), i, mo);
+				}
+			}
+		}
+		};
+	forEachMaterialOffset([&](size_t mi, std::uint32_t, const PmxModel::Morph::MaterialOffset&) {
+		++m_materialEntryOffsets[mi + 1];
+		});
+	for (size_t mi = 0; mi < materialCount; ++mi)
+	{
+		m_materialEntryOffsets[mi + 1] += m_materialEntryOffsets[mi];
+	}
+	m_materialEntries.resize(m_materialEntryOffsets.back());
+	{
+		std::vector<std::uint32_t> cursor(m_materialEntryOffsets.begin(), m_materialEntryOffsets.end() - 1);
+		forEachMaterialOffset([&](size_t mi, std::uint32_t morphIndex, const PmxModel::Morph::MaterialOffset& mo) {
+			m_materialEntries[cursor[mi]++] = { morphIndex, &mo };
+			});
+	}
+
+	// インパルス
+	m_impulseOffsets.reserve(morphCount + 1);
+	m_impulseOffsets.push_back(0);
+	for (std::uint32_t i = 0; i < morphCount; ++i)
+	{
+		if (m_types[i] == MorphType::Impulse)
+		{
+			for (const auto& io : morphs[i].impulseOffsets)
+			{
+				if (io.rigidBodyIndex < 0 || static_cast<size_t>(io.rigidBodyIndex) >= rigidBodyCount) continue;
+				m_impulseEntries.push_back({ static_cast<std::uint32_t>(io.rigidBodyIndex), io.localFlag != 0,
+											 io.velocity, io.torque });
+			}
+		}
+		m_impulseOffsets.push_back(static_cast<std::uint32_t>(m_impulseEntries.size()));
+	}
+
+	m_weights.assign(morphCount, 0.0f);
+	m_isActive.assign(morphCount, 0);
+	m_flipEvaluated.assign(morphCount, 0);
+}
+
+void MorphGraph::FlattenGroup(const PmxModel& model, std::uint32_t morphIndex, const std::vector<std::uint8_t>& state,
+							  const std::vector<std::vector<Term>>& flattened, std::vector<Term>& out) const
+{
+	const auto morphCount = static_cast<std::int32_t>(m_types.size());
+	out.clear();
+	for (const auto& go : model.Morphs()[morphIndex].groupOffsets)
+	{
+		if (go.morphIndex < 0 || go.morphIndex >= morphCount) continue;
+		const auto child = static_cast<std::uint32_t>(go.morphIndex);
+
+		if (m_types[child] != MorphType::Group)
+		{
+			out.push_back({ child, go.weight });
+		}
+		else if (state[child] == GroupFlattened)
+		{
+			for (const auto& term : flattened[child])
+			{
+				out.push_back({ term.target, term.factor * go.weight });
+			}
+		}
+		// 展開中のグループ (自分自身を含む) は循環している参照なので無視
+	}
+
+	// 同じモーフに複数の経路で届く分はまとめる
+	std::stable_sort(out.begin(), out.end(), [](const Term& a, const Term& b) { return a.target < b.target; });
+	size_t merged = 0;
+	for (size_t i = 0; i < out.size(); ++i)
+	{
+		if (merged > 0 && out[merged - 1].target == out[i].target)
+		{
+			out[merged - 1].factor += out[i].factor;
+		}
+		else
+		{
+			out[merged++] = out[i];
+		}
+	}
+	out.resize(merged);
+}
+
+void MorphGraph::AddWeight(std::uint32_t morphIndex, float weight)
+{
+	if (!m_isActive[morphIndex])
+	{
+		m_isActive[morphIndex] = 1;
+		m_active.push_back(morphIndex);
+	}
+	m_weights[morphIndex] += weight;
+}
+
+void MorphGraph::Evaluate(const DensePose& pose)
+{
+	for (const auto index : m_active)
+	{
+		m_weights[index] = 0.0f;
+		m_isActive[index] = 0;
+		m_flipEvaluated[index] = 0;
+	}
+	m_active.clear();
+
+	const size_t n = std::min(m_weights.size(), pose.MorphCount());
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (!pose.hasMorphWeight[i]) continue;
+		const float w = pose.morphWeights[i];
+		if (std::abs(w) <= WeightEpsilon) continue;
+
+		for (std::uint32_t t = m_termOffsets[i]; t < m_termOffsets[i + 1]; ++t)
+		{
+			AddWeight(m_terms[t].target, w * m_terms[t].factor);
+		}
+	}
+
+	// フリップは足し終わったウェイトで候補を選ぶ。
+	// 選んだ候補がさらにフリップのこともあるので、増えていく m_active を末尾まで見る
+	for (size_t k = 0; k < m_active.size(); ++k)
+	{
+		const auto index = m_active[k];
+		if (m_types[index] == MorphType::Flip && !m_flipEvaluated[index])
+		{
+			EvaluateFlip(index);
+		}
+	}
+
+	m_activeBoneMorphs = 0;
+	m_activeImpulseMorphs = 0;
+	for (const auto index : m_active)
+	{
+		if (std::abs(m_weights[index]) <= WeightEpsilon) continue;
+		if (m_types[index] == MorphType::Bone) ++m_activeBoneMorphs;
+		else if (m_types[index] == MorphType::Impulse) ++m_activeImpulseMorphs;
+	}
+
+	EvaluateBoneOffsets();
+	EvaluateImpulses();
+}
+
+void MorphGraph::EvaluateFlip(std::uint32_t flipIndex)
+{
+	m_flipEvaluated[flipIndex] = 1;
+
+	// ウェイトを (候補数 + 1) 等分し、いちばん下の区間は何も選ばない。
+	// 選んだ候補には、ウェイトの大きさによらず候補自身のウェイトを掛ける
+	const std::uint32_t begin = m_flipOffsets[flipIndex];
+	const std::uint32_t end = m_flipOffsets[flipIndex + 1];
+	if (begin == end) return;
+
+	const float w = m_weights[flipIndex];
+	if (w <= WeightEpsilon) return;
+
+	const auto count = static_cast<int>(end - begin);
+	const int selected = std::min(static_cast<int>(static_cast<float>(count + 1) * w) - 1, count - 1);
+	if (selected < 0) return;
+
+	const Term& child = m_flipChildren[begin + selected];
+	for (std::uint32_t t = m_termOffsets[child.target]; t < m_termOffsets[child.target + 1]; ++t)
+	{
+		AddWeight(m_terms[t].target, child.factor * m_terms[t].factor);
+	}
+}
+
+void MorphGraph::EvaluateBoneOffsets()
+{
+	m_boneOffsets.clear();
+	if (m_activeBoneMorphs == 0) return;
+
+	const XMVECTOR identity = XMQuaternionIdentity();
+	for (size_t k = 0; k < m_boneTargets.size(); ++k)
+	{
+		XMVECTOR t = XMVectorZero();
+		XMVECTOR q = identity;
+		bool any = false;
+		for (std::uint32_t e = m_boneEntryOffsets[k]; e < m_boneEntryOffsets[k + 1]; ++e)
+		{
+			const auto& entry = m_boneEntries[e];
+			const float w = m_weights[entry.morphIndex];
+			if (std::abs(w) <= WeightEpsilon) continue;
+
+			t = XMVectorAdd(t, XMVectorScale(XMLoadFloat3(&entry.translation), w));
+			q = XMQuaternionMultiply(q, XMQuaternionSlerp(identity, XMQuaternionNormalize(XMLoadFloat4(&entry.rotation)), w));
+			any = true;
+		}
+		if (!any) continue;
+
+		BoneLocalOffset offset;
+		offset.boneIndex = m_boneTargets[k];
+		XMStoreFloat3(&offset.translation, t);
+		XMStoreFloat4(&offset.rotation, XMQuaternionNormalize(q));
+		m_boneOffsets.push_back(offset);
+	}
+}
+
+void MorphGraph::EvaluateImpulses()
+{
+	m_impulses.clear();
+	if (m_activeImpulseMorphs == 0) return;
+
+	for (const auto index : m_active)
+	{
+		if (m_types[index] != MorphType::Impulse) continue;
+		const float w = m_weights[index];
+		if (std::abs(w) <= WeightEpsilon) continue;
+
+		for (std::uint32_t e = m_impulseOffsets[index]; e < m_impulseOffsets[index + 1]; ++e)
+		{
+			Impulse impulse = m_impulseEntries[e];
+			impulse.velocity = { impulse.velocity.x * w, impulse.velocity.y * w, impulse.velocity.z * w };
+			impulse.torque = { impulse.torque.x * w, impulse.torque.y * w, impulse.torque.z * w };
+			m_impulses.push_back(impulse);
+		}
+	}
+}
@@ -0,0 +1,140 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <DirectXMath.h>
+#include "BoneSolver.hpp"
+#include "PmxModel.hpp"
+
+// モーフの依存関係 (グループ・フリップ) を読み込み時に展開しておき、
+// 毎フレームはポーズのウェイトから実際に効く末端モーフ (頂点/UV/ボーン/材質/インパルス) のウェイトを一度に求める。
+// 対象ごとの索引 (ボーン → モーフ、材質 → モーフ) も作っておくので、
+// 反映側は効いているモーフに触れる分だけ見ればよい。
+class MorphGraph
+{
+public:
+	// 材質モーフの 1 要素。materialIndex が -1 (全材質) のものは各材質に展開済み
+	struct MaterialEntry
+	{
+		std::uint32_t morphIndex{};
+		const PmxModel::Morph::MaterialOffset* offset{};
+	};
+
+	// インパルスモーフの 1 要素 (速度・トルクはウェイトを掛けたもの)
+	struct Impulse
+	{
+		std::uint32_t rigidBodyIndex{};
+		bool local{ false };
+		DirectX::XMFLOAT3 velocity{};
+		DirectX::XMFLOAT3 torque{};
+	};
+
+	MorphGraph() = default;
+
+	// model は MorphGraph より長く生きていること (材質モーフの要素を指す)
+	void Initialize(const PmxModel* model);
+
+	// ポーズのモーフウェイトを展開し、末端モーフのウェイトとボーンのずれを求める
+	void Evaluate(const DensePose& pose);
+
+	size_t MorphCount() const
+	{
+		return m_weights.size();
+	}
+	// モーフ番号で引く実効ウェイト (グループ/フリップ展開済み)。
+	// グループ自身は 0、フリップには候補を選ぶのに使ったウェイトが入る
+	const std::vector<float>& Weights() const
+	{
+		return m_weights;
+	}
+	// 直前の Evaluate でウェイトが 0 でないモーフ (末端とフリップ)
+	const std::vector<std::uint32_t>& ActiveMorphs() const
+	{
+		return m_active;
+	}
+
+	// ボーンモーフを合成したずれ (ボーン番号の昇順)。BoneSolver::ApplyPose に渡す
+	const std::vector<BoneLocalOffset>& BoneOffsets() const
+	{
+		return m_boneOffsets;
+	}
+
+	// 材質ごとに、効きうる材質モーフの要素 (モーフ番号の昇順 = 適用順)
+	std::span<const MaterialEntry> MaterialEntries(size_t materialIndex) const
+	{
+		if (materialIndex + 1 >= m_materialEntryOffsets.size()) return {};
+		return std::span<const MaterialEntry>(m_materialEntries.data() + m_materialEntryOffsets[materialIndex],
+											  m_materialEntries.data() + m_materialEntryOffsets[materialIndex + 1]);
+	}
+
+	// 全材質の要素数の合計 (MaterialEntries を材質順につなげた長さ)
+	size_t MaterialEntryCount() const
+	{
+		return m_materialEntries.size();
+	}
+
+	// 直前の Evaluate で効いているインパルスモーフの要素
+	const std::vector<Impulse>& Impulses() const
+	{
+		return m_impulses;
+	}
+
+private:
+	// 展開後の 1 項: ソースのウェイト × factor が target に足される
+	struct Term
+	{
+		std::uint32_t target{};
+		float factor{};
+	};
+
+	struct BoneEntry
+	{
+		std::uint32_t morphIndex{};
+		DirectX::XMFLOAT3 translation{};
+		DirectX::XMFLOAT4 rotation{ 0.0f, 0.0f, 0.0f, 1.0f };
+	};
+
+	// 子のグループがすべて展開済み (または展開中 = 循環) のときに、グループ 1 つ分の項を作る
+	void FlattenGroup(const PmxModel& model, std::uint32_t morphIndex, const std::vector<std::uint8_t>& state,
+					  const std::vector<std::vector<Term>>& flattened, std::vector<Term>& out) const;
+	void AddWeight(std::uint32_t morphIndex, float weight);
+	void EvaluateFlip(std::uint32_t flipIndex);
+	void EvaluateBoneOffsets();
+	void EvaluateImpulses();
+
+	std::vector<PmxModel::Morph::Type> m_types;
+
+	// ソースモーフ i の展開結果は m_terms[m_termOffsets[i] .. m_termOffsets[i + 1])。
+	// 末端モーフは自分自身、グループは末端とフリップの一次結合
+	std::vector<std::uint32_t> m_termOffsets;
+	std::vector<Term> m_terms;
+
+	// フリップモーフ i の候補は m_flipChildren[m_flipOffsets[i] .. m_flipOffsets[i + 1])。
+	// factor は候補自身のウェイト
+	std::vector<std::uint32_t> m_flipOffsets;
+	std::vector<Term> m_flipChildren;
+
+	// ボーン → モーフ。m_boneTargets[k] のボーンは m_boneEntries[m_boneEntryOffsets[k] .. m_boneEntryOffsets[k + 1])
+	std::vector<std::uint32_t> m_boneTargets;
+	std::vector<std::uint32_t> m_boneEntryOffsets;
+	std::vector<BoneEntry> m_boneEntries;
+
+	// 材質 → モーフ
+	std::vector<std::uint32_t> m_materialEntryOffsets;
+	std::vector<MaterialEntry> m_materialEntries;
+
+	// インパルスモーフ i の要素は m_impulseEntries[m_impulseOffsets[i] .. m_impulseOffsets[i + 1])
+	std::vector<std::uint32_t> m_impulseOffsets;
+	std::vector<Impulse> m_impulseEntries;
+
+	std::vector<float> m_weights;
+	std::vector<std::uint32_t> m_active;
+	std::vector<std::uint8_t> m_isActive;
+	std::vector<std::uint8_t> m_flipEvaluated;
+	std::uint32_t m_activeBoneMorphs{ 0 };
+	std::uint32_t m_activeImpulseMorphs{ 0 };
+
+	std::vector<BoneLocalOffset> m_boneOffsets;
+	std::vector<Impulse> m_impulses;
+};
@@ -0,0 +1,136 @@
+﻿#include "MotionCurve.hpp"
+
+using namespace DirectX;
+
+namespace
+{
+	constexpr int NewtonIterations = 4;
+	// ニュートン法の解を採用する条件。傾きが小さい所では x の誤差が s の大きな誤差になるので二分法に任せる。
+	constexpr float MaxResidual = 1.0e-6f;
+	constexpr float MinSlope = 0.05f;
+
+	void ComputeCoefficients(float p1, float p2, float& a, float& b, float& c)
+	{
+		// B(s) = 3(1-s)^2 s p1 + 3(1-s) s^2 p2 + s^3 を s の多項式に展開
+		c = 3.0f * p1;
+		b = 3.0f * (p2 - p1) - c;
+		a = 1.0f - c - b;
+	}
+}
+
+MotionCurve::MotionCurve(const std::uint8_t x1[4], const std::uint8_t y1[4],
+						 const std::uint8_t x2[4], const std::uint8_t y2[4])
+{
+	float ax[4], bx[4], cx[4], ay[4], by[4], cy[4];
+	float fx1[4], fy1[4], fx2[4], fy2[4];
+
+	m_linearMask = 0;
+	for (int ch = 0; ch < 4; ++ch)
+	{
+		fx1[ch] = x1[ch] / 127.0f;
+		fy1[ch] = y1[ch] / 127.0f;
+		fx2[ch] = x2[ch] / 127.0f;
+		fy2[ch] = y2[ch] / 127.0f;
+		ComputeCoefficients(fx1[ch], fx2[ch], ax[ch], bx[ch], cx[ch]);
+		ComputeCoefficients(fy1[ch], fy2[ch], ay[ch], by[ch], cy[ch]);
+
+		if (x1[ch] == y1[ch] && x2[ch] == y2[ch]) m_linearMask |= 1u << ch;
+	}
+
+	auto store = [](XMFLOAT4A& dst, const float (&src)[4]) {
+		dst = XMFLOAT4A(src[0], src[1], src[2], src[3]);
+		};
+	store(m_ax, ax); store(m_bx, bx); store(m_cx, cx);
+	store(m_ay, ay); store(m_by, by); store(m_cy, cy);
+	store(m_x1, fx1); store(m_y1, fy1); store(m_x2, fx2); store(m_y2, fy2);
+}
+
+float MotionCurve::EvaluateBisection(float t, float x1, float y1, float x2, float y2)
+{
+	if (t <= 0.0f) return 0.0f;
+	if (t >= 1.0f) return 1.0f;
+
+	auto cubic = [](float p0, float p1, float p2, float p3, float s) {
+		float inv = 1.0f - s;
+		return inv * inv * inv * p0 + 3.0f * inv * inv * s * p1 + 3.0f * inv * s * s * p2 + s * s * s * p3;
+		};
+
+	float low = 0.0f, high = 1.0f, s = t;
+	for (int i = 0; i < 15; ++i)
+	{
+		s = 0.5f * (low + high);
+		float x = cubic(0.0f, x1, x2, 1.0f, s);
+		if (x < t)
+			low = s;
+		else
+			high = s;
+	}
+
+	return cubic(0.0f, y1, y2, 1.0f, s);
+}
+
+XMVECTOR XM_CALLCONV MotionCurve::Evaluate(float t) const
+{
+	if (t <= 0.0f) return XMVectorZero();
+	if (t >= 1.0f) return XMVectorSplatOne();
+
+	const XMVECTOR vt = XMVectorReplicate(t);
+	if (m_linearMask == 0xF) return vt;
+
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR one = XMVectorSplatOne();
+	const XMVECTOR ax = XMLoadFloat4A(&m_ax);
+	const XMVECTOR bx = XMLoadFloat4A(&m_bx);
+	const XMVECTOR cx = XMLoadFloat4A(&m_cx);
+	// x'(s) = (3ax * s + 2bx) * s + cx
+	const XMVECTOR dax = XMVectorMultiply(ax, XMVectorReplicate(3.0f));
+	const XMVECTOR dbx = XMVectorAdd(bx, bx);
+
+	XMVECTOR s = vt;
+	XMVECTOR x = zero;
+	XMVECTOR dx = one;
+	for (int i = 0; i < NewtonIterations; ++i)
+	{
+		x = XMVectorMultiply(XMVectorMultiplyAdd(XMVectorMultiplyAdd(ax, s, bx), s, cx), s);
+		dx = XMVectorMultiplyAdd(XMVectorMultiplyAdd(dax, s, dbx), s, cx);
+
+		// 傾きがほぼ 0 のレーンは動かさない (最後の判定で二分法に回る)
+		XMVECTOR step = XMVectorDivide(XMVectorSubtract(x, vt), dx);
+		step = XMVectorSelect(step, zero, XMVectorLess(XMVectorAbs(dx), XMVectorReplicate(1.0e-6f)));
+		s = XMVectorClamp(XMVectorSubtract(s, step), zero, one);
+	}
+	x = XMVectorMultiply(XMVectorMultiplyAdd(XMVectorMultiplyAdd(ax, s, bx), s, cx), s);
+	dx = XMVectorMultiplyAdd(XMVectorMultiplyAdd(dax, s, dbx), s, cx);
+
+	const XMVECTOR rejected = XMVectorOrInt(
+		XMVectorGreaterOrEqual(XMVectorAbs(XMVectorSubtract(x, vt)), XMVectorReplicate(MaxResidual)),
+		XMVectorLess(dx, XMVectorReplicate(MinSlope)));
+
+	const XMVECTOR ay = XMLoadFloat4A(&m_ay);
+	const XMVECTOR by = XMLoadFloat4A(&m_by);
+	const XMVECTOR cy = XMLoadFloat4A(&m_cy);
+	XMVECTOR y = XMVectorMultiply(XMVectorMultiplyAdd(XMVectorMultiplyAdd(ay, s, by), s, cy), s);
+
+	const XMVECTOR linear = XMVectorSelectControl(
+		m_linearMask & 1u, (m_linearMask >> 1) & 1u, (m_linearMask >> 2) & 1u, (m_linearMask >> 3) & 1u);
+
+	if (!XMVector4EqualInt(XMVectorAndCInt(rejected, linear), zero))
+	{
+		// 平坦な区間を含む曲線だけ従来の二分法で求める
+		const XMVECTOR x1 = XMLoadFloat4A(&m_x1);
+		const XMVECTOR y1 = XMLoadFloat4A(&m_y1);
+		const XMVECTOR x2 = XMLoadFloat4A(&m_x2);
+		const XMVECTOR y2 = XMLoadFloat4A(&m_y2);
+		for (size_t ch = 0; ch < 4; ++ch)
+		{
+			if (((m_linearMask >> ch) & 1u) != 0 || XMVectorGetIntByIndex(rejected, ch) == 0) continue;
+
+			const float v = EvaluateBisection(t,
+											  XMVectorGetByIndex(x1, ch), XMVectorGetByIndex(y1, ch),
+											  XMVectorGetByIndex(x2, ch), XMVectorGetByIndex(y2, ch));
+			y = XMVectorSetByIndex(y, v, ch);
+		}
+	}
+
+	return XMVectorSelect(y, vt, linear);
+}
@@ -0,0 +1,34 @@
+﻿#pragma once
+#include <cstdint>
+#include <DirectXMath.h>
+
+// VMD の補間曲線 1 キー分 (X/Y/Z/回転 の 4 チャンネル) を評価用に前計算したもの。
+// 制御点 (0..127) から多項式の係数を求めておき、x(s) = t となる s をニュートン法で解いて y(s) を返す。
+// 4 チャンネルは SIMD の各レーンとしてまとめて評価する。
+class MotionCurve
+{
+public:
+	MotionCurve() = default;
+	MotionCurve(const std::uint8_t x1[4], const std::uint8_t y1[4],
+				const std::uint8_t x2[4], const std::uint8_t y2[4]);
+
+	// t (0..1) に対する各チャンネルの補間係数 (x:X y:Y z:Z w:回転)
+	DirectX::XMVECTOR XM_CALLCONV Evaluate(float t) const;
+
+	// 全チャンネルが直線 (x1 == y1 かつ x2 == y2) なら係数は t そのもの
+	bool IsLinear() const
+	{
+		return m_linearMask == 0xF;
+	}
+
+	// 従来の 15 回の二分法による評価 (収束しないレーンの代替と、検証・ベンチマーク用)
+	static float EvaluateBisection(float t, float x1, float y1, float x2, float y2);
+
+private:
+	// x(s) = ((ax * s + bx) * s + cx) * s、y(s) も同様
+	DirectX::XMFLOAT4A m_ax{}, m_bx{}, m_cx{};
+	DirectX::XMFLOAT4A m_ay{}, m_by{}, m_cy{};
+	// 二分法に戻るときに使う元の制御点 (0..1)
+	DirectX::XMFLOAT4A m_x1{}, m_y1{}, m_x2{}, m_y2{};
+	std::uint32_t m_linearMask{ 0xF };
+};
@@ -47,9 +47,20 @@ cbuffer SceneCB : register(b0)
 
 cbuffer BoneCB : register(b2)
 {
-    float4x4 g_boneMatrices[1024];
+    float4x3 g_boneMatrices[1024];
 };
 
+float4x4 LoadBoneMatrix(int index)
+{
+    float4x3 m = g_boneMatrices[index];
+    return float4x4(
+        float4(m[0], 0.0),
+        float4(m[1], 0.0),
+        float4(m[2], 0.0),
+        float4(m[3], 1.0)
+    );
+}
+
 struct VSIn
 {
     float3 pos : POSITION;
@@ -86,22 +97,22 @@ float4x4 GetSkinMatrix(int4 indices, float4 weights)
 
     if (indices[0] >= 0 && indices[0] < 1024 && weights[0] > 0.0)
     {
-        skinMat += g_boneMatrices[indices[0]] * weights[0];
+        skinMat += LoadBoneMatrix(indices[0]) * weights[0];
         totalWeight += weights[0];
     }
     if (indices[1] >= 0 && indices[1] < 1024 && weights[1] > 0.0)
     {
-        skinMat += g_boneMatrices[indices[1]] * weights[1];
+        skinMat += LoadBoneMatrix(indices[1]) * weights[1];
         totalWeight += weights[1];
     }
     if (indices[2] >= 0 && indices[2] < 1024 && weights[2] > 0.0)
     {
-        skinMat += g_boneMatrices[indices[2]] * weights[2];
+        skinMat += LoadBoneMatrix(indices[2]) * weights[2];
         totalWeight += weights[2];
     }
     if (indices[3] >= 0 && indices[3] < 1024 && weights[3] > 0.0)
     {
-        skinMat += g_boneMatrices[indices[3]] * weights[3];
+        skinMat += LoadBoneMatrix(indices[3]) * weights[3];
         totalWeight += weights[3];
     }
 
@@ -194,10 +205,10 @@ void ApplySdefSkin(VSIn i, out float3 skinnedPos, out float3 skinnedNrm)
         w1 = 0.0;
     }
 
-    float4x4 matA4 = g_boneMatrices[idx0];
-    float4x4 matB4 = g_boneMatrices[idx1];
-    float3x3 matA = (float3x3) matA4;
-    float3x3 matB = (float3x3) matB4;
+    float4x4 matA4 = LoadBoneMatrix(idx0);
+    float4x4 matB4 = LoadBoneMatrix(idx1);
+    float3x3 matA = transpose((float3x3) matA4);
+    float3x3 matB = transpose((float3x3) matB4);
 
     float4 qa = QuaternionFromMatrix(matA);
     float4 qb = QuaternionFromMatrix(matB);
@@ -0,0 +1,162 @@
+﻿#include "PhysicsThread.hpp"
+#include "MmdPhysicsWorld.hpp"
+#include "JobSystem.hpp"
+#include <algorithm>
+
+using namespace DirectX;
+
+PhysicsThread::~PhysicsThread()
+{
+	Stop();
+}
+
+void PhysicsThread::Start(MmdPhysicsWorld& world, const PmxModel& model)
+{
+	Stop();
+
+	m_world = &world;
+	m_model = &model;
+
+	const auto& settings = world.GetSettings();
+	m_stepDuration = std::chrono::duration_cast<Clock::duration>(
+		std::chrono::duration<double>(std::max(settings.fixedTimeStep, 1.0e-4f)));
+	m_maxCatchUpSteps = std::max(1, settings.maxCatchUpSteps);
+
+	m_kinematicBones = world.KinematicBones();
+	m_inputs.Reset();
+	m_outputs.Reset();
+	m_receivedOutputs = 0;
+	m_stepCount.store(0, std::memory_order_relaxed);
+	m_stepNanoseconds.store(0, std::memory_order_relaxed);
+
+	m_stopRequested = false;
+	m_thread = std::thread([this] { Run(); });
+}
+
+void PhysicsThread::Stop()
+{
+	if (!m_thread.joinable()) return;
+	{
+		std::lock_guard<std::mutex> lock(m_stopMutex);
+		m_stopRequested = true;
+	}
+	m_stopCv.notify_all();
+	m_thread.join();
+	m_world = nullptr;
+	m_model = nullptr;
+}
+
+void PhysicsThread::Submit(const BoneSolver& bones, const std::vector<MorphGraph::Impulse>& impulses)
+{
+	if (!IsRunning()) return;
+
+	Input& input = m_inputs.WriteBuffer();
+	input.boneGlobals.resize(bones.BoneCount());
+	for (int boneIndex : m_kinematicBones)
+	{
+		if (static_cast<size_t>(boneIndex) >= input.boneGlobals.size()) continue;
+		input.boneGlobals[static_cast<size_t>(boneIndex)] = bones.GetBoneGlobalMatrix(static_cast<size_t>(boneIndex));
+	}
+	input.impulses.assign(impulses.begin(), impulses.end());
+	m_inputs.Publish();
+}
+
+bool PhysicsThread::WriteBack(const PmxModel& model, BoneSolver& bones)
+{
+	if (!IsRunning()) return false;
+
+	// 届いている最新のステップを受け取り、1 つ前のものと並べておく
+	if (m_outputs.Acquire())
+	{
+		std::swap(m_previous, m_latest);
+		const Output& received = m_outputs.ReadBuffer();
+		m_latest.positions.assign(received.positions.begin(), received.positions.end());
+		m_latest.rotations.assign(received.rotations.begin(), received.rotations.end());
+		m_latest.time = received.time;
+		m_receivedOutputs = std::min(m_receivedOutputs + 1, 2);
+	}
+	if (m_receivedOutputs == 0) return false;
+
+	if (m_receivedOutputs < 2 || m_previous.positions.size() != m_latest.positions.size())
+	{
+		m_world->WriteBackBones(model, bones, m_latest.positions, m_latest.rotations);
+		return true;
+	}
+
+	// 1 ステップ遅れの時刻を表示する。そうすれば普段は 2 つの姿勢の間に収まる
+	const Clock::time_point displayTime = Clock::now() - m_stepDuration;
+	const double span = std::chrono::duration<double>(m_latest.time - m_previous.time).count();
+	const double elapsed = std::chrono::duration<double>(displayTime - m_previous.time).count();
+	const float t = (span > 0.0) ? static_cast<float>(std::clamp(elapsed / span, 0.0, 1.0)) : 1.0f;
+
+	const size_t count = m_latest.positions.size();
+	m_blendPositions.resize(count);
+	m_blendRotations.resize(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const XMVECTOR p0 = XMLoadFloat3(&m_previous.positions[i]);
+		const XMVECTOR p1 = XMLoadFloat3(&m_latest.positions[i]);
+		XMStoreFloat3(&m_blendPositions[i], XMVectorLerp(p0, p1, t));
+
+		// ステップ間の回転は小さいので正規化線形補間で足りる
+		const XMVECTOR q0 = XMLoadFloat4(&m_previous.rotations[i]);
+		XMVECTOR q1 = XMLoadFloat4(&m_latest.rotations[i]);
+		if (XMVectorGetX(XMVector4Dot(q0, q1)) < 0.0f) q1 = XMVectorNegate(q1);
+		XMStoreFloat4(&m_blendRotations[i], XMQuaternionNormalize(XMVectorLerp(q0, q1, t)));
+	}
+
+	m_world->WriteBackBones(model, bones, m_blendPositions, m_blendRotations);
+	return true;
+}
+
+void PhysicsThread::Run()
+{
+	// 描画スレッドと同じキューを使うと、互いの待ち合わせ中に相手のジョブを実行してしまう
+	JobSystem::ExternalThreadScope jobScope(JobSystem::Shared());
+
+	Clock::time_point next = Clock::now();
+	bool hasInput = false;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_stopMutex);
+			if (m_stopCv.wait_until(lock, next, [this] { return m_stopRequested; })) break;
+		}
+
+		// 描画側からまだ何も届いていなければ、ボーン追従剛体の行き先がわからないので待つ
+		if (m_inputs.Acquire()) hasInput = true;
+		if (!hasInput)
+		{
+			next = Clock::now() + m_stepDuration;
+			continue;
+		}
+
+		// 新しい入力が届かなかったステップでも、前回の目標とインパルスをそのまま使う
+		const Input& input = m_inputs.ReadBuffer();
+		for (const auto& impulse : input.impulses)
+		{
+			m_world->ApplyImpulseMorph(impulse.rigidBodyIndex, impulse.velocity, impulse.torque, impulse.local);
+		}
+
+		const Clock::time_point begin = Clock::now();
+		m_world->StepFixed(*m_model, input.boneGlobals);
+		const Clock::time_point end = Clock::now();
+		m_stepCount.fetch_add(1, std::memory_order_relaxed);
+		m_stepNanoseconds.fetch_add(
+			static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()),
+			std::memory_order_relaxed);
+
+		next += m_stepDuration;
+
+		Output& output = m_outputs.WriteBuffer();
+		m_world->CopyBodyTransforms(output.positions, output.rotations);
+		output.time = next;
+		m_outputs.Publish();
+
+		// 計算が間に合わず遅れが maxCatchUpSteps ステップを超えたら、それより前の分は諦める
+		const Clock::time_point now = Clock::now();
+		const Clock::duration maxLag = m_stepDuration * m_maxCatchUpSteps;
+		if (now - next > maxLag) next = now - maxLag;
+	}
+}
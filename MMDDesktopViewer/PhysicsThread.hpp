@@ -0,0 +1,99 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <DirectXMath.h>
+#include "BoneSolver.hpp"
+#include "MorphGraph.hpp"
+#include "PmxModel.hpp"
+#include "TripleBuffer.hpp"
+
+class MmdPhysicsWorld;
+
+// MmdPhysicsWorld を専用スレッドで fixedTimeStep ごとに進める (PhysicsSettings::asyncPhysics)。
+// 描画側は Tick ごとに Submit でボーン追従剛体の目標を渡し、WriteBack で結果をボーンへ書き戻す。
+// 受け渡しはどちらも三重バッファなので、描画側が物理の計算を待つことはない。
+// 物理スレッドが回っている間、描画側は world の設定や剛体を変えてはいけない (変えるときは Stop してから)
+class PhysicsThread
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	PhysicsThread() = default;
+	~PhysicsThread();
+
+	PhysicsThread(const PhysicsThread&) = delete;
+	PhysicsThread& operator=(const PhysicsThread&) = delete;
+
+	// world は構築済みであること。world と model は Stop まで生きていること
+	void Start(MmdPhysicsWorld& world, const PmxModel& model);
+	void Stop();
+	bool IsRunning() const
+	{
+		return m_thread.joinable();
+	}
+
+	// 描画側: FK 後のボーン行列と、効いているインパルスモーフを物理スレッドへ渡す
+	void Submit(const BoneSolver& bones, const std::vector<MorphGraph::Impulse>& impulses);
+
+	// 描画側: 届いている直近 2 ステップの剛体姿勢を今の時刻で補間し、ボーンへ書き戻す。
+	// まだ 1 ステップも届いていなければ何もせず false
+	bool WriteBack(const PmxModel& model, BoneSolver& bones);
+
+	// 物理スレッドで進めたステップ数と、その計算にかかった時間の合計
+	std::uint64_t StepCount() const
+	{
+		return m_stepCount.load(std::memory_order_relaxed);
+	}
+	double StepSeconds() const
+	{
+		return static_cast<double>(m_stepNanoseconds.load(std::memory_order_relaxed)) * 1.0e-9;
+	}
+
+private:
+	// 描画側 → 物理スレッド
+	struct Input
+	{
+		std::vector<DirectX::XMFLOAT4X4> boneGlobals;   // ボーン番号で引く。ボーン追従剛体のボーンだけ埋める
+		std::vector<MorphGraph::Impulse> impulses;
+	};
+
+	// 物理スレッド → 描画側。time はこの姿勢が表す時刻 (ステップの終わり)
+	struct Output
+	{
+		std::vector<DirectX::XMFLOAT3> positions;
+		std::vector<DirectX::XMFLOAT4> rotations;
+		Clock::time_point time{};
+	};
+
+	void Run();
+
+	MmdPhysicsWorld* m_world{};
+	const PmxModel* m_model{};
+	Clock::duration m_stepDuration{};
+	int m_maxCatchUpSteps{ 1 };
+
+	std::thread m_thread;
+	std::mutex m_stopMutex;
+	std::condition_variable m_stopCv;
+	bool m_stopRequested{ false };
+
+	TripleBuffer<Input> m_inputs;
+	TripleBuffer<Output> m_outputs;
+	std::vector<int> m_kinematicBones;
+
+	// 描画側だけが触る。m_latest が最新、m_previous がその 1 つ前
+	Output m_previous;
+	Output m_latest;
+	int m_receivedOutputs{ 0 };
+	std::vector<DirectX::XMFLOAT3> m_blendPositions;
+	std::vector<DirectX::XMFLOAT4> m_blendRotations;
+
+	std::atomic<std::uint64_t> m_stepCount{ 0 };
+	std::atomic<std::uint64_t> m_stepNanoseconds{ 0 };
+};
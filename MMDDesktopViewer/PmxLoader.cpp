@@ -1,11 +1,16 @@
 #include "PmxLoader.hpp"
 #include "PmxModel.hpp"
 #include "BinaryReader.hpp"
+#include "PmxModelCache.hpp"
+#include "JobSystem.hpp"
 #include <limits>
 #include <stdexcept>
 #include <string>
 #include <algorithm>
 #include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
 
 namespace
 {
@@ -18,9 +23,134 @@ namespace
 			throw std::runtime_error(std::string("PMX truncated while reading ") + context);
 		}
 	}
+
+	// ͂ 1 Pʂ̒_
+	constexpr size_t VertexChunkSize = 4096;
+
+	size_t CheckedIndexSize(std::uint8_t size)
+	{
+		if (size != 1 && size != 2 && size != 4) throw std::runtime_error("Unsupported index size.");
+		return size;
+	}
+
+	void SkipPmxText(BinaryReader& br)
+	{
+		const auto len = br.Read<std::int32_t>();
+		if (len < 0) throw std::runtime_error("Negative string length.");
+		br.Skip(static_cast<size_t>(len));
+	}
+
+	// _ubNǂݔ΂Ȃ`N擪̃ItZbgL^ (EFCĝ݉ϒ)
+	void ScanVertexBlock(BinaryReader& br, const PmxModel::Header& header, size_t vertexCount,
+						 std::vector<size_t>& chunkOffsets)
+	{
+		const size_t bone = (vertexCount > 0) ? CheckedIndexSize(header.boneIndexSize) : 0;
+		const size_t fixedHead = 32 + 16 * static_cast<size_t>(header.additionalUV);
+
+		chunkOffsets.clear();
+		chunkOffsets.reserve(vertexCount / VertexChunkSize + 2);
+
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			if ((i % VertexChunkSize) == 0) chunkOffsets.push_back(br.Position());
+
+			br.Skip(fixedHead);
+			switch (br.Read<std::uint8_t>())
+			{
+				case 0: br.Skip(bone); break;                   // BDEF1
+				case 1: br.Skip(bone * 2 + 4); break;           // BDEF2
+				case 2: br.Skip(bone * 4 + 16); break;          // BDEF4
+				case 3: br.Skip(bone * 2 + 4 + 36); break;      // SDEF
+				case 4: br.Skip(bone * 4 + 16); break;          // QDEF
+				default: throw std::runtime_error("Unknown weight type.");
+			}
+			br.Skip(4); // edge scale
+		}
+		chunkOffsets.push_back(br.Position());
+	}
+
+	// [tubNǂݔ΂Ȃe[t̐擪ItZbgL^
+	void ScanMorphBlock(BinaryReader& br, const PmxModel::Header& header, size_t morphCount,
+						std::vector<size_t>& morphOffsets)
+	{
+		morphOffsets.clear();
+		morphOffsets.reserve(morphCount + 1);
+
+		for (size_t i = 0; i < morphCount; ++i)
+		{
+			morphOffsets.push_back(br.Position());
+
+			SkipPmxText(br);
+			SkipPmxText(br);
+			(void)br.Read<std::uint8_t>(); // panel
+			const auto type = static_cast<PmxModel::Morph::Type>(br.Read<std::uint8_t>());
+
+			const int32_t offsetCount = br.Read<std::int32_t>();
+			if (offsetCount < 0) throw std::runtime_error("Invalid morph offsetCount.");
+			if (offsetCount == 0) continue; // ʂCfbNXTCY̓ItZbgꍇ̂݌؂
+
+			size_t recordSize = 0;
+			switch (type)
+			{
+				case PmxModel::Morph::Type::Group:
+				case PmxModel::Morph::Type::Flip:
+					recordSize = CheckedIndexSize(header.morphIndexSize) + 4;
+					break;
+				case PmxModel::Morph::Type::Vertex:
+					recordSize = CheckedIndexSize(header.vertexIndexSize) + 12;
+					break;
+				case PmxModel::Morph::Type::Bone:
+					recordSize = CheckedIndexSize(header.boneIndexSize) + 28;
+					break;
+				case PmxModel::Morph::Type::UV:
+				case PmxModel::Morph::Type::AdditionalUV1:
+				case PmxModel::Morph::Type::AdditionalUV2:
+				case PmxModel::Morph::Type::AdditionalUV3:
+				case PmxModel::Morph::Type::AdditionalUV4:
+					recordSize = CheckedIndexSize(header.vertexIndexSize) + 16;
+					break;
+				case PmxModel::Morph::Type::Material:
+					recordSize = CheckedIndexSize(header.materialIndexSize) + 1 + 4 * 28;
+					break;
+				case PmxModel::Morph::Type::Impulse:
+					recordSize = CheckedIndexSize(header.rigidIndexSize) + 1 + 24;
+					break;
+				default:
+					throw std::runtime_error("Unknown morph type.");
+			}
+
+			if (static_cast<size_t>(offsetCount) > br.Remaining() / recordSize)
+			{
+				throw std::runtime_error("PMX truncated while reading morph offsets");
+			}
+			br.Skip(static_cast<size_t>(offsetCount) * recordSize);
+		}
+		morphOffsets.push_back(br.Position());
+	}
 }
 
 bool PmxLoader::LoadModel(const std::filesystem::path& pmxPath, PmxModel& model, PmxModel::ProgressCallback onProgress)
+{
+#ifndef PMXLOADER_DISABLE_MODEL_CACHE
+	if (onProgress) onProgress(0.05f, L"LbVmF...");
+	if (PmxModelCache::TryLoad(pmxPath, model))
+	{
+		if (onProgress) onProgress(0.6f, L"PMX͊ (LbV)");
+		model.m_revision = g_revisionCounter++;
+		return true;
+	}
+#endif
+
+	if (!ParseModel(pmxPath, model, onProgress)) return false;
+
+#ifndef PMXLOADER_DISABLE_MODEL_CACHE
+	// ߂Ȃꏊ̃fł͒PɍȂ
+	(void)PmxModelCache::Save(pmxPath, model);
+#endif
+	return true;
+}
+
+bool PmxLoader::ParseModel(const std::filesystem::path& pmxPath, PmxModel& model, PmxModel::ProgressCallback onProgress)
 {
 	model.m_path = pmxPath;
 
@@ -41,7 +171,7 @@ bool PmxLoader::LoadModel(const std::filesystem::path& pmxPath, PmxModel& model,
 	BinaryReader br(pmxPath);
 
 	EnsureRemaining(br, 4, "signature");
-	auto sig = br.ReadBytes(4);
+	auto sig = br.ReadSpan(4);
 	if (sig.size() != 4 || sig[0] != 'P' || sig[1] != 'M' || sig[2] != 'X' || sig[3] != ' ')
 	{
 		throw std::runtime_error("Not a PMX file.");
@@ -71,7 +201,7 @@ bool PmxLoader::LoadModel(const std::filesystem::path& pmxPath, PmxModel& model,
 	// ----------------
 	// Vertices
 	// ----------------
-	if (onProgress) onProgress(0.1f, L"_f[^ǂݍݒ...");
+	if (onProgress) onProgress(0.1f, L"_ubN𑖍...");
 	auto vertexCount = br.Read<std::int32_t>();
 	if (vertexCount < 0) throw std::runtime_error("Invalid vertexCount.");
 	model.m_vertices.reserve(static_cast<size_t>(vertexCount));
@@ -79,61 +209,57 @@ bool PmxLoader::LoadModel(const std::filesystem::path& pmxPath, PmxModel& model,
 	const size_t minVertexBytes = static_cast<size_t>(vertexCount) * static_cast<size_t>(38 + 16 * model.m_header.additionalUV);
 	EnsureRemaining(br, minVertexBytes, "vertex block");
 
-	for (int32_t i = 0; i < vertexCount; ++i)
-	{
-		PmxModel::Vertex v{};
-		v.px = br.Read<float>(); v.py = br.Read<float>(); v.pz = br.Read<float>();
-		v.nx = br.Read<float>(); v.ny = br.Read<float>(); v.nz = br.Read<float>();
-		v.u = br.Read<float>(); v.v = br.Read<float>();
-
-		// additional UV (each is float4)
-		for (uint8_t a = 0; a < model.m_header.additionalUV; ++a)
-		{
-			(void)br.Read<float>(); (void)br.Read<float>();
-			(void)br.Read<float>(); (void)br.Read<float>();
-		}
-
-		// weight block
-		v.weight = model.ReadVertexWeight(br);
-
-		// edge scale
-		v.edgeScale = br.Read<float>();
-
-		model.m_vertices.push_back(v);
-
-		model.m_minx = std::min(model.m_minx, v.px); model.m_miny = std::min(model.m_miny, v.py); model.m_minz = std::min(model.m_minz, v.pz);
-		model.m_maxx = std::max(model.m_maxx, v.px); model.m_maxy = std::max(model.m_maxy, v.py); model.m_maxz = std::max(model.m_maxz, v.pz);
-	}
+	// {̂̉͂̓[tƍ킹ČiŕɍsBł͋؂ʒu߂
+	std::vector<size_t> vertexChunkOffsets;
+	ScanVertexBlock(br, model.m_header, static_cast<size_t>(vertexCount), vertexChunkOffsets);
 
 	// ----------------
 	// Indices
 	// ----------------
-	if (onProgress) onProgress(0.3f, L"CfbNXf[^ǂݍݒ...");
+	if (onProgress) onProgress(0.15f, L"CfbNXf[^ǂݍݒ...");
 	auto indexCount = br.Read<std::int32_t>();
 	if ((indexCount % 3) != 0 || indexCount < 0)
 	{
 		throw std::runtime_error("Invalid indexCount.");
 	}
 
-	model.m_indices.reserve(static_cast<size_t>(indexCount));
 	EnsureRemaining(br, static_cast<size_t>(indexCount) * model.m_header.vertexIndexSize, "indices");
 
-	for (int32_t i = 0; i < indexCount; ++i)
+	// CfbNX̓TCYʂɈꊇœWJ
+	switch (model.m_header.vertexIndexSize)
 	{
-		uint32_t idx = model.ReadIndexUnsigned(br, model.m_header.vertexIndexSize);
+		case 1:
+		{
+			auto src = br.ReadSpan(static_cast<size_t>(indexCount));
+			model.m_indices.assign(src.begin(), src.end());
+			break;
+		}
+		case 2:
+		{
+			auto src = br.ReadArray<std::uint16_t>(static_cast<size_t>(indexCount));
+			model.m_indices.assign(src.begin(), src.end());
+			break;
+		}
+		case 4:
+			model.m_indices.resize(static_cast<size_t>(indexCount));
+			br.ReadArray(model.m_indices.data(), model.m_indices.size());
+			break;
+		default:
+			throw std::runtime_error("Unsupported index size.");
+	}
 
+	for (uint32_t idx : model.m_indices)
+	{
 		if (idx >= static_cast<uint32_t>(vertexCount))
 		{
 			throw std::runtime_error("Vertex index out of range.");
 		}
-
-		model.m_indices.push_back(idx);
 	}
 
 	// ----------------
 	// Textures
 	// ----------------
-	if (onProgress) onProgress(0.4f, L"eNX``ǂݍݒ...");
+	if (onProgress) onProgress(0.2f, L"eNX``ǂݍݒ...");
 	auto textureCount = br.Read<std::int32_t>();
 	if (textureCount < 0) throw std::runtime_error("Invalid textureCount.");
 	model.m_textures.reserve((size_t)textureCount);
@@ -149,7 +275,7 @@ bool PmxLoader::LoadModel(const std::filesystem::path& pmxPath, PmxModel& model,
 	// ----------------
 	// Materials
 	// ----------------
-	if (onProgress) onProgress(0.4f, L"}eA`ǂݍݒ...");
+	if (onProgress) onProgress(0.2f, L"}eA`ǂݍݒ...");
 	auto materialCount = br.Read<std::int32_t>();
 	if (materialCount < 0) throw std::runtime_error("Invalid materialCount.");
 	model.m_materials.reserve((size_t)materialCount);
@@ -218,16 +344,159 @@ bool PmxLoader::LoadModel(const std::filesystem::path& pmxPath, PmxModel& model,
 	// ----------------
 	// Bones
 	// ----------------
-	if (onProgress) onProgress(0.5f, L"{[\ǂݍݒ...");
+	if (onProgress) onProgress(0.25f, L"{[\ǂݍݒ...");
 	model.LoadBones(br);
 
 	// ----------------
-	// Morph / DisplayFrame / Physics
+	// Morph (scan only)
+	// ----------------
+	const int32_t morphCount = br.Read<std::int32_t>();
+	if (morphCount < 0) throw std::runtime_error("Invalid morphCount.");
+
+	std::vector<size_t> morphOffsets;
+	ScanMorphBlock(br, model.m_header, static_cast<size_t>(morphCount), morphOffsets);
+	const size_t afterMorphs = br.Position();
+
 	// ----------------
-	model.LoadMorphs(br);
-	model.LoadFrames(br);
-	model.LoadRigidBodies(br);
-	model.LoadJoints(br);
+	// Vertices / Morphs / DisplayFrame / Physics (parallel)
+	// ----------------
+	// _`Nƃ[t 1 ̍ƃXgɂ܂Ƃ߂ĕɉ͂B
+	// \gȍ~̓[t̓Ɨ̈Ȃ̂ŁAɕʂ̃WuœǂށB
+	// ݐ͊evfœƗĂAʂ͒͂ƓɂȂB
+	if (onProgress) onProgress(0.3f, L"_E[tf[^ǂݍݒ...");
+
+	const size_t vertexChunkCount = vertexChunkOffsets.size() - 1;
+	const size_t workCount = vertexChunkCount + static_cast<size_t>(morphCount);
+
+	struct ChunkBounds
+	{
+		float minx = +std::numeric_limits<float>::infinity();
+		float miny = +std::numeric_limits<float>::infinity();
+		float minz = +std::numeric_limits<float>::infinity();
+		float maxx = -std::numeric_limits<float>::infinity();
+		float maxy = -std::numeric_limits<float>::infinity();
+		float maxz = -std::numeric_limits<float>::infinity();
+	};
+
+	model.m_vertices.resize(static_cast<size_t>(vertexCount));
+	model.m_morphs.resize(static_cast<size_t>(morphCount));
+
+	std::vector<ChunkBounds> chunkBounds(vertexChunkCount);
+	// ͕\gÉEWCg̉͂̃G[
+	std::vector<std::exception_ptr> errors(workCount + 1);
+
+	const auto data = br.Data();
+	const size_t totalBytes = (vertexChunkOffsets.back() - vertexChunkOffsets.front()) +
+		(morphOffsets.back() - morphOffsets.front());
+	std::atomic<size_t> doneBytes{ 0 };
+
+	auto parseVertexChunk = [&](size_t chunk) {
+		BinaryReader r(data);
+		r.Seek(vertexChunkOffsets[chunk]);
+
+		const size_t first = chunk * VertexChunkSize;
+		const size_t last = std::min(first + VertexChunkSize, model.m_vertices.size());
+		ChunkBounds& bounds = chunkBounds[chunk];
+
+		for (size_t i = first; i < last; ++i)
+		{
+			PmxModel::Vertex& v = model.m_vertices[i];
+
+			// position / normal / uv ͌Œ背CAEgȂ̂ňꊇœǂ
+			float pnu[8];
+			r.ReadArray(pnu, 8);
+			v.px = pnu[0]; v.py = pnu[1]; v.pz = pnu[2];
+			v.nx = pnu[3]; v.ny = pnu[4]; v.nz = pnu[5];
+			v.u = pnu[6]; v.v = pnu[7];
+
+			// additional UV (each is float4)
+			r.Skip(static_cast<size_t>(model.m_header.additionalUV) * 16);
+
+			// weight block
+			v.weight = model.ReadVertexWeight(r);
+
+			// edge scale
+			v.edgeScale = r.Read<float>();
+
+			bounds.minx = std::min(bounds.minx, v.px); bounds.miny = std::min(bounds.miny, v.py); bounds.minz = std::min(bounds.minz, v.pz);
+			bounds.maxx = std::max(bounds.maxx, v.px); bounds.maxy = std::max(bounds.maxy, v.py); bounds.maxz = std::max(bounds.maxz, v.pz);
+		}
+		return vertexChunkOffsets[chunk + 1] - vertexChunkOffsets[chunk];
+		};
+
+	auto parseMorph = [&](size_t index) {
+		BinaryReader r(data);
+		r.Seek(morphOffsets[index]);
+		model.m_morphs[index] = model.ReadMorph(r);
+		return morphOffsets[index + 1] - morphOffsets[index];
+		};
+
+	// iR[obN͌ĂяoXbĥݒʒm
+	const std::thread::id callerThread = std::this_thread::get_id();
+
+	auto parseItem = [&](size_t item) {
+		size_t bytes = 0;
+		try
+		{
+			bytes = (item < vertexChunkCount) ? parseVertexChunk(item) : parseMorph(item - vertexChunkCount);
+		}
+		catch (...)
+		{
+			errors[item] = std::current_exception();
+		}
+
+		const size_t done = doneBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+		if (onProgress && totalBytes > 0 && std::this_thread::get_id() == callerThread)
+		{
+			onProgress(0.3f + 0.28f * (static_cast<float>(done) / static_cast<float>(totalBytes)),
+					   L"_E[tf[^ǂݍݒ...");
+		}
+		};
+
+	JobSystem::TaskGraph graph;
+	std::vector<JobSystem::TaskGraph::TaskId> vertexTasks;
+	vertexTasks.reserve(vertexChunkCount);
+	for (size_t item = 0; item < workCount; ++item)
+	{
+		const bool isVertexChunk = (item < vertexChunkCount);
+		const auto id = graph.Add(isVertexChunk ? "pmx.vertices" : "pmx.morph", [&parseItem, item] { parseItem(item); });
+		if (isVertexChunk) vertexTasks.push_back(id);
+	}
+
+	graph.Add("pmx.frames_physics", [&] {
+		try
+		{
+			br.Seek(afterMorphs);
+			model.LoadFrames(br);
+			model.LoadRigidBodies(br);
+			model.LoadJoints(br);
+		}
+		catch (...)
+		{
+			errors[workCount] = std::current_exception();
+		}
+		});
+
+	// S_`Nς񂾂烂f͈̔͂܂Ƃ߂
+	const auto boundsTask = graph.Add("pmx.bounds", [&] {
+		for (const auto& b : chunkBounds)
+		{
+			model.m_minx = std::min(model.m_minx, b.minx); model.m_miny = std::min(model.m_miny, b.miny); model.m_minz = std::min(model.m_minz, b.minz);
+			model.m_maxx = std::max(model.m_maxx, b.maxx); model.m_maxy = std::max(model.m_maxy, b.maxy); model.m_maxz = std::max(model.m_maxz, b.maxz);
+		}
+		});
+	for (const auto id : vertexTasks)
+	{
+		graph.Precede(id, boundsTask);
+	}
+
+	JobSystem::Shared().Run(graph);
+
+	// t@C擪̃G[D悵ĕ񍐂 (͂Ɠ)
+	for (const auto& e : errors)
+	{
+		if (e) std::rethrow_exception(e);
+	}
 
 	if (onProgress) onProgress(0.6f, L"PMX͊");
 
@@ -6,5 +6,8 @@
 class PmxLoader
 {
 public:
+	// .pmxc キャッシュが有効ならそれを使い、なければ解析してキャッシュを書き出す
 	static bool LoadModel(const std::filesystem::path& pmxPath, PmxModel& outModel, PmxModel::ProgressCallback onProgress = nullptr);
+	// キャッシュを介さず常に PMX を解析する
+	static bool ParseModel(const std::filesystem::path& pmxPath, PmxModel& outModel, PmxModel::ProgressCallback onProgress = nullptr);
 };
\ No newline at end of file
@@ -6,15 +6,24 @@
 #include "PmxLoader.hpp"
 #include "BinaryReader.hpp"
 #include "StringUtil.hpp"
-#include <windows.h>
 #include <stdexcept>
 #include <algorithm>
+#include <span>
+#include <string_view>
 
 namespace
 {
-	std::wstring U16ToW(const std::u16string& s)
+	// UTF-16LE のバイト列から直接 wstring を組み立てる (中間の u16string を作らない)
+	std::wstring U16LeBytesToW(std::span<const std::uint8_t> bytes)
 	{
-		return std::wstring(reinterpret_cast<const wchar_t*>(s.data()), s.size());
+		if ((bytes.size() % 2) != 0) throw std::runtime_error("Invalid UTF16 length.");
+
+		std::wstring out(bytes.size() / 2, L'\0');
+		for (size_t i = 0; i < out.size(); ++i)
+		{
+			out[i] = static_cast<wchar_t>(bytes[i * 2 + 0] | (bytes[i * 2 + 1] << 8));
+		}
+		return out;
 	}
 }
 
@@ -22,13 +31,12 @@ std::wstring PmxModel::ReadPmxText(BinaryReader& br) const
 {
 	if (m_header.encoding == 0)
 	{
-		auto u16 = br.ReadStringUtf16LeWithLength();
-		return U16ToW(u16);
+		return U16LeBytesToW(br.ReadSpanWithLength());
 	}
 	else if (m_header.encoding == 1)
 	{
-		auto u8 = br.ReadStringUtf8WithLength();
-		return StringUtil::Utf8ToWide(u8);
+		auto u8 = br.ReadSpanWithLength();
+		return StringUtil::Utf8ToWide(std::string_view(reinterpret_cast<const char*>(u8.data()), u8.size()));
 	}
 	throw std::runtime_error("Unknown PMX encoding.");
 }
@@ -256,150 +264,141 @@ void PmxModel::GetBounds(float& minx, float& miny, float& minz,
 	maxx = m_maxx; maxy = m_maxy; maxz = m_maxz;
 }
 
-void PmxModel::LoadMorphs(BinaryReader& br)
+PmxModel::Morph PmxModel::ReadMorph(BinaryReader& br) const
 {
-	const int32_t morphCount = br.Read<std::int32_t>();
-	if (morphCount < 0) throw std::runtime_error("Invalid morphCount.");
+	Morph morph{};
+	morph.name = ReadPmxText(br);
+	morph.nameEn = ReadPmxText(br);
+	morph.panel = br.Read<std::uint8_t>();
+	morph.type = static_cast<Morph::Type>(br.Read<std::uint8_t>());
 
-	m_morphs.clear();
-	m_morphs.reserve(static_cast<size_t>(morphCount));
+	const int32_t offsetCount = br.Read<std::int32_t>();
+	if (offsetCount < 0) throw std::runtime_error("Invalid morph offsetCount.");
 
-	for (int32_t i = 0; i < morphCount; ++i)
+	// オフセットデータの読み込み
+	switch (morph.type)
 	{
-		Morph morph{};
-		morph.name = ReadPmxText(br);
-		morph.nameEn = ReadPmxText(br);
-		morph.panel = br.Read<std::uint8_t>();
-		morph.type = static_cast<Morph::Type>(br.Read<std::uint8_t>());
-
-		const int32_t offsetCount = br.Read<std::int32_t>();
-		if (offsetCount < 0) throw std::runtime_error("Invalid morph offsetCount.");
+		case Morph::Type::Group:
+			morph.groupOffsets.reserve(offsetCount);
+			break;
+		case Morph::Type::Vertex:
+			morph.vertexOffsets.reserve(offsetCount);
+			break;
+		case Morph::Type::Bone:
+			morph.boneOffsets.reserve(offsetCount);
+			break;
+		case Morph::Type::UV:
+		case Morph::Type::AdditionalUV1:
+		case Morph::Type::AdditionalUV2:
+		case Morph::Type::AdditionalUV3:
+		case Morph::Type::AdditionalUV4:
+			morph.uvOffsets.reserve(offsetCount);
+			break;
+		case Morph::Type::Material:
+			morph.materialOffsets.reserve(offsetCount);
+			break;
+		case Morph::Type::Flip:
+			morph.flipOffsets.reserve(offsetCount);
+			break;
+		case Morph::Type::Impulse:
+			morph.impulseOffsets.reserve(offsetCount);
+			break;
+	}
 
-		// オフセットデータの読み込み
+	for (int32_t k = 0; k < offsetCount; ++k)
+	{
 		switch (morph.type)
 		{
 			case Morph::Type::Group:
-				morph.groupOffsets.reserve(offsetCount);
+			{
+				Morph::GroupOffset o{};
+				o.morphIndex = ReadIndexSigned(br, m_header.morphIndexSize);
+				o.weight = br.Read<float>();
+				morph.groupOffsets.push_back(o);
 				break;
+			}
 			case Morph::Type::Vertex:
-				morph.vertexOffsets.reserve(offsetCount);
+			{
+				Morph::VertexOffset o{};
+				o.vertexIndex = ReadIndexUnsigned(br, m_header.vertexIndexSize);
+				o.positionOffset.x = br.Read<float>();
+				o.positionOffset.y = br.Read<float>();
+				o.positionOffset.z = br.Read<float>();
+				morph.vertexOffsets.push_back(o);
 				break;
+			}
 			case Morph::Type::Bone:
-				morph.boneOffsets.reserve(offsetCount);
+			{
+				Morph::BoneOffset o{};
+				o.boneIndex = ReadIndexSigned(br, m_header.boneIndexSize);
+				o.translation.x = br.Read<float>();
+				o.translation.y = br.Read<float>();
+				o.translation.z = br.Read<float>();
+				o.rotation.x = br.Read<float>();
+				o.rotation.y = br.Read<float>();
+				o.rotation.z = br.Read<float>();
+				o.rotation.w = br.Read<float>();
+				morph.boneOffsets.push_back(o);
 				break;
+			}
 			case Morph::Type::UV:
 			case Morph::Type::AdditionalUV1:
 			case Morph::Type::AdditionalUV2:
 			case Morph::Type::AdditionalUV3:
 			case Morph::Type::AdditionalUV4:
-				morph.uvOffsets.reserve(offsetCount);
+			{
+				Morph::UVOffset o{};
+				o.vertexIndex = ReadIndexUnsigned(br, m_header.vertexIndexSize);
+				o.offset.x = br.Read<float>();
+				o.offset.y = br.Read<float>();
+				o.offset.z = br.Read<float>();
+				o.offset.w = br.Read<float>();
+				morph.uvOffsets.push_back(o);
 				break;
+			}
 			case Morph::Type::Material:
-				morph.materialOffsets.reserve(offsetCount);
+			{
+				Morph::MaterialOffset o{};
+				o.materialIndex = ReadIndexSigned(br, m_header.materialIndexSize);
+				o.operation = br.Read<std::uint8_t>();
+
+				o.diffuse.x = br.Read<float>(); o.diffuse.y = br.Read<float>(); o.diffuse.z = br.Read<float>(); o.diffuse.w = br.Read<float>();
+				o.specular.x = br.Read<float>(); o.specular.y = br.Read<float>(); o.specular.z = br.Read<float>();
+				o.specularPower = br.Read<float>();
+				o.ambient.x = br.Read<float>(); o.ambient.y = br.Read<float>(); o.ambient.z = br.Read<float>();
+				o.edgeColor.x = br.Read<float>(); o.edgeColor.y = br.Read<float>(); o.edgeColor.z = br.Read<float>(); o.edgeColor.w = br.Read<float>();
+				o.edgeSize = br.Read<float>();
+				o.textureFactor.x = br.Read<float>(); o.textureFactor.y = br.Read<float>(); o.textureFactor.z = br.Read<float>(); o.textureFactor.w = br.Read<float>();
+				o.sphereTextureFactor.x = br.Read<float>(); o.sphereTextureFactor.y = br.Read<float>(); o.sphereTextureFactor.z = br.Read<float>(); o.sphereTextureFactor.w = br.Read<float>();
+				o.toonTextureFactor.x = br.Read<float>(); o.toonTextureFactor.y = br.Read<float>(); o.toonTextureFactor.z = br.Read<float>(); o.toonTextureFactor.w = br.Read<float>();
+
+				morph.materialOffsets.push_back(o);
 				break;
+			}
 			case Morph::Type::Flip:
-				morph.flipOffsets.reserve(offsetCount);
+			{
+				Morph::FlipOffset o{};
+				o.morphIndex = ReadIndexSigned(br, m_header.morphIndexSize);
+				o.weight = br.Read<float>();
+				morph.flipOffsets.push_back(o);
 				break;
+			}
 			case Morph::Type::Impulse:
-				morph.impulseOffsets.reserve(offsetCount);
-				break;
-		}
-
-		for (int32_t k = 0; k < offsetCount; ++k)
-		{
-			switch (morph.type)
 			{
-				case Morph::Type::Group:
-				{
-					Morph::GroupOffset o{};
-					o.morphIndex = ReadIndexSigned(br, m_header.morphIndexSize);
-					o.weight = br.Read<float>();
-					morph.groupOffsets.push_back(o);
-					break;
-				}
-				case Morph::Type::Vertex:
-				{
-					Morph::VertexOffset o{};
-					o.vertexIndex = ReadIndexUnsigned(br, m_header.vertexIndexSize);
-					o.positionOffset.x = br.Read<float>();
-					o.positionOffset.y = br.Read<float>();
-					o.positionOffset.z = br.Read<float>();
-					morph.vertexOffsets.push_back(o);
-					break;
-				}
-				case Morph::Type::Bone:
-				{
-					Morph::BoneOffset o{};
-					o.boneIndex = ReadIndexSigned(br, m_header.boneIndexSize);
-					o.translation.x = br.Read<float>();
-					o.translation.y = br.Read<float>();
-					o.translation.z = br.Read<float>();
-					o.rotation.x = br.Read<float>();
-					o.rotation.y = br.Read<float>();
-					o.rotation.z = br.Read<float>();
-					o.rotation.w = br.Read<float>();
-					morph.boneOffsets.push_back(o);
-					break;
-				}
-				case Morph::Type::UV:
-				case Morph::Type::AdditionalUV1:
-				case Morph::Type::AdditionalUV2:
-				case Morph::Type::AdditionalUV3:
-				case Morph::Type::AdditionalUV4:
-				{
-					Morph::UVOffset o{};
-					o.vertexIndex = ReadIndexUnsigned(br, m_header.vertexIndexSize);
-					o.offset.x = br.Read<float>();
-					o.offset.y = br.Read<float>();
-					o.offset.z = br.Read<float>();
-					o.offset.w = br.Read<float>();
-					morph.uvOffsets.push_back(o);
-					break;
-				}
-				case Morph::Type::Material:
-				{
-					Morph::MaterialOffset o{};
-					o.materialIndex = ReadIndexSigned(br, m_header.materialIndexSize);
-					o.operation = br.Read<std::uint8_t>();
-
-					o.diffuse.x = br.Read<float>(); o.diffuse.y = br.Read<float>(); o.diffuse.z = br.Read<float>(); o.diffuse.w = br.Read<float>();
-					o.specular.x = br.Read<float>(); o.specular.y = br.Read<float>(); o.specular.z = br.Read<float>();
-					o.specularPower = br.Read<float>();
-					o.ambient.x = br.Read<float>(); o.ambient.y = br.Read<float>(); o.ambient.z = br.Read<float>();
-					o.edgeColor.x = br.Read<float>(); o.edgeColor.y = br.Read<float>(); o.edgeColor.z = br.Read<float>(); o.edgeColor.w = br.Read<float>();
-					o.edgeSize = br.Read<float>();
-					o.textureFactor.x = br.Read<float>(); o.textureFactor.y = br.Read<float>(); o.textureFactor.z = br.Read<float>(); o.textureFactor.w = br.Read<float>();
-					o.sphereTextureFactor.x = br.Read<float>(); o.sphereTextureFactor.y = br.Read<float>(); o.sphereTextureFactor.z = br.Read<float>(); o.sphereTextureFactor.w = br.Read<float>();
-					o.toonTextureFactor.x = br.Read<float>(); o.toonTextureFactor.y = br.Read<float>(); o.toonTextureFactor.z = br.Read<float>(); o.toonTextureFactor.w = br.Read<float>();
-
-					morph.materialOffsets.push_back(o);
-					break;
-				}
-				case Morph::Type::Flip:
-				{
-					Morph::FlipOffset o{};
-					o.morphIndex = ReadIndexSigned(br, m_header.morphIndexSize);
-					o.weight = br.Read<float>();
-					morph.flipOffsets.push_back(o);
-					break;
-				}
-				case Morph::Type::Impulse:
-				{
-					Morph::ImpulseOffset o{};
-					o.rigidBodyIndex = ReadIndexSigned(br, m_header.rigidIndexSize);
-					o.localFlag = br.Read<std::uint8_t>();
-					o.velocity.x = br.Read<float>(); o.velocity.y = br.Read<float>(); o.velocity.z = br.Read<float>();
-					o.torque.x = br.Read<float>(); o.torque.y = br.Read<float>(); o.torque.z = br.Read<float>();
-					morph.impulseOffsets.push_back(o);
-					break;
-				}
-				default:
-					throw std::runtime_error("Unknown morph type.");
+				Morph::ImpulseOffset o{};
+				o.rigidBodyIndex = ReadIndexSigned(br, m_header.rigidIndexSize);
+				o.localFlag = br.Read<std::uint8_t>();
+				o.velocity.x = br.Read<float>(); o.velocity.y = br.Read<float>(); o.velocity.z = br.Read<float>();
+				o.torque.x = br.Read<float>(); o.torque.y = br.Read<float>(); o.torque.z = br.Read<float>();
+				morph.impulseOffsets.push_back(o);
+				break;
 			}
+			default:
+				throw std::runtime_error("Unknown morph type.");
 		}
-
-		m_morphs.push_back(std::move(morph));
 	}
+
+	return morph;
 }
 
 void PmxModel::LoadFrames(BinaryReader& br)
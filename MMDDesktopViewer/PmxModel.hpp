@@ -348,6 +348,7 @@ public:
 
 private:
 	friend class PmxLoader;
+	friend class PmxModelCache;
 
 	std::wstring ReadPmxText(BinaryReader& br) const;
 	int32_t ReadIndexSigned(BinaryReader& br, std::uint8_t size) const;
@@ -356,7 +357,8 @@ private:
 	VertexWeight ReadVertexWeight(BinaryReader& br) const;
 	void LoadBones(BinaryReader& br);
 
-	void LoadMorphs(BinaryReader& br);
+	// 1 モーフ分を読む (PmxLoader が並列に呼ぶため const)
+	Morph ReadMorph(BinaryReader& br) const;
 	void LoadFrames(BinaryReader& br);
 	void LoadRigidBodies(BinaryReader& br);
 	void LoadJoints(BinaryReader& br);
@@ -0,0 +1,479 @@
+﻿#include "PmxModelCache.hpp"
+#include "BinaryReader.hpp"
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+	constexpr char CacheMagic[4] = { 'P', 'M', 'X', 'C' };
+	constexpr size_t ArrayAlignment = 16;
+
+	struct FileHeader
+	{
+		char magic[4];
+		std::uint32_t version;
+		std::uint32_t layoutTag;
+		std::uint32_t reserved;
+		std::uint64_t sourceSize;
+		std::int64_t sourceMtime;
+		std::uint64_t sourceHash;
+		std::uint64_t payloadSize;
+		std::uint64_t payloadHash;
+	};
+
+	// 構造体をそのまま書き出すため、レイアウトが変わったキャッシュは読まない
+	constexpr std::uint32_t ComputeLayoutTag()
+	{
+		std::uint32_t h = 2166136261u;
+		const size_t sizes[] = {
+			sizeof(wchar_t),
+			sizeof(PmxModel::Header),
+			sizeof(PmxModel::Vertex),
+			sizeof(PmxModel::Bone::IKLink),
+			sizeof(PmxModel::Morph::GroupOffset),
+			sizeof(PmxModel::Morph::VertexOffset),
+			sizeof(PmxModel::Morph::BoneOffset),
+			sizeof(PmxModel::Morph::UVOffset),
+			sizeof(PmxModel::Morph::MaterialOffset),
+			sizeof(PmxModel::Morph::FlipOffset),
+			sizeof(PmxModel::Morph::ImpulseOffset),
+		};
+		for (size_t s : sizes)
+		{
+			h ^= static_cast<std::uint32_t>(s);
+			h *= 16777619u;
+		}
+		return h;
+	}
+
+	// 8バイト単位・4レーンの軽量ハッシュ (暗号用途ではない)
+	std::uint64_t HashBytes(std::span<const std::uint8_t> data)
+	{
+		constexpr std::uint64_t Mul = 0x9E3779B97F4A7C15ull;
+		auto mix = [](std::uint64_t h, std::uint64_t w) {
+			h ^= w;
+			h *= Mul;
+			return h ^ (h >> 29);
+			};
+
+		std::uint64_t lane[4] = {
+			0xCBF29CE484222325ull ^ data.size(),
+			0x84222325CBF29CE4ull,
+			0x100000001B3ull,
+			0xD6E8FEB86659FD93ull
+		};
+
+		const std::uint8_t* p = data.data();
+		size_t n = data.size();
+		while (n >= 32)
+		{
+			std::uint64_t w[4];
+			std::memcpy(w, p, 32);
+			lane[0] = mix(lane[0], w[0]);
+			lane[1] = mix(lane[1], w[1]);
+			lane[2] = mix(lane[2], w[2]);
+			lane[3] = mix(lane[3], w[3]);
+			p += 32;
+			n -= 32;
+		}
+
+		std::uint64_t h = lane[0];
+		h = mix(h, lane[1]);
+		h = mix(h, lane[2]);
+		h = mix(h, lane[3]);
+
+		while (n >= 8)
+		{
+			std::uint64_t w;
+			std::memcpy(&w, p, 8);
+			h = mix(h, w);
+			p += 8;
+			n -= 8;
+		}
+		if (n > 0)
+		{
+			std::uint64_t w = 0;
+			std::memcpy(&w, p, n);
+			h = mix(h, w ^ (static_cast<std::uint64_t>(n) << 56));
+		}
+		return mix(h, Mul);
+	}
+
+	std::int64_t FileMtime(const std::filesystem::path& path)
+	{
+		std::error_code ec;
+		auto t = std::filesystem::last_write_time(path, ec);
+		if (ec) return 0;
+		return static_cast<std::int64_t>(t.time_since_epoch().count());
+	}
+
+	class Writer;
+	class Reader;
+
+	template <class Ar> void Transfer(Ar& ar, PmxModel::Material& m);
+	template <class Ar> void Transfer(Ar& ar, PmxModel::Bone& b);
+	template <class Ar> void Transfer(Ar& ar, PmxModel::Morph& m);
+	template <class Ar> void Transfer(Ar& ar, PmxModel::RigidBody& r);
+	template <class Ar> void Transfer(Ar& ar, PmxModel::Joint& j);
+
+	class Writer
+	{
+	public:
+		std::vector<std::uint8_t> bytes;
+
+		void Raw(const void* p, size_t n)
+		{
+			auto* b = static_cast<const std::uint8_t*>(p);
+			bytes.insert(bytes.end(), b, b + n);
+		}
+
+		void Align()
+		{
+			while ((bytes.size() % ArrayAlignment) != 0) bytes.push_back(0);
+		}
+
+		template <class T>
+			requires std::is_trivially_copyable_v<T>
+		void operator()(const T& v)
+		{
+			Raw(&v, sizeof(T));
+		}
+
+		void operator()(const std::wstring& s)
+		{
+			(*this)(static_cast<std::uint32_t>(s.size()));
+			Raw(s.data(), s.size() * sizeof(wchar_t));
+		}
+
+		template <class T>
+		void operator()(const std::vector<T>& v)
+		{
+			(*this)(static_cast<std::uint32_t>(v.size()));
+			if constexpr (std::is_trivially_copyable_v<T>)
+			{
+				// 固定長要素はアラインして生のまま並べる (読み込み時は一括コピー)
+				Align();
+				Raw(v.data(), v.size() * sizeof(T));
+			}
+			else
+			{
+				for (const auto& e : v) Transfer(*this, const_cast<T&>(e));
+			}
+		}
+	};
+
+	class Reader
+	{
+	public:
+		explicit Reader(BinaryReader& br) : m_br(br)
+		{
+		}
+
+		void Align()
+		{
+			const size_t pos = m_br.Position();
+			const size_t pad = (ArrayAlignment - (pos % ArrayAlignment)) % ArrayAlignment;
+			m_br.Skip(pad);
+		}
+
+		template <class T>
+			requires std::is_trivially_copyable_v<T>
+		void operator()(T& v)
+		{
+			m_br.ReadArray(&v, 1);
+		}
+
+		void operator()(std::wstring& s)
+		{
+			const auto len = m_br.Read<std::uint32_t>();
+			if (len > m_br.Remaining() / sizeof(wchar_t)) throw std::runtime_error("pmxc string out of range.");
+			s.resize(len);
+			m_br.ReadArray(s.data(), s.size());
+		}
+
+		template <class T>
+		void operator()(std::vector<T>& v)
+		{
+			const auto count = m_br.Read<std::uint32_t>();
+			if constexpr (std::is_trivially_copyable_v<T>)
+			{
+				Align();
+				if (count > m_br.Remaining() / sizeof(T)) throw std::runtime_error("pmxc array out of range.");
+				v.resize(count);
+				m_br.ReadArray(v.data(), v.size());
+			}
+			else
+			{
+				// 非POD要素は最低でも長さフィールド分のバイトを消費する
+				if (count > m_br.Remaining() / sizeof(std::uint32_t)) throw std::runtime_error("pmxc array out of range.");
+				v.resize(count);
+				for (auto& e : v) Transfer(*this, e);
+			}
+		}
+
+	private:
+		BinaryReader& m_br;
+	};
+
+	template <class Ar>
+	void Transfer(Ar& ar, PmxModel::Material& m)
+	{
+		ar(m.name); ar(m.nameEn);
+		ar(m.diffuse); ar(m.specular); ar(m.specularPower); ar(m.ambient);
+		ar(m.drawFlags); ar(m.edgeColor); ar(m.edgeSize);
+		ar(m.textureIndex); ar(m.sphereTextureIndex); ar(m.sphereMode);
+		ar(m.toonFlag); ar(m.toonIndex);
+		ar(m.memo);
+		ar(m.indexCount); ar(m.indexOffset);
+	}
+
+	template <class Ar>
+	void Transfer(Ar& ar, PmxModel::Bone& b)
+	{
+		ar(b.name); ar(b.nameEn);
+		ar(b.position); ar(b.parentIndex); ar(b.layer); ar(b.flags);
+		ar(b.tailBoneIndex); ar(b.tailOffset);
+		ar(b.grantParentIndex); ar(b.grantWeight);
+		ar(b.axisDirection); ar(b.localAxisX); ar(b.localAxisZ);
+		ar(b.externalParentKey);
+		ar(b.ikTargetIndex); ar(b.ikLoopCount); ar(b.ikLimitAngle);
+		ar(b.ikLinks);
+	}
+
+	template <class Ar>
+	void Transfer(Ar& ar, PmxModel::Morph& m)
+	{
+		ar(m.name); ar(m.nameEn);
+		ar(m.panel); ar(m.type);
+		ar(m.groupOffsets);
+		ar(m.vertexOffsets);
+		ar(m.boneOffsets);
+		ar(m.uvOffsets);
+		ar(m.materialOffsets);
+		ar(m.flipOffsets);
+		ar(m.impulseOffsets);
+	}
+
+	template <class Ar>
+	void Transfer(Ar& ar, PmxModel::RigidBody& r)
+	{
+		ar(r.name); ar(r.nameEn);
+		ar(r.boneIndex); ar(r.groupIndex); ar(r.ignoreCollisionGroup);
+		ar(r.shapeType); ar(r.shapeSize);
+		ar(r.position); ar(r.rotation);
+		ar(r.mass); ar(r.linearDamping); ar(r.angularDamping);
+		ar(r.restitution); ar(r.friction);
+		ar(r.operation);
+	}
+
+	template <class Ar>
+	void Transfer(Ar& ar, PmxModel::Joint& j)
+	{
+		ar(j.name); ar(j.nameEn);
+		ar(j.operation); ar(j.rigidBodyA); ar(j.rigidBodyB);
+		ar(j.position); ar(j.rotation);
+		ar(j.positionLower); ar(j.positionUpper);
+		ar(j.rotationLower); ar(j.rotationUpper);
+		ar(j.springPosition); ar(j.springRotation);
+	}
+
+	bool ReadValidHeader(BinaryReader& br, const std::filesystem::path& pmxPath, FileHeader& out)
+	{
+		if (br.Remaining() < sizeof(FileHeader)) return false;
+		out = br.Read<FileHeader>();
+
+		if (std::memcmp(out.magic, CacheMagic, sizeof(CacheMagic)) != 0) return false;
+		if (out.version != PmxModelCache::FormatVersion) return false;
+		if (out.layoutTag != ComputeLayoutTag()) return false;
+		if (out.payloadSize != br.Remaining()) return false;
+
+		std::error_code ec;
+		const auto size = std::filesystem::file_size(pmxPath, ec);
+		if (ec || size != out.sourceSize) return false;
+		if (FileMtime(pmxPath) != out.sourceMtime) return false;
+
+		return true;
+	}
+}
+
+std::filesystem::path PmxModelCache::CachePathFor(const std::filesystem::path& pmxPath)
+{
+	auto p = pmxPath;
+	p += L".pmxc";
+	return p;
+}
+
+bool PmxModelCache::IsUpToDate(const std::filesystem::path& pmxPath)
+{
+	try
+	{
+		const auto cachePath = CachePathFor(pmxPath);
+		std::error_code ec;
+		if (!std::filesystem::is_regular_file(cachePath, ec)) return false;
+
+		BinaryReader br(cachePath);
+		FileHeader header{};
+		return ReadValidHeader(br, pmxPath, header);
+	}
+	catch (...)
+	{
+		return false;
+	}
+}
+
+bool PmxModelCache::TryLoad(const std::filesystem::path& pmxPath, PmxModel& model)
+{
+	try
+	{
+		const auto cachePath = CachePathFor(pmxPath);
+		std::error_code ec;
+		if (!std::filesystem::is_regular_file(cachePath, ec)) return false;
+
+		BinaryReader br(cachePath);
+		FileHeader header{};
+		if (!ReadValidHeader(br, pmxPath, header)) return false;
+
+		// 破損チェック
+		if (HashBytes(br.Data().subspan(br.Position())) != header.payloadHash) return false;
+
+		// 同サイズ・同時刻のまま中身だけ差し替えられた場合に備えて内容も照合する
+		{
+			BinaryReader src(pmxPath);
+			if (HashBytes(src.Data()) != header.sourceHash) return false;
+		}
+
+		PmxModel tmp;
+		tmp.m_path = pmxPath;
+
+		Reader ar(br);
+		ar(tmp.m_header);
+		ar(tmp.m_name); ar(tmp.m_nameEn); ar(tmp.m_comment); ar(tmp.m_commentEn);
+		ar(tmp.m_minx); ar(tmp.m_miny); ar(tmp.m_minz);
+		ar(tmp.m_maxx); ar(tmp.m_maxy); ar(tmp.m_maxz);
+
+		ar(tmp.m_vertices);
+		ar(tmp.m_indices);
+
+		// テクスチャはモデルフォルダ基準の相対パスで保存している (フォルダごと移動しても使える)
+		const auto baseDir = pmxPath.parent_path();
+		std::uint32_t textureCount = 0;
+		ar(textureCount);
+		if (textureCount > br.Remaining()) return false;
+		tmp.m_textures.reserve(textureCount);
+		for (std::uint32_t i = 0; i < textureCount; ++i)
+		{
+			std::uint8_t relative = 0;
+			std::wstring text;
+			ar(relative);
+			ar(text);
+			tmp.m_textures.push_back(relative ? baseDir / text : std::filesystem::path(text));
+		}
+
+		ar(tmp.m_materials);
+		ar(tmp.m_bones);
+		ar(tmp.m_morphs);
+		ar(tmp.m_rigidBodies);
+		ar(tmp.m_joints);
+
+		if (br.Remaining() != 0) return false;
+
+		for (auto idx : tmp.m_indices)
+		{
+			if (idx >= tmp.m_vertices.size()) return false;
+		}
+
+		model = std::move(tmp);
+		return true;
+	}
+	catch (...)
+	{
+		return false;
+	}
+}
+
+bool PmxModelCache::Save(const std::filesystem::path& pmxPath, const PmxModel& model)
+{
+	try
+	{
+		FileHeader header{};
+		std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+		header.version = FormatVersion;
+		header.layoutTag = ComputeLayoutTag();
+
+		{
+			BinaryReader src(pmxPath);
+			header.sourceSize = src.Size();
+			header.sourceHash = HashBytes(src.Data());
+		}
+		header.sourceMtime = FileMtime(pmxPath);
+
+		// ヘッダー分を先に確保しておき、配列のアラインをファイル先頭基準にする
+		Writer ar;
+		ar.bytes.reserve(sizeof(FileHeader) + model.m_vertices.size() * sizeof(PmxModel::Vertex) +
+						 model.m_indices.size() * sizeof(std::uint32_t) + 64 * 1024);
+		ar.bytes.resize(sizeof(FileHeader));
+
+		ar(model.m_header);
+		ar(model.m_name); ar(model.m_nameEn); ar(model.m_comment); ar(model.m_commentEn);
+		ar(model.m_minx); ar(model.m_miny); ar(model.m_minz);
+		ar(model.m_maxx); ar(model.m_maxy); ar(model.m_maxz);
+
+		ar(model.m_vertices);
+		ar(model.m_indices);
+
+		const auto baseDir = pmxPath.parent_path();
+		const auto& baseNative = baseDir.native();
+		ar(static_cast<std::uint32_t>(model.m_textures.size()));
+		for (const auto& tex : model.m_textures)
+		{
+			const auto& native = tex.native();
+			const bool underBase = !baseNative.empty() &&
+				native.size() > baseNative.size() &&
+				native.compare(0, baseNative.size(), baseNative) == 0 &&
+				std::filesystem::path::preferred_separator == native[baseNative.size()];
+
+			ar(static_cast<std::uint8_t>(underBase ? 1 : 0));
+			ar(std::filesystem::path(native.substr(underBase ? baseNative.size() + 1 : 0)).wstring());
+		}
+
+		ar(model.m_materials);
+		ar(model.m_bones);
+		ar(model.m_morphs);
+		ar(model.m_rigidBodies);
+		ar(model.m_joints);
+
+		const std::span<const std::uint8_t> payload(ar.bytes.data() + sizeof(FileHeader), ar.bytes.size() - sizeof(FileHeader));
+		header.payloadSize = payload.size();
+		header.payloadHash = HashBytes(payload);
+		std::memcpy(ar.bytes.data(), &header, sizeof(FileHeader));
+
+		// 書きかけのキャッシュを読まないよう一時ファイル経由で置き換える
+		const auto cachePath = CachePathFor(pmxPath);
+		auto tmpPath = cachePath;
+		tmpPath += L".tmp";
+		{
+			std::ofstream ofs(tmpPath, std::ios::binary | std::ios::trunc);
+			if (!ofs) return false;
+			ofs.write(reinterpret_cast<const char*>(ar.bytes.data()), static_cast<std::streamsize>(ar.bytes.size()));
+			if (!ofs) return false;
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(tmpPath, cachePath, ec);
+		if (ec)
+		{
+			std::filesystem::remove(tmpPath, ec);
+			return false;
+		}
+		return true;
+	}
+	catch (...)
+	{
+		return false;
+	}
+}
@@ -0,0 +1,25 @@
+﻿#pragma once
+#include <filesystem>
+#include <cstdint>
+#include "PmxModel.hpp"
+
+// PMX を解析済みの PmxModel をそのまま展開できる形で保存するキャッシュ (.pmxc)。
+// モデルと同じフォルダに "<model>.pmx.pmxc" として置き、
+// 元ファイルのサイズ・更新日時・内容ハッシュが一致する場合のみ使用する。
+class PmxModelCache
+{
+public:
+	static constexpr std::uint32_t FormatVersion = 1;
+
+	static std::filesystem::path CachePathFor(const std::filesystem::path& pmxPath);
+
+	// キャッシュが有効なら model に展開して true を返す。
+	// 存在しない・古い・壊れている場合は false (例外は投げない)。
+	static bool TryLoad(const std::filesystem::path& pmxPath, PmxModel& model);
+
+	// 解析済みモデルからキャッシュを書き出す。書き込めない場合は false。
+	static bool Save(const std::filesystem::path& pmxPath, const PmxModel& model);
+
+	// 元ファイルを読まずに済む範囲 (サイズ・更新日時・フォーマット) で有効かどうか
+	static bool IsUpToDate(const std::filesystem::path& pmxPath);
+};
@@ -9,6 +9,7 @@
 #include <cstring>
 #include <cwctype>
 #include <filesystem>
+#include <span>
 #include <string>
 
 namespace
@@ -114,6 +115,82 @@ namespace
 		}
 	}
 
+	// 材質の色・エッジを元の値から求め直し、材質モーフを順に掛けてから範囲に収める。
+	// weights[k] は entries[k] のモーフのウェイト (閾値未満は 0 にしてある)
+	void ComputeMorphedMaterial(const PmxModel::Material& mat, std::span<const MorphGraph::MaterialEntry> entries,
+								const float* weights, PmxModelDrawer::MaterialCB& cb)
+	{
+		cb.diffuse = { mat.diffuse[0], mat.diffuse[1], mat.diffuse[2], mat.diffuse[3] };
+		cb.specular = { mat.specular[0], mat.specular[1], mat.specular[2] };
+		cb.specPower = mat.specularPower;
+		cb.ambient = { mat.ambient[0], mat.ambient[1], mat.ambient[2] };
+		cb.edgeColor = { mat.edgeColor[0], mat.edgeColor[1], mat.edgeColor[2], mat.edgeColor[3] };
+		cb.edgeSize = mat.edgeSize;
+
+		for (size_t k = 0; k < entries.size(); ++k)
+		{
+			const float w = weights[k];
+			if (w == 0.0f) continue;
+
+			const auto& mo = *entries[k].offset;
+			if (mo.operation == 0)
+			{
+				auto applyMul4 = [&](DirectX::XMFLOAT4& target, const DirectX::XMFLOAT4& offset) {
+					target.x *= (1.0f + (offset.x - 1.0f) * w);
+					target.y *= (1.0f + (offset.y - 1.0f) * w);
+					target.z *= (1.0f + (offset.z - 1.0f) * w);
+					target.w *= (1.0f + (offset.w - 1.0f) * w);
+					};
+				auto applyMul3 = [&](DirectX::XMFLOAT3& target, const DirectX::XMFLOAT3& offset) {
+					target.x *= (1.0f + (offset.x - 1.0f) * w);
+					target.y *= (1.0f + (offset.y - 1.0f) * w);
+					target.z *= (1.0f + (offset.z - 1.0f) * w);
+					};
+				auto applyMul1 = [&](float& target, float offset) {
+					target *= (1.0f + (offset - 1.0f) * w);
+					};
+
+				applyMul4(cb.diffuse, mo.diffuse);
+				applyMul3(cb.specular, mo.specular);
+				applyMul1(cb.specPower, mo.specularPower);
+				applyMul3(cb.ambient, mo.ambient);
+				applyMul4(cb.edgeColor, mo.edgeColor);
+				applyMul1(cb.edgeSize, mo.edgeSize);
+			}
+			else if (mo.operation == 1)
+			{
+				auto applyAdd4 = [&](DirectX::XMFLOAT4& target, const DirectX::XMFLOAT4& offset) {
+					target.x += offset.x * w;
+					target.y += offset.y * w;
+					target.z += offset.z * w;
+					target.w += offset.w * w;
+					};
+				auto applyAdd3 = [&](DirectX::XMFLOAT3& target, const DirectX::XMFLOAT3& offset) {
+					target.x += offset.x * w;
+					target.y += offset.y * w;
+					target.z += offset.z * w;
+					};
+				auto applyAdd1 = [&](float& target, float offset) {
+					target += offset * w;
+					};
+
+				applyAdd4(cb.diffuse, mo.diffuse);
+				applyAdd3(cb.specular, mo.specular);
+				applyAdd1(cb.specPower, mo.specularPower);
+				applyAdd3(cb.ambient, mo.ambient);
+				applyAdd4(cb.edgeColor, mo.edgeColor);
+				applyAdd1(cb.edgeSize, mo.edgeSize);
+			}
+		}
+
+		auto saturateColor = [](float& v) { v = std::clamp(v, 0.0f, 1.0f); };
+		saturateColor(cb.diffuse.x); saturateColor(cb.diffuse.y); saturateColor(cb.diffuse.z); saturateColor(cb.diffuse.w);
+		saturateColor(cb.specular.x); saturateColor(cb.specular.y); saturateColor(cb.specular.z);
+		saturateColor(cb.ambient.x); saturateColor(cb.ambient.y); saturateColor(cb.ambient.z);
+		saturateColor(cb.edgeColor.x); saturateColor(cb.edgeColor.y); saturateColor(cb.edgeColor.z); saturateColor(cb.edgeColor.w);
+		cb.edgeSize = std::max(0.0f, cb.edgeSize);
+	}
+
 	static bool IsEyeOrLashMaterial(
 		const PmxModel::Material& m,
 		const std::vector<std::filesystem::path>& texPaths)
@@ -162,102 +239,46 @@ void PmxModelDrawer::EnsurePmxResources(const PmxModel* model, const LightSettin
 
 	m_pmx = {};
 
-	const auto& verts = model->Vertices();
 	const auto& inds = model->Indices();
 	const auto& mats = model->Materials();
 	const auto& texPaths = model->TexturePaths();
 
-	std::vector<PmxVsVertex> vtx;
-	vtx.reserve(verts.size());
-
-	const auto boneCount = model->Bones().size();
-
-	for (const auto& v : verts)
-	{
-		PmxVsVertex pv{};
-		pv.px = v.px; pv.py = v.py; pv.pz = v.pz;
-		pv.nx = v.nx; pv.ny = v.ny; pv.nz = v.nz;
-		pv.u = v.u; pv.v = v.v;
-
-		for (int i = 0; i < 4; ++i)
-		{
-			pv.boneIndices[i] = -1;
-			pv.boneWeights[i] = 0.0f;
-		}
-
-		int32_t fallbackBone = -1;
-		for (int i = 0; i < 4; ++i)
-		{
-			int32_t boneIdx = v.weight.boneIndices[i];
-			float weight = v.weight.weights[i];
-
-			if (boneIdx >= 0 && boneIdx < static_cast<int32_t>(boneCount) && weight > 0.0f)
-			{
-				pv.boneIndices[i] = boneIdx;
-				pv.boneWeights[i] = weight;
-				if (fallbackBone < 0) fallbackBone = boneIdx;
-			}
-		}
-
-		float totalWeight = pv.boneWeights[0] + pv.boneWeights[1] +
-			pv.boneWeights[2] + pv.boneWeights[3];
-
-		if (totalWeight > 0.001f)
-		{
-			for (int i = 0; i < 4; ++i)
-			{
-				pv.boneWeights[i] /= totalWeight;
-			}
-		}
-		else if (fallbackBone >= 0)
-		{
-			pv.boneIndices[0] = fallbackBone;
-			pv.boneWeights[0] = 1.0f;
-		}
-
-		pv.weightType = v.weight.type;
-		if (v.weight.type == 3)
-		{
-			pv.sdefC[0] = v.weight.sdefC.x;
-			pv.sdefC[1] = v.weight.sdefC.y;
-			pv.sdefC[2] = v.weight.sdefC.z;
-			pv.sdefR0[0] = v.weight.sdefR0.x;
-			pv.sdefR0[1] = v.weight.sdefR0.y;
-			pv.sdefR0[2] = v.weight.sdefR0.z;
-			pv.sdefR1[0] = v.weight.sdefR1.x;
-			pv.sdefR1[1] = v.weight.sdefR1.y;
-			pv.sdefR1[2] = v.weight.sdefR1.z;
-		}
-
-		vtx.push_back(pv);
-	}
+	std::vector<PmxVertexStreams::DynamicVertex> dynamicVertices;
+	std::vector<PmxVertexStreams::StaticVertex> staticVertices;
+	PmxVertexStreams::Build(*model, dynamicVertices, staticVertices);
 
-	m_baseVertices = vtx;
-	m_workingVertices = vtx;
-	m_morphWeights.resize(model->Morphs().size());
+	m_vertexMorpher.Initialize(model);
 
-	const UINT vbSize = static_cast<UINT>(vtx.size() * sizeof(PmxVsVertex));
 	const UINT ibSize = static_cast<UINT>(inds.size() * sizeof(uint32_t));
 
 	auto heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
 
-	{
-		auto bufDesc = CD3DX12_RESOURCE_DESC::Buffer(vbSize);
+	// 頂点バッファはストリームごとに作る (動的はモーフで書き直す、静的は作ったきり)
+	auto createVertexBuffer = [&](const void* data, UINT stride, size_t count,
+								  winrt::com_ptr<ID3D12Resource>& outBuffer, D3D12_VERTEX_BUFFER_VIEW& outView) {
+		const UINT size = static_cast<UINT>(count * stride);
+		auto bufDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
 		DX_CALL(m_ctx->Device()->CreateCommittedResource(
 			&heapProps, D3D12_HEAP_FLAG_NONE, &bufDesc,
 			D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-			IID_PPV_ARGS(m_pmx.vb.put())));
+			IID_PPV_ARGS(outBuffer.put())));
 
 		void* mapped = nullptr;
 		CD3DX12_RANGE range(0, 0);
-		DX_CALL(m_pmx.vb->Map(0, &range, &mapped));
-		std::memcpy(mapped, vtx.data(), vbSize);
-		m_pmx.vb->Unmap(0, nullptr);
+		DX_CALL(outBuffer->Map(0, &range, &mapped));
+		std::memcpy(mapped, data, size);
+		outBuffer->Unmap(0, nullptr);
 
-		m_pmx.vbv.BufferLocation = m_pmx.vb->GetGPUVirtualAddress();
-		m_pmx.vbv.StrideInBytes = sizeof(PmxVsVertex);
-		m_pmx.vbv.SizeInBytes = vbSize;
-	}
+		outView.BufferLocation = outBuffer->GetGPUVirtualAddress();
+		outView.StrideInBytes = stride;
+		outView.SizeInBytes = size;
+		};
+
+	createVertexBuffer(dynamicVertices.data(), sizeof(PmxVertexStreams::DynamicVertex), dynamicVertices.size(),
+					   m_pmx.dynamicVb, m_pmx.vbvs[0]);
+	createVertexBuffer(staticVertices.data(), sizeof(PmxVertexStreams::StaticVertex), staticVertices.size(),
+					   m_pmx.staticVb, m_pmx.vbvs[1]);
+	m_pmx.vertexCount = dynamicVertices.size();
 
 	{
 		auto bufDesc = CD3DX12_RESOURCE_DESC::Buffer(ibSize);
@@ -337,8 +358,8 @@ void PmxModelDrawer::EnsurePmxResources(const PmxModel* model, const LightSettin
 		}
 		m_resources->CopySrv(gm.srvBlockIndex + 2, sphereSrv);
 
-		const bool isFace = LooksLikeFaceMaterial(mat);
-		if (isFace)
+		gm.isFace = LooksLikeFaceMaterial(mat);
+		if (gm.isFace)
 		{
 			shadowMul = lightSettings.faceShadowMul;
 			toonContrastMul = lightSettings.faceToonContrastMul;
@@ -346,24 +367,25 @@ void PmxModelDrawer::EnsurePmxResources(const PmxModel* model, const LightSettin
 
 		gm.materialCbGpu = m_materialCb->GetGPUVirtualAddress() + mi * m_materialCbStride;
 
-		MaterialCB* mcb = reinterpret_cast<MaterialCB*>(m_materialCbMapped + mi * m_materialCbStride);
-		mcb->diffuse = { mat.diffuse[0],  mat.diffuse[1],  mat.diffuse[2],  mat.diffuse[3] };
-		mcb->ambient = { mat.ambient[0],  mat.ambient[1],  mat.ambient[2] };
-		mcb->specular = { mat.specular[0], mat.specular[1], mat.specular[2] };
-		mcb->specPower = mat.specularPower;
-		mcb->sphereMode = mat.sphereMode;
-		mcb->edgeSize = edgeSize;
-		mcb->edgeColor = { mat.edgeColor[0], mat.edgeColor[1], mat.edgeColor[2], mat.edgeColor[3] };
-
-		mcb->materialType = matType;
-		mcb->rimMul = rimMul;
-		mcb->specMul = specMul;
-		mcb->shadowMul = shadowMul;
-		mcb->toonContrastMul = toonContrastMul;
+		// 色・エッジはモーフなしの値。以降はモーフや設定が変わった材質だけ書き直す
+		MaterialCB& mcb = gm.params;
+		ComputeMorphedMaterial(gm.mat, {}, nullptr, mcb);
+		mcb.sphereMode = mat.sphereMode;
+
+		mcb.materialType = matType;
+		mcb.rimMul = rimMul;
+		mcb.specMul = specMul;
+		mcb.shadowMul = shadowMul;
+		mcb.toonContrastMul = toonContrastMul;
 
 		m_pmx.materials.push_back(gm);
 	}
 
+	m_materialMorphWeights.clear();
+	m_faceShadowMul = lightSettings.faceShadowMul;
+	m_faceToonContrastMul = lightSettings.faceToonContrastMul;
+	FlushMaterialCbs();
+
 	m_pmx.indexCount = static_cast<uint32_t>(inds.size());
 	m_pmx.revision = model->Revision();
 	m_pmx.ready = true;
@@ -373,42 +395,37 @@ void PmxModelDrawer::UpdateMaterialSettings(const LightSettings& lightSettings)
 {
 	if (!m_pmx.ready || !m_materialCbMapped) return;
 
-	for (size_t mi = 0; mi < m_pmx.materials.size(); ++mi)
+	// 設定で変わるのは顔の材質の影の濃さとトゥーン境界だけ (他の材質は種類から決まる)
+	if (lightSettings.faceShadowMul == m_faceShadowMul &&
+		lightSettings.faceToonContrastMul == m_faceToonContrastMul)
 	{
-		auto& gm = m_pmx.materials[mi];
-
-		uint32_t matType = GuessMaterialType(gm.mat);
-		float rimMul, specMul, shadowMul, toonContrastMul;
-		GetMaterialStyleParams(matType, rimMul, specMul, shadowMul, toonContrastMul);
-
-		if (LooksLikeFaceMaterial(gm.mat))
-		{
-			shadowMul = lightSettings.faceShadowMul;
-			toonContrastMul = lightSettings.faceToonContrastMul;
-		}
+		return;
+	}
+	m_faceShadowMul = lightSettings.faceShadowMul;
+	m_faceToonContrastMul = lightSettings.faceToonContrastMul;
 
-		MaterialCB* mcb = reinterpret_cast<MaterialCB*>(m_materialCbMapped + mi * m_materialCbStride);
-		mcb->shadowMul = shadowMul;
-		mcb->toonContrastMul = toonContrastMul;
+	for (auto& gm : m_pmx.materials)
+	{
+		if (!gm.isFace) continue;
+		gm.params.shadowMul = m_faceShadowMul;
+		gm.params.toonContrastMul = m_faceToonContrastMul;
+		++gm.generation;
 	}
+
+	FlushMaterialCbs();
 }
 
-void PmxModelDrawer::AddMorphWeight(const PmxModel* model, int morphIndex, float weight, std::vector<float>& totalWeights)
+void PmxModelDrawer::FlushMaterialCbs()
 {
-	if (morphIndex < 0 || morphIndex >= static_cast<int>(totalWeights.size())) return;
+	if (!m_materialCbMapped) return;
 
-	const auto& m = model->Morphs()[morphIndex];
-
-	if (m.type == PmxModel::Morph::Type::Group)
-	{
-		for (const auto& offset : m.groupOffsets)
-		{
-			AddMorphWeight(model, offset.morphIndex, weight * offset.weight, totalWeights);
-		}
-	}
-	else
+	for (size_t mi = 0; mi < m_pmx.materials.size(); ++mi)
 	{
-		totalWeights[morphIndex] += weight;
+		auto& gm = m_pmx.materials[mi];
+		if (gm.writtenGeneration == gm.generation) continue;
+
+		std::memcpy(m_materialCbMapped + mi * m_materialCbStride, &gm.params, sizeof(MaterialCB));
+		gm.writtenGeneration = gm.generation;
 	}
 }
 
@@ -421,199 +438,102 @@ void PmxModelDrawer::UpdatePmxMorphs(const MmdAnimator& animator)
 	const auto& morphs = model->Morphs();
 	if (morphs.empty()) return;
 
-	if (m_morphWeights.size() != morphs.size())
-	{
-		m_morphWeights.resize(morphs.size());
-	}
-	std::fill(m_morphWeights.begin(), m_morphWeights.end(), 0.0f);
-
-	const auto& currentPose = animator.CurrentPose();
-
-	for (size_t i = 0; i < morphs.size(); ++i)
-	{
-		auto it = currentPose.morphWeights.find(morphs[i].name);
-		if (it != currentPose.morphWeights.end())
-		{
-			float w = it->second;
-			if (std::abs(w) > 0.0001f)
-			{
-				AddMorphWeight(model, static_cast<int>(i), w, m_morphWeights);
-			}
-		}
-	}
-
-	if (m_baseVertices.empty()) return;
-
-	if (m_workingVertices.size() != m_baseVertices.size())
-	{
-		m_workingVertices = m_baseVertices;
-	}
-	else
-	{
-		std::memcpy(m_workingVertices.data(), m_baseVertices.data(), m_baseVertices.size() * sizeof(PmxVsVertex));
-	}
-
-	bool vertexDirty = false;
+	// グループ/フリップは MmdAnimator の Tick で展開済み
+	const auto& morphGraph = animator.CurrentMorphs();
+	const auto& morphWeights = morphGraph.Weights();
 
-	for (size_t i = 0; i < morphs.size(); ++i)
+	// ウェイトが変わったモーフの差分だけを反映し、変わった頂点の範囲だけを書き込む
+	// (まばたき 1 つでメッシュ全体を複製・転送しない)
+	if (m_vertexMorpher.Apply(morphWeights) && m_pmx.dynamicVb &&
+		m_vertexMorpher.VertexCount() == m_pmx.vertexCount)
 	{
-		float w = m_morphWeights[i];
-		if (std::abs(w) < 0.0001f) continue;
-
-		const auto& m = morphs[i];
+		const auto& positions = m_vertexMorpher.Positions();
+		const auto& uvs = m_vertexMorpher.Uvs();
+		const auto& ranges = m_vertexMorpher.DirtyRanges();
 
-		if (m.type == PmxModel::Morph::Type::Vertex)
-		{
-			vertexDirty = true;
-			for (const auto& vo : m.vertexOffsets)
-			{
-				if (vo.vertexIndex < m_workingVertices.size())
-				{
-					auto& v = m_workingVertices[vo.vertexIndex];
-					v.px += vo.positionOffset.x * w;
-					v.py += vo.positionOffset.y * w;
-					v.pz += vo.positionOffset.z * w;
-				}
-			}
-		}
-		else if (m.type == PmxModel::Morph::Type::UV)
+		void* mapped = nullptr;
+		CD3DX12_RANGE readRange(0, 0);
+		if (SUCCEEDED(m_pmx.dynamicVb->Map(0, &readRange, &mapped)))
 		{
-			vertexDirty = true;
-			for (const auto& uvo : m.uvOffsets)
+			auto* dst = static_cast<PmxVertexStreams::DynamicVertex*>(mapped);
+			for (const auto& r : ranges)
 			{
-				if (uvo.vertexIndex < m_workingVertices.size())
+				for (uint32_t vi = r.begin; vi < r.end; ++vi)
 				{
-					auto& v = m_workingVertices[uvo.vertexIndex];
-					v.u += uvo.offset.x * w;
-					v.v += uvo.offset.y * w;
+					dst[vi] = { positions[vi].x, positions[vi].y, positions[vi].z, uvs[vi].x, uvs[vi].y };
 				}
 			}
+			CD3DX12_RANGE writtenRange(ranges.front().begin * sizeof(PmxVertexStreams::DynamicVertex),
+									   ranges.back().end * sizeof(PmxVertexStreams::DynamicVertex));
+			m_pmx.dynamicVb->Unmap(0, &writtenRange);
 		}
 	}
 
-	if (vertexDirty && m_pmx.vb)
+	// 材質ごとに、効く材質モーフのウェイトが前回から変わったときだけ求め直す
+	const size_t entryCount = morphGraph.MaterialEntryCount();
+	if (m_materialMorphWeights.size() != entryCount)
 	{
-		void* mapped = nullptr;
-		CD3DX12_RANGE range(0, 0);
-		if (SUCCEEDED(m_pmx.vb->Map(0, &range, &mapped)))
-		{
-			std::memcpy(mapped, m_workingVertices.data(), m_workingVertices.size() * sizeof(PmxVsVertex));
-			m_pmx.vb->Unmap(0, nullptr);
-		}
+		// 材質はウェイト 0 の状態で作ってある
+		m_materialMorphWeights.assign(entryCount, 0.0f);
 	}
 
+	size_t entryBase = 0;
 	for (size_t mi = 0; mi < m_pmx.materials.size(); ++mi)
 	{
-		const auto& gm = m_pmx.materials[mi];
-
-		MaterialCB* cb = reinterpret_cast<MaterialCB*>(m_materialCbMapped + mi * m_materialCbStride);
-
-		cb->diffuse = { gm.mat.diffuse[0], gm.mat.diffuse[1], gm.mat.diffuse[2], gm.mat.diffuse[3] };
-		cb->specular = { gm.mat.specular[0], gm.mat.specular[1], gm.mat.specular[2] };
-		cb->specPower = gm.mat.specularPower;
-		cb->ambient = { gm.mat.ambient[0], gm.mat.ambient[1], gm.mat.ambient[2] };
-		cb->edgeColor = { gm.mat.edgeColor[0], gm.mat.edgeColor[1], gm.mat.edgeColor[2], gm.mat.edgeColor[3] };
-		cb->edgeSize = gm.mat.edgeSize;
+		auto& gm = m_pmx.materials[mi];
+		const auto entries = morphGraph.MaterialEntries(mi);
+		float* cachedWeights = m_materialMorphWeights.data() + entryBase;
+		entryBase += entries.size();
 
-		for (size_t i = 0; i < morphs.size(); ++i)
+		bool changed = false;
+		for (size_t k = 0; k < entries.size(); ++k)
 		{
-			float w = m_morphWeights[i];
-			if (std::abs(w) < 0.0001f) continue;
-
-			const auto& m = morphs[i];
-			if (m.type == PmxModel::Morph::Type::Material)
+			const auto morphIndex = entries[k].morphIndex;
+			float w = morphIndex < morphWeights.size() ? morphWeights[morphIndex] : 0.0f;
+			if (std::abs(w) < 0.0001f) w = 0.0f;
+			if (w != cachedWeights[k])
 			{
-				for (const auto& mo : m.materialOffsets)
-				{
-					if (mo.materialIndex == -1 || mo.materialIndex == static_cast<int>(mi))
-					{
-						if (mo.operation == 0)
-						{
-							auto applyMul4 = [&](DirectX::XMFLOAT4& target, const DirectX::XMFLOAT4& offset) {
-								target.x *= (1.0f + (offset.x - 1.0f) * w);
-								target.y *= (1.0f + (offset.y - 1.0f) * w);
-								target.z *= (1.0f + (offset.z - 1.0f) * w);
-								target.w *= (1.0f + (offset.w - 1.0f) * w);
-								};
-							auto applyMul3 = [&](DirectX::XMFLOAT3& target, const DirectX::XMFLOAT3& offset) {
-								target.x *= (1.0f + (offset.x - 1.0f) * w);
-								target.y *= (1.0f + (offset.y - 1.0f) * w);
-								target.z *= (1.0f + (offset.z - 1.0f) * w);
-								};
-							auto applyMul1 = [&](float& target, float offset) {
-								target *= (1.0f + (offset - 1.0f) * w);
-								};
-
-							applyMul4(cb->diffuse, mo.diffuse);
-							applyMul3(cb->specular, mo.specular);
-							applyMul1(cb->specPower, mo.specularPower);
-							applyMul3(cb->ambient, mo.ambient);
-							applyMul4(cb->edgeColor, mo.edgeColor);
-							applyMul1(cb->edgeSize, mo.edgeSize);
-						}
-						else if (mo.operation == 1)
-						{
-							auto applyAdd4 = [&](DirectX::XMFLOAT4& target, const DirectX::XMFLOAT4& offset) {
-								target.x += offset.x * w;
-								target.y += offset.y * w;
-								target.z += offset.z * w;
-								target.w += offset.w * w;
-								};
-							auto applyAdd3 = [&](DirectX::XMFLOAT3& target, const DirectX::XMFLOAT3& offset) {
-								target.x += offset.x * w;
-								target.y += offset.y * w;
-								target.z += offset.z * w;
-								};
-							auto applyAdd1 = [&](float& target, float offset) {
-								target += offset * w;
-								};
-
-							applyAdd4(cb->diffuse, mo.diffuse);
-							applyAdd3(cb->specular, mo.specular);
-							applyAdd1(cb->specPower, mo.specularPower);
-							applyAdd3(cb->ambient, mo.ambient);
-							applyAdd4(cb->edgeColor, mo.edgeColor);
-							applyAdd1(cb->edgeSize, mo.edgeSize);
-						}
-					}
-				}
+				cachedWeights[k] = w;
+				changed = true;
 			}
 		}
+		if (!changed) continue;
 
-		auto saturateColor = [](float& v) { v = std::clamp(v, 0.0f, 1.0f); };
-		saturateColor(cb->diffuse.x); saturateColor(cb->diffuse.y); saturateColor(cb->diffuse.z); saturateColor(cb->diffuse.w);
-		saturateColor(cb->specular.x); saturateColor(cb->specular.y); saturateColor(cb->specular.z);
-		saturateColor(cb->ambient.x); saturateColor(cb->ambient.y); saturateColor(cb->ambient.z);
-		saturateColor(cb->edgeColor.x); saturateColor(cb->edgeColor.y); saturateColor(cb->edgeColor.z); saturateColor(cb->edgeColor.w);
-		cb->edgeSize = std::max(0.0f, cb->edgeSize);
+		ComputeMorphedMaterial(gm.mat, entries, cachedWeights, gm.params);
+		++gm.generation;
 	}
+
+	FlushMaterialCbs();
 }
 
 void PmxModelDrawer::UpdateBoneMatrices(const MmdAnimator& animator, BoneCB* dst)
 {
 	if (!dst) return;
 
+	auto upload = std::find_if(m_boneUploads.begin(), m_boneUploads.end(),
+							   [dst](const BoneUploadState& u) { return u.dst == dst; });
+	if (upload == m_boneUploads.end())
+	{
+		m_boneUploads.push_back({ dst });
+		upload = m_boneUploads.end() - 1;
+	}
+
 	if (animator.HasSkinnedPose())
 	{
-		const auto& matrices = animator.GetSkinningMatrices();
-		size_t count = std::min(matrices.size(), static_cast<size_t>(MaxBones));
+		const size_t count = std::min(animator.GetBoneCount(), static_cast<size_t>(MaxBones));
 
-		for (size_t i = 0; i < count; ++i)
-		{
-			DirectX::XMMATRIX mat = DirectX::XMLoadFloat4x4(&matrices[i]);
-			DirectX::XMStoreFloat4x4(&dst->boneMatrices[i], DirectX::XMMatrixTranspose(mat));
-		}
+		// 前回この書き込み先に書いたときから変わったボーンだけを書き直す
+		// (待機中は数本しか動かない)。モデルのボーン数より後ろは頂点から参照されないので書かない
+		const bool partial = upload->valid && upload->boneCount == count;
+		animator.WriteSkinningPalette(dst->boneMatrices, count, partial ? upload->revision : 0);
 
-		for (size_t i = count; i < MaxBones; ++i)
-		{
-			DirectX::XMStoreFloat4x4(&dst->boneMatrices[i], DirectX::XMMatrixIdentity());
-		}
+		upload->revision = animator.SkinningRevision();
+		upload->boneCount = count;
+		upload->valid = true;
 	}
 	else
 	{
-		for (size_t i = 0; i < MaxBones; ++i)
-		{
-			DirectX::XMStoreFloat4x4(&dst->boneMatrices[i], DirectX::XMMatrixIdentity());
-		}
+		// スキニングしない間はシェーダー側で行列を読まない (SceneCB::enableSkinning)
+		upload->valid = false;
 	}
 }
\ No newline at end of file
@@ -12,26 +12,15 @@
 #include "GpuResourceManager.hpp"
 #include "MmdAnimator.hpp"
 #include "PmxModel.hpp"
+#include "PmxVertexStreams.hpp"
 #include "Settings.hpp"
+#include "VertexMorpher.hpp"
 
 class PmxModelDrawer
 {
 public:
 	static constexpr size_t MaxBones = 1024;
 
-	struct PmxVsVertex
-	{
-		float px, py, pz;
-		float nx, ny, nz;
-		float u, v;
-		int32_t boneIndices[4];
-		float boneWeights[4];
-		float sdefC[3];
-		float sdefR0[3];
-		float sdefR1[3];
-		uint32_t weightType;
-	};
-
 	struct alignas(16) MaterialCB
 	{
 		DirectX::XMFLOAT4 diffuse;
@@ -51,23 +40,32 @@ public:
 		float _pad2{};
 	};
 
+	// ボーン 1 本 48 バイト (転置済み 3x4)。シェーダー側は float4x3 の配列
 	struct alignas(16) BoneCB
 	{
-		DirectX::XMFLOAT4X4 boneMatrices[MaxBones];
+		DirectX::XMFLOAT3X4 boneMatrices[MaxBones];
 	};
+	static_assert(sizeof(DirectX::XMFLOAT3X4) == 48);
 
 	struct PmxGpuMaterial
 	{
 		PmxModel::Material mat;
 		uint32_t srvBlockIndex{};
 		D3D12_GPU_VIRTUAL_ADDRESS materialCbGpu{};
+
+		MaterialCB params{};              // モーフと設定を反映した値 (MaterialCB に書く内容)
+		bool isFace{ false };             // 影の濃さ・トゥーン境界を LightSettings の顔用の値から取る
+		uint64_t generation{ 1 };         // params が変わるたびに増える
+		uint64_t writtenGeneration{ 0 };  // MaterialCB に書いたときの generation
 	};
 
 	struct PmxGpu
 	{
-		winrt::com_ptr<ID3D12Resource> vb;
+		winrt::com_ptr<ID3D12Resource> dynamicVb;   // 位置/UV (モーフで書き直す)
+		winrt::com_ptr<ID3D12Resource> staticVb;    // 法線・スキニング情報
 		winrt::com_ptr<ID3D12Resource> ib;
-		D3D12_VERTEX_BUFFER_VIEW vbv{};
+		D3D12_VERTEX_BUFFER_VIEW vbvs[2]{};         // 入力スロット 0: 動的, 1: 静的
+		size_t vertexCount{};
 		D3D12_INDEX_BUFFER_VIEW ibv{};
 		std::vector<PmxGpuMaterial> materials;
 		uint32_t indexCount{};
@@ -105,7 +103,8 @@ public:
 	}
 
 private:
-	void AddMorphWeight(const PmxModel* model, int morphIndex, float weight, std::vector<float>& totalWeights);
+	// generation が書いたときから進んだ材質だけ MaterialCB に書く
+	void FlushMaterialCbs();
 
 	Dx12Context* m_ctx{};
 	GpuResourceManager* m_resources{};
@@ -116,7 +115,22 @@ private:
 	uint8_t* m_materialCbMapped = nullptr;
 	UINT64 m_materialCbStride = 256;
 
-	std::vector<PmxVsVertex> m_baseVertices;
-	std::vector<PmxVsVertex> m_workingVertices;
-	std::vector<float> m_morphWeights;
+	VertexMorpher m_vertexMorpher;
+
+	// 材質モーフの要素 (MorphGraph::MaterialEntries を材質順に並べたもの) ごとに、いまの params に使ったウェイト
+	std::vector<float> m_materialMorphWeights;
+	// いまの params に使った LightSettings の顔用の値
+	float m_faceShadowMul{};
+	float m_faceToonContrastMul{};
+
+	// ボーン行列の書き込み先ごとに、どの時点のスキニング行列まで書いたか。
+	// 前回から値が変わったボーンだけを書き直すのに使う。
+	struct BoneUploadState
+	{
+		const BoneCB* dst{};
+		uint64_t revision{};
+		size_t boneCount{};
+		bool valid{ false };
+	};
+	std::vector<BoneUploadState> m_boneUploads;
 };
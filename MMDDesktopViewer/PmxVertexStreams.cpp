@@ -0,0 +1,89 @@
+﻿#include "PmxVertexStreams.hpp"
+
+namespace PmxVertexStreams
+{
+	void CleanBoneWeights(const PmxModel::VertexWeight& weight, size_t boneCount,
+						  std::int32_t (&outBones)[4], float (&outWeights)[4])
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			outBones[i] = -1;
+			outWeights[i] = 0.0f;
+		}
+
+		int32_t fallbackBone = -1;
+		for (int i = 0; i < 4; ++i)
+		{
+			int32_t boneIdx = weight.boneIndices[i];
+			float w = weight.weights[i];
+
+			if (boneIdx >= 0 && boneIdx < static_cast<int32_t>(boneCount) && w > 0.0f)
+			{
+				outBones[i] = boneIdx;
+				outWeights[i] = w;
+				if (fallbackBone < 0) fallbackBone = boneIdx;
+			}
+		}
+
+		float totalWeight = outWeights[0] + outWeights[1] + outWeights[2] + outWeights[3];
+
+		if (totalWeight > 0.001f)
+		{
+			for (int i = 0; i < 4; ++i)
+			{
+				outWeights[i] /= totalWeight;
+			}
+		}
+		else if (fallbackBone >= 0)
+		{
+			// ほぼ 0 のウェイトは残さない (合計が 1 からずれ、同じボーンが 2 つの枠に入りうる)
+			for (int i = 1; i < 4; ++i)
+			{
+				outBones[i] = -1;
+				outWeights[i] = 0.0f;
+			}
+			outBones[0] = fallbackBone;
+			outWeights[0] = 1.0f;
+		}
+	}
+
+	void Build(const PmxModel& model, std::vector<DynamicVertex>& outDynamic, std::vector<StaticVertex>& outStatic)
+	{
+		const auto& verts = model.Vertices();
+		const auto boneCount = model.Bones().size();
+
+		outDynamic.clear();
+		outStatic.clear();
+		outDynamic.reserve(verts.size());
+		outStatic.reserve(verts.size());
+
+		for (const auto& v : verts)
+		{
+			DynamicVertex dv{};
+			dv.px = v.px; dv.py = v.py; dv.pz = v.pz;
+			dv.u = v.u; dv.v = v.v;
+			outDynamic.push_back(dv);
+
+			StaticVertex sv{};
+			sv.nx = v.nx; sv.ny = v.ny; sv.nz = v.nz;
+
+			CleanBoneWeights(v.weight, boneCount, sv.boneIndices, sv.boneWeights);
+
+			sv.weightType = v.weight.type;
+			if (v.weight.type == 3)
+			{
+				sv.sdefC[0] = v.weight.sdefC.x;
+				sv.sdefC[1] = v.weight.sdefC.y;
+				sv.sdefC[2] = v.weight.sdefC.z;
+				sv.sdefR0[0] = v.weight.sdefR0.x;
+				sv.sdefR0[1] = v.weight.sdefR0.y;
+				sv.sdefR0[2] = v.weight.sdefR0.z;
+				sv.sdefR1[0] = v.weight.sdefR1.x;
+				sv.sdefR1[1] = v.weight.sdefR1.y;
+				sv.sdefR1[2] = v.weight.sdefR1.z;
+			}
+
+			outStatic.push_back(sv);
+		}
+	}
+}
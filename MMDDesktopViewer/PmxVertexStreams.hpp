@@ -0,0 +1,41 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "PmxModel.hpp"
+
+// 描画用の頂点ストリーム。
+// モーフで書き換える位置/UV (動的) と、読み込み後は変わらない法線・スキニング情報 (静的) を別のバッファに分け、
+// モーフのたびに書き直すのは 1 頂点 20 バイトだけにする。
+// 入力レイアウトはスロット 0 が DynamicVertex、スロット 1 が StaticVertex (RenderPipelineManager)。
+namespace PmxVertexStreams
+{
+	struct DynamicVertex
+	{
+		float px, py, pz;
+		float u, v;
+	};
+
+	struct StaticVertex
+	{
+		float nx, ny, nz;
+		std::int32_t boneIndices[4];
+		float boneWeights[4];
+		float sdefC[3];
+		float sdefR0[3];
+		float sdefR1[3];
+		std::uint32_t weightType;
+	};
+
+	static_assert(sizeof(DynamicVertex) == 20);
+	static_assert(sizeof(StaticVertex) == 84);
+
+	// 頂点のボーンウェイトを描画用に整える (Build と CpuSkinner で共通)。
+	// 無効なボーン (範囲外・ウェイト 0 以下) は -1 / 0 にし、残りを合計 1 に正規化する。
+	// 有効なウェイトの合計がほぼ 0 なら、最初の有効なボーンだけをウェイト 1 で残す
+	void CleanBoneWeights(const PmxModel::VertexWeight& weight, size_t boneCount,
+						  std::int32_t (&outBones)[4], float (&outWeights)[4]);
+
+	// 頂点ごとに 1 要素ずつ作る。ボーンウェイトは CleanBoneWeights で整える。
+	void Build(const PmxModel& model, std::vector<DynamicVertex>& outDynamic, std::vector<StaticVertex>& outStatic);
+}
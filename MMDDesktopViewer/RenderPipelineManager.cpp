@@ -4,12 +4,67 @@
 #include "ExceptionHelper.hpp"
 #include "FileUtil.hpp"
 #include "DebugUtil.hpp"
+#include "PmxModelDrawer.hpp"
+#include "PmxVertexStreams.hpp"
 
 #include <d3dcompiler.h>
+#include <d3d12shader.h>
+#include <cstddef>
 #include <filesystem>
+#include <system_error>
 
 #pragma comment(lib, "d3dcompiler.lib")
 
+namespace
+{
+	using PmxVertexStreams::DynamicVertex;
+	using PmxVertexStreams::StaticVertex;
+
+	// PMX_VS / Edge_VS 共通。スロット 0 が動的ストリーム、スロット 1 が静的ストリーム
+	const D3D12_INPUT_ELEMENT_DESC PmxInputLayout[] = {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(DynamicVertex, px), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, offsetof(DynamicVertex, u), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 1, offsetof(StaticVertex, nx), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "BLENDINDICES", 0, DXGI_FORMAT_R32G32B32A32_SINT, 1, offsetof(StaticVertex, boneIndices), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "BLENDWEIGHT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(StaticVertex, boneWeights), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 1, DXGI_FORMAT_R32G32B32_FLOAT, 1, offsetof(StaticVertex, sdefC), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 2, DXGI_FORMAT_R32G32B32_FLOAT, 1, offsetof(StaticVertex, sdefR0), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 3, DXGI_FORMAT_R32G32B32_FLOAT, 1, offsetof(StaticVertex, sdefR1), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 4, DXGI_FORMAT_R32_UINT, 1, offsetof(StaticVertex, weightType), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	};
+
+	// コンパイル済みシェーダーがあり、元の .hlsl より古くなければ使う
+	// (シェーダーを更新したのに古い .cso を読み続けないように)
+	bool IsCompiledShaderFresh(const std::wstring& compiledPath, const std::wstring& sourcePath)
+	{
+		std::error_code ec;
+		if (!std::filesystem::exists(compiledPath, ec)) return false;
+
+		const auto sourceTime = std::filesystem::last_write_time(sourcePath, ec);
+		if (ec) return true;
+		const auto compiledTime = std::filesystem::last_write_time(compiledPath, ec);
+		if (ec) return false;
+		return compiledTime >= sourceTime;
+	}
+
+	// スキニングする頂点シェーダーは、BoneCB の大きさが PmxModelDrawer::BoneCB と一致することも確かめる
+	// (float4x4 のパレットでコンパイルされた .cso は、.hlsl より新しくても使わない)
+	bool IsCompiledSkinningShaderFresh(const std::wstring& compiledPath, const std::wstring& sourcePath)
+	{
+		if (!IsCompiledShaderFresh(compiledPath, sourcePath)) return false;
+
+		winrt::com_ptr<ID3DBlob> blob;
+		if (FAILED(D3DReadFileToBlob(compiledPath.c_str(), blob.put()))) return false;
+
+		winrt::com_ptr<ID3D12ShaderReflection> reflection;
+		if (FAILED(D3DReflect(blob->GetBufferPointer(), blob->GetBufferSize(), IID_PPV_ARGS(reflection.put())))) return false;
+
+		D3D12_SHADER_BUFFER_DESC desc{};
+		if (FAILED(reflection->GetConstantBufferByName("BoneCB")->GetDesc(&desc))) return false;
+		return desc.Size == sizeof(PmxModelDrawer::BoneCB);
+	}
+}
+
 void RenderPipelineManager::Initialize(Dx12Context* ctx)
 {
 	m_ctx = ctx;
@@ -87,7 +142,8 @@ void RenderPipelineManager::CreatePmxPipeline(UINT msaaSampleCount, UINT msaaQua
 
 	HRESULT hr;
 
-	if (std::filesystem::exists(vscompiled))
+	const bool vsCached = IsCompiledSkinningShaderFresh(vscompiled, vsname);
+	if (vsCached)
 	{
 		hr = D3DReadFileToBlob(vscompiled.c_str(), vsBlob.put());
 		if (FAILED(hr))
@@ -106,12 +162,12 @@ void RenderPipelineManager::CreatePmxPipeline(UINT msaaSampleCount, UINT msaaQua
 		ThrowIfFailedEx(hr, "D3DCompile PMX VS", FILENAME, __LINE__);
 	}
 
-	if (!std::filesystem::exists(vscompiled))
+	if (!vsCached)
 	{
-		D3DWriteBlobToFile(vsBlob.get(), vscompiled.c_str(), FALSE);
+		D3DWriteBlobToFile(vsBlob.get(), vscompiled.c_str(), TRUE);
 	}
 
-	if (std::filesystem::exists(pscompiled))
+	if (IsCompiledShaderFresh(pscompiled, psname))
 	{
 		hr = D3DReadFileToBlob(pscompiled.c_str(), psBlob.put());
 		if (FAILED(hr))
@@ -130,29 +186,17 @@ void RenderPipelineManager::CreatePmxPipeline(UINT msaaSampleCount, UINT msaaQua
 		ThrowIfFailedEx(hr, "D3DCompile PMX PS", FILENAME, __LINE__);
 	}
 
-	if (!std::filesystem::exists(pscompiled))
+	if (!IsCompiledShaderFresh(pscompiled, psname))
 	{
-		D3DWriteBlobToFile(psBlob.get(), pscompiled.c_str(), FALSE);
+		D3DWriteBlobToFile(psBlob.get(), pscompiled.c_str(), TRUE);
 	}
 
-	D3D12_INPUT_ELEMENT_DESC layout[] = {
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "BLENDINDICES", 0, DXGI_FORMAT_R32G32B32A32_SINT, 0, 32, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "BLENDWEIGHT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 48, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 1, DXGI_FORMAT_R32G32B32_FLOAT, 0, 64, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 2, DXGI_FORMAT_R32G32B32_FLOAT, 0, 76, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 3, DXGI_FORMAT_R32G32B32_FLOAT, 0, 88, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 4, DXGI_FORMAT_R32_UINT, 0, 100, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-	};
-
 	auto MakeBaseDesc = [&]() {
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC pso{};
 		pso.pRootSignature = m_pmxRootSig.get();
 		pso.VS = { vsBlob->GetBufferPointer(), vsBlob->GetBufferSize() };
 		pso.PS = { psBlob->GetBufferPointer(), psBlob->GetBufferSize() };
-		pso.InputLayout = { layout, _countof(layout) };
+		pso.InputLayout = { PmxInputLayout, _countof(PmxInputLayout) };
 		pso.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
 		pso.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
 		pso.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
@@ -207,7 +251,8 @@ void RenderPipelineManager::CreateEdgePipeline(UINT msaaSampleCount, UINT msaaQu
 
 	HRESULT hr;
 
-	if (std::filesystem::exists(vscompiled))
+	const bool vsCached = IsCompiledSkinningShaderFresh(vscompiled, vsname);
+	if (vsCached)
 	{
 		hr = D3DReadFileToBlob(vscompiled.c_str(), vsBlob.put());
 		if (FAILED(hr))
@@ -226,12 +271,12 @@ void RenderPipelineManager::CreateEdgePipeline(UINT msaaSampleCount, UINT msaaQu
 		ThrowIfFailedEx(hr, "D3DCompile Edge VS", FILENAME, __LINE__);
 	}
 
-	if (!std::filesystem::exists(vscompiled))
+	if (!vsCached)
 	{
-		D3DWriteBlobToFile(vsBlob.get(), vscompiled.c_str(), FALSE);
+		D3DWriteBlobToFile(vsBlob.get(), vscompiled.c_str(), TRUE);
 	}
 
-	if (std::filesystem::exists(pscompiled))
+	if (IsCompiledShaderFresh(pscompiled, psname))
 	{
 		hr = D3DReadFileToBlob(pscompiled.c_str(), psBlob.put());
 		if (FAILED(hr))
@@ -250,28 +295,16 @@ void RenderPipelineManager::CreateEdgePipeline(UINT msaaSampleCount, UINT msaaQu
 		ThrowIfFailedEx(hr, "D3DCompile Edge PS", FILENAME, __LINE__);
 	}
 
-	if (!std::filesystem::exists(pscompiled))
+	if (!IsCompiledShaderFresh(pscompiled, psname))
 	{
-		D3DWriteBlobToFile(psBlob.get(), pscompiled.c_str(), FALSE);
+		D3DWriteBlobToFile(psBlob.get(), pscompiled.c_str(), TRUE);
 	}
 
-	D3D12_INPUT_ELEMENT_DESC layout[] = {
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "BLENDINDICES", 0, DXGI_FORMAT_R32G32B32A32_SINT, 0, 32, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "BLENDWEIGHT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 48, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 1, DXGI_FORMAT_R32G32B32_FLOAT, 0, 64, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 2, DXGI_FORMAT_R32G32B32_FLOAT, 0, 76, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 3, DXGI_FORMAT_R32G32B32_FLOAT, 0, 88, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 4, DXGI_FORMAT_R32_UINT, 0, 100, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-	};
-
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC pso{};
 	pso.pRootSignature = m_pmxRootSig.get();
 	pso.VS = { vsBlob->GetBufferPointer(), vsBlob->GetBufferSize() };
 	pso.PS = { psBlob->GetBufferPointer(), psBlob->GetBufferSize() };
-	pso.InputLayout = { layout, _countof(layout) };
+	pso.InputLayout = { PmxInputLayout, _countof(PmxInputLayout) };
 	pso.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
 	pso.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
 	pso.RasterizerState.CullMode = D3D12_CULL_MODE_FRONT;
@@ -332,7 +365,7 @@ void RenderPipelineManager::CreateFxaaPipeline()
 
 	HRESULT hr;
 
-	if (std::filesystem::exists(vscompiled))
+	if (IsCompiledShaderFresh(vscompiled, vsname))
 	{
 		hr = D3DReadFileToBlob(vscompiled.c_str(), vsBlob.put());
 		if (FAILED(hr))
@@ -351,12 +384,12 @@ void RenderPipelineManager::CreateFxaaPipeline()
 		ThrowIfFailedEx(hr, "D3DCompile FXAA VS", FILENAME, __LINE__);
 	}
 
-	if (!std::filesystem::exists(vscompiled))
+	if (!IsCompiledShaderFresh(vscompiled, vsname))
 	{
-		D3DWriteBlobToFile(vsBlob.get(), vscompiled.c_str(), FALSE);
+		D3DWriteBlobToFile(vsBlob.get(), vscompiled.c_str(), TRUE);
 	}
 
-	if (std::filesystem::exists(pscompiled))
+	if (IsCompiledShaderFresh(pscompiled, psname))
 	{
 		hr = D3DReadFileToBlob(pscompiled.c_str(), psBlob.put());
 		if (FAILED(hr))
@@ -375,9 +408,9 @@ void RenderPipelineManager::CreateFxaaPipeline()
 		ThrowIfFailedEx(hr, "D3DCompile FXAA PS", FILENAME, __LINE__);
 	}
 
-	if (!std::filesystem::exists(pscompiled))
+	if (!IsCompiledShaderFresh(pscompiled, psname))
 	{
-		D3DWriteBlobToFile(psBlob.get(), pscompiled.c_str(), FALSE);
+		D3DWriteBlobToFile(psBlob.get(), pscompiled.c_str(), TRUE);
 	}
 
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC pso{};
@@ -195,6 +195,7 @@ bool ParsePhysicsSettingLine(const std::wstring& key, const std::wstring& value,
 	if (subKey == L"fixedTimeStep") physics.fixedTimeStep = ParseFloat(value, physics.fixedTimeStep);
 	else if (subKey == L"maxSubSteps") physics.maxSubSteps = ParseInt(value, physics.maxSubSteps);
 	else if (subKey == L"maxCatchUpSteps") physics.maxCatchUpSteps = ParseInt(value, physics.maxCatchUpSteps);
+	else if (subKey == L"asyncPhysics") physics.asyncPhysics = (value == L"1" || value == L"true" || value == L"True");
 	else if (subKey == L"gravityX") physics.gravity.x = ParseFloat(value, physics.gravity.x);
 	else if (subKey == L"gravityY") physics.gravity.y = ParseFloat(value, physics.gravity.y);
 	else if (subKey == L"gravityZ") physics.gravity.z = ParseFloat(value, physics.gravity.z);
@@ -202,6 +203,7 @@ bool ParsePhysicsSettingLine(const std::wstring& key, const std::wstring& value,
 	else if (subKey == L"jointCompliance") physics.jointCompliance = ParseFloat(value, physics.jointCompliance);
 	else if (subKey == L"contactCompliance") physics.contactCompliance = ParseFloat(value, physics.contactCompliance);
 	else if (subKey == L"jointWarmStart") physics.jointWarmStart = ParseFloat(value, physics.jointWarmStart);
+	else if (subKey == L"contactWarmStart") physics.contactWarmStart = ParseFloat(value, physics.contactWarmStart);
 	else if (subKey == L"postSolveVelocityBlend") physics.postSolveVelocityBlend = ParseFloat(value, physics.postSolveVelocityBlend);
 	else if (subKey == L"postSolveAngularVelocityBlend") physics.postSolveAngularVelocityBlend = ParseFloat(value, physics.postSolveAngularVelocityBlend);
 	else if (subKey == L"maxContactAngularCorrection") physics.maxContactAngularCorrection = ParseFloat(value, physics.maxContactAngularCorrection);
@@ -222,6 +224,7 @@ bool ParsePhysicsSettingLine(const std::wstring& key, const std::wstring& value,
 	else if (subKey == L"generatedBodyColliderRestitution") physics.generatedBodyColliderRestitution = ParseFloat(value, physics.generatedBodyColliderRestitution);
 	else if (subKey == L"solverIterations") physics.solverIterations = ParseInt(value, physics.solverIterations);
 	else if (subKey == L"collisionIterations") physics.collisionIterations = ParseInt(value, physics.collisionIterations);
+	else if (subKey == L"deterministicJointOrder") physics.deterministicJointOrder = (value == L"1" || value == L"true" || value == L"True");
 	else if (subKey == L"collisionMargin") physics.collisionMargin = ParseFloat(value, physics.collisionMargin);
 	else if (subKey == L"phantomMargin") physics.phantomMargin = ParseFloat(value, physics.phantomMargin);
 	else if (subKey == L"contactSlop") physics.contactSlop = ParseFloat(value, physics.contactSlop);
@@ -251,6 +254,7 @@ void WritePhysicsSettings(std::wostream& os, const PhysicsSettings& physics)
 	os << kPrefix << L"fixedTimeStep=" << FloatToWString(physics.fixedTimeStep) << L"\n";
 	os << kPrefix << L"maxSubSteps=" << IntToWString(physics.maxSubSteps) << L"\n";
 	os << kPrefix << L"maxCatchUpSteps=" << IntToWString(physics.maxCatchUpSteps) << L"\n";
+	os << kPrefix << L"asyncPhysics=" << (physics.asyncPhysics ? L"1" : L"0") << L"\n";
 	os << kPrefix << L"gravityX=" << FloatToWString(physics.gravity.x) << L"\n";
 	os << kPrefix << L"gravityY=" << FloatToWString(physics.gravity.y) << L"\n";
 	os << kPrefix << L"gravityZ=" << FloatToWString(physics.gravity.z) << L"\n";
@@ -258,6 +262,7 @@ void WritePhysicsSettings(std::wostream& os, const PhysicsSettings& physics)
 	os << kPrefix << L"jointCompliance=" << FloatToWString(physics.jointCompliance) << L"\n";
 	os << kPrefix << L"contactCompliance=" << FloatToWString(physics.contactCompliance) << L"\n";
 	os << kPrefix << L"jointWarmStart=" << FloatToWString(physics.jointWarmStart) << L"\n";
+	os << kPrefix << L"contactWarmStart=" << FloatToWString(physics.contactWarmStart) << L"\n";
 	os << kPrefix << L"postSolveVelocityBlend=" << FloatToWString(physics.postSolveVelocityBlend) << L"\n";
 	os << kPrefix << L"postSolveAngularVelocityBlend=" << FloatToWString(physics.postSolveAngularVelocityBlend) << L"\n";
 	os << kPrefix << L"maxContactAngularCorrection=" << FloatToWString(physics.maxContactAngularCorrection) << L"\n";
@@ -278,6 +283,7 @@ void WritePhysicsSettings(std::wostream& os, const PhysicsSettings& physics)
 	os << kPrefix << L"generatedBodyColliderRestitution=" << FloatToWString(physics.generatedBodyColliderRestitution) << L"\n";
 	os << kPrefix << L"solverIterations=" << IntToWString(physics.solverIterations) << L"\n";
 	os << kPrefix << L"collisionIterations=" << IntToWString(physics.collisionIterations) << L"\n";
+	os << kPrefix << L"deterministicJointOrder=" << (physics.deterministicJointOrder ? L"1" : L"0") << L"\n";
 	os << kPrefix << L"collisionMargin=" << FloatToWString(physics.collisionMargin) << L"\n";
 	os << kPrefix << L"phantomMargin=" << FloatToWString(physics.phantomMargin) << L"\n";
 	os << kPrefix << L"contactSlop=" << FloatToWString(physics.contactSlop) << L"\n";
@@ -65,6 +65,10 @@ struct PhysicsSettings
 	int maxSubSteps{ 2 };
 	int maxCatchUpSteps{ 4 };
 
+	// true なら物理を専用スレッドで fixedTimeStep ごとに進め、描画側は直近 2 ステップの結果を補間して書き戻すだけにする。
+	// 描画が詰まっても物理の時間は捨てられないが、物理で動くボーンは 1〜2 ステップ遅れて見える
+	bool asyncPhysics{ false };
+
 	DirectX::XMFLOAT3 gravity{ 0.0f, -9.8f, 0.0f };
 	float groundY{ -1000.0f };
 
@@ -80,6 +84,9 @@ struct PhysicsSettings
 	// 余計な力を持ち越さないようにリセットします。
 	float jointWarmStart{ 0.0f };
 
+	// 続いている接触で、前のサブステップに押し戻した量を先に適用する割合。0 なら毎回食い込みから解く
+	float contactWarmStart{ 0.0f };
+
 	// 揺れ抑制のため 0.0f を維持
 	float postSolveVelocityBlend{ 0.0f };
 	float postSolveAngularVelocityBlend{ 0.0f };
@@ -113,6 +120,10 @@ struct PhysicsSettings
 	int solverIterations{ 4 };
 	int collisionIterations{ 4 };
 
+	// ジョイントは互いに剛体を共有しない色に分けて色ごとに並列に解く。
+	// true なら色を解く順を固定して毎回同じ結果にする。false なら反復ごとに順番を入れ替え、解く順による偏りをならす
+	bool deterministicJointOrder{ true };
+
 	float collisionMargin{ 0.005f };
 
 	// Extra margin applied only in mixed (static vs dynamic) pairs. Default 0 to avoid perpetual contact.
@@ -130,6 +130,9 @@ namespace
 	constexpr int ID_PHYS_SLEEP_LINEAR_SPEED = 345;
 	constexpr int ID_PHYS_SLEEP_ANGULAR_SPEED = 346;
 	constexpr int ID_PHYS_MAX_INV_MASS = 347;
+	constexpr int ID_PHYS_DETERMINISTIC_JOINT_ORDER = 348;
+	constexpr int ID_PHYS_CONTACT_WARMSTART = 349;
+	constexpr int ID_PHYS_ASYNC = 350;
 
 	constexpr int ID_OK = 200;
 	constexpr int ID_CANCEL = 201;
@@ -247,6 +250,7 @@ namespace
 			NearlyEqual(a.fixedTimeStep, b.fixedTimeStep) &&
 			(a.maxSubSteps == b.maxSubSteps) &&
 			(a.maxCatchUpSteps == b.maxCatchUpSteps) &&
+			(a.asyncPhysics == b.asyncPhysics) &&
 			NearlyEqual(a.gravity.x, b.gravity.x) &&
 			NearlyEqual(a.gravity.y, b.gravity.y) &&
 			NearlyEqual(a.gravity.z, b.gravity.z) &&
@@ -254,6 +258,7 @@ namespace
 			NearlyEqual(a.jointCompliance, b.jointCompliance) &&
 			NearlyEqual(a.contactCompliance, b.contactCompliance) &&
 			NearlyEqual(a.jointWarmStart, b.jointWarmStart) &&
+			NearlyEqual(a.contactWarmStart, b.contactWarmStart) &&
 			NearlyEqual(a.postSolveVelocityBlend, b.postSolveVelocityBlend) &&
 			NearlyEqual(a.postSolveAngularVelocityBlend, b.postSolveAngularVelocityBlend) &&
 			NearlyEqual(a.maxContactAngularCorrection, b.maxContactAngularCorrection) &&
@@ -274,6 +279,7 @@ namespace
 			NearlyEqual(a.generatedBodyColliderRestitution, b.generatedBodyColliderRestitution) &&
 			(a.solverIterations == b.solverIterations) &&
 			(a.collisionIterations == b.collisionIterations) &&
+			(a.deterministicJointOrder == b.deterministicJointOrder) &&
 			NearlyEqual(a.collisionMargin, b.collisionMargin) &&
 			NearlyEqual(a.phantomMargin, b.phantomMargin) &&
 			NearlyEqual(a.contactSlop, b.contactSlop) &&
@@ -1250,6 +1256,10 @@ void SettingsWindow::CreateControls()
 	AddTooltip(m_physicsMaxCatchUpStepsEdit, L"処理遅延時の追従上限ステップ数。高いほど追従↑/負荷↑。標準: 2〜6。");
 	y += rowH;
 
+	m_physicsAsyncCheck = CreateCheck(ID_PHYS_ASYNC, L"物理を別スレッドで計算", xPadding, y, 240);
+	AddTooltip(m_physicsAsyncCheck, L"物理を専用スレッドで一定間隔に計算し、描画側は結果を補間して使います。描画の負荷は減りますが、揺れ物が少し遅れて見えます。");
+	y += rowH;
+
 	label = CreateLabel(L"重力 (X/Y/Z):", xPadding, y, physicsLabelW);
 	AddTooltip(label, L"重力加速度。Yが下方向。標準: (0, -9.8, 0)。");
 	m_physicsGravityXEdit = CreateEdit(ID_PHYS_GRAVITY_X, xPadding + physicsLabelW, y, physicsEditW);
@@ -1284,6 +1294,12 @@ void SettingsWindow::CreateControls()
 	AddTooltip(m_physicsJointWarmStartEdit, L"前フレームの解を引き継ぐ割合。0でリセット。");
 	y += rowH;
 
+	label = CreateLabel(L"接触ウォームスタート:", xPadding, y, physicsLabelW);
+	AddTooltip(label, L"続いている接触で前回の押し戻しを先に適用する割合。0でリセット。");
+	m_physicsContactWarmStartEdit = CreateEdit(ID_PHYS_CONTACT_WARMSTART, xPadding + physicsLabelW, y, physicsEditW);
+	AddTooltip(m_physicsContactWarmStartEdit, L"続いている接触で前回の押し戻しを先に適用する割合。0でリセット。");
+	y += rowH;
+
 	label = CreateLabel(L"速度/角速度ブレンド:", xPadding, y, physicsLabelW);
 	AddTooltip(label, L"ポストソルブで速度を混ぜる割合。大きいほど揺れ抑制。");
 	m_physicsPostSolveVelocityBlendEdit = CreateEdit(ID_PHYS_POST_SOLVE_VEL_BLEND, xPadding + physicsLabelW, y, physicsEditW);
@@ -1386,6 +1402,10 @@ void SettingsWindow::CreateControls()
 	AddTooltip(m_physicsCollisionIterationsEdit, L"衝突解決の反復回数。多いほど貫通しにくい。");
 	y += rowH;
 
+	m_physicsDeterministicJointOrderCheck = CreateCheck(ID_PHYS_DETERMINISTIC_JOINT_ORDER, L"関節の解決順を固定", xPadding, y, 220);
+	AddTooltip(m_physicsDeterministicJointOrderCheck, L"毎回同じ結果になるよう関節を解く順番を固定します。オフにすると反復ごとに順番を入れ替え、偏りを抑えます。");
+	y += rowH;
+
 	label = CreateLabel(L"衝突マージン:", xPadding, y, physicsLabelW);
 	AddTooltip(label, L"衝突の当たり判定に足す余裕。大きいほど離れ気味。");
 	m_physicsCollisionMarginEdit = CreateEdit(ID_PHYS_COLLISION_MARGIN, xPadding + physicsLabelW, y, physicsEditW);
@@ -1680,6 +1700,7 @@ void SettingsWindow::LoadCurrentSettings()
 	SetWindowTextW(m_physicsFixedTimeStepEdit, FormatFloatPrec(physics.fixedTimeStep, 5).c_str());
 	SetWindowTextW(m_physicsMaxSubStepsEdit, std::to_wstring(physics.maxSubSteps).c_str());
 	SetWindowTextW(m_physicsMaxCatchUpStepsEdit, std::to_wstring(physics.maxCatchUpSteps).c_str());
+	SendMessageW(m_physicsAsyncCheck, BM_SETCHECK, physics.asyncPhysics ? BST_CHECKED : BST_UNCHECKED, 0);
 	SetWindowTextW(m_physicsGravityXEdit, FormatFloatPrec(physics.gravity.x, 4).c_str());
 	SetWindowTextW(m_physicsGravityYEdit, FormatFloatPrec(physics.gravity.y, 4).c_str());
 	SetWindowTextW(m_physicsGravityZEdit, FormatFloatPrec(physics.gravity.z, 4).c_str());
@@ -1687,6 +1708,7 @@ void SettingsWindow::LoadCurrentSettings()
 	SetWindowTextW(m_physicsJointComplianceEdit, FormatFloatPrec(physics.jointCompliance, 5).c_str());
 	SetWindowTextW(m_physicsContactComplianceEdit, FormatFloatPrec(physics.contactCompliance, 5).c_str());
 	SetWindowTextW(m_physicsJointWarmStartEdit, FormatFloatPrec(physics.jointWarmStart, 5).c_str());
+	SetWindowTextW(m_physicsContactWarmStartEdit, FormatFloatPrec(physics.contactWarmStart, 5).c_str());
 	SetWindowTextW(m_physicsPostSolveVelocityBlendEdit, FormatFloatPrec(physics.postSolveVelocityBlend, 4).c_str());
 	SetWindowTextW(m_physicsPostSolveAngularBlendEdit, FormatFloatPrec(physics.postSolveAngularVelocityBlend, 4).c_str());
 	SetWindowTextW(m_physicsMaxContactAngularCorrectionEdit, FormatFloatPrec(physics.maxContactAngularCorrection, 4).c_str());
@@ -1708,6 +1730,7 @@ void SettingsWindow::LoadCurrentSettings()
 	SetWindowTextW(m_physicsGeneratedRestitutionEdit, FormatFloatPrec(physics.generatedBodyColliderRestitution, 4).c_str());
 	SetWindowTextW(m_physicsSolverIterationsEdit, std::to_wstring(physics.solverIterations).c_str());
 	SetWindowTextW(m_physicsCollisionIterationsEdit, std::to_wstring(physics.collisionIterations).c_str());
+	SendMessageW(m_physicsDeterministicJointOrderCheck, BM_SETCHECK, physics.deterministicJointOrder ? BST_CHECKED : BST_UNCHECKED, 0);
 	SetWindowTextW(m_physicsCollisionMarginEdit, FormatFloatPrec(physics.collisionMargin, 5).c_str());
 	SetWindowTextW(m_physicsPhantomMarginEdit, FormatFloatPrec(physics.phantomMargin, 5).c_str());
 	SetWindowTextW(m_physicsContactSlopEdit, FormatFloatPrec(physics.contactSlop, 5).c_str());
@@ -1835,6 +1858,7 @@ void SettingsWindow::ApplyAndSave()
 	physics.fixedTimeStep = std::max(0.0001f, GetEditBoxFloat(m_physicsFixedTimeStepEdit, physics.fixedTimeStep));
 	physics.maxSubSteps = std::max(1, GetEditBoxInt(m_physicsMaxSubStepsEdit, physics.maxSubSteps));
 	physics.maxCatchUpSteps = std::max(0, GetEditBoxInt(m_physicsMaxCatchUpStepsEdit, physics.maxCatchUpSteps));
+	physics.asyncPhysics = (SendMessageW(m_physicsAsyncCheck, BM_GETCHECK, 0, 0) == BST_CHECKED);
 	physics.gravity.x = GetEditBoxFloat(m_physicsGravityXEdit, physics.gravity.x);
 	physics.gravity.y = GetEditBoxFloat(m_physicsGravityYEdit, physics.gravity.y);
 	physics.gravity.z = GetEditBoxFloat(m_physicsGravityZEdit, physics.gravity.z);
@@ -1842,6 +1866,7 @@ void SettingsWindow::ApplyAndSave()
 	physics.jointCompliance = std::max(0.0f, GetEditBoxFloat(m_physicsJointComplianceEdit, physics.jointCompliance));
 	physics.contactCompliance = std::max(0.0f, GetEditBoxFloat(m_physicsContactComplianceEdit, physics.contactCompliance));
 	physics.jointWarmStart = std::max(0.0f, GetEditBoxFloat(m_physicsJointWarmStartEdit, physics.jointWarmStart));
+	physics.contactWarmStart = std::max(0.0f, GetEditBoxFloat(m_physicsContactWarmStartEdit, physics.contactWarmStart));
 	physics.postSolveVelocityBlend = std::max(0.0f, GetEditBoxFloat(m_physicsPostSolveVelocityBlendEdit, physics.postSolveVelocityBlend));
 	physics.postSolveAngularVelocityBlend = std::max(0.0f, GetEditBoxFloat(m_physicsPostSolveAngularBlendEdit, physics.postSolveAngularVelocityBlend));
 	physics.maxContactAngularCorrection = std::max(0.0f, GetEditBoxFloat(m_physicsMaxContactAngularCorrectionEdit, physics.maxContactAngularCorrection));
@@ -1863,6 +1888,7 @@ void SettingsWindow::ApplyAndSave()
 	physics.generatedBodyColliderRestitution = std::max(0.0f, GetEditBoxFloat(m_physicsGeneratedRestitutionEdit, physics.generatedBodyColliderRestitution));
 	physics.solverIterations = std::max(0, GetEditBoxInt(m_physicsSolverIterationsEdit, physics.solverIterations));
 	physics.collisionIterations = std::max(0, GetEditBoxInt(m_physicsCollisionIterationsEdit, physics.collisionIterations));
+	physics.deterministicJointOrder = (SendMessageW(m_physicsDeterministicJointOrderCheck, BM_GETCHECK, 0, 0) == BST_CHECKED);
 	physics.collisionMargin = std::max(0.0f, GetEditBoxFloat(m_physicsCollisionMarginEdit, physics.collisionMargin));
 	physics.phantomMargin = std::max(0.0f, GetEditBoxFloat(m_physicsPhantomMarginEdit, physics.phantomMargin));
 	physics.contactSlop = std::max(0.0f, GetEditBoxFloat(m_physicsContactSlopEdit, physics.contactSlop));
@@ -1922,6 +1948,7 @@ bool SettingsWindow::HasUnsavedChanges() const
 	physics.fixedTimeStep = std::max(0.0001f, GetEditBoxFloat(m_physicsFixedTimeStepEdit, physics.fixedTimeStep));
 	physics.maxSubSteps = std::max(1, GetEditBoxInt(m_physicsMaxSubStepsEdit, physics.maxSubSteps));
 	physics.maxCatchUpSteps = std::max(0, GetEditBoxInt(m_physicsMaxCatchUpStepsEdit, physics.maxCatchUpSteps));
+	physics.asyncPhysics = (SendMessageW(m_physicsAsyncCheck, BM_GETCHECK, 0, 0) == BST_CHECKED);
 	physics.gravity.x = GetEditBoxFloat(m_physicsGravityXEdit, physics.gravity.x);
 	physics.gravity.y = GetEditBoxFloat(m_physicsGravityYEdit, physics.gravity.y);
 	physics.gravity.z = GetEditBoxFloat(m_physicsGravityZEdit, physics.gravity.z);
@@ -1929,6 +1956,7 @@ bool SettingsWindow::HasUnsavedChanges() const
 	physics.jointCompliance = std::max(0.0f, GetEditBoxFloat(m_physicsJointComplianceEdit, physics.jointCompliance));
 	physics.contactCompliance = std::max(0.0f, GetEditBoxFloat(m_physicsContactComplianceEdit, physics.contactCompliance));
 	physics.jointWarmStart = std::max(0.0f, GetEditBoxFloat(m_physicsJointWarmStartEdit, physics.jointWarmStart));
+	physics.contactWarmStart = std::max(0.0f, GetEditBoxFloat(m_physicsContactWarmStartEdit, physics.contactWarmStart));
 	physics.postSolveVelocityBlend = std::max(0.0f, GetEditBoxFloat(m_physicsPostSolveVelocityBlendEdit, physics.postSolveVelocityBlend));
 	physics.postSolveAngularVelocityBlend = std::max(0.0f, GetEditBoxFloat(m_physicsPostSolveAngularBlendEdit, physics.postSolveAngularVelocityBlend));
 	physics.maxContactAngularCorrection = std::max(0.0f, GetEditBoxFloat(m_physicsMaxContactAngularCorrectionEdit, physics.maxContactAngularCorrection));
@@ -1950,6 +1978,7 @@ bool SettingsWindow::HasUnsavedChanges() const
 	physics.generatedBodyColliderRestitution = std::max(0.0f, GetEditBoxFloat(m_physicsGeneratedRestitutionEdit, physics.generatedBodyColliderRestitution));
 	physics.solverIterations = std::max(0, GetEditBoxInt(m_physicsSolverIterationsEdit, physics.solverIterations));
 	physics.collisionIterations = std::max(0, GetEditBoxInt(m_physicsCollisionIterationsEdit, physics.collisionIterations));
+	physics.deterministicJointOrder = (SendMessageW(m_physicsDeterministicJointOrderCheck, BM_GETCHECK, 0, 0) == BST_CHECKED);
 	physics.collisionMargin = std::max(0.0f, GetEditBoxFloat(m_physicsCollisionMarginEdit, physics.collisionMargin));
 	physics.phantomMargin = std::max(0.0f, GetEditBoxFloat(m_physicsPhantomMarginEdit, physics.phantomMargin));
 	physics.contactSlop = std::max(0.0f, GetEditBoxFloat(m_physicsContactSlopEdit, physics.contactSlop));
@@ -150,6 +150,7 @@ private:
 	HWND m_physicsFixedTimeStepEdit{};
 	HWND m_physicsMaxSubStepsEdit{};
 	HWND m_physicsMaxCatchUpStepsEdit{};
+	HWND m_physicsAsyncCheck{};
 	HWND m_physicsGravityXEdit{};
 	HWND m_physicsGravityYEdit{};
 	HWND m_physicsGravityZEdit{};
@@ -157,6 +158,7 @@ private:
 	HWND m_physicsJointComplianceEdit{};
 	HWND m_physicsContactComplianceEdit{};
 	HWND m_physicsJointWarmStartEdit{};
+	HWND m_physicsContactWarmStartEdit{};
 	HWND m_physicsPostSolveVelocityBlendEdit{};
 	HWND m_physicsPostSolveAngularBlendEdit{};
 	HWND m_physicsMaxContactAngularCorrectionEdit{};
@@ -177,6 +179,7 @@ private:
 	HWND m_physicsGeneratedRestitutionEdit{};
 	HWND m_physicsSolverIterationsEdit{};
 	HWND m_physicsCollisionIterationsEdit{};
+	HWND m_physicsDeterministicJointOrderCheck{};
 	HWND m_physicsCollisionMarginEdit{};
 	HWND m_physicsPhantomMarginEdit{};
 	HWND m_physicsContactSlopEdit{};
@@ -3,6 +3,7 @@
 #include <stdexcept>
 #include <system_error>
 
+#if defined _WIN32
 namespace
 {
 	std::wstring ConvertToWide(std::string_view input, UINT codePage, DWORD flags)
@@ -78,4 +79,95 @@ namespace StringUtil
 	{
 		return ConvertToMultiByte(input, CP_UTF8, 0);
 	}
-}
\ No newline at end of file
+}
+#else
+// Non-Windows builds (headless tools) only need UTF-8 <-> wchar_t (UTF-32).
+namespace
+{
+	bool DecodeUtf8(std::string_view input, std::wstring& output)
+	{
+		output.clear();
+		output.reserve(input.size());
+
+		size_t i = 0;
+		while (i < input.size())
+		{
+			const unsigned char c = static_cast<unsigned char>(input[i]);
+			char32_t cp = 0;
+			size_t extra = 0;
+			if (c < 0x80) { cp = c; extra = 0; }
+			else if ((c & 0xE0) == 0xC0) { cp = c & 0x1F; extra = 1; }
+			else if ((c & 0xF0) == 0xE0) { cp = c & 0x0F; extra = 2; }
+			else if ((c & 0xF8) == 0xF0) { cp = c & 0x07; extra = 3; }
+			else return false;
+
+			if (i + extra >= input.size()) return false;
+			for (size_t k = 1; k <= extra; ++k)
+			{
+				const unsigned char cc = static_cast<unsigned char>(input[i + k]);
+				if ((cc & 0xC0) != 0x80) return false;
+				cp = (cp << 6) | (cc & 0x3F);
+			}
+			i += extra + 1;
+			output.push_back(static_cast<wchar_t>(cp));
+		}
+		return true;
+	}
+}
+
+namespace StringUtil
+{
+	std::wstring Utf8ToWide(std::string_view input)
+	{
+		std::wstring output;
+		if (!DecodeUtf8(input, output))
+		{
+			throw std::runtime_error("Invalid UTF-8 sequence");
+		}
+		return output;
+	}
+
+	std::wstring Utf8ToWideAllowAcpFallback(std::string_view input)
+	{
+		std::wstring output;
+		if (DecodeUtf8(input, output)) return output;
+
+		// No ANSI code page here: keep the bytes as Latin-1.
+		output.assign(input.begin(), input.end());
+		return output;
+	}
+
+	std::string WideToUtf8(std::wstring_view input)
+	{
+		std::string output;
+		output.reserve(input.size());
+		for (wchar_t wc : input)
+		{
+			const char32_t cp = static_cast<char32_t>(wc);
+			if (cp < 0x80)
+			{
+				output.push_back(static_cast<char>(cp));
+			}
+			else if (cp < 0x800)
+			{
+				output.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+				output.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+			}
+			else if (cp < 0x10000)
+			{
+				output.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+				output.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+				output.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+			}
+			else
+			{
+				output.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+				output.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+				output.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+				output.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+			}
+		}
+		return output;
+	}
+}
+#endif
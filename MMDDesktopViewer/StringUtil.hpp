@@ -6,12 +6,16 @@
 
 #include <string>
 #include <string_view>
+#if defined _WIN32
 #include <windows.h>
+#endif
 
 namespace StringUtil
 {
+#if defined _WIN32
 	std::wstring MultiByteToWide(std::string_view input, UINT codePage, DWORD flags = 0);
 	std::string WideToMultiByte(std::wstring_view input, UINT codePage, DWORD flags = 0);
+#endif
 
 	std::wstring Utf8ToWide(std::string_view input);
 	std::wstring Utf8ToWideAllowAcpFallback(std::string_view input);
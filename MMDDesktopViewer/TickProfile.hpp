@@ -0,0 +1,103 @@
+﻿#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// MmdAnimator::Tick の段階ごとの所要時間 (ベンチマーク・計測用)。
+// 計測先が設定されていないときは何もしないので、通常の描画では時計を読まない。
+enum class TickStage : std::uint8_t
+{
+	TrackSampling,  // ボーントラックの補間
+	MorphWeights,   // モーフトラックの補間、グループ/フリップの展開とポーズへの反映
+	PoseLayers,     // まばたき・呼吸・視線・遷移などの後段レイヤー
+	ForwardKinematics,
+	InverseKinematics,
+	PhysicsSubSteps,
+	PhysicsWriteBack,
+	Count
+};
+
+struct TickProfile
+{
+	static constexpr size_t StageCount = static_cast<size_t>(TickStage::Count);
+
+	std::array<double, StageCount> seconds{};
+	std::uint32_t physicsSubSteps{ 0 };
+	std::uint32_t physicsBodySubSteps{ 0 };  // 起きていた動的剛体数 × サブステップ数
+	std::uint32_t physicsPairsAdded{ 0 };      // 境界球が重なり始めた剛体の組 (サブステップの合計)
+	std::uint32_t physicsPairsRemoved{ 0 };    // 重ならなくなった組
+	std::uint32_t physicsCandidatePairs{ 0 };  // 除外されずに narrow phase で調べた組
+	std::uint32_t physicsContacts{ 0 };        // narrow phase で当たった回数 (反復ごとに数える)
+	std::uint32_t ikCacheHits{ 0 };     // 入力が前回と同じで、解き直さなかった IK チェーン数
+	std::uint32_t ikCacheMisses{ 0 };
+
+	void Reset()
+	{
+		seconds.fill(0.0);
+		physicsSubSteps = 0;
+		physicsBodySubSteps = 0;
+		physicsPairsAdded = 0;
+		physicsPairsRemoved = 0;
+		physicsCandidatePairs = 0;
+		physicsContacts = 0;
+		ikCacheHits = 0;
+		ikCacheMisses = 0;
+	}
+
+	double& operator[](TickStage stage)
+	{
+		return seconds[static_cast<size_t>(stage)];
+	}
+	double operator[](TickStage stage) const
+	{
+		return seconds[static_cast<size_t>(stage)];
+	}
+
+	static const char* StageName(TickStage stage)
+	{
+		switch (stage)
+		{
+			case TickStage::TrackSampling: return "track_sampling";
+			case TickStage::MorphWeights: return "morph_weights";
+			case TickStage::PoseLayers: return "pose_layers";
+			case TickStage::ForwardKinematics: return "fk";
+			case TickStage::InverseKinematics: return "ik";
+			case TickStage::PhysicsSubSteps: return "physics_substeps";
+			case TickStage::PhysicsWriteBack: return "physics_writeback";
+			default: return "unknown";
+		}
+	}
+};
+
+// スコープの経過時間を profile の該当段階に加算する
+class TickStageTimer
+{
+public:
+	TickStageTimer(TickProfile* profile, TickStage stage)
+		: m_profile(profile)
+		, m_stage(stage)
+	{
+		if (m_profile) m_start = std::chrono::steady_clock::now();
+	}
+	~TickStageTimer()
+	{
+		Stop();
+	}
+
+	// スコープの途中で計測を終える (以降は何もしない)
+	void Stop()
+	{
+		if (!m_profile) return;
+		(*m_profile)[m_stage] += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+		m_profile = nullptr;
+	}
+
+	TickStageTimer(const TickStageTimer&) = delete;
+	TickStageTimer& operator=(const TickStageTimer&) = delete;
+
+private:
+	TickProfile* m_profile;
+	TickStage m_stage;
+	std::chrono::steady_clock::time_point m_start{};
+};
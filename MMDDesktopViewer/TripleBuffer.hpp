@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// 書き込み側 1 スレッド・読み込み側 1 スレッドで、最新の値だけを受け渡す三重バッファ。
+// 書き込み側は WriteBuffer() に書いて Publish()、読み込み側は Acquire() が true を返したら ReadBuffer() を読む。
+// どちらも相手を待たない。読まれないまま次が Publish されたら古い方は捨てられる
+template <class T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() = default;
+	TripleBuffer(const TripleBuffer&) = delete;
+	TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+	T& WriteBuffer()
+	{
+		return m_slots[m_writeIndex];
+	}
+
+	// 書き終えたバッファを読み込み側へ渡し、受け渡し用だったバッファを次の書き込み先にする
+	void Publish()
+	{
+		const std::uint32_t previous = m_shared.exchange(m_writeIndex | kFresh, std::memory_order_acq_rel);
+		m_writeIndex = previous & kIndexMask;
+	}
+
+	// 前回から新しい値が Publish されていれば、それを ReadBuffer() に移して true
+	bool Acquire()
+	{
+		if ((m_shared.load(std::memory_order_relaxed) & kFresh) == 0) return false;
+		const std::uint32_t previous = m_shared.exchange(m_readIndex, std::memory_order_acq_rel);
+		m_readIndex = previous & kIndexMask;
+		return true;
+	}
+
+	const T& ReadBuffer() const
+	{
+		return m_slots[m_readIndex];
+	}
+	T& ReadBuffer()
+	{
+		return m_slots[m_readIndex];
+	}
+
+	// 受け渡し中の値を捨てて最初の状態に戻す。どちらのスレッドも触っていないときに呼ぶこと
+	void Reset()
+	{
+		m_writeIndex = 0;
+		m_shared.store(1, std::memory_order_relaxed);
+		m_readIndex = 2;
+	}
+
+private:
+	static constexpr std::uint32_t kIndexMask = 0x3u;
+	static constexpr std::uint32_t kFresh = 0x4u;
+
+	std::array<T, 3> m_slots{};
+	std::uint32_t m_writeIndex{ 0 };                // 書き込み側だけが触る
+	alignas(64) std::atomic<std::uint32_t> m_shared{ 1 };
+	alignas(64) std::uint32_t m_readIndex{ 2 };     // 読み込み側だけが触る
+};
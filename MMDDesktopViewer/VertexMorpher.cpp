@@ -0,0 +1,202 @@
+﻿#include "VertexMorpher.hpp"
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// これより小さいウェイトは 0 とみなす (PmxModelDrawer の従来の閾値と同じ)
+	constexpr float WeightEpsilon = 0.0001f;
+
+	// モーフが触る頂点の番号がこれより離れていたら範囲を分ける。
+	// 間の頂点も書き直すことになるので、小さいほど無駄は減るが範囲の数が増える
+	constexpr std::uint32_t RangeGap = 32;
+
+	JobSystem::LoopSite g_positionSite{ "morph.vertex_deltas" };
+	JobSystem::LoopSite g_uvSite{ "morph.uv_deltas" };
+}
+
+void VertexMorpher::Initialize(const PmxModel* model)
+{
+	m_basePositions.clear();
+	m_baseUvs.clear();
+	m_positions.clear();
+	m_uvs.clear();
+	m_positionOffsets.clear();
+	m_uvOffsets.clear();
+	m_targets.clear();
+	m_positionDeltas.clear();
+	m_uvDeltas.clear();
+	m_targetRanges.clear();
+	m_activeCounts.clear();
+	m_dirtyRanges.clear();
+
+	if (!model) return;
+
+	const auto& verts = model->Vertices();
+	const auto vertexCount = static_cast<std::uint32_t>(verts.size());
+	m_basePositions.resize(verts.size());
+	m_baseUvs.resize(verts.size());
+	for (size_t i = 0; i < verts.size(); ++i)
+	{
+		m_basePositions[i] = { verts[i].px, verts[i].py, verts[i].pz };
+		m_baseUvs[i] = { verts[i].u, verts[i].v };
+	}
+	m_positions = m_basePositions;
+	m_uvs = m_baseUvs;
+	m_positionOffsets.assign(verts.size(), XMFLOAT3(0.0f, 0.0f, 0.0f));
+	m_uvOffsets.assign(verts.size(), XMFLOAT2(0.0f, 0.0f));
+	m_activeCounts.assign(verts.size(), 0);
+
+	std::vector<std::uint32_t> touched;
+	const auto& morphs = model->Morphs();
+	for (size_t mi = 0; mi < morphs.size(); ++mi)
+	{
+		const auto& m = morphs[mi];
+		if (m.type != PmxModel::Morph::Type::Vertex && m.type != PmxModel::Morph::Type::UV) continue;
+
+		MorphTarget target{};
+		target.morphIndex = static_cast<std::uint32_t>(mi);
+		target.positionBegin = static_cast<std::uint32_t>(m_positionDeltas.size());
+		target.uvBegin = static_cast<std::uint32_t>(m_uvDeltas.size());
+		touched.clear();
+
+		if (m.type == PmxModel::Morph::Type::Vertex)
+		{
+			for (const auto& vo : m.vertexOffsets)
+			{
+				if (vo.vertexIndex >= vertexCount) continue;
+				m_positionDeltas.push_back({ vo.vertexIndex, vo.positionOffset });
+				touched.push_back(vo.vertexIndex);
+			}
+		}
+		else
+		{
+			for (const auto& uvo : m.uvOffsets)
+			{
+				if (uvo.vertexIndex >= vertexCount) continue;
+				m_uvDeltas.push_back({ uvo.vertexIndex, XMFLOAT2(uvo.offset.x, uvo.offset.y) });
+				touched.push_back(uvo.vertexIndex);
+			}
+		}
+
+		target.positionEnd = static_cast<std::uint32_t>(m_positionDeltas.size());
+		target.uvEnd = static_cast<std::uint32_t>(m_uvDeltas.size());
+		if (touched.empty()) continue;
+
+		std::sort(touched.begin(), touched.end());
+		target.uniqueVertices = (std::adjacent_find(touched.begin(), touched.end()) == touched.end());
+		target.rangeBegin = static_cast<std::uint32_t>(m_targetRanges.size());
+		DirtyRange range{ touched.front(), touched.front() + 1 };
+		for (std::uint32_t v : touched)
+		{
+			if (v > range.end + RangeGap)
+			{
+				m_targetRanges.push_back(range);
+				range.begin = v;
+			}
+			range.end = std::max(range.end, v + 1);
+		}
+		m_targetRanges.push_back(range);
+		target.rangeEnd = static_cast<std::uint32_t>(m_targetRanges.size());
+
+		m_targets.push_back(target);
+	}
+}
+
+bool VertexMorpher::Apply(const std::vector<float>& morphWeights)
+{
+	m_dirtyRanges.clear();
+
+	for (auto& target : m_targets)
+	{
+		float w = (target.morphIndex < morphWeights.size()) ? morphWeights[target.morphIndex] : 0.0f;
+		if (std::abs(w) < WeightEpsilon) w = 0.0f;
+		if (w == target.appliedWeight) continue;
+
+		const bool activating = (target.appliedWeight == 0.0f);
+		const bool deactivating = (w == 0.0f);
+		const float delta = w - target.appliedWeight;
+		const XMVECTOR deltaV = XMVectorReplicate(delta);
+		target.appliedWeight = w;
+
+		auto restore = [this](std::uint32_t v) {
+			m_positionOffsets[v] = XMFLOAT3(0.0f, 0.0f, 0.0f);
+			m_uvOffsets[v] = XMFLOAT2(0.0f, 0.0f);
+			m_positions[v] = m_basePositions[v];
+			m_uvs[v] = m_baseUvs[v];
+		};
+
+		auto applyPositions = [&](size_t begin, size_t end) {
+			for (size_t i = target.positionBegin + begin; i < target.positionBegin + end; ++i)
+			{
+				const auto& d = m_positionDeltas[i];
+				if (activating) ++m_activeCounts[d.vertex];
+				if (deactivating && --m_activeCounts[d.vertex] == 0)
+				{
+					restore(d.vertex);
+					continue;
+				}
+				const XMVECTOR offset = XMVectorMultiplyAdd(XMLoadFloat3(&d.offset), deltaV, XMLoadFloat3(&m_positionOffsets[d.vertex]));
+				XMStoreFloat3(&m_positionOffsets[d.vertex], offset);
+				XMStoreFloat3(&m_positions[d.vertex], XMVectorAdd(XMLoadFloat3(&m_basePositions[d.vertex]), offset));
+			}
+		};
+		auto applyUvs = [&](size_t begin, size_t end) {
+			for (size_t i = target.uvBegin + begin; i < target.uvBegin + end; ++i)
+			{
+				const auto& d = m_uvDeltas[i];
+				if (activating) ++m_activeCounts[d.vertex];
+				if (deactivating && --m_activeCounts[d.vertex] == 0)
+				{
+					restore(d.vertex);
+					continue;
+				}
+				auto& offset = m_uvOffsets[d.vertex];
+				offset.x += d.offset.x * delta;
+				offset.y += d.offset.y * delta;
+				m_uvs[d.vertex] = XMFLOAT2(m_baseUvs[d.vertex].x + offset.x, m_baseUvs[d.vertex].y + offset.y);
+			}
+		};
+
+		const size_t positionCount = target.positionEnd - target.positionBegin;
+		const size_t uvCount = target.uvEnd - target.uvBegin;
+		if (target.uniqueVertices)
+		{
+			// 要素どうしが同じ頂点に触れないので分けて足せる。実際に分かれるのは大きなモーフだけ
+			JobSystem::Shared().ParallelFor(g_positionSite, positionCount, applyPositions);
+			JobSystem::Shared().ParallelFor(g_uvSite, uvCount, applyUvs);
+		}
+		else
+		{
+			applyPositions(0, positionCount);
+			applyUvs(0, uvCount);
+		}
+
+		m_dirtyRanges.insert(m_dirtyRanges.end(),
+							 m_targetRanges.begin() + target.rangeBegin, m_targetRanges.begin() + target.rangeEnd);
+	}
+
+	if (m_dirtyRanges.empty()) return false;
+
+	// 重なる・隣り合う範囲をまとめる
+	std::sort(m_dirtyRanges.begin(), m_dirtyRanges.end(),
+			  [](const DirtyRange& a, const DirtyRange& b) { return a.begin < b.begin; });
+	size_t merged = 0;
+	for (size_t i = 1; i < m_dirtyRanges.size(); ++i)
+	{
+		if (m_dirtyRanges[i].begin <= m_dirtyRanges[merged].end)
+		{
+			m_dirtyRanges[merged].end = std::max(m_dirtyRanges[merged].end, m_dirtyRanges[i].end);
+		}
+		else
+		{
+			m_dirtyRanges[++merged] = m_dirtyRanges[i];
+		}
+	}
+	m_dirtyRanges.resize(merged + 1);
+	return true;
+}
@@ -0,0 +1,92 @@
+﻿#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <DirectXMath.h>
+#include "PmxModel.hpp"
+
+// 頂点モーフ・UV モーフを頂点位置/UV に反映する。
+// モーフごとに前回反映したウェイトを覚えておき、変わったモーフの差分だけを対象頂点に足す。
+// 変わった頂点の範囲を返すので、頂点バッファも差分だけ書き直せる。
+class VertexMorpher
+{
+public:
+	// 書き直しが必要な頂点の範囲 [begin, end)
+	struct DirtyRange
+	{
+		std::uint32_t begin{};
+		std::uint32_t end{};
+	};
+
+	VertexMorpher() = default;
+
+	void Initialize(const PmxModel* model);
+
+	// morphWeights: モーフごとの実効ウェイト (グループモーフ展開済み)。足りない分は 0 とみなす。
+	// 頂点が変わったら true を返し、変わった範囲を DirtyRanges() に入れる
+	bool Apply(const std::vector<float>& morphWeights);
+
+	size_t VertexCount() const
+	{
+		return m_positions.size();
+	}
+	const std::vector<DirectX::XMFLOAT3>& Positions() const
+	{
+		return m_positions;
+	}
+	const std::vector<DirectX::XMFLOAT2>& Uvs() const
+	{
+		return m_uvs;
+	}
+	// 直前の Apply で変わった範囲 (昇順、重なりなし)
+	const std::vector<DirtyRange>& DirtyRanges() const
+	{
+		return m_dirtyRanges;
+	}
+
+private:
+	struct PositionDelta
+	{
+		std::uint32_t vertex{};
+		DirectX::XMFLOAT3 offset{};
+	};
+	struct UvDelta
+	{
+		std::uint32_t vertex{};
+		DirectX::XMFLOAT2 offset{};
+	};
+
+	// 頂点を動かすモーフ (頂点/UV) だけを並べたもの
+	struct MorphTarget
+	{
+		std::uint32_t morphIndex{};
+		std::uint32_t positionBegin{};
+		std::uint32_t positionEnd{};
+		std::uint32_t uvBegin{};
+		std::uint32_t uvEnd{};
+		std::uint32_t rangeBegin{};   // m_targetRanges 内の位置
+		std::uint32_t rangeEnd{};
+		float appliedWeight{ 0.0f };
+		bool uniqueVertices{ false };   // 要素の頂点がすべて異なる (要素ごとに並列に足してよい)
+	};
+
+	std::vector<DirectX::XMFLOAT3> m_basePositions;
+	std::vector<DirectX::XMFLOAT2> m_baseUvs;
+	std::vector<DirectX::XMFLOAT3> m_positions;
+	std::vector<DirectX::XMFLOAT2> m_uvs;
+	// 元の値からのずれ。差分はこちらに足してから元の値に加える
+	// (座標そのものに足し続けるより丸め誤差がずっと小さい)
+	std::vector<DirectX::XMFLOAT3> m_positionOffsets;
+	std::vector<DirectX::XMFLOAT2> m_uvOffsets;
+
+	std::vector<MorphTarget> m_targets;
+	std::vector<PositionDelta> m_positionDeltas;
+	std::vector<UvDelta> m_uvDeltas;
+	// モーフごとの触る頂点を、離れたところで区切った範囲
+	std::vector<DirtyRange> m_targetRanges;
+
+	// 頂点ごとに、いま効いているモーフの要素数。0 に戻ったら元の値に戻して誤差を残さない
+	std::vector<std::uint32_t> m_activeCounts;
+
+	std::vector<DirtyRange> m_dirtyRanges;
+};
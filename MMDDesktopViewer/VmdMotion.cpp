@@ -1,35 +1,191 @@
-﻿#ifndef NOMINMAX
-#define NOMINMAX
-#endif
-
-#include "VmdMotion.hpp"
+﻿#include "VmdMotion.hpp"
 #include "BinaryReader.hpp"
-#include <windows.h>
+#include "Cp932.hpp"
 #include <stdexcept>
 #include <algorithm>
 #include <cstring>
+#include <numeric>
+#include <span>
 #include <sstream>
+#include <string_view>
+#include <type_traits>
 
 namespace
 {
-	std::wstring SjisBytesToW(const std::vector<std::uint8_t>& bytes)
+	std::string AsciiZ(std::span<const std::uint8_t> bytes)
 	{
-		int lenA = 0;
-		while (lenA < (int)bytes.size() && bytes[lenA] != 0) ++lenA;
-		if (lenA == 0) return {};
-
-		int lenW = MultiByteToWideChar(932, 0, (const char*)bytes.data(), lenA, nullptr, 0);
-		if (lenW <= 0) return {};
-		std::wstring out(lenW, L'\0');
-		MultiByteToWideChar(932, 0, (const char*)bytes.data(), lenA, out.data(), lenW);
-		return out;
+		return std::string(reinterpret_cast<const char*>(bytes.data()), Cp932::LengthZ(bytes));
 	}
 
-	std::string AsciiZ(const std::vector<std::uint8_t>& bytes)
+	// 固定長の生の名前バイト列 → NameId。
+	// 10万キーのモーションでも実際の名前は数百程度なので、変換は名前ごとに 1 回だけ行う。
+	// キーの string_view は読み込み中のファイルを指す (Load の間だけ有効)。
+	class NameInterner
+	{
+	public:
+		explicit NameInterner(std::vector<std::wstring>& names) : m_names(names)
+		{
+		}
+
+		VmdMotion::NameId Intern(std::span<const std::uint8_t> raw)
+		{
+			const std::string_view key(reinterpret_cast<const char*>(raw.data()), Cp932::LengthZ(raw));
+
+			// 同じボーンのキーが連続することが多い
+			if (m_hasLast && key == m_lastKey) return m_lastId;
+
+			VmdMotion::NameId id{};
+			if (auto it = m_byBytes.find(key); it != m_byBytes.end())
+			{
+				id = it->second;
+			}
+			else
+			{
+				// 異なるバイト列が同じ文字列になる場合 (不正な文字など) も同じ ID にまとめる
+				std::wstring text = Cp932::ToWide(key);
+				if (auto jt = m_byText.find(text); jt != m_byText.end())
+				{
+					id = jt->second;
+				}
+				else
+				{
+					id = static_cast<VmdMotion::NameId>(m_names.size());
+					m_names.push_back(text);
+					m_byText.emplace(std::move(text), id);
+				}
+				m_byBytes.emplace(key, id);
+			}
+
+			m_lastKey = key;
+			m_lastId = id;
+			m_hasLast = true;
+			return id;
+		}
+
+	private:
+		std::vector<std::wstring>& m_names;
+		std::unordered_map<std::string_view, VmdMotion::NameId> m_byBytes;
+		std::unordered_map<std::wstring, VmdMotion::NameId> m_byText;
+		std::string_view m_lastKey;
+		VmdMotion::NameId m_lastId{};
+		bool m_hasLast{ false };
+	};
+
+	constexpr size_t BoneRecSize = 15 + 4 + 12 + 16 + 64; // 111
+	constexpr size_t MorphRecSize = 15 + 4 + 4; // 23
+	constexpr std::uint32_t NoTrack = 0xFFFFFFFFu;
+
+	// 64 バイトの補間データ → 一意化した曲線 ID。
+	// ほとんどのキーは線形補間などの少数の曲線を共有している。
+	class CurveInterner
 	{
-		size_t n = 0;
-		while (n < bytes.size() && bytes[n] != 0) ++n;
-		return std::string(reinterpret_cast<const char*>(bytes.data()), n);
+	public:
+		explicit CurveInterner(std::vector<VmdMotion::BezierCurve>& curves) : m_curves(curves)
+		{
+			for (size_t i = 0; i < m_curves.size(); ++i)
+			{
+				m_ids.emplace(KeyOf(m_curves[i]), static_cast<VmdMotion::CurveId>(i));
+			}
+		}
+
+		VmdMotion::CurveId Intern(std::span<const std::uint8_t> interp)
+		{
+			// チャンネル ch の x1/y1/x2/y2 は interp[ch*16 + 0/4/8/12]
+			VmdMotion::BezierCurve c{};
+			for (int ch = 0; ch < 4; ++ch)
+			{
+				const std::uint8_t* row = interp.data() + ch * 16;
+				c.x1[ch] = row[0];
+				c.y1[ch] = row[4];
+				c.x2[ch] = row[8];
+				c.y2[ch] = row[12];
+			}
+
+			auto [it, inserted] = m_ids.try_emplace(KeyOf(c), static_cast<VmdMotion::CurveId>(m_curves.size()));
+			if (inserted) m_curves.push_back(c);
+			return it->second;
+		}
+
+	private:
+		struct Key
+		{
+			std::uint64_t lo, hi;
+			bool operator==(const Key&) const = default;
+		};
+		struct KeyHash
+		{
+			size_t operator()(const Key& k) const noexcept
+			{
+				return std::hash<std::uint64_t>{}(k.lo ^ (k.hi * 0x9E3779B97F4A7C15ull));
+			}
+		};
+
+		static Key KeyOf(const VmdMotion::BezierCurve& c)
+		{
+			static_assert(sizeof(VmdMotion::BezierCurve) == sizeof(Key));
+			Key k{};
+			std::memcpy(&k, &c, sizeof(k));
+			return k;
+		}
+
+		std::vector<VmdMotion::BezierCurve>& m_curves;
+		std::unordered_map<Key, VmdMotion::CurveId, KeyHash> m_ids;
+	};
+
+	// キー数を数え、名前順にトラックを割り当てる。空の名前のキーはトラックにしない。
+	// 戻り値は NameId → トラック番号 (NoTrack はトラック無し)。
+	template <class Track>
+	std::vector<std::uint32_t> AllocateTracks(const std::vector<std::wstring>& names,
+											  const std::vector<VmdMotion::NameId>& keyNames,
+											  std::vector<Track>& tracks)
+	{
+		std::vector<std::uint32_t> counts(names.size(), 0);
+		for (auto id : keyNames) ++counts[id];
+
+		std::vector<VmdMotion::NameId> used;
+		for (VmdMotion::NameId id = 0; id < names.size(); ++id)
+		{
+			if (counts[id] != 0 && !names[id].empty()) used.push_back(id);
+		}
+		std::sort(used.begin(), used.end(), [&](VmdMotion::NameId a, VmdMotion::NameId b) {
+			return names[a] < names[b];
+				  });
+
+		std::vector<std::uint32_t> trackOf(names.size(), NoTrack);
+		tracks.clear();
+		tracks.resize(used.size());
+		for (size_t i = 0; i < used.size(); ++i)
+		{
+			const auto id = used[i];
+			trackOf[id] = static_cast<std::uint32_t>(i);
+			tracks[i].name = names[id];
+			tracks[i].nameId = id;
+			tracks[i].frames.reserve(counts[id]);
+		}
+		return trackOf;
+	}
+
+	// ファイル順のキーをフレーム順に並べ替える。
+	// 通常の VMD はボーンごとに既に昇順なので、その場合は何もしない。
+	template <class... Arrays>
+	void SortTrackByFrame(std::vector<std::uint32_t>& frames, Arrays&... arrays)
+	{
+		if (std::is_sorted(frames.begin(), frames.end())) return;
+
+		std::vector<std::uint32_t> order(frames.size());
+		std::iota(order.begin(), order.end(), 0u);
+		std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+			return frames[a] < frames[b];
+						 });
+
+		auto permute = [&](auto& v) {
+			std::remove_reference_t<decltype(v)> sorted;
+			sorted.reserve(v.size());
+			for (auto i : order) sorted.push_back(v[i]);
+			v = std::move(sorted);
+			};
+		permute(frames);
+		(permute(arrays), ...);
 	}
 }
 
@@ -37,21 +193,32 @@ bool VmdMotion::Load(const std::filesystem::path& vmdPath)
 {
 	m_path = vmdPath;
 
+	m_names.clear();
+	m_curves.clear();
+	m_compiledCurves.clear();
+
+	m_boneTracks.clear();
+	m_morphTracks.clear();
 	m_boneKeys.clear();
 	m_morphKeys.clear();
+	m_boneKeysBuilt = false;
+	m_morphKeysBuilt = false;
+	m_maxFrame = 0;
+
 	m_cameraKeys.clear();
 	m_lightKeys.clear();
 	m_shadowKeys.clear();
 	m_ikKeys.clear();
 
 	BinaryReader br(vmdPath);
+	NameInterner names(m_names);
 
 	std::string stage = "begin";
 	try
 	{
 		// header string (30 bytes)
 		stage = "header";
-		auto headerBytes = br.ReadBytes(30);
+		auto headerBytes = br.ReadSpan(30);
 		auto headerStr = AsciiZ(headerBytes);
 
 		const bool isOld = (headerStr == "Vocaloid Motion Data file");
@@ -66,7 +233,7 @@ bool VmdMotion::Load(const std::filesystem::path& vmdPath)
 		// old: 10 bytes, new: 20 bytes  (per common VMD docs)
 		stage = "modelName";
 		const size_t modelNameLen = isOld ? 10 : 20;
-		(void)br.ReadBytes(modelNameLen);
+		br.Skip(modelNameLen);
 
 		// bone key count
 		stage = "boneCount";
@@ -74,29 +241,24 @@ bool VmdMotion::Load(const std::filesystem::path& vmdPath)
 
 		// sanity check (111 bytes per bone key)
 		{
-			constexpr size_t BoneRecSize = 15 + 4 + 12 + 16 + 64; // 111
 			if (static_cast<size_t>(boneCount) > br.Remaining() / BoneRecSize)
 			{
 				throw std::runtime_error("Invalid boneCount (file is likely malformed or version mismatch).");
 			}
 		}
 
-		m_boneKeys.reserve(boneCount);
+		// 1 回目は名前だけ読んでキー数を数え、2 回目でトラックへ直接書き込む
 		stage = "boneKeys";
-		for (std::uint32_t i = 0; i < boneCount; ++i)
 		{
-			BoneKey k{};
-			auto nameBytes = br.ReadBytes(15);
-			k.boneName = SjisBytesToW(nameBytes);
-
-			k.frame = br.Read<std::uint32_t>();
-			k.tx = br.Read<float>(); k.ty = br.Read<float>(); k.tz = br.Read<float>();
-			k.qx = br.Read<float>(); k.qy = br.Read<float>(); k.qz = br.Read<float>(); k.qw = br.Read<float>();
-
-			auto interpBytes = br.ReadBytes(64);
-			std::memcpy(k.interp, interpBytes.data(), 64);
-
-			m_boneKeys.push_back(std::move(k));
+			const size_t sectionPos = br.Position();
+			std::vector<NameId> keyNames(boneCount);
+			for (std::uint32_t i = 0; i < boneCount; ++i)
+			{
+				keyNames[i] = names.Intern(br.ReadSpan(15));
+				br.Skip(BoneRecSize - 15);
+			}
+			br.Seek(sectionPos);
+			ReadBoneTracks(br, keyNames);
 		}
 
 		// morph key count
@@ -105,29 +267,29 @@ bool VmdMotion::Load(const std::filesystem::path& vmdPath)
 
 		// sanity check (23 bytes per morph key)
 		{
-			constexpr size_t MorphRecSize = 15 + 4 + 4; // 23
 			if (static_cast<size_t>(morphCount) > br.Remaining() / MorphRecSize)
 			{
 				throw std::runtime_error("Invalid morphCount (file is likely malformed or version mismatch).");
 			}
 		}
 
-		m_morphKeys.reserve(morphCount);
 		stage = "morphKeys";
-		for (std::uint32_t i = 0; i < morphCount; ++i)
 		{
-			MorphKey k{};
-			auto nameBytes = br.ReadBytes(15);
-			k.morphName = SjisBytesToW(nameBytes);
-			k.frame = br.Read<std::uint32_t>();
-			k.weight = br.Read<float>();
-			m_morphKeys.push_back(std::move(k));
+			const size_t sectionPos = br.Position();
+			std::vector<NameId> keyNames(morphCount);
+			for (std::uint32_t i = 0; i < morphCount; ++i)
+			{
+				keyNames[i] = names.Intern(br.ReadSpan(15));
+				br.Skip(MorphRecSize - 15);
+			}
+			br.Seek(sectionPos);
+			ReadMorphTracks(br, keyNames);
 		}
 
 		// camera section (optional if file ends)
 		if (br.Remaining() < 4)
 		{
-			BuildTracks();
+			FinishLoad();
 			return true;
 		}
 
@@ -152,8 +314,7 @@ bool VmdMotion::Load(const std::filesystem::path& vmdPath)
 			k.distance = br.Read<float>();
 			k.posX = br.Read<float>(); k.posY = br.Read<float>(); k.posZ = br.Read<float>();
 			k.rotX = br.Read<float>(); k.rotY = br.Read<float>(); k.rotZ = br.Read<float>();
-			auto interpBytes = br.ReadBytes(24);
-			std::memcpy(k.interp, interpBytes.data(), 24);
+			br.ReadArray(k.interp, 24);
 			k.viewAngle = br.Read<std::uint32_t>();
 			k.perspective = br.Read<std::uint8_t>() == 0;
 			m_cameraKeys.push_back(std::move(k));
@@ -162,7 +323,7 @@ bool VmdMotion::Load(const std::filesystem::path& vmdPath)
 		// light section (optional if file ends)
 		if (br.Remaining() < 4)
 		{
-			BuildTracks();
+			FinishLoad();
 			return true;
 		}
 
@@ -192,7 +353,7 @@ bool VmdMotion::Load(const std::filesystem::path& vmdPath)
 		// shadow section (optional if file ends)
 		if (br.Remaining() < 4)
 		{
-			BuildTracks();
+			FinishLoad();
 			return true;
 		}
 
@@ -222,7 +383,7 @@ bool VmdMotion::Load(const std::filesystem::path& vmdPath)
 		// ik section (optional if file ends)
 		if (br.Remaining() < 4)
 		{
-			BuildTracks();
+			FinishLoad();
 			return true;
 		}
 
@@ -243,15 +404,14 @@ bool VmdMotion::Load(const std::filesystem::path& vmdPath)
 			for (std::uint32_t j = 0; j < ikStateCount; ++j)
 			{
 				IkState state{};
-				auto nameBytes = br.ReadBytes(20);
-				state.name = SjisBytesToW(nameBytes);
+				state.nameId = names.Intern(br.ReadSpan(20));
 				state.enabled = br.Read<std::uint8_t>() != 0;
 				k.states.push_back(std::move(state));
 			}
 			m_ikKeys.push_back(std::move(k));
 		}
 
-		BuildTracks();
+		FinishLoad();
 		return true;
 	}
 	catch (const std::exception& e)
@@ -265,73 +425,149 @@ bool VmdMotion::Load(const std::filesystem::path& vmdPath)
 	}
 }
 
-void VmdMotion::BuildTracks()
+void VmdMotion::ReadBoneTracks(BinaryReader& br, const std::vector<NameId>& keyNames)
 {
-	m_boneTracks.clear();
-	m_morphTracks.clear();
-	m_maxFrame = 0;
-
-	auto sortBone = m_boneKeys;
-	auto sortMorph = m_morphKeys;
-
-	std::sort(sortBone.begin(), sortBone.end(), [](const BoneKey& a, const BoneKey& b) {
-		if (a.boneName == b.boneName) return a.frame < b.frame;
-		return a.boneName < b.boneName;
-			  });
+	const auto trackOf = AllocateTracks(m_names, keyNames, m_boneTracks);
+	for (auto& track : m_boneTracks)
+	{
+		const size_t n = track.frames.capacity();
+		track.translations.reserve(n);
+		track.rotations.reserve(n);
+		track.curveIds.reserve(n);
+	}
 
-	std::sort(sortMorph.begin(), sortMorph.end(), [](const MorphKey& a, const MorphKey& b) {
-		if (a.morphName == b.morphName) return a.frame < b.frame;
-		return a.morphName < b.morphName;
-			  });
+	CurveInterner curves(m_curves);
+	for (const auto id : keyNames)
+	{
+		br.Skip(15);
+		const auto frame = br.Read<std::uint32_t>();
+		m_maxFrame = std::max(m_maxFrame, frame);
 
-	auto pushBoneTrack = [&](std::wstring current, std::vector<BoneKey>&& keys) {
-		if (!current.empty() && !keys.empty())
+		const auto trackIndex = trackOf[id];
+		if (trackIndex == NoTrack)
 		{
-			m_boneTracks.push_back({ std::move(current), std::move(keys) });
+			br.Skip(BoneRecSize - 15 - 4);
+			continue;
 		}
-		};
 
-	std::wstring currentBone;
-	std::vector<BoneKey> currentBoneKeys;
-	for (auto& k : sortBone)
+		auto& track = m_boneTracks[trackIndex];
+		track.frames.push_back(frame);
+		track.translations.push_back(br.Read<DirectX::XMFLOAT3>());
+		track.rotations.push_back(br.Read<DirectX::XMFLOAT4>());
+		track.curveIds.push_back(curves.Intern(br.ReadSpan(64)));
+	}
+
+	for (auto& track : m_boneTracks)
 	{
-		m_maxFrame = std::max(m_maxFrame, k.frame);
+		SortTrackByFrame(track.frames, track.translations, track.rotations, track.curveIds);
+	}
+}
 
-		if (currentBone != k.boneName)
-		{
-			pushBoneTrack(std::move(currentBone), std::move(currentBoneKeys));
-			currentBone = k.boneName;
-			currentBoneKeys.clear();
-		}
-		currentBoneKeys.push_back(std::move(k));
+void VmdMotion::ReadMorphTracks(BinaryReader& br, const std::vector<NameId>& keyNames)
+{
+	const auto trackOf = AllocateTracks(m_names, keyNames, m_morphTracks);
+	for (auto& track : m_morphTracks)
+	{
+		track.weights.reserve(track.frames.capacity());
 	}
-	pushBoneTrack(std::move(currentBone), std::move(currentBoneKeys));
 
-	auto pushMorphTrack = [&](std::wstring current, std::vector<MorphKey>&& keys) {
-		if (!current.empty() && !keys.empty())
-		{
-			m_morphTracks.push_back({ std::move(current), std::move(keys) });
-		}
-		};
+	for (const auto id : keyNames)
+	{
+		br.Skip(15);
+		const auto frame = br.Read<std::uint32_t>();
+		const auto weight = br.Read<float>();
+		m_maxFrame = std::max(m_maxFrame, frame);
 
-	std::wstring currentMorph;
-	std::vector<MorphKey> currentMorphKeys;
-	for (auto& k : sortMorph)
+		const auto trackIndex = trackOf[id];
+		if (trackIndex == NoTrack) continue;
+
+		auto& track = m_morphTracks[trackIndex];
+		track.frames.push_back(frame);
+		track.weights.push_back(weight);
+	}
+
+	for (auto& track : m_morphTracks)
 	{
-		m_maxFrame = std::max(m_maxFrame, k.frame);
+		SortTrackByFrame(track.frames, track.weights);
+	}
+}
 
-		if (currentMorph != k.morphName)
-		{
-			pushMorphTrack(std::move(currentMorph), std::move(currentMorphKeys));
-			currentMorph = k.morphName;
-			currentMorphKeys.clear();
-		}
-		currentMorphKeys.push_back(std::move(k));
+void VmdMotion::FinishLoad()
+{
+	// 曲線は数が少ないので全セクションを読み終えてからまとめて前計算する
+	m_compiledCurves.clear();
+	m_compiledCurves.reserve(m_curves.size());
+	for (const auto& c : m_curves)
+	{
+		m_compiledCurves.emplace_back(c.x1, c.y1, c.x2, c.y2);
 	}
-	pushMorphTrack(std::move(currentMorph), std::move(currentMorphKeys));
 
 	for (const auto& k : m_cameraKeys) m_maxFrame = std::max(m_maxFrame, k.frame);
 	for (const auto& k : m_lightKeys)  m_maxFrame = std::max(m_maxFrame, k.frame);
 	for (const auto& k : m_shadowKeys) m_maxFrame = std::max(m_maxFrame, k.frame);
 	for (const auto& k : m_ikKeys)     m_maxFrame = std::max(m_maxFrame, k.frame);
+
+	// IK の有効/無効は段階的に切り替わるだけなので、フレーム順に並んでいれば直前のキーを引くだけで済む
+	std::stable_sort(m_ikKeys.begin(), m_ikKeys.end(),
+					 [](const IkKey& a, const IkKey& b) { return a.frame < b.frame; });
+}
+
+const std::vector<VmdMotion::BoneKey>& VmdMotion::BoneKeys() const
+{
+	if (m_boneKeysBuilt) return m_boneKeys;
+
+	size_t total = 0;
+	for (const auto& track : m_boneTracks) total += track.KeyCount();
+	m_boneKeys.clear();
+	m_boneKeys.reserve(total);
+
+	for (const auto& track : m_boneTracks)
+	{
+		for (size_t i = 0; i < track.KeyCount(); ++i)
+		{
+			BoneKey k{};
+			k.nameId = track.nameId;
+			k.frame = track.frames[i];
+			k.tx = track.translations[i].x; k.ty = track.translations[i].y; k.tz = track.translations[i].z;
+			k.qx = track.rotations[i].x; k.qy = track.rotations[i].y; k.qz = track.rotations[i].z; k.qw = track.rotations[i].w;
+
+			// VMD と同じく 16 バイトの行を 1 バイトずつずらして 4 行並べる
+			const auto& c = m_curves[track.curveIds[i]];
+			std::uint8_t row[16]{};
+			std::memcpy(row + 0, c.x1, 4);
+			std::memcpy(row + 4, c.y1, 4);
+			std::memcpy(row + 8, c.x2, 4);
+			std::memcpy(row + 12, c.y2, 4);
+			for (int ch = 0; ch < 4; ++ch)
+			{
+				std::memcpy(k.interp + ch * 16, row + ch, 16 - ch);
+			}
+
+			m_boneKeys.push_back(k);
+		}
+	}
+
+	m_boneKeysBuilt = true;
+	return m_boneKeys;
+}
+
+const std::vector<VmdMotion::MorphKey>& VmdMotion::MorphKeys() const
+{
+	if (m_morphKeysBuilt) return m_morphKeys;
+
+	size_t total = 0;
+	for (const auto& track : m_morphTracks) total += track.KeyCount();
+	m_morphKeys.clear();
+	m_morphKeys.reserve(total);
+
+	for (const auto& track : m_morphTracks)
+	{
+		for (size_t i = 0; i < track.KeyCount(); ++i)
+		{
+			m_morphKeys.push_back({ track.nameId, track.frames[i], track.weights[i] });
+		}
+	}
+
+	m_morphKeysBuilt = true;
+	return m_morphKeys;
 }
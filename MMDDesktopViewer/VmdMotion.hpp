@@ -4,13 +4,34 @@
 #include <vector>
 #include <cstdint>
 #include <unordered_map>
+#include <DirectXMath.h>
+#include "MotionCurve.hpp"
+
+class BinaryReader;
 
 class VmdMotion
 {
 public:
+	// モーション内で一意化した名前の ID (Name() で文字列を引く)
+	using NameId = std::uint32_t;
+	// 一意化した補間曲線の ID (Curve() で引く)
+	using CurveId = std::uint32_t;
+
+	// ボーンキーの補間曲線。添字はチャンネル (0:X 1:Y 2:Z 3:回転)、値は 0..127。
+	// VMD の 64 バイトの補間データのうち、実際に参照する 16 バイトだけを持つ。
+	struct BezierCurve
+	{
+		std::uint8_t x1[4]{};
+		std::uint8_t y1[4]{};
+		std::uint8_t x2[4]{};
+		std::uint8_t y2[4]{};
+
+		bool operator==(const BezierCurve&) const = default;
+	};
+
 	struct BoneKey
 	{
-		std::wstring boneName;
+		NameId nameId{};
 		std::uint32_t frame{};
 		float tx{}, ty{}, tz{};
 		float qx{}, qy{}, qz{}, qw{};
@@ -19,7 +40,7 @@ public:
 
 	struct MorphKey
 	{
-		std::wstring morphName;
+		NameId nameId{};
 		std::uint32_t frame{};
 		float weight{};
 	};
@@ -51,7 +72,7 @@ public:
 
 	struct IkState
 	{
-		std::wstring name;
+		NameId nameId{};
 		bool enabled{};
 	};
 
@@ -62,28 +83,65 @@ public:
 		std::vector<IkState> states;
 	};
 
+	// キーはフレーム昇順。各配列の同じ添字が 1 つのキーを表す。
 	struct BoneTrack
 	{
 		std::wstring name;
-		std::vector<BoneKey> keys;
+		NameId nameId{};
+		std::vector<std::uint32_t> frames;
+		std::vector<DirectX::XMFLOAT3> translations;
+		std::vector<DirectX::XMFLOAT4> rotations;
+		std::vector<CurveId> curveIds;
+
+		size_t KeyCount() const
+		{
+			return frames.size();
+		}
 	};
 
 	struct MorphTrack
 	{
 		std::wstring name;
-		std::vector<MorphKey> keys;
+		NameId nameId{};
+		std::vector<std::uint32_t> frames;
+		std::vector<float> weights;
+
+		size_t KeyCount() const
+		{
+			return frames.size();
+		}
 	};
 
 	bool Load(const std::filesystem::path& vmdPath);
 
-	const std::vector<BoneKey>& BoneKeys() const
+	const std::wstring& Name(NameId id) const
+	{
+		return m_names[id];
+	}
+	const std::vector<std::wstring>& Names() const
+	{
+		return m_names;
+	}
+
+	const BezierCurve& Curve(CurveId id) const
+	{
+		return m_curves[id];
+	}
+	const std::vector<BezierCurve>& Curves() const
 	{
-		return m_boneKeys;
+		return m_curves;
 	}
-	const std::vector<MorphKey>& MorphKeys() const
+	// 読み込み時に前計算した評価用の曲線 (Curve() と同じ ID)
+	const MotionCurve& CompiledCurve(CurveId id) const
 	{
-		return m_morphKeys;
+		return m_compiledCurves[id];
 	}
+
+	// 互換用のフラットなキー列。初回呼び出し時にトラックから組み立てる (トラック順・フレーム順)。
+	// 組み立てはスレッドセーフではないので、複数スレッドから使う場合は先に 1 回呼んでおくこと。
+	const std::vector<BoneKey>& BoneKeys() const;
+	const std::vector<MorphKey>& MorphKeys() const;
+
 	const std::vector<BoneTrack>& BoneTracks() const
 	{
 		return m_boneTracks;
@@ -108,6 +166,7 @@ public:
 		return m_shadowKeys;
 	}
 
+	// フレーム昇順
 	const std::vector<IkKey>& IkKeys() const
 	{
 		return m_ikKeys;
@@ -119,10 +178,14 @@ public:
 	}
 
 private:
-	void BuildTracks();
+	void ReadBoneTracks(BinaryReader& br, const std::vector<NameId>& keyNames);
+	void ReadMorphTracks(BinaryReader& br, const std::vector<NameId>& keyNames);
+	void FinishLoad();
+
 	std::filesystem::path m_path;
-	std::vector<BoneKey> m_boneKeys;
-	std::vector<MorphKey> m_morphKeys;
+	std::vector<std::wstring> m_names;
+	std::vector<BezierCurve> m_curves;
+	std::vector<MotionCurve> m_compiledCurves;
 	std::vector<CameraKey> m_cameraKeys;
 	std::vector<LightKey> m_lightKeys;
 	std::vector<ShadowKey> m_shadowKeys;
@@ -131,4 +194,9 @@ private:
 	std::vector<BoneTrack> m_boneTracks;
 	std::vector<MorphTrack> m_morphTracks;
 	uint32_t m_maxFrame{};
+
+	mutable std::vector<BoneKey> m_boneKeys;
+	mutable std::vector<MorphKey> m_morphKeys;
+	mutable bool m_boneKeysBuilt{ false };
+	mutable bool m_morphKeysBuilt{ false };
 };
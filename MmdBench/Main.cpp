@@ -0,0 +1,1070 @@
+﻿// mmd_bench: 描画なしで MmdAnimator を回し、Tick の段階ごとの所要時間を集計する。
+//
+//   mmd_bench <model.pmx> [motion.vmd] [--frames N] [--warmup N] [--dt 秒]
+//             [--no-physics] [--no-ik-cache] [--idle] [--cpu-skinning] [--threads N] [--sleep 速さ] [--async-physics]
+//             [--self-check] [--json <出力先|->]
+//   mmd_bench --synthetic-bodies N [motion.vmd] [...]
+//
+// --synthetic-bodies は、剛体 N 個の鎖をぶら下げただけのモデルを一時ファイルに作って計る (物理の規模を変えて比べる用)。
+// --async-physics は物理を専用スレッドで回す。物理スレッドは実時間で進むので、Tick も dt ごとに実時間で刻む
+// (表の tick は Tick 自体の時間で、待ち時間は含まない)。
+// --self-check は計測の代わりに、描画用の頂点ストリーム (PmxVertexStreams) の配置とボーンウェイトの整形を確かめ、
+// 3x4 ボーンパレット (WriteSkinningPalette) を 4x4 のスキニング行列を転置したものと突き合わせる
+// (差分書き込みと capacity の制限も含む)。
+// GPU を使わないので、シミュレーション部分だけをビルドすれば Linux でも動く。
+// 終了コード: 0 成功 / 1 引数エラー / 2 読み込み失敗 / 3 自己検査の不一致
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "CpuSkinner.hpp"
+#include "JobSystem.hpp"
+#include "MmdAnimator.hpp"
+#include "PhysicsThread.hpp"
+#include "PmxModelCache.hpp"
+#include "PmxVertexStreams.hpp"
+#include "TickProfile.hpp"
+
+namespace
+{
+	struct Options
+	{
+		std::filesystem::path modelPath;
+		std::filesystem::path motionPath;
+		int syntheticBodies{ 0 };   // 1 以上なら modelPath の代わりに合成モデルを使う
+		int frames{ 600 };
+		int warmup{ 60 };
+		double dt{ 1.0 / 60.0 };
+		bool physics{ true };
+		bool ikCache{ true };
+		bool idle{ false };     // 待機中の常駐を想定 (呼吸・まばたき・視線)
+		bool cpuSkinning{ false };  // Tick のあとに全頂点を CPU でスキニングして計る
+		int threads{ 0 };       // 0 なら JobSystem の既定 (論理コア数)
+		float sleepSpeed{ -1.0f };  // 0 以上なら剛体の島を眠らせる速さ (線速度・角速度とも)
+		bool asyncPhysics{ false }; // 物理を専用スレッドで回す (PhysicsSettings::asyncPhysics)
+		bool selfCheck{ false };    // 計測せずにボーンパレットを検査する
+		bool json{ false };
+		std::string jsonPath;   // "-" なら標準出力
+	};
+
+	struct Summary
+	{
+		double mean{};
+		double p50{};
+		double p95{};
+		double p99{};
+		double max{};
+	};
+
+	// ジョブ名ごとの実行回数と合計時間
+	struct JobStat
+	{
+		std::uint64_t count{};
+		std::uint64_t items{};
+		double busyUs{};
+	};
+
+	void PrintUsage()
+	{
+		std::cerr <<
+			"Usage: mmd_bench <model.pmx> [motion.vmd] [options]\n"
+			"       mmd_bench --synthetic-bodies N [motion.vmd] [options]\n"
+			"  --synthetic-bodies N  generate a model with N dynamic rigid bodies in hanging chains\n"
+			"  --frames N      measured frames (default 600)\n"
+			"  --warmup N      frames run before measuring (default 60)\n"
+			"  --dt SECONDS    fixed tick length (default 1/60)\n"
+			"  --no-physics    disable rigid body simulation\n"
+			"  --no-ik-cache   always re-solve IK chains\n"
+			"  --idle          enable breathing, auto blink and a fixed look-at target\n"
+			"  --cpu-skinning  also skin every vertex on the CPU after each tick\n"
+			"  --threads N     job system concurrency including the main thread (default: all cores)\n"
+			"  --sleep SPEED   linear/angular speed below which physics islands fall asleep (default: settings)\n"
+			"  --async-physics run physics on its own thread; ticks are paced to dt in real time\n"
+			"  --self-check    instead of measuring, verify the vertex streams and the packed 3x4 bone palette\n"
+			"  --json PATH     write the report as JSON (\"-\" for stdout)\n";
+	}
+
+	bool ParseArgs(int argc, char** argv, Options& opt)
+	{
+		std::vector<std::string_view> positional;
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string_view a = argv[i];
+			auto next = [&]() -> const char* {
+				return (i + 1 < argc) ? argv[++i] : nullptr;
+			};
+
+			if (a == "--frames" || a == "--warmup" || a == "--dt" || a == "--threads" || a == "--sleep" || a == "--json" ||
+				a == "--synthetic-bodies")
+			{
+				const char* v = next();
+				if (!v)
+				{
+					std::cerr << "Missing value for " << a << "\n";
+					return false;
+				}
+				if (a == "--frames") opt.frames = std::atoi(v);
+				else if (a == "--warmup") opt.warmup = std::atoi(v);
+				else if (a == "--dt") opt.dt = std::atof(v);
+				else if (a == "--threads") opt.threads = std::atoi(v);
+				else if (a == "--sleep") opt.sleepSpeed = static_cast<float>(std::atof(v));
+				else if (a == "--synthetic-bodies") opt.syntheticBodies = std::atoi(v);
+				else
+				{
+					opt.json = true;
+					opt.jsonPath = v;
+				}
+			}
+			else if (a == "--no-physics")
+			{
+				opt.physics = false;
+			}
+			else if (a == "--no-ik-cache")
+			{
+				opt.ikCache = false;
+			}
+			else if (a == "--idle")
+			{
+				opt.idle = true;
+			}
+			else if (a == "--cpu-skinning")
+			{
+				opt.cpuSkinning = true;
+			}
+			else if (a == "--async-physics")
+			{
+				opt.asyncPhysics = true;
+			}
+			else if (a == "--self-check")
+			{
+				opt.selfCheck = true;
+			}
+			else if (a.starts_with("--"))
+			{
+				std::cerr << "Unknown option: " << a << "\n";
+				return false;
+			}
+			else
+			{
+				positional.push_back(a);
+			}
+		}
+
+		if (opt.frames <= 0 || opt.warmup < 0 || !(opt.dt > 0.0) || opt.threads < 0 || opt.syntheticBodies < 0)
+		{
+			std::cerr << "Invalid --frames/--warmup/--dt/--threads/--synthetic-bodies\n";
+			return false;
+		}
+
+		// 合成モデルのときは位置引数はモーションだけ
+		if (opt.syntheticBodies > 0)
+		{
+			if (positional.size() > 1) return false;
+			if (!positional.empty()) opt.motionPath = std::filesystem::path(positional[0]);
+			return true;
+		}
+
+		if (positional.empty() || positional.size() > 2) return false;
+		opt.modelPath = std::filesystem::path(positional[0]);
+		if (positional.size() > 1) opt.motionPath = std::filesystem::path(positional[1]);
+		return true;
+	}
+
+	// 物理だけを重くした PMX を書き出す (面・材質・モーフなし)。
+	// 鎖 1 本は根元のボーン追従剛体と、その先に斜めに垂れた動的剛体 kChainLength 個。
+	// 鎖は格子状に並べ、揺れて隣の鎖と少し触れる程度の間隔にする。
+	// 頂点は --self-check でボーンウェイトの整形を通すためのもので、ウェイトの種類と崩れ方ごとに 1 つずつ置く
+	bool WriteSyntheticModel(const std::filesystem::path& path, int bodyCount)
+	{
+		constexpr int kChainLength = 8;
+		constexpr float kLinkLength = 0.6f;
+		constexpr float kRadius = 0.25f;
+		constexpr float kRowSpacing = 0.7f;
+		constexpr float kColumnSpacing = 1.5f;
+		constexpr float kTilt = 0.6f;   // 鉛直からの傾き (ラジアン)
+
+		const int chainCount = (bodyCount + kChainLength - 1) / kChainLength;
+		const int columns = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(chainCount)))));
+
+		std::string out;
+		auto bytes = [&](const void* p, size_t n) { out.append(static_cast<const char*>(p), n); };
+		auto u8 = [&](std::uint8_t v) { bytes(&v, 1); };
+		auto u16 = [&](std::uint16_t v) { bytes(&v, 2); };
+		auto i32 = [&](std::int32_t v) { bytes(&v, 4); };
+		auto f32 = [&](float v) { bytes(&v, 4); };
+		auto vec3 = [&](float x, float y, float z) { f32(x); f32(y); f32(z); };
+		auto text = [&](std::string_view ascii) {
+			i32(static_cast<std::int32_t>(ascii.size() * 2));
+			for (char c : ascii) u16(static_cast<std::uint16_t>(c));
+		};
+
+		struct Bone
+		{
+			float x, y, z;
+			int parent;
+		};
+		struct RigidBody
+		{
+			int bone;
+			int group;      // 根元は 0、鎖は市松模様に 1 か 2 (同じ鎖の中と、斜め隣の鎖とは当たらない)
+			bool dynamic;
+		};
+		std::vector<Bone> bones{ { 0.0f, 0.0f, 0.0f, -1 } };
+		std::vector<RigidBody> bodies;
+		std::vector<std::pair<int, int>> joints;
+
+		int remaining = bodyCount;
+		for (int c = 0; c < chainCount; ++c)
+		{
+			const float x0 = static_cast<float>(c % columns) * kColumnSpacing;
+			const float z0 = static_cast<float>(c / columns) * kRowSpacing;
+			const float y0 = 20.0f;
+
+			const int group = 1 + (c % columns + c / columns) % 2;
+
+			bones.push_back({ x0, y0, z0, 0 });
+			bodies.push_back({ static_cast<int>(bones.size()) - 1, 0, false });
+
+			const int links = std::min(kChainLength, remaining);
+			remaining -= links;
+			for (int j = 1; j <= links; ++j)
+			{
+				const float d = kLinkLength * static_cast<float>(j);
+				bones.push_back({ x0 + d * std::sin(kTilt), y0 - d * std::cos(kTilt), z0, static_cast<int>(bones.size()) - 1 });
+				bodies.push_back({ static_cast<int>(bones.size()) - 1, group, true });
+				joints.emplace_back(static_cast<int>(bodies.size()) - 2, static_cast<int>(bodies.size()) - 1);
+			}
+		}
+
+		// ヘッダ: UTF-16、追加 UV なし、インデックスはすべて 4 バイト
+		out.append("PMX ", 4);
+		f32(2.0f);
+		u8(8);
+		for (int v : { 0, 0, 4, 4, 4, 4, 4, 4 }) u8(static_cast<std::uint8_t>(v));
+		text("synthetic");
+		text("synthetic");
+		text("");
+		text("");
+
+		// 頂点: BDEF1 / BDEF2 / BDEF4 / SDEF と、正規化されていない・範囲外のボーン・ウェイトがほぼ 0 のもの
+		struct Vertex
+		{
+			std::uint8_t type;
+			std::int32_t bones[4];
+			float weights[4];       // BDEF2 / SDEF は先頭だけ使う
+		};
+		const auto boneCount = static_cast<std::int32_t>(bones.size());
+		auto bone = [&](std::int32_t i) { return i % boneCount; };
+		const Vertex vertices[] = {
+			{ 0, { bone(1) }, {} },
+			{ 1, { bone(1), bone(2) }, { 0.25f } },
+			{ 1, { bone(1), bone(2) }, { 1.0f } },
+			{ 2, { bone(0), bone(1), bone(2), bone(3) }, { 0.5f, 0.5f, 0.5f, 0.5f } },
+			{ 2, { bone(1), boneCount + 3, bone(2), -1 }, { 0.3f, 0.4f, 0.3f, 0.0f } },
+			{ 2, { bone(1), bone(2), bone(3), bone(0) }, { 1.0e-4f, 2.0e-4f, 0.0f, -0.5f } },
+			{ 2, { bone(1), bone(2), -1, -1 }, { 0.0f, 0.0f, 0.0f, 0.0f } },
+			{ 3, { bone(1), bone(2) }, { 0.7f } },
+			{ 3, { bone(2), bone(1) }, { 0.0f } },
+		};
+		i32(static_cast<std::int32_t>(std::size(vertices)));
+		for (size_t i = 0; i < std::size(vertices); ++i)
+		{
+			const Vertex& v = vertices[i];
+			const float t = static_cast<float>(i);
+			vec3(t, 10.0f + t, -t);
+			vec3(0.0f, 1.0f, 0.0f);
+			f32(t * 0.125f);
+			f32(1.0f - t * 0.125f);
+			u8(v.type);
+			switch (v.type)
+			{
+				case 0:
+					i32(v.bones[0]);
+					break;
+				case 1:
+				case 3:
+					i32(v.bones[0]);
+					i32(v.bones[1]);
+					f32(v.weights[0]);
+					if (v.type == 3)
+					{
+						vec3(t, 10.0f, 0.0f);       // C
+						vec3(t, 10.5f, 0.0f);       // R0
+						vec3(t, 9.5f, 0.0f);        // R1
+					}
+					break;
+				default:
+					for (std::int32_t b : v.bones) i32(b);
+					for (float w : v.weights) f32(w);
+					break;
+			}
+			f32(1.0f);              // エッジ倍率
+		}
+
+		i32(0);     // 面
+		i32(0);     // テクスチャ
+		i32(0);     // 材質
+
+		i32(static_cast<std::int32_t>(bones.size()));
+		for (size_t i = 0; i < bones.size(); ++i)
+		{
+			text("b" + std::to_string(i));
+			text("");
+			vec3(bones[i].x, bones[i].y, bones[i].z);
+			i32(bones[i].parent);
+			i32(0);                 // 変形階層
+			u16(0x001E);            // 回転・移動・表示・操作
+			vec3(0.0f, -kLinkLength, 0.0f);
+		}
+
+		i32(0);     // モーフ
+		i32(0);     // 表示枠
+
+		i32(static_cast<std::int32_t>(bodies.size()));
+		for (size_t i = 0; i < bodies.size(); ++i)
+		{
+			const Bone& bone = bones[static_cast<size_t>(bodies[i].bone)];
+			text("r" + std::to_string(i));
+			text("");
+			i32(bodies[i].bone);
+			u8(static_cast<std::uint8_t>(bodies[i].group));
+			u16(static_cast<std::uint16_t>(0xFFFF ^ (1u << bodies[i].group)));
+			u8(0);                  // 球
+			vec3(kRadius, 0.0f, 0.0f);
+			vec3(bone.x, bone.y, bone.z);
+			vec3(0.0f, 0.0f, 0.0f);
+			f32(1.0f);              // 質量
+			f32(0.5f);              // 移動減衰
+			f32(0.5f);              // 回転減衰
+			f32(0.0f);              // 反発
+			f32(0.5f);              // 摩擦
+			u8(bodies[i].dynamic ? 1 : 0);
+		}
+
+		i32(static_cast<std::int32_t>(joints.size()));
+		for (size_t i = 0; i < joints.size(); ++i)
+		{
+			const auto [a, b] = joints[i];
+			const Bone& bone = bones[static_cast<size_t>(bodies[static_cast<size_t>(b)].bone)];
+			text("j" + std::to_string(i));
+			text("");
+			u8(0);                  // バネ付き 6DOF
+			i32(a);
+			i32(b);
+			vec3(bone.x, bone.y, bone.z);
+			vec3(0.0f, 0.0f, 0.0f);
+			vec3(0.0f, 0.0f, 0.0f);
+			vec3(0.0f, 0.0f, 0.0f);
+			vec3(-1.0f, -1.0f, -1.0f);
+			vec3(1.0f, 1.0f, 1.0f);
+			vec3(0.0f, 0.0f, 0.0f);
+			vec3(0.0f, 0.0f, 0.0f);
+		}
+
+		std::ofstream ofs(path, std::ios::binary);
+		if (!ofs) return false;
+		ofs.write(out.data(), static_cast<std::streamsize>(out.size()));
+		return static_cast<bool>(ofs);
+	}
+
+	// 合成モデルと、読み込み時に作られたキャッシュを消す
+	void RemoveSyntheticModel(const std::filesystem::path& path)
+	{
+		std::error_code ec;
+		std::filesystem::remove(path, ec);
+		std::filesystem::remove(PmxModelCache::CachePathFor(path), ec);
+	}
+
+	Summary Summarize(std::vector<double> samples)
+	{
+		Summary s;
+		if (samples.empty()) return s;
+
+		std::sort(samples.begin(), samples.end());
+		double sum = 0.0;
+		for (double v : samples) sum += v;
+
+		// 最近傍順位 (nearest-rank) 法
+		auto percentile = [&](double p) {
+			const size_t n = samples.size();
+			size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(n)));
+			rank = std::clamp<size_t>(rank, 1, n);
+			return samples[rank - 1];
+		};
+
+		s.mean = sum / static_cast<double>(samples.size());
+		s.p50 = percentile(50.0);
+		s.p95 = percentile(95.0);
+		s.p99 = percentile(99.0);
+		s.max = samples.back();
+		return s;
+	}
+
+	std::string PathToUtf8(const std::filesystem::path& p)
+	{
+		const auto u8 = p.u8string();
+		return std::string(reinterpret_cast<const char*>(u8.data()), u8.size());
+	}
+
+	std::string EscapeJson(std::string_view s)
+	{
+		std::string o;
+		o.reserve(s.size() + 8);
+		for (char c : s)
+		{
+			switch (c)
+			{
+				case '\"': o += "\\\""; break;
+				case '\\': o += "\\\\"; break;
+				case '\n': o += "\\n"; break;
+				case '\r': o += "\\r"; break;
+				case '\t': o += "\\t"; break;
+				default:
+					if (static_cast<unsigned char>(c) < 0x20)
+					{
+						char buf[8];
+						std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(static_cast<unsigned char>(c)));
+						o += buf;
+					}
+					else
+					{
+						o += c;
+					}
+					break;
+			}
+		}
+		return o;
+	}
+
+	std::string FormatNumber(double v)
+	{
+		char buf[32];
+		std::snprintf(buf, sizeof(buf), "%.3f", v);
+		return buf;
+	}
+
+	// 4x4 のスキニング行列を転置した 3x4 (シェーダーの float4x3 と同じ並び)。
+	// 最終列が (0, 0, 0, 1) でなければ 3x4 に詰められないので false
+	bool TransposeTo3x4(const DirectX::XMFLOAT4X4& m, DirectX::XMFLOAT3X4& out)
+	{
+		for (int r = 0; r < 3; ++r)
+		{
+			for (int c = 0; c < 4; ++c) out.m[r][c] = m.m[c][r];
+		}
+		constexpr float Tolerance = 1.0e-5f;
+		return std::abs(m.m[0][3]) <= Tolerance && std::abs(m.m[1][3]) <= Tolerance &&
+			std::abs(m.m[2][3]) <= Tolerance && std::abs(m.m[3][3] - 1.0f) <= Tolerance;
+	}
+
+	// 書かれていない要素を見分けるための値 (NaN のビット列)
+	void FillSentinel(std::vector<DirectX::XMFLOAT3X4>& palette)
+	{
+		std::memset(palette.data(), 0xFF, palette.size() * sizeof(DirectX::XMFLOAT3X4));
+	}
+	bool IsSentinel(const DirectX::XMFLOAT3X4& m)
+	{
+		DirectX::XMFLOAT3X4 sentinel;
+		std::memset(&sentinel, 0xFF, sizeof(sentinel));
+		return std::memcmp(&m, &sentinel, sizeof(m)) == 0;
+	}
+	bool SameBits(const DirectX::XMFLOAT3X4& a, const DirectX::XMFLOAT3X4& b)
+	{
+		return std::memcmp(&a, &b, sizeof(a)) == 0;
+	}
+
+	// PmxVertexStreams::Build の結果を検査する。
+	//  - 2 つのストリームの大きさと各要素の位置が、入力レイアウト (シェーダーの VSInput) の想定どおり
+	//  - 位置・UV・法線・ウェイトの種類・SDEF のパラメータがそのまま写っている
+	//  - ボーンウェイトは範囲内でウェイトが正のものだけが元の枠に残り、合計 1 に正規化され、
+	//    残りの枠は -1 / 0 で埋まっている。有効なウェイトの合計がほぼ 0 なら最初の有効なボーンだけが 1
+	int RunVertexStreamSelfCheck(const PmxModel& model)
+	{
+		using PmxVertexStreams::DynamicVertex;
+		using PmxVertexStreams::StaticVertex;
+
+		auto fail = [](const char* what, size_t vertex) {
+			std::fprintf(stderr, "self-check failed at vertex %zu: %s\n", vertex, what);
+			return 3;
+		};
+
+		struct Field
+		{
+			const char* name;
+			size_t offset;
+			size_t expected;
+		};
+		const Field layout[] = {
+			{ "DynamicVertex stride", sizeof(DynamicVertex), 20 },
+			{ "DynamicVertex::px", offsetof(DynamicVertex, px), 0 },
+			{ "DynamicVertex::u", offsetof(DynamicVertex, u), 12 },
+			{ "StaticVertex stride", sizeof(StaticVertex), 84 },
+			{ "StaticVertex::nx", offsetof(StaticVertex, nx), 0 },
+			{ "StaticVertex::boneIndices", offsetof(StaticVertex, boneIndices), 12 },
+			{ "StaticVertex::boneWeights", offsetof(StaticVertex, boneWeights), 28 },
+			{ "StaticVertex::sdefC", offsetof(StaticVertex, sdefC), 44 },
+			{ "StaticVertex::sdefR0", offsetof(StaticVertex, sdefR0), 56 },
+			{ "StaticVertex::sdefR1", offsetof(StaticVertex, sdefR1), 68 },
+			{ "StaticVertex::weightType", offsetof(StaticVertex, weightType), 80 },
+		};
+		for (const Field& f : layout)
+		{
+			if (f.offset != f.expected)
+			{
+				std::fprintf(stderr, "self-check failed: %s is %zu, expected %zu\n", f.name, f.offset, f.expected);
+				return 3;
+			}
+		}
+
+		std::vector<DynamicVertex> dynamicStream;
+		std::vector<StaticVertex> staticStream;
+		PmxVertexStreams::Build(model, dynamicStream, staticStream);
+
+		const auto& vertices = model.Vertices();
+		const size_t boneCount = model.Bones().size();
+		if (dynamicStream.size() != vertices.size() || staticStream.size() != vertices.size())
+		{
+			return fail("stream length differs from the vertex count", vertices.size());
+		}
+
+		size_t typeCounts[5]{};
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			const PmxModel::Vertex& v = vertices[i];
+			const DynamicVertex& dv = dynamicStream[i];
+			const StaticVertex& sv = staticStream[i];
+
+			if (dv.px != v.px || dv.py != v.py || dv.pz != v.pz || dv.u != v.u || dv.v != v.v)
+			{
+				return fail("position or UV not copied", i);
+			}
+			if (sv.nx != v.nx || sv.ny != v.ny || sv.nz != v.nz) return fail("normal not copied", i);
+			if (sv.weightType != v.weight.type) return fail("weight type not copied", i);
+			if (v.weight.type < std::size(typeCounts)) ++typeCounts[v.weight.type];
+
+			const bool sdef = (v.weight.type == 3);
+			const float sdefParams[9] = {
+				v.weight.sdefC.x, v.weight.sdefC.y, v.weight.sdefC.z,
+				v.weight.sdefR0.x, v.weight.sdefR0.y, v.weight.sdefR0.z,
+				v.weight.sdefR1.x, v.weight.sdefR1.y, v.weight.sdefR1.z,
+			};
+			const float* streamParams[3] = { sv.sdefC, sv.sdefR0, sv.sdefR1 };
+			for (int k = 0; k < 9; ++k)
+			{
+				if (streamParams[k / 3][k % 3] != (sdef ? sdefParams[k] : 0.0f)) return fail("SDEF parameters not copied", i);
+			}
+
+			// 元のウェイトのうち残るはずの枠
+			bool valid[4]{};
+			float total = 0.0f;
+			int first = -1;
+			for (int k = 0; k < 4; ++k)
+			{
+				const std::int32_t b = v.weight.boneIndices[k];
+				valid[k] = (b >= 0 && static_cast<size_t>(b) < boneCount && v.weight.weights[k] > 0.0f);
+				if (!valid[k]) continue;
+				total += v.weight.weights[k];
+				if (first < 0) first = k;
+			}
+
+			float sum = 0.0f;
+			for (int k = 0; k < 4; ++k)
+			{
+				const std::int32_t b = sv.boneIndices[k];
+				const float w = sv.boneWeights[k];
+				if (b < 0)
+				{
+					if (b != -1 || w != 0.0f) return fail("unused slot not padded with -1 / 0", i);
+					continue;
+				}
+				if (static_cast<size_t>(b) >= boneCount) return fail("bone index out of range", i);
+				if (!(w > 0.0f)) return fail("used slot has no weight", i);
+				sum += w;
+			}
+
+			for (int k = 0; k < 4; ++k)
+			{
+				std::int32_t expectedBone = -1;
+				float expectedWeight = 0.0f;
+				if (total > 0.001f)
+				{
+					if (valid[k])
+					{
+						expectedBone = v.weight.boneIndices[k];
+						expectedWeight = v.weight.weights[k] / total;
+					}
+				}
+				else if (first >= 0 && k == 0)
+				{
+					expectedBone = v.weight.boneIndices[first];
+					expectedWeight = 1.0f;
+				}
+				if (sv.boneIndices[k] != expectedBone) return fail("wrong bone kept in slot", i);
+				if (std::abs(sv.boneWeights[k] - expectedWeight) > 1.0e-6f) return fail("weight not normalized", i);
+			}
+			if (first >= 0 && std::abs(sum - 1.0f) > 1.0e-5f) return fail("weights do not sum to 1", i);
+		}
+
+		std::printf("self-check: %zu vertices (BDEF1 %zu, BDEF2 %zu, BDEF4 %zu, SDEF %zu, QDEF %zu), streams %zu + %zu bytes: OK\n",
+					vertices.size(), typeCounts[0], typeCounts[1], typeCounts[2], typeCounts[3], typeCounts[4],
+					sizeof(DynamicVertex), sizeof(StaticVertex));
+		return 0;
+	}
+
+	// WriteSkinningPalette を毎フレーム次の点で検査する。
+	//  - 全体書き込み (sinceRevision = 0) が全ボーンを書き、転置した 4x4 と一致する
+	//  - 前回の番号からの差分書き込みは変化範囲の外に触れず、書いた本数を正しく返し、
+	//    それを重ねた写しが全体と一致する (変化の取りこぼしがない)
+	//  - 物理なしなら、4x4 が前のフレームと同じボーンは書かない
+	//    (物理ありでは Tick の中で物理の前後に 2 回更新されるので、途中で変わって元に戻ったボーンも書かれる)
+	//  - capacity より先には書かない
+	int RunPaletteSelfCheck(MmdAnimator& animator, const Options& opt)
+	{
+		const size_t boneCount = animator.GetBoneCount();
+		std::vector<DirectX::XMFLOAT3X4> expected(boneCount);
+		std::vector<DirectX::XMFLOAT3X4> mirror(boneCount);
+		std::vector<DirectX::XMFLOAT3X4> scratch(boneCount);
+		std::vector<DirectX::XMFLOAT4X4> previous(boneCount);
+		std::uint64_t mirrorRevision = 0;
+		std::uint64_t partialWrites = 0;
+		std::uint64_t partialBones = 0;
+
+		auto fail = [&](int frame, const char* what, size_t bone) {
+			std::fprintf(stderr, "self-check failed at frame %d, bone %zu: %s\n", frame, bone, what);
+			return 3;
+		};
+
+		for (int frame = 0; frame < opt.frames; ++frame)
+		{
+			animator.Tick(opt.dt);
+
+			const auto& matrices = animator.GetSkinningMatrices();
+			for (size_t i = 0; i < boneCount; ++i)
+			{
+				if (!TransposeTo3x4(matrices[i], expected[i])) return fail(frame, "last column is not (0, 0, 0, 1)", i);
+			}
+
+			// 全体
+			FillSentinel(scratch);
+			const size_t fullCount = animator.WriteSkinningPalette(scratch.data(), boneCount, 0);
+			if (fullCount != boneCount) return fail(frame, "full write did not write every bone", fullCount);
+			for (size_t i = 0; i < boneCount; ++i)
+			{
+				if (!SameBits(scratch[i], expected[i])) return fail(frame, "full write differs from the transposed 4x4", i);
+			}
+
+			// 差分 (初回は写しが空なので全体と同じ扱い)
+			const std::uint64_t revision = animator.SkinningRevision();
+			size_t rangeBegin = 0, rangeEnd = 0;
+			const bool changed = animator.GetSkinningChangedRange(mirrorRevision, rangeBegin, rangeEnd);
+			FillSentinel(scratch);
+			const size_t partialCount = animator.WriteSkinningPalette(scratch.data(), boneCount, mirrorRevision);
+			size_t touched = 0;
+			for (size_t i = 0; i < boneCount; ++i)
+			{
+				if (IsSentinel(scratch[i])) continue;
+				if (!changed || i < rangeBegin || i >= rangeEnd) return fail(frame, "partial write outside the changed range", i);
+				if (!SameBits(scratch[i], expected[i])) return fail(frame, "partial write differs from the transposed 4x4", i);
+				if (!opt.physics && mirrorRevision != 0 &&
+					std::memcmp(&previous[i], &matrices[i], sizeof(DirectX::XMFLOAT4X4)) == 0)
+				{
+					return fail(frame, "partial write touched an unchanged bone", i);
+				}
+				mirror[i] = scratch[i];
+				++touched;
+			}
+			if (touched != partialCount) return fail(frame, "partial write count does not match the bones written", partialCount);
+			for (size_t i = 0; i < boneCount; ++i)
+			{
+				if (!SameBits(mirror[i], expected[i])) return fail(frame, "partial writes missed a changed bone", i);
+			}
+			if (mirrorRevision != 0)
+			{
+				++partialWrites;
+				partialBones += partialCount;
+			}
+			mirrorRevision = revision;
+			std::copy(matrices.begin(), matrices.begin() + static_cast<std::ptrdiff_t>(boneCount), previous.begin());
+
+			// capacity の制限
+			const size_t capacity = boneCount / 2;
+			FillSentinel(scratch);
+			animator.WriteSkinningPalette(scratch.data(), capacity, 0);
+			for (size_t i = capacity; i < boneCount; ++i)
+			{
+				if (!IsSentinel(scratch[i])) return fail(frame, "write past capacity", i);
+			}
+		}
+
+		std::printf("self-check: %d frames, %zu bones, %.1f bones per partial write: OK\n", opt.frames, boneCount,
+					partialWrites ? static_cast<double>(partialBones) / static_cast<double>(partialWrites) : 0.0);
+		return 0;
+	}
+
+	void AppendSummaryJson(std::ostringstream& os, const Summary& s)
+	{
+		os << "{\"mean_us\":" << FormatNumber(s.mean)
+			<< ",\"p50_us\":" << FormatNumber(s.p50)
+			<< ",\"p95_us\":" << FormatNumber(s.p95)
+			<< ",\"p99_us\":" << FormatNumber(s.p99)
+			<< ",\"max_us\":" << FormatNumber(s.max) << "}";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options opt;
+	if (!ParseArgs(argc, argv, opt))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	JobSystem& jobs = JobSystem::Shared();
+	if (opt.threads > 0) jobs.SetWorkerCount(static_cast<unsigned>(opt.threads - 1));
+
+	using Clock = std::chrono::steady_clock;
+	auto elapsedMs = [](Clock::time_point a, Clock::time_point b) {
+		return std::chrono::duration<double, std::milli>(b - a).count();
+	};
+
+	MmdAnimator animator;
+	animator.SetPhysicsEnabled(opt.physics);
+	animator.SetIkCacheEnabled(opt.ikCache);
+	if (opt.sleepSpeed >= 0.0f || opt.asyncPhysics)
+	{
+		PhysicsSettings physics = animator.GetPhysicsSettings();
+		if (opt.sleepSpeed >= 0.0f)
+		{
+			physics.sleepLinearSpeed = opt.sleepSpeed;
+			physics.sleepAngularSpeed = opt.sleepSpeed;
+		}
+		physics.asyncPhysics = opt.asyncPhysics;
+		animator.SetPhysicsSettings(physics);
+	}
+	if (opt.idle)
+	{
+		animator.SetBreathingEnabled(true);
+		animator.SetAutoBlinkEnabled(true);
+		animator.SetLookAtState(true, 0.3f, 0.1f);
+	}
+
+	if (opt.syntheticBodies > 0)
+	{
+		std::error_code ec;
+		opt.modelPath = std::filesystem::temp_directory_path(ec) /
+			("mmd_bench_synthetic_" + std::to_string(opt.syntheticBodies) + ".pmx");
+		if (ec || !WriteSyntheticModel(opt.modelPath, opt.syntheticBodies))
+		{
+			std::cerr << "Failed to write synthetic model: " << PathToUtf8(opt.modelPath) << "\n";
+			return 2;
+		}
+	}
+
+	double modelLoadMs = 0.0;
+	double motionLoadMs = 0.0;
+	try
+	{
+		const auto t0 = Clock::now();
+		const bool modelLoaded = animator.LoadModel(opt.modelPath);
+		if (opt.syntheticBodies > 0) RemoveSyntheticModel(opt.modelPath);
+		if (!modelLoaded)
+		{
+			std::cerr << "Failed to load model: " << PathToUtf8(opt.modelPath) << "\n";
+			return 2;
+		}
+		const auto t1 = Clock::now();
+		modelLoadMs = elapsedMs(t0, t1);
+
+		if (!opt.motionPath.empty())
+		{
+			if (!animator.LoadMotion(opt.motionPath))
+			{
+				std::cerr << "Failed to load motion: " << PathToUtf8(opt.motionPath) << "\n";
+				return 2;
+			}
+			motionLoadMs = elapsedMs(t1, Clock::now());
+		}
+	}
+	catch (const std::exception& e)
+	{
+		if (opt.syntheticBodies > 0) RemoveSyntheticModel(opt.modelPath);
+		std::cerr << "Load error: " << e.what() << "\n";
+		return 2;
+	}
+
+	if (opt.selfCheck)
+	{
+		// 合成モデルのボーンには物理後フラグがなく、そのままでは物理の結果が書き戻されない。
+		// 揺れる鎖のボーンだけが変わるようにして、差分書き込みを検査できるようにする
+		if (opt.syntheticBodies > 0)
+		{
+			PhysicsSettings physics = animator.GetPhysicsSettings();
+			physics.requireAfterPhysicsFlag = false;
+			animator.SetPhysicsSettings(physics);
+		}
+		if (const int rc = RunVertexStreamSelfCheck(*animator.Model()); rc != 0) return rc;
+		return RunPaletteSelfCheck(animator, opt);
+	}
+
+	CpuSkinner skinner;
+	if (opt.cpuSkinning) skinner.Initialize(animator.Model());
+
+	// 非同期物理のときは Tick を dt ごとに実時間で刻む
+	const auto frameDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.dt));
+	Clock::time_point nextFrame = Clock::now();
+	auto pace = [&]() {
+		if (!opt.asyncPhysics) return;
+		nextFrame += frameDuration;
+		std::this_thread::sleep_until(nextFrame);
+	};
+
+	for (int i = 0; i < opt.warmup; ++i)
+	{
+		pace();
+		animator.Tick(opt.dt);
+	}
+
+	TickProfile profile;
+	animator.SetProfile(&profile);
+
+	std::mutex jobStatsMutex;
+	std::map<std::string, JobStat> jobStats;
+	jobs.SetTimingHook([&](const JobSystem::TaskTiming& t) {
+		const double us = std::chrono::duration<double, std::micro>(t.end - t.begin).count();
+		std::lock_guard lock(jobStatsMutex);
+		auto& stat = jobStats[t.name ? t.name : "?"];
+		++stat.count;
+		stat.items += t.items;
+		stat.busyUs += us;
+	});
+
+	constexpr size_t StageCount = TickProfile::StageCount;
+	std::vector<std::vector<double>> stageSamples(StageCount);
+	std::vector<double> totalSamples;
+	std::vector<double> skinningSamples;
+	for (auto& v : stageSamples) v.reserve(static_cast<size_t>(opt.frames));
+	totalSamples.reserve(static_cast<size_t>(opt.frames));
+	if (opt.cpuSkinning) skinningSamples.reserve(static_cast<size_t>(opt.frames));
+	std::uint64_t subStepTotal = 0;
+	std::uint64_t bodySubStepTotal = 0;
+	std::uint64_t pairsAddedTotal = 0;
+	std::uint64_t pairsRemovedTotal = 0;
+	std::uint64_t candidatePairTotal = 0;
+	std::uint64_t contactTotal = 0;
+	std::uint64_t ikHitTotal = 0;
+	std::uint64_t ikMissTotal = 0;
+
+	// 物理スレッドの計測は開始からの累計なので、計測区間の前後の差をとる
+	auto physicsThreadStats = [&](std::uint64_t& steps, double& seconds) {
+		const PhysicsThread* thread = animator.GetPhysicsThread();
+		steps = thread ? thread->StepCount() : 0;
+		seconds = thread ? thread->StepSeconds() : 0.0;
+	};
+	std::uint64_t asyncStepsBegin = 0, asyncStepsEnd = 0;
+	double asyncSecondsBegin = 0.0, asyncSecondsEnd = 0.0;
+	physicsThreadStats(asyncStepsBegin, asyncSecondsBegin);
+	const auto measureBegin = Clock::now();
+
+	for (int i = 0; i < opt.frames; ++i)
+	{
+		profile.Reset();
+		pace();
+
+		const auto t0 = Clock::now();
+		animator.Tick(opt.dt);
+		const auto t1 = Clock::now();
+
+		totalSamples.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+		for (size_t s = 0; s < StageCount; ++s)
+		{
+			stageSamples[s].push_back(profile.seconds[s] * 1.0e6);
+		}
+		subStepTotal += profile.physicsSubSteps;
+		bodySubStepTotal += profile.physicsBodySubSteps;
+		pairsAddedTotal += profile.physicsPairsAdded;
+		pairsRemovedTotal += profile.physicsPairsRemoved;
+		candidatePairTotal += profile.physicsCandidatePairs;
+		contactTotal += profile.physicsContacts;
+		ikHitTotal += profile.ikCacheHits;
+		ikMissTotal += profile.ikCacheMisses;
+
+		if (opt.cpuSkinning)
+		{
+			const auto t2 = Clock::now();
+			skinner.Skin(animator.GetSkinningMatrices());
+			skinningSamples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - t2).count());
+		}
+	}
+	physicsThreadStats(asyncStepsEnd, asyncSecondsEnd);
+	const double measureSeconds = std::chrono::duration<double>(Clock::now() - measureBegin).count();
+	const std::uint64_t asyncSteps = asyncStepsEnd - asyncStepsBegin;
+	const double asyncStepMs = asyncSteps ? (asyncSecondsEnd - asyncSecondsBegin) * 1.0e3 / static_cast<double>(asyncSteps) : 0.0;
+	const double asyncStepsPerSecond = measureSeconds > 0.0 ? static_cast<double>(asyncSteps) / measureSeconds : 0.0;
+	animator.SetProfile(nullptr);
+	jobs.SetTimingHook({});
+
+	const PmxModel* model = animator.Model();
+	const VmdMotion* motion = animator.Motion();
+	const double subStepsPerFrame = static_cast<double>(subStepTotal) / static_cast<double>(opt.frames);
+	auto perSubStep = [&](std::uint64_t total) {
+		return subStepTotal ? static_cast<double>(total) / static_cast<double>(subStepTotal) : 0.0;
+	};
+	const double awakeBodiesPerSubStep = perSubStep(bodySubStepTotal);
+	const std::uint64_t ikSolveTotal = ikHitTotal + ikMissTotal;
+	const double ikHitRate = ikSolveTotal ? static_cast<double>(ikHitTotal) / static_cast<double>(ikSolveTotal) : 0.0;
+
+	std::vector<Summary> stageSummaries(StageCount);
+	for (size_t s = 0; s < StageCount; ++s) stageSummaries[s] = Summarize(stageSamples[s]);
+	const Summary totalSummary = Summarize(totalSamples);
+	const Summary skinningSummary = Summarize(skinningSamples);
+
+	if (opt.json)
+	{
+		std::ostringstream os;
+		os << "{\"model\":\"" << EscapeJson(PathToUtf8(opt.modelPath)) << "\"";
+		os << ",\"motion\":\"" << EscapeJson(PathToUtf8(opt.motionPath)) << "\"";
+		os << ",\"bones\":" << (model ? model->Bones().size() : 0);
+		os << ",\"vertices\":" << (model ? model->Vertices().size() : 0);
+		os << ",\"morphs\":" << (model ? model->Morphs().size() : 0);
+		os << ",\"rigid_bodies\":" << (model ? model->RigidBodies().size() : 0);
+		os << ",\"joints\":" << (model ? model->Joints().size() : 0);
+		os << ",\"bone_tracks\":" << (motion ? motion->BoneTracks().size() : 0);
+		os << ",\"morph_tracks\":" << (motion ? motion->MorphTracks().size() : 0);
+		os << ",\"frames\":" << opt.frames;
+		os << ",\"warmup\":" << opt.warmup;
+		os << ",\"dt\":" << opt.dt;
+		os << ",\"physics\":" << (opt.physics ? "true" : "false");
+		os << ",\"idle\":" << (opt.idle ? "true" : "false");
+		os << ",\"threads\":" << jobs.Concurrency();
+		os << ",\"fork_join_us\":" << FormatNumber(jobs.ForkJoinNanoseconds() * 1.0e-3);
+		os << ",\"model_load_ms\":" << FormatNumber(modelLoadMs);
+		os << ",\"motion_load_ms\":" << FormatNumber(motionLoadMs);
+		os << ",\"physics_substeps_per_frame\":" << FormatNumber(subStepsPerFrame);
+		os << ",\"physics_awake_bodies_per_substep\":" << FormatNumber(awakeBodiesPerSubStep);
+		os << ",\"physics_pairs_added_per_substep\":" << FormatNumber(perSubStep(pairsAddedTotal));
+		os << ",\"physics_pairs_removed_per_substep\":" << FormatNumber(perSubStep(pairsRemovedTotal));
+		os << ",\"physics_candidate_pairs_per_substep\":" << FormatNumber(perSubStep(candidatePairTotal));
+		os << ",\"physics_contacts_per_substep\":" << FormatNumber(perSubStep(contactTotal));
+		os << ",\"async_physics\":" << (opt.asyncPhysics ? "true" : "false");
+		os << ",\"async_physics_steps\":" << asyncSteps;
+		os << ",\"async_physics_steps_per_second\":" << FormatNumber(asyncStepsPerSecond);
+		os << ",\"async_physics_step_ms\":" << FormatNumber(asyncStepMs);
+		os << ",\"ik_cache\":" << (opt.ikCache ? "true" : "false");
+		os << ",\"ik_cache_hits\":" << ikHitTotal;
+		os << ",\"ik_cache_misses\":" << ikMissTotal;
+		os << ",\"stages\":{";
+		for (size_t s = 0; s < StageCount; ++s)
+		{
+			if (s) os << ",";
+			os << "\"" << TickProfile::StageName(static_cast<TickStage>(s)) << "\":";
+			AppendSummaryJson(os, stageSummaries[s]);
+		}
+		os << "},\"tick\":";
+		AppendSummaryJson(os, totalSummary);
+		if (opt.cpuSkinning)
+		{
+			os << ",\"cpu_skinning\":";
+			AppendSummaryJson(os, skinningSummary);
+		}
+		os << ",\"jobs\":{";
+		bool firstJob = true;
+		for (const auto& [name, stat] : jobStats)
+		{
+			if (!firstJob) os << ",";
+			firstJob = false;
+			os << "\"" << EscapeJson(name) << "\":{\"count\":" << stat.count
+				<< ",\"items\":" << stat.items
+				<< ",\"busy_us_per_frame\":" << FormatNumber(stat.busyUs / static_cast<double>(opt.frames)) << "}";
+		}
+		os << "}}\n";
+
+		if (opt.jsonPath == "-")
+		{
+			std::cout << os.str();
+		}
+		else
+		{
+			std::ofstream ofs(opt.jsonPath, std::ios::binary);
+			if (!ofs)
+			{
+				std::cerr << "Failed to open " << opt.jsonPath << "\n";
+				return 1;
+			}
+			ofs << os.str();
+		}
+	}
+
+	// JSON を標準出力に出す場合は表を混ぜない
+	if (opt.json && opt.jsonPath == "-") return 0;
+
+	std::printf("model   : %s (%zu bones, %zu morphs, %zu bodies, %zu joints) load %.2f ms\n",
+				PathToUtf8(opt.modelPath).c_str(),
+				model ? model->Bones().size() : 0, model ? model->Morphs().size() : 0,
+				model ? model->RigidBodies().size() : 0, model ? model->Joints().size() : 0,
+				modelLoadMs);
+	if (motion)
+	{
+		std::printf("motion  : %s (%zu bone tracks, %zu morph tracks) load %.2f ms\n",
+					PathToUtf8(opt.motionPath).c_str(),
+					motion->BoneTracks().size(), motion->MorphTracks().size(), motionLoadMs);
+	}
+	std::printf("frames  : %d (+%d warmup), dt %.6f s, physics %s%s, %.2f substeps/frame, %.1f awake bodies/substep\n",
+				opt.frames, opt.warmup, opt.dt, opt.physics ? "on" : "off", opt.idle ? ", idle layers" : "",
+				subStepsPerFrame, awakeBodiesPerSubStep);
+	if (opt.physics && opt.asyncPhysics)
+	{
+		std::printf("async   : %llu physics steps on its own thread (%.1f steps/s, %.3f ms/step)\n",
+					static_cast<unsigned long long>(asyncSteps), asyncStepsPerSecond, asyncStepMs);
+	}
+	else if (opt.physics)
+	{
+		std::printf("contacts: %.1f candidate pairs/substep, %.1f hits/substep, pairs +%.2f/-%.2f per substep\n",
+					perSubStep(candidatePairTotal), perSubStep(contactTotal),
+					perSubStep(pairsAddedTotal), perSubStep(pairsRemovedTotal));
+	}
+	std::printf("jobs    : %u threads, fork/join %.2f us\n",
+				jobs.Concurrency(), jobs.ForkJoinNanoseconds() * 1.0e-3);
+	std::printf("ik cache: %s, %llu hits / %llu misses (%.1f%%)\n\n",
+				opt.ikCache ? "on" : "off", static_cast<unsigned long long>(ikHitTotal),
+				static_cast<unsigned long long>(ikMissTotal), ikHitRate * 100.0);
+
+	std::printf("%-18s %10s %10s %10s %10s %10s\n", "stage (us)", "mean", "p50", "p95", "p99", "max");
+	auto printRow = [](const char* name, const Summary& s) {
+		std::printf("%-18s %10.2f %10.2f %10.2f %10.2f %10.2f\n", name, s.mean, s.p50, s.p95, s.p99, s.max);
+	};
+	for (size_t s = 0; s < StageCount; ++s)
+	{
+		printRow(TickProfile::StageName(static_cast<TickStage>(s)), stageSummaries[s]);
+	}
+	printRow("tick", totalSummary);
+	if (opt.cpuSkinning) printRow("cpu_skinning", skinningSummary);
+
+	if (!jobStats.empty())
+	{
+		std::printf("\n%-18s %10s %10s %14s\n", "job", "count", "items", "busy us/frame");
+		for (const auto& [name, stat] : jobStats)
+		{
+			std::printf("%-18s %10llu %10llu %14.2f\n", name.c_str(), static_cast<unsigned long long>(stat.count),
+						static_cast<unsigned long long>(stat.items), stat.busyUs / static_cast<double>(opt.frames));
+		}
+	}
+
+	return 0;
+}
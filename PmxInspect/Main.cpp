@@ -13,11 +13,17 @@
 #include <vector>
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <cmath>
+#include <cwctype>
+#include <chrono>
 
 #include "PmxModel.hpp"
 #include "PmxLoader.hpp"
 #include "BinaryReader.hpp"
+#include "PmxModelCache.hpp"
+#include "VmdMotion.hpp"
+#include "MotionCurve.hpp"
 
 using namespace std;
 
@@ -527,6 +533,246 @@ static void PrintUsage()
 {
     std::wcout << L"Usage:\n";
     std::wcout << L"  PmxInspect.exe <model.pmx> [--out <dir>] [--filter <substring>]\n";
+    std::wcout << L"  PmxInspect.exe --build-cache <model.pmx|dir>... [--force]\n";
+    std::wcout << L"  PmxInspect.exe --bench-curves [motion.vmd]\n";
+}
+
+static bool IsPmxFile(const std::filesystem::path& p)
+{
+    auto ext = p.extension().wstring();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](wchar_t c) { return (wchar_t)towlower(c); });
+    return ext == L".pmx";
+}
+
+// 指定したモデル/フォルダ配下の PMX について .pmxc キャッシュを事前に作る
+static int RunBuildCache(int argc, wchar_t** argv)
+{
+    Logger logger;
+    std::vector<std::filesystem::path> inputs;
+    bool force = false;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        std::wstring a = argv[i];
+        if (a == L"--force") force = true;
+        else inputs.emplace_back(a);
+    }
+
+    if (inputs.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<std::filesystem::path> files;
+    for (const auto& in : inputs)
+    {
+        std::error_code ec;
+        if (std::filesystem::is_directory(in, ec))
+        {
+            auto opts = std::filesystem::directory_options::skip_permission_denied;
+            for (auto it = std::filesystem::recursive_directory_iterator(in, opts, ec);
+                 !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+            {
+                if (it->is_regular_file(ec) && IsPmxFile(it->path())) files.push_back(it->path());
+            }
+        }
+        else if (std::filesystem::is_regular_file(in, ec) && IsPmxFile(in))
+        {
+            files.push_back(in);
+        }
+        else
+        {
+            logger.PrintErrLn(std::string("Not a PMX file or directory: ") + PathToUtf8(in));
+        }
+    }
+
+    size_t built = 0, skipped = 0, failed = 0;
+    for (const auto& path : files)
+    {
+        if (!force && PmxModelCache::IsUpToDate(path))
+        {
+            ++skipped;
+            logger.PrintLn(std::string("[skip ] ") + PathToUtf8(path));
+            continue;
+        }
+
+        PmxModel model;
+        try
+        {
+            if (!PmxLoader::ParseModel(path, model))
+            {
+                ++failed;
+                logger.PrintErrLn(std::string("[fail ] ") + PathToUtf8(path) + " : parse returned false");
+                continue;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            ++failed;
+            logger.PrintErrLn(std::string("[fail ] ") + PathToUtf8(path) + " : " + e.what());
+            continue;
+        }
+
+        if (PmxModelCache::Save(path, model))
+        {
+            ++built;
+            logger.PrintLn(std::string("[built] ") + PathToUtf8(PmxModelCache::CachePathFor(path)));
+        }
+        else
+        {
+            ++failed;
+            logger.PrintErrLn(std::string("[fail ] ") + PathToUtf8(path) + " : could not write cache");
+        }
+    }
+
+    logger.PrintLn("Cache: built=" + std::to_string(built) + " skipped=" + std::to_string(skipped) +
+                   " failed=" + std::to_string(failed));
+    return failed ? 4 : 0;
+}
+
+// 前計算した補間曲線 (MotionCurve) と従来の二分法を比較し、誤差と速度を表示する。
+// 制御点を 8 刻みで総当たりした曲線に加え、VMD を指定した場合はその曲線も使う。
+static int RunBenchCurves(int argc, wchar_t** argv)
+{
+    Logger logger;
+    constexpr float Tolerance = 1.0e-4f;
+    constexpr int TSteps = 256;
+
+    struct Source
+    {
+        std::uint8_t x1[4], y1[4], x2[4], y2[4];
+    };
+    std::vector<Source> sources;
+
+    // 各レーンに別々の制御点を割り当てる
+    {
+        Source cur{};
+        int lane = 0;
+        for (int a = 0; a < 128; a += 8)
+            for (int b = 0; b < 128; b += 8)
+                for (int c = 0; c < 128; c += 8)
+                    for (int d = 0; d < 128; d += 8)
+                    {
+                        cur.x1[lane] = (std::uint8_t)a;
+                        cur.y1[lane] = (std::uint8_t)b;
+                        cur.x2[lane] = (std::uint8_t)c;
+                        cur.y2[lane] = (std::uint8_t)d;
+                        if (++lane == 4)
+                        {
+                            sources.push_back(cur);
+                            lane = 0;
+                        }
+                    }
+    }
+
+    if (argc >= 3)
+    {
+        std::filesystem::path vmdPath = argv[2];
+        VmdMotion motion;
+        try
+        {
+            motion.Load(vmdPath);
+        }
+        catch (const std::exception& e)
+        {
+            logger.PrintErrLn(std::string("Exception while loading VMD: ") + e.what());
+            return 2;
+        }
+
+        for (const auto& c : motion.Curves())
+        {
+            Source src{};
+            std::memcpy(src.x1, c.x1, 4);
+            std::memcpy(src.y1, c.y1, 4);
+            std::memcpy(src.x2, c.x2, 4);
+            std::memcpy(src.y2, c.y2, 4);
+            sources.push_back(src);
+        }
+        logger.PrintLn(std::string("vmd: ") + PathToUtf8(vmdPath) + " curves=" + std::to_string(motion.Curves().size()));
+    }
+
+    std::vector<MotionCurve> curves;
+    curves.reserve(sources.size());
+    size_t linearCount = 0;
+    for (const auto& src : sources)
+    {
+        curves.emplace_back(src.x1, src.y1, src.x2, src.y2);
+        if (curves.back().IsLinear()) ++linearCount;
+    }
+
+    // 誤差
+    float maxError = 0.0f;
+    size_t worstCurve = 0;
+    for (size_t i = 0; i < curves.size(); ++i)
+    {
+        const auto& src = sources[i];
+        for (int k = 0; k <= TSteps; ++k)
+        {
+            const float t = (float)k / (float)TSteps;
+            DirectX::XMFLOAT4 v;
+            DirectX::XMStoreFloat4(&v, curves[i].Evaluate(t));
+            const float lanes[4] = { v.x, v.y, v.z, v.w };
+            for (int ch = 0; ch < 4; ++ch)
+            {
+                const float ref = MotionCurve::EvaluateBisection(t,
+                    src.x1[ch] / 127.0f, src.y1[ch] / 127.0f, src.x2[ch] / 127.0f, src.y2[ch] / 127.0f);
+                const float err = std::abs(lanes[ch] - ref);
+                if (err > maxError)
+                {
+                    maxError = err;
+                    worstCurve = i;
+                }
+            }
+        }
+    }
+
+    // 速度 (1 キー = 4 チャンネル)
+    using Clock = std::chrono::steady_clock;
+    volatile float sink = 0.0f;
+
+    auto t0 = Clock::now();
+    for (size_t i = 0; i < curves.size(); ++i)
+    {
+        const auto& src = sources[i];
+        float acc = 0.0f;
+        for (int k = 1; k < TSteps; ++k)
+        {
+            const float t = (float)k / (float)TSteps;
+            for (int ch = 0; ch < 4; ++ch)
+            {
+                acc += MotionCurve::EvaluateBisection(t,
+                    src.x1[ch] / 127.0f, src.y1[ch] / 127.0f, src.x2[ch] / 127.0f, src.y2[ch] / 127.0f);
+            }
+        }
+        sink = sink + acc;
+    }
+    auto t1 = Clock::now();
+    for (size_t i = 0; i < curves.size(); ++i)
+    {
+        DirectX::XMVECTOR acc = DirectX::XMVectorZero();
+        for (int k = 1; k < TSteps; ++k)
+        {
+            acc = DirectX::XMVectorAdd(acc, curves[i].Evaluate((float)k / (float)TSteps));
+        }
+        sink = sink + DirectX::XMVectorGetX(acc);
+    }
+    auto t2 = Clock::now();
+
+    const double keys = (double)curves.size() * (TSteps - 1);
+    const double bisectNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / keys;
+    const double compiledNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / keys;
+
+    std::ostringstream ss;
+    ss << "curves=" << curves.size() << " (linear=" << linearCount << ") samples/curve=" << (TSteps + 1) << "\n";
+    ss << "max |compiled - bisection| = " << maxError << " (tolerance " << Tolerance << ")";
+    if (maxError > 0.0f) ss << " worst curve #" << worstCurve;
+    ss << "\n";
+    ss << "bisection: " << bisectNs << " ns/key, compiled: " << compiledNs << " ns/key";
+    if (compiledNs > 0.0) ss << " (x" << (bisectNs / compiledNs) << ")";
+    logger.PrintLn(ss.str());
+
+    return (maxError <= Tolerance) ? 0 : 6;
 }
 
 int wmain(int argc, wchar_t** argv)
@@ -539,6 +785,15 @@ int wmain(int argc, wchar_t** argv)
         return 1;
     }
 
+    if (std::wstring(argv[1]) == L"--build-cache")
+    {
+        return RunBuildCache(argc, argv);
+    }
+    if (std::wstring(argv[1]) == L"--bench-curves")
+    {
+        return RunBenchCurves(argc, argv);
+    }
+
     std::filesystem::path pmxPath = argv[1];
     std::filesystem::path outDir;
     std::wstring filter;